@@ -1116,53 +1116,20 @@ static int complete_remove_obj(cls_method_context_t hctx,
   return ret;
 }
 
-int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+// applies a complete op to the index shard whose header is given, and
+// sets *modified once it starts changing the shard, so that a caller
+// applying several ops knows whether it can skip a failed one
+static int apply_complete_op(cls_method_context_t hctx,
+			     rgw_cls_obj_complete_op& op,
+			     rgw_bucket_dir_header& header,
+			     const bool bitx_inst,
+			     bool* modified)
 {
-  const ConfigProxy& conf = cls_get_config(hctx);
-  const object_info_t& oi = cls_get_object_info(hctx);
-
-  // bucket index transaction instrumentation
-  const bool bitx_inst =
-    conf->rgw_bucket_index_transaction_instrumentation;
-
-  CLS_LOG_BITX(bitx_inst, 10, "ENTERING %s for object oid=%s key=%s",
-	       __func__, oi.soid.oid.name.c_str(), oi.soid.get_key().c_str());
-
-  // decode request
-  rgw_cls_obj_complete_op op;
-  auto iter = in->cbegin();
-  try {
-    decode(op, iter);
-  } catch (ceph::buffer::error& err) {
-    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to decode request", __func__);
-    return -EINVAL;
-  }
-
-  CLS_LOG_BITX(bitx_inst, 1,
-	       "INFO: %s: request: op=%s name=%s ver=%lu:%llu tag=%s",
-	       __func__,
-	       modify_op_str(op.op).c_str(), op.key.to_string().c_str(),
-	       (unsigned long)op.ver.pool, (unsigned long long)op.ver.epoch,
-	       op.tag.c_str());
-
-  rgw_bucket_dir_header header;
-  int rc = read_bucket_header(hctx, &header);
-  if (rc < 0) {
-    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to read header, rc=%d",
-		 __func__, rc);
-    return -EINVAL;
-  }
-
-  rc = guard_bucket_resharding(hctx, header);
-  if (rc < 0) {
-    return rc;
-  }
-
   rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
   std::string idx;
-  rc = read_key_entry(hctx, op.key, &idx, &entry);
+  int rc = read_key_entry(hctx, op.key, &idx, &entry);
   if (rc == -ENOENT) {
     entry.key = op.key;
     entry.ver = op.ver;
@@ -1204,6 +1171,9 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     op.op = CLS_RGW_OP_CANCEL;
   }
 
+  // from here on the shard is modified
+  *modified = true;
+
   // controls whether remove_objs deletions are logged
   const bool default_log_op = op.log_op && !header.syncstopped;
   // controls whether this operation is logged (depends on op.op and ondisk)
@@ -1340,6 +1310,57 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     }
   } // remove loop
 
+  return 0;
+} // apply_complete_op
+
+int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  const ConfigProxy& conf = cls_get_config(hctx);
+  const object_info_t& oi = cls_get_object_info(hctx);
+
+  // bucket index transaction instrumentation
+  const bool bitx_inst =
+    conf->rgw_bucket_index_transaction_instrumentation;
+
+  CLS_LOG_BITX(bitx_inst, 10, "ENTERING %s for object oid=%s key=%s",
+	       __func__, oi.soid.oid.name.c_str(), oi.soid.get_key().c_str());
+
+  // decode request
+  rgw_cls_obj_complete_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  CLS_LOG_BITX(bitx_inst, 1,
+	       "INFO: %s: request: op=%s name=%s ver=%lu:%llu tag=%s",
+	       __func__,
+	       modify_op_str(op.op).c_str(), op.key.to_string().c_str(),
+	       (unsigned long)op.ver.pool, (unsigned long long)op.ver.epoch,
+	       op.tag.c_str());
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to read header, rc=%d",
+		 __func__, rc);
+    return -EINVAL;
+  }
+
+  rc = guard_bucket_resharding(hctx, header);
+  if (rc < 0) {
+    return rc;
+  }
+
+  bool modified = false;
+  rc = apply_complete_op(hctx, op, header, bitx_inst, &modified);
+  if (rc < 0) {
+    return rc;
+  }
+
   CLS_LOG_BITX(bitx_inst, 20,
 	       "INFO: %s: writing bucket header", __func__);
   rc = write_bucket_header(hctx, &header);
@@ -1354,6 +1375,94 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
   return rc;
 } // rgw_bucket_complete_op
 
+int rgw_bucket_complete_ops(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  const ConfigProxy& conf = cls_get_config(hctx);
+  const object_info_t& oi = cls_get_object_info(hctx);
+
+  // bucket index transaction instrumentation
+  const bool bitx_inst =
+    conf->rgw_bucket_index_transaction_instrumentation;
+
+  CLS_LOG_BITX(bitx_inst, 10, "ENTERING %s for object oid=%s key=%s",
+	       __func__, oi.soid.oid.name.c_str(), oi.soid.get_key().c_str());
+
+  // decode request
+  rgw_cls_obj_complete_ops op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to read header, rc=%d",
+		 __func__, rc);
+    return -EINVAL;
+  }
+
+  size_t num_applied = 0;
+  for (auto& complete : op.ops) {
+    CLS_LOG_BITX(bitx_inst, 20,
+		 "INFO: %s: request: op=%s name=%s ver=%lu:%llu tag=%s",
+		 __func__,
+		 modify_op_str(complete.op).c_str(),
+		 complete.key.to_string().c_str(),
+		 (unsigned long)complete.ver.pool,
+		 (unsigned long long)complete.ver.epoch,
+		 complete.tag.c_str());
+
+    // checked before each op, as the ops of this batch count towards
+    // the reshard log threshold; none of them is applied if it trips
+    rc = guard_bucket_resharding(hctx, header);
+    if (rc < 0) {
+      return rc;
+    }
+
+    if (num_applied > 0) {
+      // each op is logged and versioned as if the op before it had
+      // written the header on its own, so that their bilog entries do
+      // not collide
+      header.ver++;
+    }
+    bool modified = false;
+    rc = apply_complete_op(hctx, complete, header, bitx_inst, &modified);
+    if (rc < 0) {
+      if (modified) {
+	// the shard failed to write the op. failing the call drops the
+	// writes of the whole batch, and the client retries each op alone
+	return rc;
+      }
+      // the op would have failed on its own without changing the shard
+      CLS_LOG_BITX(bitx_inst, 1,
+		   "WARNING: %s: skipping op on key=%s, rc=%d",
+		   __func__, complete.key.to_string().c_str(), rc);
+      continue;
+    }
+    ++num_applied;
+  }
+
+  if (num_applied > 0) {
+    CLS_LOG_BITX(bitx_inst, 20,
+		 "INFO: %s: writing bucket header after %zu ops",
+		 __func__, num_applied);
+    rc = write_bucket_header(hctx, &header);
+    if (rc < 0) {
+      CLS_LOG_BITX(bitx_inst, 0,
+		   "ERROR: %s: failed to write bucket header ret=%d",
+		   __func__, rc);
+    }
+  }
+
+  CLS_LOG_BITX(bitx_inst, 10,
+	       "EXITING %s: returning %d", __func__, rc);
+  return rc;
+} // rgw_bucket_complete_ops
+
 static int read_olh(cls_method_context_t hctx,cls_rgw_obj_key& obj_key, rgw_bucket_olh_entry *olh_data_entry, string *index_key, bool *found)
 {
   cls_rgw_obj_key olh_key;
@@ -3927,6 +4036,77 @@ static int rgw_reshard_log_trim_op(cls_method_context_t hctx, bufferlist *in, bu
   return 0;
 }
 
+/*
+ * Remove the given reshard log entries from the index shard, unless the
+ * write of another op overwrote them after they were listed, so that the
+ * reshard can copy and trim the log while the writes are still recorded.
+ */
+static int rgw_reshard_log_trim_entries_op(cls_method_context_t hctx,
+                                           bufferlist *in, bufferlist *out)
+{
+  rgw_cls_reshard_log_trim_entries_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(0, "ERROR: %s: failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(0, "ERROR: %s: failed to read header", __func__);
+    return rc;
+  }
+
+  uint32_t removed = 0;
+  for (const auto& entry : op.entries) {
+    string key;
+    bi_reshard_log_key(hctx, key, entry.idx);
+
+    bufferlist bl;
+    rc = cls_cxx_map_get_val(hctx, key, &bl);
+    if (rc == -ENOENT) {
+      continue;
+    }
+    if (rc < 0) {
+      CLS_LOG(1, "ERROR: %s: cls_cxx_map_get_val failed rc=%d", __func__, rc);
+      return rc;
+    }
+
+    rgw_cls_bi_entry logged;
+    try {
+      auto biter = bl.cbegin();
+      decode(logged, biter);
+    } catch (ceph::buffer::error& err) {
+      CLS_LOG(0, "ERROR: %s: failed to decode reshard log entry \"%s\"",
+              __func__, escape_str(key).c_str());
+      return -EIO;
+    }
+    if (!logged.data.contents_equal(entry.data)) {
+      CLS_LOG(20, "%s: skipping overwritten entry %s", __func__,
+              escape_str(entry.idx).c_str());
+      continue;
+    }
+
+    rc = cls_cxx_map_remove_key(hctx, key);
+    if (rc < 0) {
+      CLS_LOG(1, "ERROR: %s: cls_cxx_map_remove_key failed rc=%d", __func__, rc);
+      return rc;
+    }
+    ++removed;
+  }
+
+  if (removed == 0) {
+    return 0;
+  }
+  // reshardlog_entries counts the writes recorded, and so is at least the
+  // number of entries left
+  header.reshardlog_entries -= std::min(header.reshardlog_entries, removed);
+  return write_bucket_header(hctx, &header);
+}
+
 static void usage_record_prefix_by_time(uint64_t epoch, string& key)
 {
   char buf[32];
@@ -5063,6 +5243,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bucket_update_stats;
   cls_method_handle_t h_rgw_bucket_prepare_op;
   cls_method_handle_t h_rgw_bucket_complete_op;
+  cls_method_handle_t h_rgw_bucket_complete_ops;
   cls_method_handle_t h_rgw_bucket_link_olh;
   cls_method_handle_t h_rgw_bucket_unlink_instance_op;
   cls_method_handle_t h_rgw_bucket_read_olh_log;
@@ -5077,6 +5258,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bi_put_entries_op;
   cls_method_handle_t h_rgw_bi_list_op;
   cls_method_handle_t h_rgw_reshard_log_trim_op;
+  cls_method_handle_t h_rgw_reshard_log_trim_entries_op;
   cls_method_handle_t h_rgw_bi_log_list_op;
   cls_method_handle_t h_rgw_bi_log_trim_op;
   cls_method_handle_t h_rgw_bi_log_resync_op;
@@ -5119,6 +5301,7 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BUCKET_UPDATE_STATS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_update_stats, &h_rgw_bucket_update_stats);
   cls_register_cxx_method(h_class, RGW_BUCKET_PREPARE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_prepare_op, &h_rgw_bucket_prepare_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_op, &h_rgw_bucket_complete_op);
+  cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OPS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_ops, &h_rgw_bucket_complete_ops);
   cls_register_cxx_method(h_class, RGW_BUCKET_LINK_OLH, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_link_olh, &h_rgw_bucket_link_olh);
   cls_register_cxx_method(h_class, RGW_BUCKET_UNLINK_INSTANCE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_unlink_instance, &h_rgw_bucket_unlink_instance_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_READ_OLH_LOG, CLS_METHOD_RD, rgw_bucket_read_olh_log, &h_rgw_bucket_read_olh_log);
@@ -5135,6 +5318,8 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BI_PUT_ENTRIES, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_put_entries, &h_rgw_bi_put_entries_op);
   cls_register_cxx_method(h_class, RGW_BI_LIST, CLS_METHOD_RD, rgw_bi_list_op, &h_rgw_bi_list_op);
   cls_register_cxx_method(h_class, RGW_RESHARD_LOG_TRIM, CLS_METHOD_RD | CLS_METHOD_WR, rgw_reshard_log_trim_op, &h_rgw_reshard_log_trim_op);
+  cls_register_cxx_method(h_class, RGW_RESHARD_LOG_TRIM_ENTRIES, CLS_METHOD_RD | CLS_METHOD_WR,
+                          rgw_reshard_log_trim_entries_op, &h_rgw_reshard_log_trim_entries_op);
 
   cls_register_cxx_method(h_class, RGW_BI_LOG_LIST, CLS_METHOD_RD, rgw_bi_log_list, &h_rgw_bi_log_list_op);
   cls_register_cxx_method(h_class, RGW_BI_LOG_TRIM, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_log_trim, &h_rgw_bi_log_trim_op);
@@ -341,6 +341,16 @@ void cls_rgw_bucket_complete_op(ObjectWriteOperation& o, RGWModifyOp op, const s
   o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OP, in);
 }
 
+void cls_rgw_bucket_complete_ops(ObjectWriteOperation& o,
+                                 const std::vector<rgw_cls_obj_complete_op>& ops)
+{
+  bufferlist in;
+  rgw_cls_obj_complete_ops call;
+  call.ops = ops;
+  encode(call, in);
+  o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OPS, in);
+}
+
 void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const cls_rgw_obj_key& start_obj,
                             const std::string& filter_prefix,
@@ -512,6 +522,19 @@ void cls_rgw_bi_put_entries(librados::ObjectWriteOperation& op,
   op.exec(RGW_CLASS, RGW_BI_PUT_ENTRIES, in);
 }
 
+void cls_rgw_reshard_log_trim_entries(librados::ObjectWriteOperation& op,
+                                      std::vector<rgw_cls_bi_entry> entries)
+{
+  const auto call = rgw_cls_reshard_log_trim_entries_op{
+    .entries = std::move(entries)
+  };
+
+  bufferlist in;
+  encode(call, in);
+
+  op.exec(RGW_CLASS, RGW_RESHARD_LOG_TRIM_ENTRIES, in);
+}
+
 /* nb: any entries passed in are replaced with the results of the cls
  * call, so caller does not need to clear entries between calls
  */
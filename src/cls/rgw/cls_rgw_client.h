@@ -376,6 +376,11 @@ void cls_rgw_bucket_complete_op(librados::ObjectWriteOperation& o, RGWModifyOp o
                                 uint16_t bilog_op, const rgw_zone_set *zones_trace,
 				const std::string& obj_locator = ""); // ignored if it's the empty string
 
+// applies the complete ops of several objects of the same index shard
+// at once; requires an osd that knows about RGW_BUCKET_COMPLETE_OPS
+void cls_rgw_bucket_complete_ops(librados::ObjectWriteOperation& o,
+                                 const std::vector<rgw_cls_obj_complete_op>& ops);
+
 void cls_rgw_remove_obj(librados::ObjectWriteOperation& o, std::list<std::string>& keep_attr_prefixes);
 void cls_rgw_obj_store_pg_ver(librados::ObjectWriteOperation& o, const std::string& attr);
 void cls_rgw_obj_check_attrs_prefix(librados::ObjectOperation& o, const std::string& prefix, bool fail_if_exist);
@@ -392,6 +397,10 @@ void cls_rgw_bi_put(librados::ObjectWriteOperation& op, const std::string oid, c
 void cls_rgw_bi_put_entries(librados::ObjectWriteOperation& op,
                             std::vector<rgw_cls_bi_entry> entries,
                             bool check_existing);
+// Remove the given reshard log entries, as returned by cls_rgw_bi_list() with
+// reshardlog=true, unless they were overwritten since.
+void cls_rgw_reshard_log_trim_entries(librados::ObjectWriteOperation& op,
+                                      std::vector<rgw_cls_bi_entry> entries);
 int cls_rgw_bi_list(librados::IoCtx& io_ctx, const std::string& oid,
                    const std::string& name, const std::string& marker, uint32_t max,
                    std::list<rgw_cls_bi_entry> *entries, bool *is_truncated, bool reshardlog = false);
@@ -21,6 +21,7 @@ constexpr int RGWBIAdvanceAndRetryError = -EFBIG;
 #define RGW_BUCKET_UPDATE_STATS "bucket_update_stats"
 #define RGW_BUCKET_PREPARE_OP "bucket_prepare_op"
 #define RGW_BUCKET_COMPLETE_OP "bucket_complete_op"
+#define RGW_BUCKET_COMPLETE_OPS "bucket_complete_ops"
 #define RGW_BUCKET_LINK_OLH "bucket_link_olh"
 #define RGW_BUCKET_UNLINK_INSTANCE "bucket_unlink_instance"
 #define RGW_BUCKET_READ_OLH_LOG "bucket_read_olh_log"
@@ -38,6 +39,7 @@ constexpr int RGWBIAdvanceAndRetryError = -EFBIG;
 #define RGW_BI_LIST "bi_list"
 
 #define RGW_RESHARD_LOG_TRIM "reshard_log_trim"
+#define RGW_RESHARD_LOG_TRIM_ENTRIES "reshard_log_trim_entries"
 
 #define RGW_BI_LOG_LIST "bi_log_list"
 #define RGW_BI_LOG_TRIM "bi_log_trim"
@@ -168,6 +168,25 @@ void rgw_cls_obj_complete_op::dump(Formatter *f) const
   encode_json("zones_trace", zones_trace, f);
 }
 
+void rgw_cls_obj_complete_ops::generate_test_instances(list<rgw_cls_obj_complete_ops*>& o)
+{
+  rgw_cls_obj_complete_ops *ops = new rgw_cls_obj_complete_ops;
+  list<rgw_cls_obj_complete_op *> l;
+  rgw_cls_obj_complete_op::generate_test_instances(l);
+  for (auto op : l) {
+    ops->ops.push_back(*op);
+    delete op;
+  }
+  o.push_back(ops);
+
+  o.push_back(new rgw_cls_obj_complete_ops);
+}
+
+void rgw_cls_obj_complete_ops::dump(Formatter *f) const
+{
+  encode_json("ops", ops, f);
+}
+
 void rgw_cls_link_olh_op::generate_test_instances(list<rgw_cls_link_olh_op*>& o)
 {
   rgw_cls_link_olh_op *op = new rgw_cls_link_olh_op;
@@ -586,3 +605,8 @@ void rgw_cls_bi_put_entries_op::dump(Formatter *f) const
   encode_json("entries", entries, f);
   encode_json("check_existing", check_existing, f);
 }
+
+void rgw_cls_reshard_log_trim_entries_op::dump(Formatter *f) const
+{
+  encode_json("entries", entries, f);
+}
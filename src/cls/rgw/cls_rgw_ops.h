@@ -164,6 +164,27 @@ struct rgw_cls_obj_complete_op
 };
 WRITE_CLASS_ENCODER(rgw_cls_obj_complete_op)
 
+// the complete ops of several objects of the same index shard, applied
+// together with a single update of the shard header
+struct rgw_cls_obj_complete_ops
+{
+  std::vector<rgw_cls_obj_complete_op> ops;
+
+  void encode(ceph::buffer::list &bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(ops, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(ceph::buffer::list::const_iterator &bl) {
+    DECODE_START(1, bl);
+    decode(ops, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(ceph::Formatter *f) const;
+  static void generate_test_instances(std::list<rgw_cls_obj_complete_ops*>& o);
+};
+WRITE_CLASS_ENCODER(rgw_cls_obj_complete_ops)
+
 struct rgw_cls_link_olh_op {
   cls_rgw_obj_key key;
   std::string olh_tag;
@@ -789,6 +810,33 @@ struct rgw_cls_bi_put_entries_op {
 };
 WRITE_CLASS_ENCODER(rgw_cls_bi_put_entries_op)
 
+struct rgw_cls_reshard_log_trim_entries_op {
+  // the reshard log entries as listed, each removed only if it was not
+  // overwritten since
+  std::vector<rgw_cls_bi_entry> entries;
+
+  void encode(ceph::buffer::list& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(entries, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(ceph::buffer::list::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(entries, bl);
+    DECODE_FINISH(bl);
+  }
+
+  void dump(ceph::Formatter *f) const;
+
+  static void generate_test_instances(std::list<rgw_cls_reshard_log_trim_entries_op*>& o) {
+    o.push_back(new rgw_cls_reshard_log_trim_entries_op);
+    o.push_back(new rgw_cls_reshard_log_trim_entries_op);
+    o.back()->entries.push_back({.idx = "entry"});
+  }
+};
+WRITE_CLASS_ENCODER(rgw_cls_reshard_log_trim_entries_op)
+
 struct rgw_cls_bi_list_op {
   uint32_t max;
   std::string name_filter; // limit result to one object and its instances
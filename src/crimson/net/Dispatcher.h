@@ -57,6 +57,10 @@ class Dispatcher {
   virtual void ms_handle_reset(ConnectionRef conn, bool is_replace) {}
 
   virtual void ms_handle_remote_reset(ConnectionRef conn) {}
+
+  // a mark-down event is dispatched instead of the reset event when the
+  // connection is closed after the user called mark_down() on it.
+  virtual void ms_handle_mark_down(ConnectionRef conn) {}
 };
 
 } // namespace crimson::net
@@ -111,4 +111,17 @@ ChainedDispatchers::ms_handle_remote_reset(ConnectionRef conn) {
   }
 }
 
+void
+ChainedDispatchers::ms_handle_mark_down(ConnectionRef conn) {
+  try {
+    for (auto& dispatcher : dispatchers) {
+      dispatcher->ms_handle_mark_down(conn);
+    }
+  } catch (...) {
+    logger().error("{} got unexpected exception in ms_handle_mark_down() {}",
+                   *conn, std::current_exception());
+    ceph_abort();
+  }
+}
+
 }
@@ -31,6 +31,7 @@ public:
   void ms_handle_connect(ConnectionRef conn, seastar::shard_id);
   void ms_handle_reset(ConnectionRef conn, bool is_replace);
   void ms_handle_remote_reset(ConnectionRef conn);
+  void ms_handle_mark_down(ConnectionRef conn);
 
  private:
   dispatchers_t dispatchers;
@@ -297,6 +297,7 @@ void IOHandler::mark_down()
   if (get_io_state() == io_state_t::drop) {
     return;
   }
+  need_dispatch_mark_down = true;
 
   auto cc_seq = proto_crosscore.prepare_submit();
   logger().info("{} mark_down() at {}, send {} notify_mark_down()",
@@ -824,6 +825,19 @@ void IOHandler::dispatch_reset(bool is_replace)
   // user can make changes
 }
 
+void IOHandler::dispatch_mark_down()
+{
+  ceph_assert_always(get_io_state() == io_state_t::drop);
+  if (!need_dispatch_mark_down) {
+    return;
+  }
+  need_dispatch_mark_down = false;
+  ceph_assert_always(conn_ref);
+
+  dispatchers.ms_handle_mark_down(conn_ref);
+  // user can make changes
+}
+
 void IOHandler::dispatch_remote_reset()
 {
   if (get_io_state() == io_state_t::drop) {
@@ -1255,6 +1269,7 @@ IOHandler::close_io(
   if (is_dispatch_reset) {
     dispatch_reset(is_replace);
   }
+  dispatch_mark_down();
 
   ceph_assert_always(conn_ref);
   conn_ref.reset();
@@ -417,6 +417,8 @@ public:
 
   void dispatch_remote_reset();
 
+  void dispatch_mark_down();
+
   bool is_out_queued() const {
     return (!out_pending_msgs.empty() ||
             ack_left > 0 ||
@@ -493,6 +495,8 @@ private:
 
   bool need_dispatch_reset = true;
 
+  bool need_dispatch_mark_down = false;
+
   /*
    * out states for writing
    */
@@ -17,9 +17,14 @@ ThreadPool::ThreadPool(size_t n_threads,
                        size_t queue_sz,
                        const std::optional<seastar::resource::cpuset>& cpus)
   : n_threads(n_threads),
+    alien(seastar::engine().alien()),
     queue_size{round_up_to(queue_sz, seastar::smp::count)},
     pending_queues(n_threads)
 {
+  // a reactor never has more tasks in flight than its free slots
+  for (auto& q : pending_queues) {
+    q.init(seastar::smp::count, queue_size / seastar::smp::count);
+  }
   auto queue_max_wait = std::chrono::seconds(local_conf()->threadpool_empty_queue_max_wait);
   for (size_t i = 0; i < n_threads; i++) {
     threads.emplace_back([this, cpus, queue_max_wait, i] {
@@ -65,17 +70,43 @@ void ThreadPool::block_sighup()
   pthread_sigmask(SIG_BLOCK, &sigs, nullptr);
 }
 
+bool ThreadPool::process_batch(
+  ShardedWorkQueue& pending,
+  std::vector<std::vector<WorkItem*>>& completed)
+{
+  bool processed = false;
+  for (unsigned shard = 0; shard < pending.num_shards(); shard++) {
+    auto& done = completed[shard];
+    while (auto work_item = pending.pop_front(shard)) {
+      work_item->process();
+      done.push_back(work_item);
+    }
+    if (done.empty()) {
+      continue;
+    }
+    processed = true;
+    seastar::alien::run_on(alien, shard,
+      [done=std::move(done)]() noexcept {
+      for (auto work_item : done) {
+        work_item->complete();
+      }
+    });
+    done = {};
+  }
+  return processed;
+}
+
 void ThreadPool::loop(std::chrono::milliseconds queue_max_wait, size_t shard)
 {
   auto& pending = pending_queues[shard];
+  std::vector<std::vector<WorkItem*>> completed(pending.num_shards());
   for (;;) {
-    WorkItem* work_item = nullptr;
-    work_item = pending.pop_front(queue_max_wait);
-    if (work_item) {
-      work_item->process();
+    if (process_batch(pending, completed)) {
+      continue;
     } else if (is_stopping()) {
       break;
     }
+    pending.wait(queue_max_wait);
   }
 }
 
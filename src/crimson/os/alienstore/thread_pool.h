@@ -6,8 +6,11 @@
 #include <condition_variable>
 #include <tuple>
 #include <type_traits>
-#include <boost/lockfree/queue.hpp>
+#include <memory>
+#include <vector>
+#include <boost/lockfree/spsc_queue.hpp>
 #include <boost/optional.hpp>
+#include <seastar/core/alien.hh>
 #include <seastar/core/future.hh>
 #include <seastar/core/gate.hh>
 #include <seastar/core/reactor.hh>
@@ -24,7 +27,10 @@ namespace crimson::os {
 
 struct WorkItem {
   virtual ~WorkItem() {}
+  /// run by an alien thread
   virtual void process() = 0;
+  /// run by the submitting reactor once process() is done
+  virtual void complete() noexcept = 0;
 };
 
 template<typename Func>
@@ -50,10 +56,12 @@ public:
     } catch (...) {
       state.set_exception(std::current_exception());
     }
-    on_done.write_side().signal(1);
+  }
+  void complete() noexcept override {
+    on_done.set_value();
   }
   typename futurator_t::type get_future() {
-    return on_done.wait().then([this](size_t) {
+    return on_done.get_future().then([this] {
       if (state.failed()) {
         return futurator_t::make_exception_future(state.get_exception());
       } else {
@@ -64,7 +72,7 @@ public:
 private:
   Func func;
   seastar::future_state<future_stored_type_t> state;
-  seastar::readable_eventfd on_done;
+  seastar::promise<> on_done;
 };
 
 struct SubmitQueue {
@@ -78,36 +86,74 @@ struct SubmitQueue {
   }
 };
 
+/**
+ * ShardedWorkQueue
+ *
+ * The work items of an alien thread, in a single-producer single-consumer
+ * ring per reactor so that submitting takes no lock.  The thread drains all
+ * the rings before going to sleep, and a reactor only posts the semaphore
+ * if the thread is sleeping, so a burst of submissions costs one wakeup.
+ */
 struct ShardedWorkQueue {
 public:
-  WorkItem* pop_front(std::chrono::milliseconds& queue_max_wait) {
-    if (sem.try_acquire_for(queue_max_wait)) {
-      if (!is_stopping()) {
-        WorkItem* work_item = nullptr;
-        [[maybe_unused]] bool popped = pending.pop(work_item);
-        assert(popped);
-        return work_item;
-      }
+  void init(unsigned num_shards, size_t ring_size) {
+    rings.reserve(num_shards);
+    for (unsigned i = 0; i < num_shards; i++) {
+      rings.emplace_back(std::make_unique<ring_t>(ring_size));
+    }
+  }
+  /// pop a work item submitted by shard, nullptr if its ring is empty
+  WorkItem* pop_front(unsigned shard) {
+    WorkItem* work_item = nullptr;
+    if (rings[shard]->pop(work_item)) {
+      return work_item;
     }
     return nullptr;
   }
+  size_t num_shards() const {
+    return rings.size();
+  }
+  /// sleep until pushed or queue_max_wait, unless the rings are not empty
+  void wait(std::chrono::milliseconds& queue_max_wait) {
+    sleeping.store(true);
+    // pairs with the exchange() in push_back(), so either we see the new
+    // item or the reactor sees us sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (is_empty() && !is_stopping()) {
+      sem.try_acquire_for(queue_max_wait);
+    }
+    sleeping.store(false);
+  }
   void stop() {
     stopping = true;
     sem.release();
   }
-  void push_back(WorkItem* work_item) {
-    [[maybe_unused]] bool pushed = pending.push(work_item);
+  /// called by the reactor of shard
+  void push_back(unsigned shard, WorkItem* work_item) {
+    [[maybe_unused]] bool pushed = rings[shard]->push(work_item);
+    // the slots of a reactor are bounded by its ring size
     assert(pushed);
-    sem.release();
+    if (sleeping.exchange(false)) {
+      sem.release();
+    }
   }
 private:
   bool is_stopping() const {
     return stopping;
   }
+  bool is_empty() const {
+    for (auto& ring : rings) {
+      if (ring->read_available()) {
+        return false;
+      }
+    }
+    return true;
+  }
   std::atomic<bool> stopping = false;
-  static constexpr unsigned QUEUE_SIZE = 128;
-  crimson::counting_semaphore<QUEUE_SIZE> sem{0};
-  boost::lockfree::queue<WorkItem*> pending{QUEUE_SIZE};
+  std::atomic<bool> sleeping = false;
+  crimson::counting_semaphore<> sem{0};
+  using ring_t = boost::lockfree::spsc_queue<WorkItem*>;
+  std::vector<std::unique_ptr<ring_t>> rings;
 };
 
 /// an engine for scheduling non-seastar tasks from seastar fibers
@@ -119,8 +165,8 @@ public:
    *                 multiple of the number of cores.
    * @param n_threads the number of threads in this thread pool.
    * @param cpu the CPU core to which this thread pool is assigned
-   * @note each @c Task has its own crimson::thread::Condition, which possesses
-   * an fd, so we should keep the size of queue under a reasonable limit.
+   * @note the completed tasks are returned to their reactors in batches
+   * through the seastar alien queue.
    */
   ThreadPool(size_t n_threads, size_t queue_sz, const std::optional<seastar::resource::cpuset>& cpus);
   ~ThreadPool();
@@ -141,7 +187,7 @@ public:
           .then([packaged=std::move(packaged), shard, this] {
             auto task = new Task{std::move(packaged)};
             auto fut = task->get_future();
-            pending_queues[shard].push_back(task);
+            pending_queues[shard].push_back(seastar::this_shard_id(), task);
             return fut.finally([task, this] {
               local_free_slots().signal();
               delete task;
@@ -157,6 +203,9 @@ public:
 
 private:
   void loop(std::chrono::milliseconds queue_max_wait, size_t shard);
+  /// process the submitted work items, and return them to their reactors
+  bool process_batch(ShardedWorkQueue& pending,
+                     std::vector<std::vector<WorkItem*>>& completed);
   bool is_stopping() const {
     return stopping.load(std::memory_order_relaxed);
   }
@@ -171,6 +220,7 @@ private:
 private:
   size_t n_threads;
   std::atomic<bool> stopping = false;
+  seastar::alien::instance& alien;
   std::vector<std::thread> threads;
   seastar::sharded<SubmitQueue> submit_queue;
   const size_t queue_size;
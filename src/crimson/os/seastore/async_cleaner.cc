@@ -1,6 +1,7 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <boost/iterator/counting_iterator.hpp>
 #include <fmt/chrono.h>
 #include <seastar/core/metrics.hh>
 
@@ -982,6 +983,10 @@ void SegmentCleaner::register_metrics()
                    [this] { return get_reclaim_ratio(); },
                    sm::description("ratio of reclaimable space to unavailable space")),
 
+    sm::make_gauge("segments_reclaiming",
+                   [this] { return reclaim_states.size(); },
+                   sm::description("the number of segments being reclaimed")),
+
     sm::make_histogram("segment_utilization_distribution",
 		       [this]() -> seastar::metrics::histogram& {
 		         return stats.segment_util;
@@ -1088,9 +1093,8 @@ double SegmentCleaner::calc_gc_benefit_cost(
 
 SegmentCleaner::do_reclaim_space_ret
 SegmentCleaner::do_reclaim_space(
-    const std::vector<CachedExtentRef> &backref_extents,
-    const backref_pin_list_t &pin_list,
-    std::size_t &reclaimed,
+    const reclaim_ranges_t &ranges,
+    std::vector<std::size_t> &reclaimed,
     std::size_t &runs)
 {
   auto& shard_stats = extent_callback->get_shard_stats();
@@ -1110,9 +1114,8 @@ SegmentCleaner::do_reclaim_space(
   // 	tree doesn't match the extent's paddr
   // 3. the extent is physical and doesn't exist in the
   // 	lba tree, backref tree or backref cache;
-  return repeat_eagain([this, &backref_extents, &shard_stats,
-                        &pin_list, &reclaimed, &runs] {
-    reclaimed = 0;
+  return repeat_eagain([this, &ranges, &shard_stats, &reclaimed, &runs] {
+    reclaimed.assign(ranges.size(), 0);
     runs++;
     transaction_type_t src;
     if (is_cold) {
@@ -1125,74 +1128,83 @@ SegmentCleaner::do_reclaim_space(
     return extent_callback->with_transaction_intr(
       src,
       "clean_reclaim_space",
-      [this, &backref_extents, &pin_list, &reclaimed](auto &t)
+      [this, &ranges, &reclaimed](auto &t)
     {
-      return seastar::do_with(
-        std::vector<CachedExtentRef>(backref_extents),
-        [this, &t, &reclaimed, &pin_list](auto &extents)
+      return trans_intr::do_for_each(
+        boost::make_counting_iterator<std::size_t>(0),
+        boost::make_counting_iterator<std::size_t>(ranges.size()),
+        [this, &t, &ranges, &reclaimed](auto i)
       {
-        LOG_PREFIX(SegmentCleaner::do_reclaim_space);
-        // calculate live extents
-        auto cached_backref_entries =
-          backref_manager.get_cached_backref_entries_in_range(
-            reclaim_state->start_pos, reclaim_state->end_pos);
-        backref_entry_query_set_t backref_entries;
-        for (auto &pin : pin_list) {
-          backref_entries.emplace(
-            pin->get_key(),
-            pin->get_val(),
-            pin->get_length(),
-            pin->get_type(),
-            JOURNAL_SEQ_NULL);
-        }
-        for (auto &cached_backref : cached_backref_entries) {
-          if (cached_backref.laddr == L_ADDR_NULL) {
-            auto it = backref_entries.find(cached_backref.paddr);
-            assert(it->len == cached_backref.len);
-            backref_entries.erase(it);
-          } else {
-            backref_entries.emplace(cached_backref);
+        return seastar::do_with(
+          std::vector<CachedExtentRef>(ranges[i].backref_extents),
+          [this, &t, &reclaimed, &ranges, i](auto &extents)
+        {
+          LOG_PREFIX(SegmentCleaner::do_reclaim_space);
+          auto &state = reclaim_states[i];
+          // calculate live extents
+          auto cached_backref_entries =
+            backref_manager.get_cached_backref_entries_in_range(
+              state.start_pos, state.end_pos);
+          backref_entry_query_set_t backref_entries;
+          for (auto &pin : ranges[i].pin_list) {
+            backref_entries.emplace(
+              pin->get_key(),
+              pin->get_val(),
+              pin->get_length(),
+              pin->get_type(),
+              JOURNAL_SEQ_NULL);
           }
-        }
-        // retrieve live extents
-        DEBUGT("start, backref_entries={}, backref_extents={}",
-               t, backref_entries.size(), extents.size());
-	return seastar::do_with(
-	  std::move(backref_entries),
-	  [this, &extents, &t](auto &backref_entries) {
-	  return trans_intr::parallel_for_each(
-	    backref_entries,
-	    [this, &extents, &t](auto &ent)
-	  {
-	    LOG_PREFIX(SegmentCleaner::do_reclaim_space);
-	    TRACET("getting extent of type {} at {}~{}",
-	      t,
-	      ent.type,
-	      ent.paddr,
-	      ent.len);
-	    return extent_callback->get_extents_if_live(
-	      t, ent.type, ent.paddr, ent.laddr, ent.len
-	    ).si_then([FNAME, &extents, &ent, &t](auto list) {
-	      if (list.empty()) {
-		TRACET("addr {} dead, skipping", t, ent.paddr);
-	      } else {
-		for (auto &e : list) {
-		  extents.emplace_back(std::move(e));
-		}
-	      }
-	    });
-	  });
-	}).si_then([FNAME, &extents, this, &reclaimed, &t] {
-          DEBUGT("reclaim {} extents", t, extents.size());
-          // rewrite live extents
-          auto modify_time = segments[reclaim_state->get_segment_id()].modify_time;
-          return trans_intr::do_for_each(
-            extents,
-            [this, modify_time, &t, &reclaimed](auto ext)
-          {
-            reclaimed += ext->get_length();
-            return extent_callback->rewrite_extent(
-                t, ext, reclaim_state->target_generation, modify_time);
+          for (auto &cached_backref : cached_backref_entries) {
+            if (cached_backref.laddr == L_ADDR_NULL) {
+              auto it = backref_entries.find(cached_backref.paddr);
+              assert(it->len == cached_backref.len);
+              backref_entries.erase(it);
+            } else {
+              backref_entries.emplace(cached_backref);
+            }
+          }
+          // retrieve live extents
+          DEBUGT("start {}~{}, backref_entries={}, backref_extents={}",
+                 t, state.start_pos, state.end_pos,
+                 backref_entries.size(), extents.size());
+          return seastar::do_with(
+            std::move(backref_entries),
+            [this, &extents, &t](auto &backref_entries) {
+            return trans_intr::parallel_for_each(
+              backref_entries,
+              [this, &extents, &t](auto &ent)
+            {
+              LOG_PREFIX(SegmentCleaner::do_reclaim_space);
+              TRACET("getting extent of type {} at {}~{}",
+                t,
+                ent.type,
+                ent.paddr,
+                ent.len);
+              return extent_callback->get_extents_if_live(
+                t, ent.type, ent.paddr, ent.laddr, ent.len
+              ).si_then([FNAME, &extents, &ent, &t](auto list) {
+                if (list.empty()) {
+                  TRACET("addr {} dead, skipping", t, ent.paddr);
+                } else {
+                  for (auto &e : list) {
+                    extents.emplace_back(std::move(e));
+                  }
+                }
+              });
+            });
+          }).si_then([FNAME, &extents, this, &reclaimed, &t, i] {
+            DEBUGT("reclaim {} extents", t, extents.size());
+            // rewrite live extents
+            auto &state = reclaim_states[i];
+            auto modify_time = segments[state.get_segment_id()].modify_time;
+            return trans_intr::do_for_each(
+              extents,
+              [this, modify_time, &t, &reclaimed, &state, i](auto ext)
+            {
+              reclaimed[i] += ext->get_disk_length();
+              return extent_callback->rewrite_extent(
+                  t, ext, state.target_generation, modify_time);
+            });
           });
         });
       }).si_then([this, &t] {
@@ -1205,65 +1217,107 @@ SegmentCleaner::do_reclaim_space(
   });
 }
 
+SegmentCleaner::clean_space_ret
+SegmentCleaner::release_reclaimed_segment(segment_id_t segment_to_release)
+{
+  LOG_PREFIX(SegmentCleaner::release_reclaimed_segment);
+  return sm_group->release_segment(segment_to_release
+  ).handle_error(
+    clean_space_ertr::pass_further{},
+    crimson::ct_error::assert_all{
+      "SegmentCleaner::clean_space encountered invalid error in release_segment"
+    }
+  ).safe_then([this, FNAME, segment_to_release] {
+    auto old_usage = calc_utilization(segment_to_release);
+    if(unlikely(old_usage != 0)) {
+      space_tracker->dump_usage(segment_to_release);
+      ERROR("segment {} old_usage {} != 0",
+             segment_to_release, old_usage);
+      ceph_abort();
+    }
+    segments.mark_empty(segment_to_release);
+    auto new_usage = calc_utilization(segment_to_release);
+    adjust_segment_util(old_usage, new_usage);
+    INFO("reclaim released {}, {}",
+         segment_to_release, stat_printer_t{*this, false});
+    background_callback->maybe_wake_blocked_io();
+  });
+}
+
 SegmentCleaner::clean_space_ret SegmentCleaner::clean_space()
 {
   LOG_PREFIX(SegmentCleaner::clean_space);
   assert(background_callback->is_ready());
   ceph_assert(can_clean_space());
-  if (!reclaim_state) {
+  while (reclaim_states.size() < config.max_reclaiming_segments) {
     segment_id_t seg_id = get_next_reclaim_segment();
+    if (seg_id == NULL_SEG_ID) {
+      break;
+    }
     auto &segment_info = segments[seg_id];
     INFO("reclaim start... {} {}, usage={}, time_bound={}",
          seg_id, segment_info,
          space_tracker->calc_utilization(seg_id),
          sea_time_point_printer_t{segments.get_time_bound()});
     ceph_assert(segment_info.is_closed());
-    reclaim_state = reclaim_state_t::create(
-        seg_id, segment_info.generation, segments.get_segment_size());
+    reclaim_states.push_back(reclaim_state_t::create(
+        seg_id, segment_info.generation, segments.get_segment_size()));
+  }
+  ceph_assert(!reclaim_states.empty());
+  for (auto &state : reclaim_states) {
+    state.advance(config.reclaim_bytes_per_cycle);
+    DEBUG("reclaiming {} {}~{}",
+          rewrite_gen_printer_t{state.generation},
+          state.start_pos,
+          state.end_pos);
   }
-  reclaim_state->advance(config.reclaim_bytes_per_cycle);
-
-  DEBUG("reclaiming {} {}~{}",
-        rewrite_gen_printer_t{reclaim_state->generation},
-        reclaim_state->start_pos,
-        reclaim_state->end_pos);
   double pavail_ratio = get_projected_available_ratio();
   sea_time_point start = seastar::lowres_system_clock::now();
 
   // Backref-tree doesn't support tree-read during tree-updates with parallel
   // transactions.  So, concurrent transactions between trim and reclaim are
-  // not allowed right now.
+  // not allowed right now, the segments are reclaimed together in the same
+  // transaction instead.
   return seastar::do_with(
-    std::pair<std::vector<CachedExtentRef>, backref_pin_list_t>(),
+    reclaim_ranges_t(),
     [this](auto &weak_read_ret) {
     return repeat_eagain([this, &weak_read_ret] {
+      weak_read_ret.clear();
+      weak_read_ret.resize(reclaim_states.size());
       // Note: not tracked by shard_stats_t intentionally.
       return extent_callback->with_transaction_intr(
 	  Transaction::src_t::READ,
 	  "retrieve_from_backref_tree",
 	  [this, &weak_read_ret](auto &t) {
-	return backref_manager.get_mappings(
-	  t,
-	  reclaim_state->start_pos,
-	  reclaim_state->end_pos
-	).si_then([this, &t, &weak_read_ret](auto pin_list) {
-	  if (!pin_list.empty()) {
-	    auto it = pin_list.begin();
-	    auto &first_pin = *it;
-	    if (first_pin->get_key() < reclaim_state->start_pos) {
-	      // BackrefManager::get_mappings may include a entry before
-	      // reclaim_state->start_pos, which is semantically inconsistent
-	      // with the requirements of the cleaner
-	      pin_list.erase(it);
-	    }
-	  }
-	  return backref_manager.retrieve_backref_extents_in_range(
+	return trans_intr::do_for_each(
+	  boost::make_counting_iterator<std::size_t>(0),
+	  boost::make_counting_iterator<std::size_t>(reclaim_states.size()),
+	  [this, &t, &weak_read_ret](auto i) {
+	  auto &state = reclaim_states[i];
+	  return backref_manager.get_mappings(
 	    t,
-	    reclaim_state->start_pos,
-	    reclaim_state->end_pos
-	  ).si_then([pin_list=std::move(pin_list),
-		    &weak_read_ret](auto extents) mutable {
-	    weak_read_ret = std::make_pair(std::move(extents), std::move(pin_list));
+	    state.start_pos,
+	    state.end_pos
+	  ).si_then([this, &t, &state, &range=weak_read_ret[i]](auto pin_list) {
+	    if (!pin_list.empty()) {
+	      auto it = pin_list.begin();
+	      auto &first_pin = *it;
+	      if (first_pin->get_key() < state.start_pos) {
+		// BackrefManager::get_mappings may include a entry before
+		// state.start_pos, which is semantically inconsistent
+		// with the requirements of the cleaner
+		pin_list.erase(it);
+	      }
+	    }
+	    return backref_manager.retrieve_backref_extents_in_range(
+	      t,
+	      state.start_pos,
+	      state.end_pos
+	    ).si_then([pin_list=std::move(pin_list),
+		      &range](auto extents) mutable {
+	      range.backref_extents = std::move(extents);
+	      range.pin_list = std::move(pin_list);
+	    });
 	  });
 	});
       });
@@ -1272,56 +1326,48 @@ SegmentCleaner::clean_space_ret SegmentCleaner::clean_space()
     });
   }).safe_then([this, FNAME, pavail_ratio, start](auto weak_read_ret) {
     return seastar::do_with(
-      std::move(weak_read_ret.first),
-      std::move(weak_read_ret.second),
-      (size_t)0,
+      std::move(weak_read_ret),
+      std::vector<std::size_t>(),
       (size_t)0,
       [this, FNAME, pavail_ratio, start](
-        auto &backref_extents, auto &pin_list, auto &reclaimed, auto &runs)
+        auto &ranges, auto &reclaimed, auto &runs)
     {
       return do_reclaim_space(
-          backref_extents,
-          pin_list,
+          ranges,
           reclaimed,
           runs
       ).safe_then([this, FNAME, pavail_ratio, start, &reclaimed, &runs] {
-        stats.reclaiming_bytes += reclaimed;
         auto d = seastar::lowres_system_clock::now() - start;
-        DEBUG("duration: {}, pavail_ratio before: {}, repeats: {}",
-              d, pavail_ratio, runs);
-        if (reclaim_state->is_complete()) {
-          auto segment_to_release = reclaim_state->get_segment_id();
+        DEBUG("duration: {}, pavail_ratio before: {}, repeats: {}, "
+              "segments: {}",
+              d, pavail_ratio, runs, reclaim_states.size());
+        std::vector<segment_id_t> segments_to_release;
+        auto it = reclaim_states.begin();
+        for (auto bytes : reclaimed) {
+          assert(it != reclaim_states.end());
+          it->reclaimed_bytes += bytes;
+          if (!it->is_complete()) {
+            ++it;
+            continue;
+          }
+          auto segment_to_release = it->get_segment_id();
           INFO("reclaim finish {}, reclaimed alive/total={}",
                segment_to_release,
-               stats.reclaiming_bytes/(double)segments.get_segment_size());
-          stats.reclaimed_bytes += stats.reclaiming_bytes;
+               it->reclaimed_bytes/(double)segments.get_segment_size());
+          stats.reclaimed_bytes += it->reclaimed_bytes;
           stats.reclaimed_segment_bytes += segments.get_segment_size();
-          stats.reclaiming_bytes = 0;
-          reclaim_state.reset();
-          return sm_group->release_segment(segment_to_release
-          ).handle_error(
-            clean_space_ertr::pass_further{},
-            crimson::ct_error::assert_all{
-              "SegmentCleaner::clean_space encountered invalid error in release_segment"
-            }
-          ).safe_then([this, FNAME, segment_to_release] {
-            auto old_usage = calc_utilization(segment_to_release);
-            if(unlikely(old_usage != 0)) {
-              space_tracker->dump_usage(segment_to_release);
-              ERROR("segment {} old_usage {} != 0",
-                     segment_to_release, old_usage);
-              ceph_abort();
-            }
-            segments.mark_empty(segment_to_release);
-            auto new_usage = calc_utilization(segment_to_release);
-            adjust_segment_util(old_usage, new_usage);
-            INFO("reclaim released {}, {}",
-                 segment_to_release, stat_printer_t{*this, false});
-            background_callback->maybe_wake_blocked_io();
-          });
-        } else {
-          return clean_space_ertr::now();
+          segments_to_release.push_back(segment_to_release);
+          it = reclaim_states.erase(it);
         }
+        return seastar::do_with(
+          std::move(segments_to_release),
+          [this](auto &segments_to_release) {
+          return crimson::do_for_each(
+            segments_to_release,
+            [this](auto segment_to_release) {
+            return release_reclaimed_segment(segment_to_release);
+          });
+        });
       });
     });
   });
@@ -1632,7 +1678,8 @@ segment_id_t SegmentCleaner::get_next_reclaim_segment() const
   for (auto& [_id, segment_info] : segments) {
     if (segment_info.is_closed() &&
         (trimmer == nullptr ||
-         !segment_info.is_in_journal(trimmer->get_journal_tail()))) {
+         !segment_info.is_in_journal(trimmer->get_journal_tail())) &&
+        !is_reclaiming(_id)) {
       double benefit_cost = calc_gc_benefit_cost(_id, now_time, bound_time);
       if (benefit_cost > max_benefit_cost) {
         id = _id;
@@ -1644,6 +1691,9 @@ segment_id_t SegmentCleaner::get_next_reclaim_segment() const
     DEBUG("segment {}, benefit_cost {}",
           id, max_benefit_cost);
     return id;
+  } else if (!reclaim_states.empty()) {
+    // all the reclaimable segments are being reclaimed
+    return NULL_SEG_ID;
   } else {
     ceph_assert(get_segments_reclaimable() == 0);
     // see should_clean_space()
@@ -18,6 +18,8 @@
 #include "crimson/os/seastore/transaction.h"
 #include "crimson/os/seastore/segment_seq_allocator.h"
 
+class transaction_manager_test_t;
+
 namespace crimson::os::seastore {
 
 /*
@@ -1222,29 +1224,34 @@ public:
     double available_ratio_hard_limit = 0;
     /// Ratio of minimum reclaimable space to stop reclaiming.
     double reclaim_ratio_gc_threshold = 0;
-    /// Number of bytes to reclaim per cycle
+    /// Number of bytes to reclaim per cycle from each reclaiming segment
     std::size_t reclaim_bytes_per_cycle = 0;
+    /// Maximum number of segments to reclaim concurrently
+    std::size_t max_reclaiming_segments = 0;
 
     void validate() const {
       ceph_assert(available_ratio_gc_max > available_ratio_hard_limit);
       ceph_assert(reclaim_bytes_per_cycle > 0);
+      ceph_assert(max_reclaiming_segments > 0);
     }
 
     static config_t get_default() {
       return config_t{
-        .15,  // available_ratio_gc_max
-        .1,   // available_ratio_hard_limit
-        .1,   // reclaim_ratio_gc_threshold
-        1<<20 // reclaim_bytes_per_cycle
+        .15,   // available_ratio_gc_max
+        .1,    // available_ratio_hard_limit
+        .1,    // reclaim_ratio_gc_threshold
+        1<<20, // reclaim_bytes_per_cycle
+        4      // max_reclaiming_segments
       };
     }
 
     static config_t get_test() {
       return config_t{
-        .99,  // available_ratio_gc_max
-        .2,   // available_ratio_hard_limit
-        .6,   // reclaim_ratio_gc_threshold
-        1<<20 // reclaim_bytes_per_cycle
+        .99,   // available_ratio_gc_max
+        .2,    // available_ratio_hard_limit
+        .6,    // reclaim_ratio_gc_threshold
+        1<<20, // reclaim_bytes_per_cycle
+        2      // max_reclaiming_segments
       };
     }
   };
@@ -1382,7 +1389,7 @@ public:
   }
 
   std::size_t get_reclaim_size_per_cycle() const final {
-    return config.reclaim_bytes_per_cycle;
+    return config.reclaim_bytes_per_cycle * config.max_reclaiming_segments;
   }
 
   // Testing interfaces
@@ -1390,6 +1397,8 @@ public:
   bool check_usage() final;
 
 private:
+  friend class ::transaction_manager_test_t;
+
   /*
    * 10 buckets for the number of closed segments by usage
    * 2 extra buckets for the number of open and empty segments
@@ -1422,6 +1431,7 @@ private:
       const sea_time_point &now_time,
       const sea_time_point &bound_time) const;
 
+  /// the closed segment with the highest benefit-cost not being reclaimed
   segment_id_t get_next_reclaim_segment() const;
 
   struct reclaim_state_t {
@@ -1430,6 +1440,8 @@ private:
     segment_off_t segment_size;
     paddr_t start_pos;
     paddr_t end_pos;
+    // live bytes rewritten from the segment so far
+    std::size_t reclaimed_bytes = 0;
 
     static reclaim_state_t create(
         segment_id_t segment_id,
@@ -1474,15 +1486,35 @@ private:
       }
     }
   };
-  std::optional<reclaim_state_t> reclaim_state;
+  /*
+   * The segments being reclaimed, at most config.max_reclaiming_segments.
+   *
+   * Each cycle advances all of them by config.reclaim_bytes_per_cycle in a
+   * single transaction, so the extents read per cycle stay bounded while
+   * the rewrites of several victims are batched together.
+   */
+  std::vector<reclaim_state_t> reclaim_states;
+
+  bool is_reclaiming(segment_id_t id) const {
+    return std::any_of(
+      reclaim_states.begin(), reclaim_states.end(),
+      [id](auto &state) { return state.get_segment_id() == id; });
+  }
+
+  /// the backref extents and mappings of a reclaim_state_t range
+  struct reclaim_range_t {
+    std::vector<CachedExtentRef> backref_extents;
+    backref_pin_list_t pin_list;
+  };
+  using reclaim_ranges_t = std::vector<reclaim_range_t>;
 
   using do_reclaim_space_ertr = base_ertr;
   using do_reclaim_space_ret = do_reclaim_space_ertr::future<>;
   do_reclaim_space_ret do_reclaim_space(
-    const std::vector<CachedExtentRef> &backref_extents,
-    const backref_pin_list_t &pin_list,
-    std::size_t &reclaimed,
+    const reclaim_ranges_t &ranges,
+    std::vector<std::size_t> &reclaimed,
     std::size_t &runs);
+  clean_space_ret release_reclaimed_segment(segment_id_t segment);
 
   /*
    * Segments calculations
@@ -1615,7 +1647,6 @@ private:
     uint64_t closed_ool_used_bytes = 0;
     uint64_t closed_ool_total_bytes = 0;
 
-    uint64_t reclaiming_bytes = 0;
     uint64_t reclaimed_bytes = 0;
     uint64_t reclaimed_segment_bytes = 0;
 
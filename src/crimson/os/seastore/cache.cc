@@ -41,7 +41,11 @@ Cache::Cache(
   ExtentPlacementManager &epm)
   : epm(epm),
     lru(crimson::common::get_conf<Option::size_t>(
-	  "seastore_cache_lru_size"))
+	  "seastore_cache_lru_size"),
+	crimson::common::get_conf<double>(
+	  "seastore_cache_lru_probation_ratio"),
+	crimson::common::get_conf<double>(
+	  "seastore_cache_lru_ghost_ratio"))
 {
   LOG_PREFIX(Cache::Cache);
   INFO("created, lru_capacity={}B", lru.get_capacity_bytes());
@@ -226,6 +230,40 @@ void Cache::register_metrics()
       ),
     }
   );
+  for (auto& [ext, ext_label] : labels_by_ext) {
+    auto sum_by_src = [this, ext=ext](auto get) {
+      uint64_t ret = 0;
+      for (auto &access_by_ext : stats.access_by_src_ext) {
+        ret += get(get_by_ext(access_by_ext, ext));
+      }
+      return ret;
+    };
+    metrics.add_group(
+      "cache",
+      {
+        sm::make_counter(
+          "cache_access_by_extent",
+          [sum_by_src] {
+            return sum_by_src([](const extent_access_stats_t &s) {
+              return s.get_estimated_cache_access();
+            });
+          },
+          sm::description("estimated number of cache accesses by extent type"),
+          {ext_label}
+        ),
+        sm::make_counter(
+          "cache_hit_by_extent",
+          [sum_by_src] {
+            return sum_by_src([](const extent_access_stats_t &s) {
+              return s.get_cache_hit();
+            });
+          },
+          sm::description("total number of cache hits by extent type"),
+          {ext_label}
+        ),
+      }
+    );
+  }
 
   {
     /*
@@ -527,6 +565,34 @@ void Cache::register_metrics()
 	},
 	sm::description("total extents pinned by the lru")
       ),
+      sm::make_counter(
+	"cache_lru_probation_size_bytes",
+	[this] {
+	  return lru.get_probation_size_bytes();
+	},
+	sm::description("bytes pinned by the lru that were accessed once")
+      ),
+      sm::make_counter(
+	"cache_lru_probation_num_extents",
+	[this] {
+	  return lru.get_probation_num_extents();
+	},
+	sm::description("extents pinned by the lru that were accessed once")
+      ),
+      sm::make_counter(
+	"cache_lru_promoted",
+	[this] {
+	  return lru.get_num_promoted();
+	},
+	sm::description("total number of extents promoted during probation")
+      ),
+      sm::make_counter(
+	"cache_lru_ghost_hits",
+	[this] {
+	  return lru.get_num_ghost_hits();
+	},
+	sm::description("total number of extents reloaded soon after eviction")
+      ),
     }
   );
 
@@ -1174,6 +1240,9 @@ CachedExtentRef Cache::duplicate_for_write(
     return i;
   }
 
+  // a compressed extent is only ever replaced as a whole, replaying a
+  // delta on top of it would need to decompress the base first
+  ceph_assert(!i->is_compressed());
   auto ret = i->duplicate_for_write(t);
   ret->pending_for_transaction = t.get_trans_id();
   ret->prior_instance = i;
@@ -1353,7 +1422,7 @@ record_t Cache::prepare_record(
       rel_delta.alloc_blk_ranges.emplace_back(
 	extent->get_paddr(),
 	L_ADDR_NULL,
-	extent->get_length(),
+	extent->get_disk_length(),
 	extent->get_type());
     }
   }
@@ -1428,7 +1497,7 @@ record_t Cache::prepare_record(
 	i->is_logical()
 	? i->cast<LogicalCachedExtent>()->get_laddr()
 	: i->cast<lba_manager::btree::LBANode>()->get_node_meta().begin,
-	i->get_length(),
+	i->get_disk_length(),
 	i->get_type());
     }
   }
@@ -1674,12 +1743,12 @@ void Cache::complete_commit(
     assert(!i->is_dirty());
     const auto t_src = t.get_src();
     touch_extent(*i, &t_src);
-    epm.commit_space_used(i->get_paddr(), i->get_length());
+    epm.commit_space_used(i->get_paddr(), i->get_disk_length());
     if (is_backref_mapped_extent_node(i)) {
       DEBUGT("backref_list new {} len {}",
 	     t,
 	     i->get_paddr(),
-	     i->get_length());
+	     i->get_disk_length());
       backref_list.emplace_back(
 	std::make_unique<backref_entry_t>(
 	  i->get_paddr(),
@@ -1688,7 +1757,7 @@ void Cache::complete_commit(
 	  : (is_lba_node(i->get_type())
 	    ? i->cast<lba_manager::btree::LBANode>()->get_node_meta().begin
 	    : L_ADDR_NULL),
-	  i->get_length(),
+	  i->get_disk_length(),
 	  i->get_type(),
 	  start_seq));
     } else if (is_backref_node(i->get_type())) {
@@ -1724,7 +1793,8 @@ void Cache::complete_commit(
 
   for (auto &i: t.retired_set) {
     auto &extent = i.extent;
-    epm.mark_space_free(extent->get_paddr(), extent->get_length());
+    epm.mark_space_free(extent->get_paddr(), extent->get_disk_length());
+    lru.on_space_freed(extent->get_paddr(), extent->get_disk_length());
   }
   for (auto &i: t.existing_block_list) {
     if (i->is_valid()) {
@@ -1748,12 +1818,12 @@ void Cache::complete_commit(
       DEBUGT("backref_list free {} len {}",
 	     t,
 	     extent->get_paddr(),
-	     extent->get_length());
+	     extent->get_disk_length());
       backref_list.emplace_back(
 	std::make_unique<backref_entry_t>(
 	  extent->get_paddr(),
 	  L_ADDR_NULL,
-	  extent->get_length(),
+	  extent->get_disk_length(),
 	  extent->get_type(),
 	  start_seq));
     } else if (is_backref_node(extent->get_type())) {
@@ -2438,7 +2508,8 @@ void Cache::LRU::get_stats(
 {
   LOG_PREFIX(Cache::LRU::get_stats);
 
-  stats.lru_sizes = cache_size_stats_t{current_size, lru.size()};
+  stats.lru_sizes = cache_size_stats_t{
+    current_size, get_current_num_extents()};
   stats.lru_io = overall_io;
   stats.lru_io.minus(last_overall_io);
 
@@ -2483,6 +2554,10 @@ void Cache::LRU::get_stats(
     oss << "\n  data" << data_sizes
         << "\n  mdat" << mdat_sizes
         << "\n  phys" << phys_sizes;
+    oss << "\n  probation"
+        << cache_size_stats_t{probation_size, probation.size()}
+        << ", promoted " << num_promoted
+        << ", ghost hits " << num_ghost_hits;
 
     oss << "\nlru io: trans-"
         << cache_io_stats_printer_t{seconds, trans_io}
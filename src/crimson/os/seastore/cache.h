@@ -4,6 +4,8 @@
 #pragma once
 
 #include <iostream>
+#include <list>
+#include <map>
 
 #include "seastar/core/shared_future.hh"
 
@@ -656,10 +658,12 @@ private:
       SUBDEBUG(seastore_cache,
           "{} {}~{} is absent, add extent and reading ... -- {}",
           T::TYPE, offset, length, *ret);
+      // extent_init_func() may set the compressed length, which decides
+      // the range the extent covers in extents_index
+      extent_init_func(*ret);
       add_extent(ret);
       // touch_extent() should be included in on_cache
       on_cache(*ret);
-      extent_init_func(*ret);
       return read_extent<T>(
 	std::move(ret));
     }
@@ -676,6 +680,7 @@ private:
       SUBDEBUG(seastore_cache,
           "{} {}~{} is absent(placeholder), reading ... -- {}",
           T::TYPE, offset, length, *ret);
+      extent_init_func(*ret);
       extents_index.replace(*ret, *cached);
       on_cache(*ret);
 
@@ -686,7 +691,6 @@ private:
       }
 
       cached->state = CachedExtent::extent_state_t::INVALID;
-      extent_init_func(*ret);
       return read_extent<T>(
 	std::move(ret));
     } else if (!cached->is_fully_loaded()) {
@@ -1442,6 +1446,11 @@ private:
 	is_logical_type(ext.get_type())) {
       return;
     }
+    if (p_src && ext.is_logical() && ext.is_stable()) {
+      epm.record_access(
+	static_cast<LogicalCachedExtent&>(ext).get_laddr(),
+	ext.get_paddr());
+    }
     if (ext.is_stable_clean() && !ext.is_placeholder()) {
       lru.move_to_top(ext, p_src);
     }
@@ -1499,41 +1508,108 @@ private:
 
   friend class crimson::os::seastore::backref::BtreeBackrefManager;
   friend class crimson::os::seastore::BackrefManager;
+  friend class ::cache_test_t;
 
   /**
    * lru
    *
-   * holds references to recently used extents
+   * holds references to recently used extents, replaced with 2Q so that a
+   * single pass over many extents (backfill, scrub, large reads) cannot
+   * flush the working set:
+   * - probation: FIFO of the extents accessed once, bounded by
+   *   seastore_cache_lru_probation_ratio of the capacity;
+   * - protected: LRU of the extents accessed again while cached, or soon
+   *   after being evicted from probation;
+   * - ghost: paddrs recently evicted from probation, without their data.
+   *
+   * Metadata extents are promoted on their second access in probation.
+   * Data extents are only promoted through the ghost queue, because their
+   * correlated accesses (e.g. a partial overwrite right after the read)
+   * would otherwise make every scanned extent look hot.
    */
   class LRU {
     // max size (bytes)
     const size_t capacity = 0;
 
+    // max size of probation (bytes)
+    const size_t probation_capacity = 0;
+
+    // max size of the extents remembered by ghost (bytes)
+    const size_t ghost_capacity = 0;
+
     // current size (bytes)
     size_t current_size = 0;
 
+    // current size of probation (bytes)
+    size_t probation_size = 0;
+
     counter_by_extent_t<cache_size_stats_t> sizes_by_ext;
     cache_io_stats_t overall_io;
     counter_by_src_t<counter_by_extent_t<cache_io_stats_t> >
       trans_io_by_src_ext;
+    uint64_t num_promoted = 0;
+    uint64_t num_ghost_hits = 0;
 
     mutable cache_io_stats_t last_overall_io;
     mutable cache_io_stats_t last_trans_io;
     mutable counter_by_src_t<counter_by_extent_t<cache_io_stats_t> >
       last_trans_io_by_src_ext;
 
-    CachedExtent::primary_ref_list lru;
+    CachedExtent::primary_ref_list probation;
+    CachedExtent::primary_ref_list protected_list;
+
+    struct ghost_entry_t {
+      paddr_t paddr;
+      extent_len_t length;
+    };
+    using ghost_list_t = std::list<ghost_entry_t>;
+    ghost_list_t ghost;
+    std::map<paddr_t, ghost_list_t::iterator> ghost_index;
+    size_t ghost_size = 0;
+
+    void add_to_ghost(paddr_t paddr, extent_len_t length) {
+      if (ghost_capacity == 0) {
+        return;
+      }
+      remove_from_ghost(paddr);
+      auto iter = ghost.insert(ghost.end(), ghost_entry_t{paddr, length});
+      ghost_index.emplace(paddr, iter);
+      ghost_size += length;
+      while (ghost_size > ghost_capacity) {
+        remove_from_ghost(ghost.front().paddr);
+      }
+    }
+
+    bool remove_from_ghost(paddr_t paddr) {
+      auto iter = ghost_index.find(paddr);
+      if (iter == ghost_index.end()) {
+        return false;
+      }
+      assert(ghost_size >= iter->second->length);
+      ghost_size -= iter->second->length;
+      ghost.erase(iter->second);
+      ghost_index.erase(iter);
+      return true;
+    }
 
     void do_remove_from_lru(
         CachedExtent &extent,
         const Transaction::src_t* p_src) {
       assert(extent.is_stable_clean() && !extent.is_placeholder());
       assert(extent.primary_ref_list_hook.is_linked());
-      assert(lru.size() > 0);
       auto extent_length = extent.get_length();
       assert(current_size >= extent_length);
 
-      lru.erase(lru.s_iterator_to(extent));
+      if (extent.lru_protected) {
+        assert(protected_list.size() > 0);
+        protected_list.erase(protected_list.s_iterator_to(extent));
+        extent.lru_protected = false;
+      } else {
+        assert(probation.size() > 0);
+        assert(probation_size >= extent_length);
+        probation.erase(probation.s_iterator_to(extent));
+        probation_size -= extent_length;
+      }
       current_size -= extent_length;
       get_by_ext(sizes_by_ext, extent.get_type()).account_out(extent_length);
       overall_io.out_sizes.account_in(extent_length);
@@ -1546,8 +1622,24 @@ private:
       intrusive_ptr_release(&extent);
     }
 
+    /// evict one extent, from probation unless it is within its share
+    void evict(const Transaction::src_t* p_src) {
+      if (!probation.empty() &&
+          (probation_size > probation_capacity || protected_list.empty())) {
+        auto &extent = probation.front();
+        add_to_ghost(extent.get_paddr(), extent.get_length());
+        do_remove_from_lru(extent, p_src);
+      } else {
+        assert(!protected_list.empty());
+        do_remove_from_lru(protected_list.front(), p_src);
+      }
+    }
+
   public:
-    LRU(size_t capacity) : capacity(capacity) {}
+    LRU(size_t capacity, double probation_ratio, double ghost_ratio)
+      : capacity(capacity),
+        probation_capacity(capacity * probation_ratio),
+        ghost_capacity(capacity * ghost_ratio) {}
 
     size_t get_capacity_bytes() const {
       return capacity;
@@ -1558,7 +1650,27 @@ private:
     }
 
     size_t get_current_num_extents() const {
-      return lru.size();
+      return probation.size() + protected_list.size();
+    }
+
+    size_t get_probation_size_bytes() const {
+      return probation_size;
+    }
+
+    size_t get_probation_num_extents() const {
+      return probation.size();
+    }
+
+    uint64_t get_num_promoted() const {
+      return num_promoted;
+    }
+
+    uint64_t get_num_ghost_hits() const {
+      return num_ghost_hits;
+    }
+
+    size_t get_ghost_size_bytes() const {
+      return ghost_size;
     }
 
     void get_stats(
@@ -1566,6 +1678,19 @@ private:
         bool report_detail,
         double seconds) const;
 
+    /// forget the evicted extents within the freed space, which may be
+    /// reused by new extents that must not inherit their history
+    void on_space_freed(paddr_t paddr, extent_len_t length) {
+      auto end = paddr.add_offset(length);
+      for (auto iter = ghost_index.lower_bound(paddr);
+           iter != ghost_index.end() && iter->first < end;) {
+        assert(ghost_size >= iter->second->length);
+        ghost_size -= iter->second->length;
+        ghost.erase(iter->second);
+        iter = ghost_index.erase(iter);
+      }
+    }
+
     void remove_from_lru(CachedExtent &extent) {
       assert(extent.is_stable_clean() && !extent.is_placeholder());
 
@@ -1581,11 +1706,22 @@ private:
 
       auto extent_length = extent.get_length();
       if (extent.primary_ref_list_hook.is_linked()) {
-        // present, move to top (back)
-        assert(lru.size() > 0);
         assert(current_size >= extent_length);
-        lru.erase(lru.s_iterator_to(extent));
-        lru.push_back(extent);
+        if (extent.lru_protected) {
+          // present, move to top (back)
+          assert(protected_list.size() > 0);
+          protected_list.erase(protected_list.s_iterator_to(extent));
+          protected_list.push_back(extent);
+        } else if (!is_data_type(extent.get_type())) {
+          // accessed again during probation, promote
+          assert(probation_size >= extent_length);
+          probation.erase(probation.s_iterator_to(extent));
+          probation_size -= extent_length;
+          extent.lru_protected = true;
+          protected_list.push_back(extent);
+          ++num_promoted;
+        }
+        // data extents keep their position in probation
       } else {
         // absent, add to top (back)
         current_size += extent_length;
@@ -1598,21 +1734,34 @@ private:
           ).in_sizes.account_in(extent_length);
         }
         intrusive_ptr_add_ref(&extent);
-        lru.push_back(extent);
+        if (remove_from_ghost(extent.get_paddr())) {
+          // evicted from probation not long ago, so it is reused
+          extent.lru_protected = true;
+          protected_list.push_back(extent);
+          ++num_ghost_hits;
+        } else {
+          probation.push_back(extent);
+          probation_size += extent_length;
+        }
 
         // trim to capacity
         while (current_size > capacity) {
-          do_remove_from_lru(lru.front(), p_src);
+          evict(p_src);
         }
       }
     }
 
     void clear() {
       LOG_PREFIX(Cache::LRU::clear);
-      for (auto iter = lru.begin(); iter != lru.end();) {
-	SUBDEBUG(seastore_cache, "clearing {}", *iter);
-	do_remove_from_lru(*(iter++), nullptr);
+      for (auto *list : {&probation, &protected_list}) {
+        for (auto iter = list->begin(); iter != list->end();) {
+          SUBDEBUG(seastore_cache, "clearing {}", *iter);
+          do_remove_from_lru(*(iter++), nullptr);
+        }
       }
+      ghost_index.clear();
+      ghost.clear();
+      ghost_size = 0;
     }
 
     ~LRU() {
@@ -1819,6 +1968,29 @@ private:
   /// Introspect transaction when it is being destructed
   void on_transaction_destruct(Transaction& t);
 
+  /// read the extent data from disk, decompressing it if needed
+  ExtentPlacementManager::read_ertr::future<> do_read_extent(
+    CachedExtent &extent
+  ) {
+    if (!extent.is_compressed()) {
+      return epm.read(
+        extent.get_paddr(),
+        extent.get_length(),
+        extent.get_bptr());
+    }
+    return epm.read_compressed(
+      extent.get_paddr(),
+      extent.get_compressed_length(),
+      extent.get_bptr()
+    ).safe_then([&extent](auto algorithm) {
+      // keep the extent compressed when it is rewritten
+      assert(extent.is_logical());
+      auto params = compression_params_t::from_config();
+      params.algorithm = algorithm;
+      static_cast<LogicalCachedExtent&>(extent).set_compression_params(params);
+    });
+  }
+
   template <typename T>
   read_extent_ret<T> read_extent(
     TCachedExtentRef<T>&& extent
@@ -1827,10 +1999,7 @@ private:
       extent->state == CachedExtent::extent_state_t::EXIST_CLEAN ||
       extent->state == CachedExtent::extent_state_t::CLEAN);
     extent->set_io_wait();
-    return epm.read(
-      extent->get_paddr(),
-      extent->get_length(),
-      extent->get_bptr()
+    return do_read_extent(*extent
     ).safe_then(
       [extent=std::move(extent), this]() mutable {
         LOG_PREFIX(Cache::read_extent);
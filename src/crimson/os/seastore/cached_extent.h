@@ -14,6 +14,7 @@
 #include "include/buffer.h"
 #include "crimson/common/errorator.h"
 #include "crimson/common/interruptible_future.h"
+#include "crimson/os/seastore/extent_compressor.h"
 #include "crimson/os/seastore/seastore_types.h"
 
 struct btree_lba_manager_test;
@@ -350,8 +351,11 @@ public:
 	<< ", modify_time=" << sea_time_point_printer_t{modify_time}
 	<< ", paddr=" << get_paddr()
 	<< ", prior_paddr=" << prior_poffset_str
-	<< ", length=" << get_length()
-	<< ", state=" << state
+	<< ", length=" << get_length();
+    if (is_compressed()) {
+      out << ", compressed_length=" << compressed_length;
+    }
+    out << ", state=" << state
 	<< ", last_committed_crc=" << last_committed_crc
 	<< ", refcount=" << use_count()
 	<< ", user_hint=" << user_hint
@@ -553,6 +557,30 @@ public:
     return length;
   }
 
+  /**
+   * get_disk_length
+   *
+   * Returns the length the extent occupies on disk, which is less than
+   * get_length() if the extent has been written compressed.
+   */
+  extent_len_t get_disk_length() const {
+    return compressed_length ? compressed_length : length;
+  }
+
+  /// Returns the compressed length, 0 if the extent is stored raw
+  extent_len_t get_compressed_length() const {
+    return compressed_length;
+  }
+
+  bool is_compressed() const {
+    return compressed_length != 0;
+  }
+
+  void set_compressed_length(extent_len_t len) {
+    assert(len < length);
+    compressed_length = len;
+  }
+
   extent_len_t get_loaded_length() const {
     if (ptr.has_value()) {
       return ptr->length();
@@ -689,6 +717,9 @@ private:
     CachedExtent,
     primary_ref_list_member_options>;
 
+  /// whether the extent is in the protected queue of Cache::LRU
+  bool lru_protected = false;
+
   /**
    * dirty_from_or_retired_at
    *
@@ -703,6 +734,9 @@ private:
   /// disk data length
   extent_len_t length;
 
+  /// length of the compressed on-disk image, 0 if stored raw
+  extent_len_t compressed_length = 0;
+
   /// number of deltas since initial write
   extent_version_t version = 0;
 
@@ -758,6 +792,7 @@ protected:
     : state(other.state),
       dirty_from_or_retired_at(other.dirty_from_or_retired_at),
       length(other.get_length()),
+      compressed_length(other.compressed_length),
       version(other.version),
       poffset(other.poffset) {
       assert((length % CEPH_PAGE_SIZE) == 0);
@@ -777,6 +812,7 @@ protected:
       dirty_from_or_retired_at(other.dirty_from_or_retired_at),
       ptr(other.ptr),
       length(other.get_length()),
+      compressed_length(other.compressed_length),
       version(other.version),
       poffset(other.poffset) {}
 
@@ -980,7 +1016,7 @@ public:
     if (bottom != extent_index.begin())
       --bottom;
     if (bottom != extent_index.end() &&
-	bottom->get_paddr().add_offset(bottom->get_length()) <= addr)
+	bottom->get_paddr().add_offset(bottom->get_disk_length()) <= addr)
       ++bottom;
 
     auto top = extent_index.lower_bound(addr.add_offset(len), paddr_cmp());
@@ -1005,7 +1041,7 @@ public:
     ceph_assert(!extent.parent_index);
     auto [a, b] = get_overlap(
       extent.get_paddr(),
-      extent.get_length());
+      extent.get_disk_length());
     ceph_assert(a == b);
 
     [[maybe_unused]] auto [iter, inserted] = extent_index.insert(extent);
@@ -1027,7 +1063,7 @@ public:
   }
 
   void replace(CachedExtent &to, CachedExtent &from) {
-    assert(to.get_length() == from.get_length());
+    assert(to.get_disk_length() == from.get_disk_length());
     extent_index.replace_node(extent_index.s_iterator_to(from), to);
     from.parent_index = nullptr;
     to.parent_index = this;
@@ -1143,6 +1179,9 @@ public:
     ceph_abort("impossible");
     return 0;
   }
+  // The on-disk length of a compressed extent, 0 if stored raw
+  virtual extent_len_t get_compressed_length() const { return 0; }
+  bool is_compressed() const { return get_compressed_length() != 0; }
   // The start offset of the pin, must be 0 if the pin is not indirect
   virtual extent_len_t get_intermediate_offset() const {
     return std::numeric_limits<extent_len_t>::max();
@@ -1326,6 +1365,7 @@ public:
     assert(get_type() == extent.get_type());
     auto &lextent = (LogicalCachedExtent&)extent;
     set_laddr((lextent.get_laddr() + off).checked_to_laddr());
+    compression = lextent.compression;
   }
 
   bool has_laddr() const {
@@ -1341,6 +1381,15 @@ public:
     laddr = nladdr;
   }
 
+  /// How the extent is compressed when written out of line
+  const compression_params_t &get_compression_params() const {
+    return compression;
+  }
+
+  void set_compression_params(const compression_params_t &params) {
+    compression = params;
+  }
+
   void maybe_set_intermediate_laddr(LBAMapping &mapping) {
     laddr = mapping.is_indirect()
       ? mapping.get_intermediate_base()
@@ -1392,6 +1441,8 @@ private:
   // the logical address of the extent, and if shared,
   // it is the intermediate_base, see BtreeLBAMapping comments.
   laddr_t laddr = L_ADDR_NULL;
+
+  compression_params_t compression;
 };
 
 using LogicalCachedExtentRef = TCachedExtentRef<LogicalCachedExtent>;
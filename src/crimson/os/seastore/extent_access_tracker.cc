@@ -0,0 +1,110 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 smarttab expandtab
+
+#include "crimson/os/seastore/extent_access_tracker.h"
+
+#include <algorithm>
+#include <bit>
+
+#include <seastar/core/metrics.hh>
+
+#include "crimson/os/seastore/logging.h"
+
+SET_SUBSYS(seastore_epm);
+
+namespace crimson::os::seastore {
+
+void ExtentAccessTracker::init(std::size_t width, unsigned threshold)
+{
+  LOG_PREFIX(ExtentAccessTracker::init);
+  hot_threshold = std::min<unsigned>(threshold, MAX_COUNT);
+  if (!is_enabled()) {
+    counters.clear();
+    INFO("disabled");
+    return;
+  }
+  width = std::bit_ceil(std::max<std::size_t>(width, 64));
+  width_mask = width - 1;
+  counters.assign(width * DEPTH, 0);
+  num_samples = 0;
+  sample_limit = width * 10;
+  INFO("width={}, hot_threshold={}", width, hot_threshold);
+}
+
+std::size_t ExtentAccessTracker::get_index(laddr_t laddr, unsigned row) const
+{
+  // splitmix64 finalizer, seeded differently for each row
+  uint64_t x = laddr_le_t{laddr}.laddr;
+  x += (row + 1) * 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return row * (width_mask + 1) + (x & width_mask);
+}
+
+void ExtentAccessTracker::record_access(laddr_t laddr, bool on_cold_tier)
+{
+  if (on_cold_tier) {
+    ++stats.cold_tier_accesses;
+  } else {
+    ++stats.main_tier_accesses;
+  }
+  if (!is_enabled()) {
+    return;
+  }
+  // conservative update: only raise the smallest counters, which keeps the
+  // estimate of the extents sharing a counter with a hot one lower
+  auto current = estimate(laddr);
+  if (current < MAX_COUNT) {
+    for (unsigned row = 0; row < DEPTH; ++row) {
+      auto &c = counters[get_index(laddr, row)];
+      if (c == current) {
+        ++c;
+      }
+    }
+  }
+  if (++num_samples >= sample_limit) {
+    age();
+  }
+}
+
+unsigned ExtentAccessTracker::estimate(laddr_t laddr) const
+{
+  assert(is_enabled());
+  uint8_t ret = MAX_COUNT;
+  for (unsigned row = 0; row < DEPTH; ++row) {
+    ret = std::min(ret, counters[get_index(laddr, row)]);
+  }
+  return ret;
+}
+
+void ExtentAccessTracker::age()
+{
+  for (auto &c : counters) {
+    c >>= 1;
+  }
+  num_samples /= 2;
+  ++stats.num_aged;
+}
+
+void ExtentAccessTracker::register_metrics()
+{
+  namespace sm = seastar::metrics;
+  metrics.clear();
+  metrics.add_group("multiple_tiers", {
+    sm::make_counter("main_tier_accesses", stats.main_tier_accesses,
+                     sm::description("accesses to the logical extents "
+                                     "stored on the main tier")),
+    sm::make_counter("cold_tier_accesses", stats.cold_tier_accesses,
+                     sm::description("accesses to the logical extents "
+                                     "stored on the cold tier")),
+    sm::make_counter("kept_on_main_tier", stats.num_kept_on_main_tier,
+                     sm::description("frequently accessed extents rewritten "
+                                     "to the main tier instead of being "
+                                     "evicted")),
+    sm::make_counter("access_sketch_aged", stats.num_aged,
+                     sm::description("times the access counters were halved"))
+  });
+}
+
+}
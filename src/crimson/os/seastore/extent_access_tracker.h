@@ -0,0 +1,76 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 smarttab expandtab
+
+#pragma once
+
+#include <vector>
+
+#include <seastar/core/metrics_registration.hh>
+
+#include "crimson/os/seastore/seastore_types.h"
+
+namespace crimson::os::seastore {
+
+/**
+ * ExtentAccessTracker
+ *
+ * Estimates how often the logical extents have been accessed recently with
+ * a count-min sketch of 4-bit saturating counters, so that the extents
+ * which are read often but never rewritten can be kept on the main tier
+ * when the cleaner would otherwise evict them to the cold tier.  All the
+ * counters are halved once the number of recorded accesses reaches ten
+ * times the width of the sketch, so the estimate follows the recent
+ * accesses only.
+ */
+class ExtentAccessTracker {
+public:
+  ExtentAccessTracker() = default;
+  ExtentAccessTracker(const ExtentAccessTracker &) = delete;
+  ExtentAccessTracker &operator=(const ExtentAccessTracker &) = delete;
+
+  /// width is rounded up to a power of two, threshold 0 disables tracking
+  void init(std::size_t width, unsigned hot_threshold);
+
+  bool is_enabled() const {
+    return hot_threshold > 0;
+  }
+
+  void record_access(laddr_t laddr, bool on_cold_tier);
+
+  /// the estimated number of recent accesses to laddr
+  unsigned estimate(laddr_t laddr) const;
+
+  bool is_hot(laddr_t laddr) const {
+    return is_enabled() && estimate(laddr) >= hot_threshold;
+  }
+
+  void account_kept_on_main_tier() {
+    ++stats.num_kept_on_main_tier;
+  }
+
+  void register_metrics();
+
+private:
+  static constexpr unsigned DEPTH = 4;
+  static constexpr uint8_t MAX_COUNT = 15;
+
+  std::size_t get_index(laddr_t laddr, unsigned row) const;
+  void age();
+
+  // DEPTH rows of width counters
+  std::vector<uint8_t> counters;
+  std::size_t width_mask = 0;
+  uint64_t num_samples = 0;
+  uint64_t sample_limit = 0;
+  unsigned hot_threshold = 0;
+
+  struct {
+    uint64_t main_tier_accesses = 0;
+    uint64_t cold_tier_accesses = 0;
+    uint64_t num_kept_on_main_tier = 0;
+    uint64_t num_aged = 0;
+  } stats;
+  seastar::metrics::metric_group metrics;
+};
+
+}
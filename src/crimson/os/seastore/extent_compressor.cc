@@ -0,0 +1,192 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 smarttab expandtab
+
+#include "crimson/os/seastore/extent_compressor.h"
+
+#include <seastar/core/metrics.hh>
+
+#include "crimson/common/config_proxy.h"
+#include "crimson/os/seastore/logging.h"
+
+SET_SUBSYS(seastore_epm);
+
+namespace crimson::os::seastore {
+
+compression_params_t compression_params_t::from_config()
+{
+  return resolve({}, {}, std::nullopt);
+}
+
+compression_params_t compression_params_t::resolve(
+  std::string_view mode,
+  std::string_view algorithm,
+  std::optional<double> required_ratio)
+{
+  auto conf_mode = crimson::common::get_conf<std::string>(
+    "seastore_compression_mode");
+  auto conf_algorithm = crimson::common::get_conf<std::string>(
+    "seastore_compression_algorithm");
+  if (mode.empty()) {
+    mode = conf_mode;
+  }
+  if (algorithm.empty()) {
+    algorithm = conf_algorithm;
+  }
+
+  compression_params_t ret;
+  // seastore has no allocation hints, so passive never compresses
+  auto m = Compressor::get_comp_mode_type(mode);
+  if (!m || *m == Compressor::COMP_NONE || *m == Compressor::COMP_PASSIVE) {
+    return ret;
+  }
+  ret.algorithm = Compressor::get_comp_alg_type(algorithm).value_or(
+    Compressor::COMP_ALG_NONE);
+  ret.required_ratio = required_ratio.value_or(
+    crimson::common::get_conf<double>("seastore_compression_required_ratio"));
+  return ret;
+}
+
+std::ostream &operator<<(std::ostream &out, const compression_params_t &p)
+{
+  out << "compression_params_t(";
+  if (p.is_enabled()) {
+    out << Compressor::get_comp_alg_name(p.algorithm)
+        << ", required_ratio=" << p.required_ratio;
+  } else {
+    out << "none";
+  }
+  return out << ")";
+}
+
+CompressorRef ExtentCompressor::get_compressor(
+  Compressor::CompressionAlgorithm algorithm)
+{
+  assert(algorithm > Compressor::COMP_ALG_NONE &&
+         algorithm < Compressor::COMP_ALG_LAST);
+  auto &ret = compressors[algorithm];
+  if (!ret) {
+    ret = Compressor::create(&cct, algorithm);
+  }
+  return ret;
+}
+
+std::optional<ceph::bufferlist> ExtentCompressor::compress(
+  const compression_params_t &params,
+  const ceph::bufferptr &raw,
+  extent_len_t block_size)
+{
+  LOG_PREFIX(ExtentCompressor::compress);
+  assert(params.is_enabled());
+  assert(raw.length() % block_size == 0);
+  if (!enabled) {
+    return std::nullopt;
+  }
+  auto compressor = get_compressor(params.algorithm);
+  if (!compressor) {
+    ERROR("unable to load compressor {}", params);
+    return std::nullopt;
+  }
+
+  ceph::bufferlist in;
+  in.append(raw);
+  ceph::bufferlist payload;
+  compression_header_t header;
+  header.algorithm = params.algorithm;
+  header.raw_length = raw.length();
+  if (int r = compressor->compress(in, payload, header.compressor_message);
+      r != 0) {
+    ERROR("{} failed to compress {} bytes, r={}", params, raw.length(), r);
+    ++stats.num_rejected;
+    return std::nullopt;
+  }
+  header.payload_length = payload.length();
+
+  ceph::bufferlist ret;
+  encode(header, ret);
+  ret.claim_append(payload);
+  auto image_length = p2roundup<extent_len_t>(ret.length(), block_size);
+  if (image_length >= raw.length() ||
+      image_length > raw.length() * params.required_ratio ||
+      // the LBA leaves can't record its length
+      !can_record_compressed_length(image_length)) {
+    TRACE("{} rejected, {} -> {}", params, raw.length(), image_length);
+    ++stats.num_rejected;
+    return std::nullopt;
+  }
+  ret.append_zero(image_length - ret.length());
+  // the writer expects a contiguous page aligned buffer like the raw extent
+  ret.rebuild_aligned(CEPH_PAGE_SIZE);
+
+  ++stats.num_compressed;
+  stats.raw_bytes += raw.length();
+  stats.compressed_bytes += image_length;
+  return ret;
+}
+
+std::optional<Compressor::CompressionAlgorithm> ExtentCompressor::decompress(
+  const ceph::bufferptr &image,
+  ceph::bufferptr &out)
+{
+  LOG_PREFIX(ExtentCompressor::decompress);
+  ceph::bufferlist in;
+  in.append(image);
+  compression_header_t header;
+  auto p = in.cbegin();
+  try {
+    decode(header, p);
+  } catch (const ceph::buffer::error &e) {
+    ERROR("unable to decode header: {}", e.what());
+    return std::nullopt;
+  }
+  auto algorithm = Compressor::CompressionAlgorithm(header.algorithm);
+  if (algorithm <= Compressor::COMP_ALG_NONE ||
+      algorithm >= Compressor::COMP_ALG_LAST ||
+      header.raw_length != out.length() ||
+      header.payload_length > p.get_remaining()) {
+    ERROR("invalid header: algorithm {}, raw_length {} (expected {}), "
+          "payload_length {} (at most {})",
+          header.algorithm, header.raw_length, out.length(),
+          header.payload_length, p.get_remaining());
+    return std::nullopt;
+  }
+  auto compressor = get_compressor(algorithm);
+  if (!compressor) {
+    ERROR("unable to load compressor {}",
+          Compressor::get_comp_alg_name(algorithm));
+    return std::nullopt;
+  }
+
+  ceph::bufferlist raw;
+  if (int r = compressor->decompress(
+        p, header.payload_length, raw, header.compressor_message);
+      r != 0 || raw.length() != out.length()) {
+    ERROR("{} failed to decompress {} bytes, r={}, got {} bytes",
+          compressor->get_type_name(), header.payload_length,
+          r, raw.length());
+    return std::nullopt;
+  }
+  raw.begin().copy(raw.length(), out.c_str());
+  ++stats.num_decompressed;
+  return algorithm;
+}
+
+void ExtentCompressor::register_metrics()
+{
+  namespace sm = seastar::metrics;
+  metrics.clear();
+  metrics.add_group("compression", {
+    sm::make_counter("compressed_extents", stats.num_compressed,
+                     sm::description("extents written compressed")),
+    sm::make_counter("rejected_extents", stats.num_rejected,
+                     sm::description("extents written raw because compression "
+                                     "did not save enough space")),
+    sm::make_counter("decompressed_extents", stats.num_decompressed,
+                     sm::description("compressed extents read")),
+    sm::make_counter("raw_bytes", stats.raw_bytes,
+                     sm::description("raw bytes of the compressed extents")),
+    sm::make_counter("compressed_bytes", stats.compressed_bytes,
+                     sm::description("on-disk bytes of the compressed extents"))
+  });
+}
+
+}
@@ -0,0 +1,137 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 smarttab expandtab
+
+#pragma once
+
+#include <array>
+#include <optional>
+
+#include <seastar/core/metrics_registration.hh>
+
+#include "compressor/Compressor.h"
+#include "common/ceph_context.h"
+#include "crimson/os/seastore/seastore_types.h"
+#include "include/denc.h"
+
+namespace crimson::os::seastore {
+
+/**
+ * compression_params_t
+ *
+ * How the data of a logical extent should be compressed when it is
+ * written out of line, COMP_ALG_NONE disables compression.
+ */
+struct compression_params_t {
+  Compressor::CompressionAlgorithm algorithm = Compressor::COMP_ALG_NONE;
+  // the compressed image must not exceed raw_length * required_ratio
+  double required_ratio = 1.0;
+
+  bool is_enabled() const {
+    return algorithm != Compressor::COMP_ALG_NONE;
+  }
+
+  /// the defaults of seastore_compression_*
+  static compression_params_t from_config();
+
+  /**
+   * resolve
+   *
+   * Combine the compression mode, algorithm and ratio of a pool with the
+   * defaults, an empty value means the pool does not specify it.
+   */
+  static compression_params_t resolve(
+    std::string_view mode,
+    std::string_view algorithm,
+    std::optional<double> required_ratio);
+};
+std::ostream &operator<<(std::ostream &out, const compression_params_t &p);
+
+/**
+ * compression_header_t
+ *
+ * Leads the on-disk image of a compressed extent, followed by the
+ * compressed payload and zero padding up to the block size.
+ */
+struct compression_header_t {
+  uint8_t algorithm = Compressor::COMP_ALG_NONE;
+  extent_len_t raw_length = 0;
+  extent_len_t payload_length = 0;
+  std::optional<int32_t> compressor_message;
+
+  DENC(compression_header_t, v, p) {
+    DENC_START(1, 1, p);
+    denc(v.algorithm, p);
+    denc(v.raw_length, p);
+    denc(v.payload_length, p);
+    denc(v.compressor_message, p);
+    DENC_FINISH(p);
+  }
+};
+
+/**
+ * ExtentCompressor
+ *
+ * Per-shard compressor instances shared by the out-of-line writers and the
+ * extent reads.  Compression only pays off if it frees at least one block,
+ * so the compressed image is always padded to the block size and discarded
+ * if it is not smaller than the raw extent.
+ */
+class ExtentCompressor {
+public:
+  ExtentCompressor() = default;
+  ExtentCompressor(const ExtentCompressor &) = delete;
+  ExtentCompressor &operator=(const ExtentCompressor &) = delete;
+
+  /**
+   * compress
+   *
+   * Returns the block aligned on-disk image of raw, or std::nullopt if the
+   * extent should be stored uncompressed.
+   */
+  std::optional<ceph::bufferlist> compress(
+    const compression_params_t &params,
+    const ceph::bufferptr &raw,
+    extent_len_t block_size);
+
+  /**
+   * decompress
+   *
+   * Decodes the on-disk image into out, which must be as large as the raw
+   * extent.  Returns the algorithm the image was compressed with, or
+   * std::nullopt if the image is corrupted.
+   */
+  std::optional<Compressor::CompressionAlgorithm> decompress(
+    const ceph::bufferptr &image,
+    ceph::bufferptr &out);
+
+  /// extents are only compressed on the stores whose format supports it
+  void set_enabled(bool e) {
+    enabled = e;
+  }
+
+  void register_metrics();
+
+private:
+  CompressorRef get_compressor(Compressor::CompressionAlgorithm algorithm);
+
+  crimson::common::CephContext cct;
+  bool enabled = false;
+  std::array<CompressorRef, Compressor::COMP_ALG_LAST> compressors;
+
+  struct {
+    uint64_t num_compressed = 0;
+    uint64_t num_rejected = 0;
+    uint64_t num_decompressed = 0;
+    uint64_t raw_bytes = 0;
+    uint64_t compressed_bytes = 0;
+  } stats;
+  seastar::metrics::metric_group metrics;
+};
+
+}
+
+WRITE_CLASS_DENC(crimson::os::seastore::compression_header_t)
+
+#if FMT_VERSION >= 90000
+template <> struct fmt::formatter<crimson::os::seastore::compression_params_t> : fmt::ostream_formatter {};
+#endif
@@ -14,7 +14,8 @@ SegmentedOolWriter::SegmentedOolWriter(
   data_category_t category,
   rewrite_gen_t gen,
   SegmentProvider& sp,
-  SegmentSeqAllocator &ssa)
+  SegmentSeqAllocator &ssa,
+  ExtentCompressor &compressor)
   : segment_allocator(nullptr, category, gen, sp, ssa),
     record_submitter(crimson::common::get_conf<uint64_t>(
                        "seastore_journal_iodepth_limit"),
@@ -24,7 +25,11 @@ SegmentedOolWriter::SegmentedOolWriter(
                        "seastore_journal_batch_flush_size"),
                      crimson::common::get_conf<double>(
                        "seastore_journal_batch_preferred_fullness"),
-                     segment_allocator)
+                     // ool records are waited by the transactions before
+                     // their journal records, don't delay them
+                     std::chrono::microseconds::zero(),
+                     segment_allocator),
+    compressor(compressor)
 {
 }
 
@@ -61,7 +66,7 @@ SegmentedOolWriter::write_record(
            extent_addr, *extent);
     t.update_delayed_ool_extent_addr(extent, extent_addr);
     extent_addr = extent_addr.as_seg_paddr().add_offset(
-        extent->get_length());
+        extent->get_disk_length());
   }
   return std::move(ret.future
   ).safe_then([this, FNAME, &t,
@@ -74,40 +79,63 @@ SegmentedOolWriter::write_record(
   });
 }
 
+SegmentedOolWriter::ool_image_t
+SegmentedOolWriter::prepare_image(CachedExtentRef &ext)
+{
+  assert(ext->is_logical());
+  auto extent = ext->template cast<LogicalCachedExtent>();
+  extent->prepare_write();
+  ceph::bufferlist bl;
+  std::optional<ceph::bufferlist> compressed;
+  if (extent->get_compression_params().is_enabled()) {
+    compressed = compressor.compress(
+      extent->get_compression_params(),
+      extent->get_bptr(),
+      segment_allocator.get_block_size());
+  }
+  if (compressed) {
+    extent->set_compressed_length(compressed->length());
+    bl = std::move(*compressed);
+  } else {
+    extent->set_compressed_length(0);
+    bl.append(extent->get_bptr());
+  }
+  assert(bl.length() == extent->get_disk_length());
+  return ool_image_t{std::move(extent), std::move(bl)};
+}
+
 SegmentedOolWriter::alloc_write_iertr::future<>
 SegmentedOolWriter::do_write(
   Transaction& t,
-  std::list<CachedExtentRef>& extents)
+  std::list<ool_image_t>& images)
 {
   LOG_PREFIX(SegmentedOolWriter::do_write);
-  assert(!extents.empty());
+  assert(!images.empty());
   if (!record_submitter.is_available()) {
     DEBUGT("{} extents={} wait ...",
            t, segment_allocator.get_name(),
-           extents.size());
+           images.size());
     return trans_intr::make_interruptible(
       record_submitter.wait_available()
-    ).si_then([this, &t, &extents] {
-      return do_write(t, extents);
+    ).si_then([this, &t, &images] {
+      return do_write(t, images);
     });
   }
   record_t record(record_type_t::OOL, t.get_src());
   std::list<LogicalCachedExtentRef> pending_extents;
   auto commit_time = seastar::lowres_system_clock::now();
 
-  for (auto it = extents.begin(); it != extents.end();) {
-    auto& ext = *it;
-    assert(ext->is_logical());
-    auto extent = ext->template cast<LogicalCachedExtent>();
+  for (auto it = images.begin(); it != images.end();) {
+    auto& extent = it->extent;
     record_size_t wouldbe_rsize = record.size;
-    wouldbe_rsize.account_extent(extent->get_bptr().length());
+    wouldbe_rsize.account_extent(it->bl.length());
     using action_t = journal::RecordSubmitter::action_t;
     action_t action = record_submitter.check_action(wouldbe_rsize);
     if (action == action_t::ROLL) {
       auto num_extents = pending_extents.size();
       DEBUGT("{} extents={} submit {} extents and roll, unavailable ...",
              t, segment_allocator.get_name(),
-             extents.size(), num_extents);
+             images.size(), num_extents);
       auto fut_write = alloc_write_ertr::now();
       if (num_extents > 0) {
         assert(record_submitter.check_action(record.size) !=
@@ -121,18 +149,14 @@ SegmentedOolWriter::do_write(
         ).safe_then([fut_write=std::move(fut_write)]() mutable {
           return std::move(fut_write);
         })
-      ).si_then([this, &t, &extents] {
-        return do_write(t, extents);
+      ).si_then([this, &t, &images] {
+        return do_write(t, images);
       });
     }
 
     TRACET("{} extents={} add extent to record -- {}",
            t, segment_allocator.get_name(),
-           extents.size(), *extent);
-    ceph::bufferlist bl;
-    extent->prepare_write();
-    bl.append(extent->get_bptr());
-    assert(bl.length() == extent->get_length());
+           images.size(), *extent);
     auto modify_time = extent->get_modify_time();
     if (modify_time == NULL_TIME) {
       modify_time = commit_time;
@@ -141,21 +165,21 @@ SegmentedOolWriter::do_write(
       extent_t{
         extent->get_type(),
         extent->get_laddr(),
-        std::move(bl)},
+        std::move(it->bl)},
       modify_time);
     pending_extents.push_back(extent);
-    it = extents.erase(it);
+    it = images.erase(it);
 
     assert(record_submitter.check_action(record.size) == action);
     if (action == action_t::SUBMIT_FULL) {
       DEBUGT("{} extents={} submit {} extents ...",
              t, segment_allocator.get_name(),
-             extents.size(), pending_extents.size());
+             images.size(), pending_extents.size());
       return trans_intr::make_interruptible(
         write_record(t, std::move(record), std::move(pending_extents))
-      ).si_then([this, &t, &extents] {
-        if (!extents.empty()) {
-          return do_write(t, extents);
+      ).si_then([this, &t, &images] {
+        if (!images.empty()) {
+          return do_write(t, images);
         } else {
           return alloc_write_iertr::now();
         }
@@ -182,7 +206,16 @@ SegmentedOolWriter::alloc_write_ool_extents(
     return alloc_write_iertr::now();
   }
   return seastar::with_gate(write_guard, [this, &t, &extents] {
-    return do_write(t, extents);
+    std::list<ool_image_t> images;
+    for (auto &ext : extents) {
+      images.push_back(prepare_image(ext));
+    }
+    extents.clear();
+    return seastar::do_with(
+      std::move(images),
+      [this, &t](auto &images) {
+      return do_write(t, images);
+    });
   });
 }
 
@@ -207,7 +240,7 @@ void ExtentPlacementManager::init(
     for (rewrite_gen_t gen = OOL_GENERATION; gen < MIN_COLD_GENERATION; ++gen) {
       writer_refs.emplace_back(std::make_unique<SegmentedOolWriter>(
 	    data_category_t::DATA, gen, *segment_cleaner,
-            *ool_segment_seq_allocator));
+            *ool_segment_seq_allocator, compressor));
       data_writers_by_gen[generation_to_writer(gen)] = writer_refs.back().get();
     }
 
@@ -215,7 +248,7 @@ void ExtentPlacementManager::init(
     for (rewrite_gen_t gen = OOL_GENERATION; gen < MIN_COLD_GENERATION; ++gen) {
       writer_refs.emplace_back(std::make_unique<SegmentedOolWriter>(
 	    data_category_t::METADATA, gen, *segment_cleaner,
-            *ool_segment_seq_allocator));
+            *ool_segment_seq_allocator, compressor));
       md_writers_by_gen[generation_to_writer(gen)] = writer_refs.back().get();
     }
 
@@ -244,13 +277,13 @@ void ExtentPlacementManager::init(
     for (rewrite_gen_t gen = MIN_COLD_GENERATION; gen < REWRITE_GENERATIONS; ++gen) {
       writer_refs.emplace_back(std::make_unique<SegmentedOolWriter>(
             data_category_t::DATA, gen, *cold_segment_cleaner,
-            *ool_segment_seq_allocator));
+            *ool_segment_seq_allocator, compressor));
       data_writers_by_gen[generation_to_writer(gen)] = writer_refs.back().get();
     }
     for (rewrite_gen_t gen = MIN_COLD_GENERATION; gen < REWRITE_GENERATIONS; ++gen) {
       writer_refs.emplace_back(std::make_unique<SegmentedOolWriter>(
             data_category_t::METADATA, gen, *cold_segment_cleaner,
-            *ool_segment_seq_allocator));
+            *ool_segment_seq_allocator, compressor));
       md_writers_by_gen[generation_to_writer(gen)] = writer_refs.back().get();
     }
     for (auto *device : cold_segment_cleaner->get_segment_manager_group()
@@ -265,9 +298,16 @@ void ExtentPlacementManager::init(
   if (cold_segment_cleaner) {
     ceph_assert(get_main_backend_type() == backend_type_t::SEGMENTED);
     ceph_assert(background_process.has_cold_tier());
+    access_tracker.init(
+      crimson::common::get_conf<uint64_t>(
+        "seastore_multiple_tiers_access_sketch_width"),
+      crimson::common::get_conf<uint64_t>(
+        "seastore_multiple_tiers_hot_access_threshold"));
+    access_tracker.register_metrics();
   } else {
     ceph_assert(!background_process.has_cold_tier());
   }
+  compressor.register_metrics();
 }
 
 void ExtentPlacementManager::set_primary_device(Device *device)
@@ -275,6 +315,7 @@ void ExtentPlacementManager::set_primary_device(Device *device)
   ceph_assert(primary_device == nullptr);
   primary_device = device;
   ceph_assert(devices_by_id[device->get_device_id()] == device);
+  compressor.set_enabled(device->get_meta().supports_compression());
 }
 
 device_stats_t
@@ -550,6 +591,31 @@ ExtentPlacementManager::close()
   });
 }
 
+ExtentPlacementManager::read_compressed_ret
+ExtentPlacementManager::read_compressed(
+  paddr_t addr,
+  extent_len_t disk_len,
+  ceph::bufferptr &out)
+{
+  return seastar::do_with(
+    ceph::bufferptr(buffer::create_page_aligned(disk_len)),
+    [this, addr, disk_len, &out](auto &image) {
+    return read(addr, disk_len, image
+    ).safe_then([this, addr, &image, &out]() -> read_compressed_ret {
+      LOG_PREFIX(ExtentPlacementManager::read_compressed);
+      auto algorithm = compressor.decompress(image, out);
+      if (!algorithm) {
+        ERROR("unable to decompress {}~{} into {} bytes",
+              addr, image.length(), out.length());
+        return crimson::ct_error::input_output_error::make();
+      }
+      return read_compressed_ret(
+        read_ertr::ready_future_marker{},
+        *algorithm);
+    });
+  });
+}
+
 void ExtentPlacementManager::BackgroundProcess::log_state(const char *caller) const
 {
   LOG_PREFIX(BackgroundProcess::log_state);
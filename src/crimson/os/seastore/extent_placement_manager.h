@@ -8,6 +8,8 @@
 
 #include "crimson/os/seastore/async_cleaner.h"
 #include "crimson/os/seastore/cached_extent.h"
+#include "crimson/os/seastore/extent_access_tracker.h"
+#include "crimson/os/seastore/extent_compressor.h"
 #include "crimson/os/seastore/journal/segment_allocator.h"
 #include "crimson/os/seastore/journal/record_submitter.h"
 #include "crimson/os/seastore/transaction.h"
@@ -71,7 +73,8 @@ public:
   SegmentedOolWriter(data_category_t category,
                      rewrite_gen_t gen,
                      SegmentProvider &sp,
-                     SegmentSeqAllocator &ssa);
+                     SegmentSeqAllocator &ssa,
+                     ExtentCompressor &compressor);
 
   backend_type_t get_type() const final {
     return backend_type_t::SEGMENTED;
@@ -111,9 +114,17 @@ public:
   }
 
 private:
+  // an extent with the image it is written with, compressed or not
+  struct ool_image_t {
+    LogicalCachedExtentRef extent;
+    ceph::bufferlist bl;
+  };
+  // prepared once, so that rolling the record doesn't compress it again
+  ool_image_t prepare_image(CachedExtentRef &ext);
+
   alloc_write_iertr::future<> do_write(
     Transaction& t,
-    std::list<CachedExtentRef> &extent);
+    std::list<ool_image_t> &images);
 
   alloc_write_ertr::future<> write_record(
     Transaction& t,
@@ -124,6 +135,7 @@ private:
   journal::SegmentAllocator segment_allocator;
   journal::RecordSubmitter record_submitter;
   seastar::gate write_guard;
+  ExtentCompressor &compressor;
 };
 
 
@@ -513,6 +525,20 @@ public:
     return devices_by_id[addr.get_device_id()]->read(addr, len, out);
   }
 
+  /**
+   * read_compressed
+   *
+   * Read the disk_len bytes of a compressed extent at addr and decompress
+   * them into out, which holds the raw extent.  Returns the algorithm the
+   * extent has been compressed with.
+   */
+  using read_compressed_ret =
+    read_ertr::future<Compressor::CompressionAlgorithm>;
+  read_compressed_ret read_compressed(
+    paddr_t addr,
+    extent_len_t disk_len,
+    ceph::bufferptr &out);
+
   void mark_space_used(paddr_t addr, extent_len_t len) {
     background_process.mark_space_used(addr, len);
   }
@@ -542,6 +568,44 @@ public:
     return primary_device->get_backend_type();
   }
 
+  /// record a foreground access to a logical extent
+  void record_access(laddr_t laddr, paddr_t paddr) {
+    if (!background_process.has_cold_tier() || !paddr.is_absolute()) {
+      return;
+    }
+    access_tracker.record_access(
+      laddr, background_process.is_cold_device(paddr.get_device_id()));
+  }
+
+  /**
+   * adjust_generation_by_access
+   *
+   * Keep the frequently accessed logical extents on the main tier when the
+   * cleaner is about to evict them to the cold tier, unless the main tier
+   * is so full that the eviction must not be held back.
+   */
+  rewrite_gen_t adjust_generation_by_access(
+      const CachedExtent &extent,
+      rewrite_gen_t gen) {
+    if (gen < MIN_COLD_GENERATION ||
+        !extent.is_logical() ||
+        !access_tracker.is_enabled() ||
+        background_process.is_fast_eviction()) {
+      return gen;
+    }
+    auto paddr = extent.get_paddr();
+    if (!paddr.is_absolute() ||
+        background_process.is_cold_device(paddr.get_device_id())) {
+      return gen;
+    }
+    auto &lextent = static_cast<const LogicalCachedExtent&>(extent);
+    if (!access_tracker.is_hot(lextent.get_laddr())) {
+      return gen;
+    }
+    access_tracker.account_kept_on_main_tier();
+    return MIN_COLD_GENERATION - 1;
+  }
+
   // Testing interfaces
 
   void test_init_no_background(Device *test_device) {
@@ -721,6 +785,16 @@ private:
       return cold_cleaner.get() != nullptr;
     }
 
+    bool is_cold_device(device_id_t id) const {
+      assert(has_cold_tier());
+      assert(id < cleaners_by_device_id.size());
+      return cleaners_by_device_id[id] == cold_cleaner.get();
+    }
+
+    bool is_fast_eviction() const {
+      return has_cold_tier() && eviction_state.is_fast_mode();
+    }
+
     void set_extent_callback(ExtentCallbackInterface *cb) {
       trimmer->set_extent_callback(cb);
       main_cleaner->set_extent_callback(cb);
@@ -1096,6 +1170,8 @@ private:
 
   rewrite_gen_t dynamic_max_rewrite_generation = REWRITE_GENERATIONS;
   BackgroundProcess background_process;
+  ExtentCompressor compressor;
+  ExtentAccessTracker access_tracker;
   // TODO: drop once paddr->journal_seq_t is introduced
   SegmentSeqAllocatorRef ool_segment_seq_allocator;
   extent_len_t max_data_allocation_size = 0;
@@ -28,6 +28,8 @@ CircularBoundedJournal::CircularBoundedJournal(
       "seastore_journal_batch_flush_size"),
     crimson::common::get_conf<double>(
       "seastore_journal_batch_preferred_fullness"),
+    std::chrono::microseconds(crimson::common::get_conf<uint64_t>(
+      "seastore_journal_group_commit_max_delay")),
     cjs)
   {}
 
@@ -3,6 +3,7 @@
 
 #include "record_submitter.h"
 
+#include <fmt/chrono.h>
 #include <fmt/format.h>
 #include <fmt/os.h>
 #include <fmt/std.h>
@@ -12,6 +13,22 @@
 
 SET_SUBSYS(seastore_journal);
 
+namespace {
+
+// the weight of a new sample in the moving averages
+constexpr double AVG_WEIGHT = 1.0 / 8;
+
+void update_avg(double &avg, double sample)
+{
+  if (avg == 0) {
+    avg = sample;
+  } else {
+    avg += (sample - avg) * AVG_WEIGHT;
+  }
+}
+
+}
+
 namespace crimson::os::seastore::journal {
 
 RecordBatch::add_pending_ret_t
@@ -137,17 +154,19 @@ RecordSubmitter::RecordSubmitter(
   std::size_t batch_capacity,
   std::size_t batch_flush_size,
   double preferred_fullness,
+  std::chrono::microseconds group_commit_max_delay,
   JournalAllocator& ja)
   : io_depth_limit{io_depth},
     preferred_fullness{preferred_fullness},
+    group_commit_max_delay{group_commit_max_delay},
     journal_allocator{ja},
     batches(new RecordBatch[io_depth + 1])
 {
   LOG_PREFIX(RecordSubmitter);
   INFO("{} io_depth_limit={}, batch_capacity={}, batch_flush_size={}, "
-       "preferred_fullness={}",
+       "preferred_fullness={}, group_commit_max_delay={}",
        get_name(), io_depth, batch_capacity,
-       batch_flush_size, preferred_fullness);
+       batch_flush_size, preferred_fullness, group_commit_max_delay);
   ceph_assert(io_depth > 0);
   ceph_assert(batch_capacity > 0);
   ceph_assert(preferred_fullness >= 0 &&
@@ -158,6 +177,16 @@ RecordSubmitter::RecordSubmitter(
     free_batch_ptrs.push_back(&batches[i]);
   }
   pop_free_batch();
+
+  group_commit_timer.set_callback([this] {
+    LOG_PREFIX(RecordSubmitter::group_commit_timer);
+    // otherwise the batch is flushed when the outstanding io finishes
+    if (p_current_batch->is_pending() && state == state_t::IDLE) {
+      DEBUG("{} {} records, flush", get_name(),
+            p_current_batch->get_num_records());
+      flush_current_batch();
+    }
+  });
 }
 
 bool RecordSubmitter::is_available() const
@@ -294,16 +323,25 @@ RecordSubmitter::submit(
   LOG_PREFIX(RecordSubmitter::submit);
   ceph_assert(is_available());
   assert(check_action(record.size) != action_t::ROLL);
+  account_submit_gap(clock_t::now());
   journal_allocator.update_modify_time(record);
   auto eval = p_current_batch->evaluate_submit(
       record.size, journal_allocator.get_block_size());
-  bool needs_flush = (
-      state == state_t::IDLE ||
+  bool is_batch_full = (
       eval.submit_size.get_fullness() > preferred_fullness ||
       // RecordBatch::needs_flush()
       eval.is_full ||
       p_current_batch->get_num_records() + 1 >=
         p_current_batch->get_batch_capacity());
+  // group commit: hold the idle batch for the records expected soon
+  auto group_commit_window = std::chrono::microseconds::zero();
+  if (state == state_t::IDLE && !is_batch_full) {
+    group_commit_window = get_group_commit_window();
+  }
+  bool needs_flush = (
+      (state == state_t::IDLE &&
+       group_commit_window == std::chrono::microseconds::zero()) ||
+      is_batch_full);
   if (p_current_batch->is_empty() &&
       needs_flush &&
       state != state_t::FULL) {
@@ -326,7 +364,9 @@ RecordSubmitter::submit(
         journal_allocator.get_written_to(),
         to_write.length()};
     auto write_fut = journal_allocator.write(std::move(to_write)
-    ).safe_then([mdlength=sizes.get_mdlength(), result] {
+    ).safe_then([this, mdlength=sizes.get_mdlength(), result,
+                 start=clock_t::now()] {
+      account_write_latency(start);
       return record_locator_t{
         result.start_seq.offset.add_offset(mdlength),
         result
@@ -379,11 +419,18 @@ RecordSubmitter::submit(
     }
   } else {
     // will flush later
-    DEBUG("{} added with {} pending, outstanding_io={}",
+    DEBUG("{} added with {} pending, outstanding_io={}, "
+          "group_commit_window={}",
           get_name(),
           p_current_batch->get_num_records(),
-          num_outstanding_io);
+          num_outstanding_io,
+          group_commit_window);
     assert(!p_current_batch->needs_flush());
+    if (group_commit_window != std::chrono::microseconds::zero() &&
+        !group_commit_timer.armed()) {
+      ++num_group_commit_delayed;
+      group_commit_timer.arm(group_commit_window);
+    }
   }
   return ret;
 }
@@ -397,6 +444,20 @@ RecordSubmitter::open(bool is_mkfs)
     DEBUG("{} register metrics", get_name());
     stats = {};
     last_stats = {};
+    avg_write_latency = 0;
+    avg_submit_gap = 0;
+    last_submit_time.reset();
+    num_group_commit_delayed = 0;
+    // power of 2 buckets up to the batch capacity
+    batch_size_histogram = {};
+    auto batch_capacity = p_current_batch->get_batch_capacity();
+    for (std::size_t bound = 1; ; bound *= 2) {
+      bound = std::min(bound, batch_capacity);
+      batch_size_histogram.buckets.push_back({0, (double)bound});
+      if (bound == batch_capacity) {
+        break;
+      }
+    }
     namespace sm = seastar::metrics;
     std::vector<sm::label_instance> label_instances;
     label_instances.push_back(sm::label_instance("submitter", get_name()));
@@ -439,6 +500,28 @@ RecordSubmitter::open(bool is_mkfs)
           sm::description("bytes of data when write record groups"),
           label_instances
         ),
+        sm::make_counter(
+          "group_commit_delayed_num",
+          num_group_commit_delayed,
+          sm::description("total number of idle batches delayed to group "
+                          "the records of concurrent transactions"),
+          label_instances
+        ),
+        sm::make_gauge(
+          "write_latency_avg_us",
+          avg_write_latency,
+          sm::description("moving average of the record write latency in "
+                          "microseconds"),
+          label_instances
+        ),
+        sm::make_histogram(
+          "record_batch_size",
+          [this]() -> seastar::metrics::histogram& {
+            return batch_size_histogram;
+          },
+          sm::description("the number of records written per io"),
+          label_instances
+        ),
       }
     );
     return ret;
@@ -456,6 +539,7 @@ RecordSubmitter::close()
   ceph_assert(!wait_available_promise.has_value());
   has_io_error = false;
   ceph_assert(!wait_unfull_flush_promise.has_value());
+  ceph_assert(!group_commit_timer.armed());
   metrics.clear();
   return journal_allocator.close();
 }
@@ -515,6 +599,13 @@ void RecordSubmitter::account_submission(
   stats.record_group_metadata_bytes += rg.size.get_raw_mdlength();
   stats.data_bytes += rg.size.dlength;
   stats.record_batch_stats.increment(rg.get_size());
+  ++batch_size_histogram.sample_count;
+  batch_size_histogram.sample_sum += rg.get_size();
+  for (auto &bucket : batch_size_histogram.buckets) {
+    if (rg.get_size() <= bucket.upper_bound) {
+      ++bucket.count;
+    }
+  }
 
   for (const record_t& r : rg.records) {
     auto src = r.trans_type;
@@ -526,6 +617,39 @@ void RecordSubmitter::account_submission(
   }
 }
 
+void RecordSubmitter::account_write_latency(clock_t::time_point start)
+{
+  std::chrono::duration<double, std::micro> latency = clock_t::now() - start;
+  update_avg(avg_write_latency, latency.count());
+}
+
+void RecordSubmitter::account_submit_gap(clock_t::time_point now)
+{
+  if (group_commit_max_delay == std::chrono::microseconds::zero()) {
+    return;
+  }
+  if (last_submit_time.has_value()) {
+    std::chrono::duration<double, std::micro> gap = now - *last_submit_time;
+    // cap the sample so that the average recovers quickly after idle
+    update_avg(avg_submit_gap, std::min(
+      gap.count(), 2.0 * group_commit_max_delay.count()));
+  }
+  last_submit_time = now;
+}
+
+std::chrono::microseconds RecordSubmitter::get_group_commit_window() const
+{
+  // wait at most half of a write, otherwise writing the record alone and
+  // batching the following ones behind it is faster
+  auto window = std::min<double>(
+    group_commit_max_delay.count(), avg_write_latency / 2);
+  if (window < 1 || avg_submit_gap == 0 || avg_submit_gap >= window) {
+    // the next record is not expected within the window
+    return std::chrono::microseconds::zero();
+  }
+  return std::chrono::microseconds(static_cast<int64_t>(window));
+}
+
 void RecordSubmitter::finish_submit_batch(
   RecordBatch* p_batch,
   maybe_result_t maybe_result)
@@ -541,6 +665,7 @@ void RecordSubmitter::flush_current_batch()
   LOG_PREFIX(RecordSubmitter::flush_current_batch);
   RecordBatch* p_batch = p_current_batch;
   assert(p_batch->is_pending());
+  group_commit_timer.cancel();
   p_current_batch = nullptr;
   pop_free_batch();
 
@@ -563,9 +688,11 @@ void RecordSubmitter::flush_current_batch()
         get_committed_to(), num_outstanding_io);
   assert(write_base == journal_allocator.get_written_to());
   std::ignore = journal_allocator.write(std::move(encode_ret.bl)
-  ).safe_then([this, p_batch, FNAME, num, sizes, write_len] {
+  ).safe_then([this, p_batch, FNAME, num, sizes, write_len,
+               start=clock_t::now()] {
     TRACE("{} {} records, {}, write done",
           get_name(), num, sizes);
+    account_write_latency(start);
     finish_submit_batch(p_batch, write_len);
   }).handle_error(
     crimson::ct_error::all_same_way([this, p_batch, FNAME, num, sizes](auto e) {
@@ -3,10 +3,12 @@
 
 #pragma once
 
+#include <chrono>
 #include <optional>
 #include <seastar/core/circular_buffer.hh>
 #include <seastar/core/metrics.hh>
 #include <seastar/core/shared_future.hh>
+#include <seastar/core/timer.hh>
 
 #include "include/buffer.h"
 
@@ -14,6 +16,8 @@
 #include "crimson/os/seastore/segment_manager_group.h"
 #include "crimson/os/seastore/segment_seq_allocator.h"
 
+class record_submitter_test_t;
+
 namespace crimson::os::seastore {
   class SegmentProvider;
   class JournalTrimmer;
@@ -229,6 +233,11 @@ private:
  * - batch_flush_size: the bytes threshold to force flush a RecordBatch to
  *   control the maximum latency;
  * - preferred_fullness: the fullness threshold to flush a RecordBatch;
+ * - group_commit_max_delay: the maximum time to hold a RecordBatch when
+ *   there is no outstanding io, so that the records of concurrent
+ *   transactions can be written together. The actual window adapts to the
+ *   observed write latency and is only applied when further records are
+ *   expected to arrive within it, 0 to disable;
  */
 class RecordSubmitter {
   enum class state_t {
@@ -241,11 +250,14 @@ class RecordSubmitter {
   using base_ertr = crimson::errorator<
       crimson::ct_error::input_output_error>;
 
+  friend class ::record_submitter_test_t;
+
 public:
   RecordSubmitter(std::size_t io_depth,
                   std::size_t batch_capacity,
                   std::size_t batch_flush_size,
                   double preferred_fullness,
+                  std::chrono::microseconds group_commit_max_delay,
 		  JournalAllocator&);
 
   const std::string& get_name() const {
@@ -321,6 +333,14 @@ private:
 
   void account_submission(const record_group_t&);
 
+  using clock_t = seastar::steady_clock_type;
+  void account_write_latency(clock_t::time_point start);
+
+  void account_submit_gap(clock_t::time_point now);
+
+  // the time to delay flushing an idle batch, 0 if not worth it
+  std::chrono::microseconds get_group_commit_window() const;
+
   using maybe_result_t = RecordBatch::maybe_result_t;
   void finish_submit_batch(RecordBatch*, maybe_result_t);
 
@@ -330,6 +350,7 @@ private:
   std::size_t num_outstanding_io = 0;
   std::size_t io_depth_limit;
   double preferred_fullness;
+  std::chrono::microseconds group_commit_max_delay;
 
   JournalAllocator& journal_allocator;
   // committed_to may be in a previous journal segment
@@ -347,6 +368,15 @@ private:
   // wait for decrement_io_with_flush()
   std::optional<seastar::promise<> > wait_unfull_flush_promise;
 
+  // flush the current batch when the group commit window is over
+  seastar::timer<clock_t> group_commit_timer;
+  // moving averages in microseconds
+  double avg_write_latency = 0;
+  double avg_submit_gap = 0;
+  std::optional<clock_t::time_point> last_submit_time;
+  uint64_t num_group_commit_delayed = 0;
+  seastar::metrics::histogram batch_size_histogram;
+
   writer_stats_t stats;
   mutable writer_stats_t last_stats;
 
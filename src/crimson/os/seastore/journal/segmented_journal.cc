@@ -44,6 +44,8 @@ SegmentedJournal::SegmentedJournal(
                        "seastore_journal_batch_flush_size"),
                      crimson::common::get_conf<double>(
                        "seastore_journal_batch_preferred_fullness"),
+                     std::chrono::microseconds(crimson::common::get_conf<uint64_t>(
+                       "seastore_journal_group_commit_max_delay")),
                      journal_segment_allocator),
     sm_group(*segment_provider.get_segment_manager_group()),
     trimmer{trimmer}
@@ -21,6 +21,7 @@ LBAManager::update_mappings(
       extent->get_length(),
       extent->get_paddr(),
       extent->get_last_committed_crc(),
+      extent->get_compressed_length(),
       nullptr	// all the extents should have already been
 		// added to the fixed_kv_btree
     ).discard_result();
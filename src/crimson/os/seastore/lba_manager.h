@@ -112,6 +112,12 @@ public:
     extent_ref_count_t refcount = 0;
     pladdr_t addr;
     extent_len_t length = 0;
+    // the length on disk if the extent is compressed, or 0
+    extent_len_t compressed_length = 0;
+
+    extent_len_t get_disk_length() const {
+      return compressed_length ? compressed_length : length;
+    }
   };
   using ref_iertr = base_iertr::extend<
     crimson::ct_error::enoent>;
@@ -220,6 +226,7 @@ public:
     extent_len_t len,
     paddr_t paddr,
     uint32_t checksum,
+    extent_len_t compressed_len,
     LogicalCachedExtent *nextent) = 0;
 
   /**
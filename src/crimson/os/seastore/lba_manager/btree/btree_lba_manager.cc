@@ -591,6 +591,7 @@ BtreeLBAManager::update_mapping(
   extent_len_t len,
   paddr_t addr,
   uint32_t checksum,
+  extent_len_t compressed_len,
   LogicalCachedExtent *nextent)
 {
   LOG_PREFIX(BtreeLBAManager::update_mapping);
@@ -598,7 +599,7 @@ BtreeLBAManager::update_mapping(
   return _update_mapping(
     t,
     laddr,
-    [prev_addr, addr, prev_len, len, checksum](
+    [prev_addr, addr, prev_len, len, checksum, compressed_len](
       const lba_map_val_t &in) {
       assert(!addr.is_null());
       lba_map_val_t ret = in;
@@ -608,6 +609,7 @@ BtreeLBAManager::update_mapping(
       ret.pladdr = addr;
       ret.len = len;
       ret.checksum = checksum;
+      ret.compressed_len = compressed_len;
       return ret;
     },
     nextent
@@ -713,7 +715,8 @@ BtreeLBAManager::_decref_intermediate(
 	    auto res = ref_update_result_t{
 	      val.refcount,
 	      val.pladdr.get_paddr(),
-	      val.len
+	      val.len,
+	      val.compressed_len
 	    };
 	    return ref_iertr::make_ready_future<
 	      std::optional<ref_update_result_t>>(
@@ -776,7 +779,8 @@ BtreeLBAManager::update_refcount(
 	  ref_update_result_t{
 	    map_value.refcount,
 	    map_value.pladdr,
-	    map_value.len
+	    map_value.len,
+	    map_value.compressed_len
 	  },
 	  std::move(mapping)
 	};
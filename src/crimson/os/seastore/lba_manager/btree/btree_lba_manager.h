@@ -145,6 +145,10 @@ public:
     return get_map_val().checksum;
   }
 
+  extent_len_t get_compressed_length() const final {
+    return get_map_val().compressed_len;
+  }
+
   void adjust_mutable_indirect_attrs(
     laddr_t new_key,
     extent_len_t length,
@@ -572,6 +576,7 @@ public:
     extent_len_t len,
     paddr_t paddr,
     uint32_t checksum,
+    extent_len_t compressed_len,
     LogicalCachedExtent*) final;
 
   get_physical_extent_if_live_ret get_physical_extent_if_live(
@@ -24,6 +24,7 @@ std::ostream& operator<<(std::ostream& out, const lba_map_val_t& v)
              << "~" << v.len
              << ", refcount=" << v.refcount
              << ", checksum=" << v.checksum
+             << ", compressed_len=" << v.compressed_len
              << ")";
 }
 
@@ -39,14 +39,17 @@ struct lba_map_val_t {
 			   //	laddr of a physical lba mapping(see btree_lba_manager.h)
   extent_ref_count_t refcount = 0; ///< refcount
   uint32_t checksum = 0; ///< checksum of original block written at paddr (TODO)
+  extent_len_t compressed_len = 0; ///< length on disk if compressed, or 0
 
   lba_map_val_t() = default;
   lba_map_val_t(
     extent_len_t len,
     pladdr_t pladdr,
     extent_ref_count_t refcount,
-    uint32_t checksum)
-    : len(len), pladdr(pladdr), refcount(refcount), checksum(checksum) {}
+    uint32_t checksum,
+    extent_len_t compressed_len = 0)
+    : len(len), pladdr(pladdr), refcount(refcount), checksum(checksum),
+      compressed_len(compressed_len) {}
   bool operator==(const lba_map_val_t&) const = default;
 };
 
@@ -122,6 +125,10 @@ constexpr size_t LEAF_NODE_CAPACITY = 140;
  * lba_map_val_le_t
  *
  * On disk layout for lba_map_val_t.
+ *
+ * compressed_len is kept in the bits of pladdr.addr_type that addr_type_t
+ * doesn't use, see COMPRESSED_LENGTH_UNIT, so that the leaves of stores
+ * with and without compressed extents share the same layout.
  */
 struct __attribute__((packed)) lba_map_val_le_t {
   extent_len_le_t len = init_extent_len_le(0);
@@ -135,10 +142,20 @@ struct __attribute__((packed)) lba_map_val_le_t {
     : len(init_extent_len_le(val.len)),
       pladdr(pladdr_le_t(val.pladdr)),
       refcount(val.refcount),
-      checksum(val.checksum) {}
+      checksum(val.checksum) {
+    assert(can_record_compressed_length(val.compressed_len));
+    pladdr.addr_type = static_cast<addr_type_t>(
+      static_cast<uint8_t>(pladdr.addr_type) |
+      ((val.compressed_len / COMPRESSED_LENGTH_UNIT) << ADDR_TYPE_BITS));
+  }
 
   operator lba_map_val_t() const {
-    return lba_map_val_t{ len, pladdr, refcount, checksum };
+    auto type = static_cast<uint8_t>(pladdr.addr_type);
+    pladdr_le_t addr = pladdr;
+    addr.addr_type = static_cast<addr_type_t>(type & ADDR_TYPE_MASK);
+    extent_len_t compressed_len =
+      (type >> ADDR_TYPE_BITS) * COMPRESSED_LENGTH_UNIT;
+    return lba_map_val_t{ len, addr, refcount, checksum, compressed_len };
   }
 };
 
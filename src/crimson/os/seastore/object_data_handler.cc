@@ -324,7 +324,8 @@ overwrite_ops_t prepare_ops_list(
 	  [&region, &to_remap](auto &r) {
 	    laddr_interval_set_t range;
 	    range.insert(r->get_key(), r->get_length());
-	    if (range.contains(region.addr, region.len) && !r->is_clone()) {
+	    if (range.contains(region.addr, region.len) && !r->is_clone() &&
+		!r->is_compressed()) {
 	      to_remap.push_back(extent_to_remap_t::create_overwrite(
 		0, region.len, std::move(r), *region.to_write));
 	      return true;
@@ -340,7 +341,8 @@ overwrite_ops_t prepare_ops_list(
 	  [&region, &to_remap](auto &r) {
 	    laddr_interval_set_t range;
 	    range.insert(r.pin->get_key(), r.pin->get_length());
-	    if (range.contains(region.addr, region.len) && !r.pin->is_clone()) {
+	    if (range.contains(region.addr, region.len) && !r.pin->is_clone() &&
+		!r.pin->is_compressed()) {
 	      to_remap.push_back(extent_to_remap_t::create_overwrite(
 		region.addr.get_byte_distance<
 		  extent_len_t> (range.begin().get_start()),
@@ -514,11 +516,12 @@ ObjectDataHandler::write_ret do_removals(
 /// Creates zero/data extents in to_insert
 ObjectDataHandler::write_ret do_insertions(
   context_t ctx,
-  extent_to_insert_list_t &to_insert)
+  extent_to_insert_list_t &to_insert,
+  const compression_params_t &compression)
 {
   return trans_intr::do_for_each(
     to_insert,
-    [ctx](auto &region) {
+    [ctx, &compression](auto &region) {
       LOG_PREFIX(object_data_handler.cc::do_insertions);
       if (region.is_data()) {
 	assert_aligned(region.len);
@@ -531,7 +534,7 @@ ObjectDataHandler::write_ret do_insertions(
 	  ctx.t,
 	  region.addr,
 	  region.len
-        ).si_then([&region](auto extents) {
+        ).si_then([&region, &compression](auto extents) {
           auto off = region.addr;
           auto left = region.len;
 	  auto iter = region.bl->cbegin();
@@ -545,6 +548,7 @@ ObjectDataHandler::write_ret do_insertions(
                 off);
             }
             iter.copy(extent->get_length(), extent->get_bptr().c_str());
+            extent->set_compression_params(compression);
             off = (off + extent->get_length()).checked_to_laddr();
             left -= extent->get_length();
           }
@@ -647,6 +651,9 @@ struct overwrite_plan_t {
   extent_len_t block_size;
   bool is_left_fresh;
   bool is_right_fresh;
+  // compressed extents can't be split, see TransactionManager::remap_pin()
+  bool is_left_compressed;
+  bool is_right_compressed;
 
 public:
   extent_len_t get_left_size() const {
@@ -699,6 +706,8 @@ public:
 	       << ", block_size=" << overwrite_plan.block_size
 	       << ", is_left_fresh=" << overwrite_plan.is_left_fresh
 	       << ", is_right_fresh=" << overwrite_plan.is_right_fresh
+	       << ", is_left_compressed=" << overwrite_plan.is_left_compressed
+	       << ", is_right_compressed=" << overwrite_plan.is_right_compressed
 	       << ")";
   }
 
@@ -722,7 +731,11 @@ public:
       // TODO: introduce PhysicalNodeMapping::is_fresh()
       // Note: fresh write can be merged with overwrite if they overlap.
       is_left_fresh(!pins.front()->is_stable()),
-      is_right_fresh(!pins.back()->is_stable()) {
+      is_right_fresh(!pins.back()->is_stable()),
+      is_left_compressed(!pins.front()->is_indirect() &&
+			 pins.front()->is_compressed()),
+      is_right_compressed(!pins.back()->is_indirect() &&
+			  pins.back()->is_compressed()) {
     validate();
     evaluate_operations();
     assert(left_operation != overwrite_operation_t::UNKNOWN);
@@ -760,7 +773,7 @@ private:
       actual_write_size -= left_ext_size;
       left_ext_size = 0;
       left_operation = overwrite_operation_t::OVERWRITE_ZERO;
-    } else if (is_left_fresh) {
+    } else if (is_left_fresh || is_left_compressed) {
       aligned_data_size += left_ext_size;
       left_ext_size = 0;
       left_operation = overwrite_operation_t::MERGE_EXISTING;
@@ -770,7 +783,7 @@ private:
       actual_write_size -= right_ext_size;
       right_ext_size = 0;
       right_operation = overwrite_operation_t::OVERWRITE_ZERO;
-    } else if (is_right_fresh) {
+    } else if (is_right_fresh || is_right_compressed) {
       aligned_data_size += right_ext_size;
       right_ext_size = 0;
       right_operation = overwrite_operation_t::MERGE_EXISTING;
@@ -1118,7 +1131,9 @@ ObjectDataHandler::clear_ret ObjectDataHandler::trim_data_reservation(
 	   * if aligned or rewrite it if not aligned to size */
           auto roundup_size = p2roundup(size, ctx.tm.get_block_size());
           auto append_len = roundup_size - size;
-          if (append_len == 0) {
+          // a direct compressed extent can't be remapped, rewrite its head
+          bool can_remap = pin.is_indirect() || !pin.is_compressed();
+          if (append_len == 0 && can_remap) {
             LOG_PREFIX(ObjectDataHandler::trim_data_reservation);
             TRACET("First pin overlaps the boundary and has aligned data"
               "create existing at addr:{}, len:{}",
@@ -1168,7 +1183,7 @@ ObjectDataHandler::clear_ret ObjectDataHandler::trim_data_reservation(
             ).si_then([ctx, &ops] {
               return do_removals(ctx, ops.to_remove);
             }).si_then([ctx, &ops] {
-              return do_insertions(ctx, ops.to_insert);
+              return do_insertions(ctx, ops.to_insert, compression);
             }).si_then([size, &object_data] {
 	      if (size == 0) {
 	        object_data.clear();
@@ -1366,7 +1381,7 @@ ObjectDataHandler::write_ret ObjectDataHandler::overwrite(
             ).si_then([ctx, &ops] {
               return do_removals(ctx, ops.to_remove);
             }).si_then([ctx, &ops] {
-              return do_insertions(ctx, ops.to_insert);
+              return do_insertions(ctx, ops.to_insert, compression);
             });
         });
       });
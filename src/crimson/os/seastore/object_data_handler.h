@@ -166,9 +166,13 @@ class ObjectDataHandler {
 public:
   using base_iertr = TransactionManager::base_iertr;
 
-  ObjectDataHandler(uint32_t mos) : max_object_size(mos),
-    delta_based_overwrite_max_extent_size(
-      crimson::common::get_conf<Option::size_t>("seastore_data_delta_based_overwrite")) {}
+  ObjectDataHandler(
+    uint32_t mos,
+    compression_params_t compression = {})
+    : max_object_size(mos),
+      delta_based_overwrite_max_extent_size(
+        crimson::common::get_conf<Option::size_t>("seastore_data_delta_based_overwrite")),
+      compression(compression) {}
 
   struct context_t {
     TransactionManager &tm;
@@ -265,6 +269,8 @@ private:
    */
   const uint32_t max_object_size = 0;
   extent_len_t delta_based_overwrite_max_extent_size = 0; // enable only if rbm is used
+  // applied to the data extents written by this handler
+  compression_params_t compression;
 };
 
 }
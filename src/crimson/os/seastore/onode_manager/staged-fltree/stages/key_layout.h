@@ -747,6 +747,38 @@ inline std::ostream& operator<<(std::ostream& os, const snap_gen_t& sg) {
   return os << sg.snap << "," << sg.gen;
 }
 
+/*
+ * search_key_t
+ *
+ * An order preserving integer image of the fixed-size keys, so that the
+ * indexable stages can be searched with a single integer compare per key
+ * instead of the field by field three-way compare.
+ */
+using search_key_t = unsigned __int128;
+
+inline search_key_t to_search_key(const shard_pool_t& sp) {
+  // flip the sign bits so that the signed fields order as unsigned
+  return (search_key_t(uint8_t(sp.shard) ^ 0x80u) << 64) |
+         (uint64_t(sp.pool()) ^ (uint64_t(1) << 63));
+}
+
+inline search_key_t to_search_key(const crush_t& c) {
+  return c.crush;
+}
+
+inline search_key_t to_search_key(const shard_pool_crush_t& spc) {
+  return (to_search_key(spc.shard_pool) << 32) | spc.crush.crush;
+}
+
+inline search_key_t to_search_key(const snap_gen_t& sg) {
+  return (search_key_t(sg.snap) << 64) | sg.gen;
+}
+
+template <typename T>
+concept HasSearchKey = requires(const T& key) {
+  { to_search_key(key) } -> std::same_as<search_key_t>;
+};
+
 shard_t key_view_t::shard() const {
   return shard_pool_packed().shard;
 }
@@ -21,11 +21,56 @@ struct search_result_bs_t {
   index_t index;
   MatchKindBS match;
 };
+
+/*
+ * Branchless lower bound over the search_key_t of fixed-size keys: the
+ * range is halved with a conditional move instead of a mispredicted branch
+ * per level, and the keys of both possible next levels are prefetched so
+ * that the cache misses of a large node overlap.
+ */
+template <HasSearchKey Target, typename FGetKey>
+search_result_bs_t search_by_search_key(
+    const key_hobj_t& key,
+    index_t begin, index_t end, FGetKey&& f_get_key) {
+  assert(begin < end);
+  auto target = to_search_key(Target::from_key(key));
+  auto get = [&f_get_key](index_t index) {
+    return to_search_key(f_get_key(index));
+  };
+  index_t base = begin;
+  index_t n = end - begin;
+  while (n > 1) {
+    index_t half = n >> 1;
+    if constexpr (std::is_reference_v<decltype(f_get_key(base))>) {
+      __builtin_prefetch(&f_get_key(base + (half >> 1)));
+      __builtin_prefetch(&f_get_key(base + half + (half >> 1)));
+    }
+    base = (get(base + half) < target) ? base + half : base;
+    n -= half;
+  }
+  auto search_key = get(base);
+  if (search_key < target) {
+    return {base + 1, MatchKindBS::NE};
+  } else if (search_key == target) {
+    return {base, MatchKindBS::EQ};
+  } else {
+    return {base, MatchKindBS::NE};
+  }
+}
+
 template <typename FGetKey>
 search_result_bs_t binary_search(
     const key_hobj_t& key,
     index_t begin, index_t end, FGetKey&& f_get_key) {
   assert(begin <= end);
+  using target_t = std::remove_cvref_t<decltype(f_get_key(begin))>;
+  if constexpr (HasSearchKey<target_t>) {
+    if (begin == end) {
+      return {begin, MatchKindBS::NE};
+    }
+    return search_by_search_key<target_t>(
+        key, begin, end, std::forward<FGetKey>(f_get_key));
+  }
   while (begin < end) {
     auto total = begin + end;
     auto mid = total >> 1;
@@ -311,7 +356,9 @@ struct staged {
         assert(key < container[end_index]);
       }
       auto ret = binary_search(key, _index, end_index,
-          [this] (index_t index) { return container[index]; });
+          [this] (index_t index) -> decltype(auto) {
+        return container[index];
+      });
       _index = ret.index;
       return ret.match;
     }
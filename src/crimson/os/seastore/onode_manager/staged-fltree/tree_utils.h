@@ -504,6 +504,36 @@ class TreeBuilder {
     });
   }
 
+  eagain_ifuture<> lookup(Transaction& t) {
+    kvs.shuffle();
+    logger().warn("start looking up {} kvs ...", kvs.size());
+    return seastar::do_with(
+      kvs.random_begin(),
+      mono_clock::now(),
+      [this, &t] (auto &iter, auto &start_time) {
+      return trans_intr::repeat(
+        [this, &t, &iter, &start_time]()
+        -> eagain_iertr::future<seastar::stop_iteration> {
+        if (iter == kvs.random_end()) {
+          std::chrono::duration<double> duration = mono_clock::now() - start_time;
+          logger().warn("Lookup done! {}s, {:.0f} lookups/s",
+                        duration.count(), kvs.size() / duration.count());
+          return seastar::make_ready_future<seastar::stop_iteration>(
+            seastar::stop_iteration::yes);
+        }
+        auto p_kv = *iter;
+        return tree->find(t, p_kv->key
+        ).si_then([&iter] (auto cursor) {
+          auto p_kv = *iter;
+          validate_cursor_from_item(p_kv->key, p_kv->value, cursor);
+          ++iter;
+          return seastar::make_ready_future<seastar::stop_iteration>(
+            seastar::stop_iteration::no);
+        });
+      });
+    });
+  }
+
   eagain_ifuture<std::size_t> height(Transaction& t) {
     return tree->height(t);
   }
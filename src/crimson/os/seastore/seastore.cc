@@ -4,6 +4,7 @@
 #include "seastore.h"
 
 #include <algorithm>
+#include <system_error>
 
 #include <boost/algorithm/string/trim.hpp>
 #include <fmt/format.h>
@@ -250,39 +251,56 @@ SeaStore::mount_ertr::future<> SeaStore::test_mount()
 
 SeaStore::mount_ertr::future<> SeaStore::mount()
 {
+  LOG_PREFIX(SeaStore::mount);
   ceph_assert(seastar::this_shard_id() == primary_core);
   return device->mount(
-  ).safe_then([this] {
-    ceph_assert(device->get_sharded_device().get_block_size()
-		>= laddr_t::UNIT_SIZE);
-    auto &sec_devices = device->get_sharded_device().get_secondary_devices();
-    return crimson::do_for_each(sec_devices, [this](auto& device_entry) {
-      device_id_t id = device_entry.first;
-      magic_t magic = device_entry.second.magic;
-      device_type_t dtype = device_entry.second.dtype;
-      std::string path =
-        fmt::format("{}/block.{}.{}", root, dtype, std::to_string(id));
-      return Device::make_device(path, dtype
-      ).then([this, path, magic](DeviceRef sec_dev) {
-        return sec_dev->start(
-        ).then([this, magic, sec_dev = std::move(sec_dev)]() mutable {
-          return sec_dev->mount(
-          ).safe_then([this, sec_dev=std::move(sec_dev), magic]() mutable {
-	    ceph_assert(sec_dev->get_sharded_device().get_block_size()
-			>= laddr_t::UNIT_SIZE);
-            boost::ignore_unused(magic);  // avoid clang warning;
-            assert(sec_dev->get_sharded_device().get_magic() == magic);
-            secondaries.emplace_back(std::move(sec_dev));
-          });
-        }).safe_then([this] {
-          return set_secondaries();
+  ).handle_error(
+    crimson::ct_error::assert_all{
+      "Invalid error in SeaStore::mount"
+    }
+  ).then([this, FNAME]() -> mount_ertr::future<> {
+    const auto& meta = device->get_sharded_device().get_meta();
+    if (!meta.is_mountable()) {
+      ERROR("on-disk format version {} is newer than the supported {}",
+            meta.format_version, SEASTORE_FORMAT_VERSION);
+      return crimson::stateful_ec{
+        std::make_error_code(std::errc::not_supported) };
+    }
+    return mount_devices();
+  });
+}
+
+seastar::future<> SeaStore::mount_devices()
+{
+  ceph_assert(device->get_sharded_device().get_block_size()
+	      >= laddr_t::UNIT_SIZE);
+  auto &sec_devices = device->get_sharded_device().get_secondary_devices();
+  return crimson::do_for_each(sec_devices, [this](auto& device_entry) {
+    device_id_t id = device_entry.first;
+    magic_t magic = device_entry.second.magic;
+    device_type_t dtype = device_entry.second.dtype;
+    std::string path =
+      fmt::format("{}/block.{}.{}", root, dtype, std::to_string(id));
+    return Device::make_device(path, dtype
+    ).then([this, path, magic](DeviceRef sec_dev) {
+      return sec_dev->start(
+      ).then([this, magic, sec_dev = std::move(sec_dev)]() mutable {
+        return sec_dev->mount(
+        ).safe_then([this, sec_dev=std::move(sec_dev), magic]() mutable {
+	  ceph_assert(sec_dev->get_sharded_device().get_block_size()
+		      >= laddr_t::UNIT_SIZE);
+          boost::ignore_unused(magic);  // avoid clang warning;
+          assert(sec_dev->get_sharded_device().get_magic() == magic);
+          secondaries.emplace_back(std::move(sec_dev));
         });
-      });
-    }).safe_then([this] {
-      return shard_stores.invoke_on_all([](auto &local_store) {
-        return local_store.mount_managers();
+      }).safe_then([this] {
+        return set_secondaries();
       });
     });
+  }).safe_then([this] {
+    return shard_stores.invoke_on_all([](auto &local_store) {
+      return local_store.mount_managers();
+    });
   }).handle_error(
     crimson::ct_error::assert_all{
       "Invalid error in SeaStore::mount"
@@ -965,7 +983,20 @@ seastar::future<>
 SeaStore::Shard::set_collection_opts(CollectionRef c,
                                         const pool_opts_t& opts)
 {
-  //TODO
+  LOG_PREFIX(SeaStore::set_collection_opts);
+  std::string mode;
+  std::string algorithm;
+  double required_ratio = 0;
+  opts.get(pool_opts_t::COMPRESSION_MODE, &mode);
+  opts.get(pool_opts_t::COMPRESSION_ALGORITHM, &algorithm);
+  auto &coll = static_cast<SeastoreCollection&>(*c);
+  coll.compression = compression_params_t::resolve(
+    mode,
+    algorithm,
+    opts.get(pool_opts_t::COMPRESSION_REQUIRED_RATIO, &required_ratio)
+    ? std::make_optional(required_ratio)
+    : std::nullopt);
+  DEBUG("cid={} {}", c->get_cid(), coll.compression);
   return seastar::now();
 }
 
@@ -1925,7 +1956,7 @@ SeaStore::Shard::_write(
   }
   return seastar::do_with(
     std::move(_bl),
-    ObjectDataHandler(max_object_size),
+    ObjectDataHandler(max_object_size, get_compression_params(ctx.ch)),
     [=, this, &ctx, &onode](auto &bl, auto &objhandler) {
       return objhandler.write(
         ObjectDataHandler::context_t{
@@ -2044,7 +2075,7 @@ SeaStore::Shard::_zero(
     *ctx.transaction,
     std::max<uint64_t>(offset + len, object_size));
   return seastar::do_with(
-    ObjectDataHandler(max_object_size),
+    ObjectDataHandler(max_object_size, get_compression_params(ctx.ch)),
     [=, this, &ctx, &onode](auto &objhandler) {
       return objhandler.zero(
         ObjectDataHandler::context_t{
@@ -2251,7 +2282,7 @@ SeaStore::Shard::_truncate(
   DEBUGT("onode={} size={}", *ctx.transaction, *onode, size);
   onode->update_onode_size(*ctx.transaction, size);
   return seastar::do_with(
-    ObjectDataHandler(max_object_size),
+    ObjectDataHandler(max_object_size, get_compression_params(ctx.ch)),
     [=, this, &ctx, &onode](auto &objhandler) {
     return objhandler.truncate(
       ObjectDataHandler::context_t{
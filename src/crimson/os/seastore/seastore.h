@@ -53,6 +53,8 @@ public:
     FuturizedCollection(std::forward<T>(args)...) {}
 
   seastar::shared_mutex ordering_lock;
+  // from the pool options, see SeaStore::Shard::set_collection_opts()
+  compression_params_t compression = compression_params_t::from_config();
 };
 
 /**
@@ -471,6 +473,11 @@ public:
 
     boost::intrusive_ptr<SeastoreCollection> _get_collection(const coll_t& cid);
 
+    const compression_params_t &get_compression_params(
+      const CollectionRef &ch) const {
+      return static_cast<const SeastoreCollection&>(*ch).compression;
+    }
+
     static constexpr auto LAT_MAX = static_cast<std::size_t>(op_type_t::MAX);
 
     struct {
@@ -576,6 +583,9 @@ private:
 
   seastar::future<> set_secondaries();
 
+  // mount the secondary devices and the managers of every shard
+  seastar::future<> mount_devices();
+
 private:
   std::string root;
   MDStoreRef mdstore;
@@ -41,13 +41,46 @@ inline depth_le_t init_depth_le(uint32_t i) {
 using checksum_t = uint32_t;
 constexpr checksum_t CRC_NULL = 0;
 
+/**
+ * SEASTORE_FORMAT_VERSION
+ *
+ * Version of the on-disk layout, a store is not mounted by a version older
+ * than the one that created it.
+ *
+ * 1: the stores made before compression, including those made before the
+ *    version was recorded
+ * 2: the LBA leaves may map compressed extents, whose length goes in bits
+ *    of pladdr_le_t::addr_type that version 1 takes as unused
+ */
+constexpr uint32_t SEASTORE_FORMAT_VERSION = 2;
+constexpr uint32_t SEASTORE_FORMAT_VERSION_COMPRESSION = 2;
+
 // Immutable metadata for seastore to set at mkfs time
 struct seastore_meta_t {
   uuid_d seastore_id;
+  uint32_t format_version = SEASTORE_FORMAT_VERSION;
+
+  /// whether a version supporting up to supported can mount the store
+  bool is_mountable(uint32_t supported = SEASTORE_FORMAT_VERSION) const {
+    return format_version <= supported;
+  }
+  /// the stores of an older format keep their extents raw
+  bool supports_compression() const {
+    return format_version >= SEASTORE_FORMAT_VERSION_COMPRESSION;
+  }
 
+  // compat 2, so that the decoders of version 1, which take the bits of
+  // the compressed lengths as unused, fail to decode the meta and refuse
+  // the store. the meta is only encoded by mkfs, for a store of this version
   DENC(seastore_meta_t, v, p) {
-    DENC_START(1, 1, p);
+    DENC_START_COMPAT_2(2, 2, p);
     denc(v.seastore_id, p);
+    if (struct_v >= 2) {
+      denc(v.format_version, p);
+    } else if constexpr (!std::is_const_v<T>) {
+      // decoding the meta of an older store
+      v.format_version = 1;
+    }
     DENC_FINISH(p);
   }
 };
@@ -1303,6 +1336,24 @@ enum class addr_type_t : uint8_t {
   MAX=2	// or NONE
 };
 
+/*
+ * addr_type_t only takes the low ADDR_TYPE_BITS of pladdr_le_t::addr_type.
+ * The LBA leaves keep the on-disk length of a compressed extent in the
+ * others, in units of COMPRESSED_LENGTH_UNIT, so an extent whose compressed
+ * image is not a multiple of the unit or exceeds MAX_COMPRESSED_LENGTH is
+ * stored uncompressed.
+ */
+constexpr uint8_t ADDR_TYPE_BITS = 2;
+constexpr uint8_t ADDR_TYPE_MASK = (1 << ADDR_TYPE_BITS) - 1;
+static_assert(static_cast<uint8_t>(addr_type_t::MAX) <= ADDR_TYPE_MASK);
+constexpr extent_len_t COMPRESSED_LENGTH_UNIT = 4096;
+constexpr extent_len_t MAX_COMPRESSED_LENGTH =
+  ((1 << (8 - ADDR_TYPE_BITS)) - 1) * COMPRESSED_LENGTH_UNIT;
+
+constexpr bool can_record_compressed_length(extent_len_t len) {
+  return len % COMPRESSED_LENGTH_UNIT == 0 && len <= MAX_COMPRESSED_LENGTH;
+}
+
 struct __attribute__((packed)) pladdr_le_t {
   ceph_le64 pladdr = ceph_le64(PL_ADDR_NULL);
   addr_type_t addr_type = addr_type_t::MAX;
@@ -356,7 +356,7 @@ public:
     if (extent->get_paddr() != paddr) {
       return false;
     } else {
-      assert(len == extent->get_length());
+      assert(len == extent->get_disk_length());
       return true;
     }
   }
@@ -256,7 +256,7 @@ TransactionManager::ref_ret TransactionManager::_dec_ref(
       if (result.addr.is_paddr() &&
           !result.addr.get_paddr().is_zero()) {
         fut = cache->retire_extent_addr(
-          t, result.addr.get_paddr(), result.length);
+          t, result.addr.get_paddr(), result.get_disk_length());
       }
     }
 
@@ -551,6 +551,7 @@ TransactionManager::rewrite_logical_extent(
       nlextent->get_length(),
       nlextent->get_paddr(),
       nlextent->get_last_committed_crc(),
+      nlextent->get_compressed_length(),
       nlextent.get()).discard_result();
   } else {
     assert(get_extent_category(lextent->get_type()) == data_category_t::DATA);
@@ -591,6 +592,7 @@ TransactionManager::rewrite_logical_extent(
             nlextent->get_length(),
             nlextent->get_paddr(),
             nlextent->get_last_committed_crc(),
+            nlextent->get_compressed_length(),
             nlextent.get()
 	  ).si_then([&refcount](auto c) {
 	    refcount = c;
@@ -658,6 +660,8 @@ TransactionManager::rewrite_extent_ret TransactionManager::rewrite_extent(
     extent->set_target_rewrite_generation(INIT_GENERATION);
   } else {
     assert(!is_root_type(extent->get_type()));
+    target_generation = epm->adjust_generation_by_access(
+      *extent, target_generation);
     extent->set_target_rewrite_generation(target_generation);
     ceph_assert(modify_time != NULL_TIME);
     extent->set_modify_time(modify_time);
@@ -702,7 +706,7 @@ TransactionManager::get_extents_if_live(
   return cache->get_extent_if_cached(t, paddr, type
   ).si_then([=, this, &t](auto extent)
 	    -> get_extents_if_live_ret {
-    if (extent && extent->get_length() == len) {
+    if (extent && extent->get_disk_length() == len) {
       DEBUGT("{} {}~{} {} is live in cache -- {}",
              t, type, laddr, len, paddr, *extent);
       std::list<CachedExtentRef> res;
@@ -483,6 +483,9 @@ public:
       // The according extent might be stable or pending.
       auto fut = base_iertr::now();
       if (!pin->is_indirect()) {
+	// the remapped pieces would address into the compressed image,
+	// compressed extents are rewritten as a whole instead
+	ceph_assert(!pin->is_compressed());
 	if (!pin->is_parent_viewable()) {
 	  if (pin->is_parent_valid()) {
 	    pin = pin->refresh_with_pending_parent();
@@ -904,6 +907,9 @@ private:
 	assert(pref.get_parent());
 	pref.link_child(&extent);
 	extent.maybe_set_intermediate_laddr(pref);
+	if (pref.is_compressed()) {
+	  extent.set_compressed_length(pref.get_compressed_length());
+	}
       }
     ).si_then([FNAME, &t, pin=std::move(pin), this](auto ref) mutable -> ret {
       auto crc = ref->calc_crc32c();
@@ -970,6 +976,9 @@ private:
 	assert(!pref.get_parent()->is_pending());
 	pref.link_child(&lextent);
 	lextent.maybe_set_intermediate_laddr(pref);
+	if (pref.is_compressed()) {
+	  lextent.set_compressed_length(pref.get_compressed_length());
+	}
       }
     ).si_then([FNAME, &t, pin=std::move(pin), this](auto ref) {
       auto crc = ref->calc_crc32c();
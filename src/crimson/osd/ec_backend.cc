@@ -1,37 +1,604 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
 #include "ec_backend.h"
 
+#include <fmt/ranges.h>
+#include <seastar/core/when_all.hh>
+
+#include "erasure-code/ErasureCodePlugin.h"
+#include "include/scope_guard.h"
+#include "osd/osd_types_fmt.h"
+
+#include "crimson/common/config_proxy.h"
+#include "crimson/common/coroutine.h"
+#include "crimson/common/exception.h"
+#include "crimson/common/log.h"
+#include "crimson/os/futurized_store.h"
+#include "crimson/osd/pg.h"
 #include "crimson/osd/shard_services.h"
 
-ECBackend::ECBackend(shard_id_t shard,
-                     ECBackend::CollectionRef coll,
-                     crimson::osd::ShardServices& shard_services,
-                     const ec_profile_t&,
-                     uint64_t,
-		     DoutPrefixProvider &dpp)
-  : PGBackend{shard, coll, shard_services, dpp}
+SET_SUBSYS(osd);
+
+using crimson::common::local_conf;
+
+namespace {
+
+ceph::ErasureCodeInterfaceRef create_ec_impl(
+  const std::map<std::string, std::string>& profile)
 {
-  // todo
+  ceph::ErasureCodeProfile ec_profile = profile;
+  ceph::ErasureCodeInterfaceRef ec_impl;
+  std::stringstream ss;
+  ceph::ErasureCodePluginRegistry::instance().factory(
+    profile.find("plugin")->second,
+    local_conf().get_val<std::string>("erasure_code_dir"),
+    ec_profile,
+    &ec_impl,
+    &ss);
+  if (!ec_impl) {
+    // fails the creation of the PG, not the whole OSD
+    throw std::runtime_error(
+      fmt::format("unable to load erasure code plugin: {}", ss.str()));
+  }
+  return ec_impl;
+}
+
 }
 
+ECBackend::ECBackend(pg_t pgid,
+		     pg_shard_t whoami,
+		     crimson::osd::PG& pg,
+		     ECBackend::CollectionRef coll,
+		     crimson::osd::ShardServices& shard_services,
+		     const ec_profile_t& ec_profile,
+		     uint64_t stripe_width,
+		     DoutPrefixProvider &dpp)
+  : PGBackend{whoami.shard, coll, shard_services, dpp},
+    pgid{pgid},
+    whoami{whoami},
+    pg(pg),
+    ec_impl{create_ec_impl(ec_profile)},
+    codec{ec_impl, stripe_width, coll->get_cid(), *this},
+    sinfo{codec.get_sinfo()}
+{}
+
 ECBackend::ll_read_ierrorator::future<ceph::bufferlist>
 ECBackend::_read(const hobject_t& hoid,
                  const uint64_t off,
                  const uint64_t len,
                  const uint32_t flags)
 {
-  // todo
-  return seastar::make_ready_future<bufferlist>();
+  if (len == 0) {
+    return ll_read_ierrorator::make_ready_future<ceph::bufferlist>();
+  }
+  const auto bounds = sinfo.offset_len_to_stripe_bounds({off, len});
+  return read_stripes(hoid, bounds.first, bounds.second, flags
+  ).then_interruptible([off, len, stripe_off=bounds.first](read_result_t&& r)
+		       -> ll_read_ierrorator::future<ceph::bufferlist> {
+    if (r.error == -ENOENT) {
+      return ll_read_ierrorator::future<ceph::bufferlist>{
+	crimson::ct_error::enoent::make()};
+    } else if (r.error < 0) {
+      return ll_read_ierrorator::future<ceph::bufferlist>{
+	crimson::ct_error::input_output_error::make()};
+    }
+    ceph::bufferlist bl;
+    if (const uint64_t skip = off - stripe_off; r.data.length() > skip) {
+      bl.substr_of(r.data, skip, std::min<uint64_t>(len, r.data.length() - skip));
+    }
+    return ll_read_ierrorator::make_ready_future<ceph::bufferlist>(
+      std::move(bl));
+  });
+}
+
+ECBackend::interruptible_future<ECBackend::read_result_t>
+ECBackend::read_local_shard(const hobject_t& hoid,
+			    const uint64_t off,
+			    const uint64_t len,
+			    const uint32_t flags,
+			    const subchunks_t& subchunks)
+{
+  auto read = [this, oid=shard_oid(hoid, whoami.shard), flags](
+    uint64_t extent_off, uint64_t extent_len)
+    -> interruptible_future<read_result_t> {
+    return interruptor::make_interruptible(
+      store->read(coll, oid, extent_off, extent_len, flags)
+    ).safe_then_interruptible([](ceph::bufferlist&& bl) {
+      return seastar::make_ready_future<read_result_t>(
+	read_result_t{0, std::move(bl)});
+    }, ll_read_errorator::all_same_way([](const std::error_code& e) {
+      return seastar::make_ready_future<read_result_t>(
+	read_result_t{-e.value(), {}});
+    }));
+  };
+  if (subchunks.empty() ||
+      (subchunks.size() == 1 &&
+       subchunks.front().second == ec_impl->get_sub_chunk_count())) {
+    co_return co_await read(off, len);
+  }
+  // only some of the sub-chunks of every chunk are wanted
+  const uint64_t subchunk_size =
+    sinfo.get_chunk_size() / ec_impl->get_sub_chunk_count();
+  read_result_t ret;
+  for (uint64_t m = 0; m < len; m += sinfo.get_chunk_size()) {
+    for (auto [index, count] : subchunks) {
+      auto r = co_await read(off + m + index * subchunk_size,
+			     count * subchunk_size);
+      if (r.error < 0) {
+	co_return r;
+      }
+      ret.data.claim_append(r.data);
+    }
+  }
+  co_return ret;
+}
+
+ECBackend::interruptible_future<std::map<int, ECBackend::read_result_t>>
+ECBackend::read_chunks(const hobject_t& hoid,
+		       const uint64_t chunk_off,
+		       const uint64_t chunk_len,
+		       const uint32_t flags,
+		       const std::set<pg_shard_t>& shards)
+{
+  LOG_PREFIX(ECBackend::read_chunks);
+  DEBUGDPP("{} {}~{} from {}", dpp, hoid, chunk_off, chunk_len, shards);
+  // the stripes are decoded chunk by chunk, so always read whole chunks
+  const subchunks_t whole_chunks{{0, ec_impl->get_sub_chunk_count()}};
+  const ceph_tid_t tid = shard_services.get_tid();
+  const auto map_epoch = pg.get_osdmap_epoch();
+  // if a send or the local read fails, nobody waits for the replies to tid
+  // anymore. declared before all_replied, so that its promise outlives it
+  auto drop_pending = make_scope_guard([this, tid] {
+    pending_reads.erase(tid);
+  });
+  std::vector<seastar::future<>> sends;
+  for (auto pg_shard : shards) {
+    if (pg_shard == whoami) {
+      continue;
+    }
+    auto m = crimson::make_message<MOSDECSubOpRead>();
+    m->pgid = spg_t{pgid, pg_shard.shard};
+    m->map_epoch = map_epoch;
+    m->min_epoch = pg.get_interval_start_epoch();
+    m->op.from = whoami;
+    m->op.tid = tid;
+    m->op.to_read[hoid].push_back(
+      boost::make_tuple(chunk_off, chunk_len, flags));
+    m->op.subchunks[hoid] = whole_chunks;
+    pending_reads[tid].waiting_on.insert(pg_shard);
+    sends.emplace_back(
+      shard_services.send_to_osd(pg_shard.osd, std::move(m), map_epoch));
+  }
+  // get the future before yielding, so an interval change cannot drop the
+  // pending read unnoticed
+  auto all_replied = sends.empty() ?
+    seastar::now() : pending_reads[tid].all_replied.get_future();
+
+  std::map<int, read_result_t> ret;
+  if (shards.contains(whoami)) {
+    ret[whoami.shard] = co_await read_local_shard(
+      hoid, chunk_off, chunk_len, flags, whole_chunks);
+  }
+  if (!sends.empty()) {
+    co_await interruptor::make_interruptible(
+      seastar::when_all_succeed(sends.begin(), sends.end()));
+    co_await interruptor::make_interruptible(std::move(all_replied));
+    auto pending = pending_reads.extract(tid);
+    ret.merge(pending.mapped().results);
+  }
+  co_return ret;
+}
+
+ECBackend::interruptible_future<ECBackend::read_result_t>
+ECBackend::read_stripes(const hobject_t& hoid,
+			const uint64_t off,
+			const uint64_t len,
+			const uint32_t flags)
+{
+  LOG_PREFIX(ECBackend::read_stripes);
+  DEBUGDPP("{} {}~{}", dpp, hoid, off, len);
+  assert(sinfo.logical_offset_is_stripe_aligned(off));
+  assert(sinfo.logical_offset_is_stripe_aligned(len));
+  const uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(off);
+  const uint64_t chunk_len = sinfo.aligned_logical_offset_to_chunk_offset(len);
+  const auto want = codec.get_want_to_read_shards();
+  std::map<int, ceph::bufferlist> chunks;
+  std::set<pg_shard_t> failed;
+  int error = -EIO;
+  while (true) {
+    std::set<int> available;
+    std::map<int, pg_shard_t> shards;
+    for (auto& pg_shard : pg.get_actingset()) {
+      if (failed.contains(pg_shard)) {
+	continue;
+      }
+      if (auto missing = pg.get_shard_missing(pg_shard);
+	  missing && missing->is_missing(hoid)) {
+	continue;
+      }
+      available.insert(pg_shard.shard);
+      shards.emplace(pg_shard.shard, pg_shard);
+    }
+    std::map<int, subchunks_t> minimum;
+    if (ec_impl->minimum_to_decode(want, available, &minimum) != 0) {
+      ERRORDPP("unable to decode {} from shards {}, failed {}",
+	       dpp, hoid, available, failed);
+      co_return read_result_t{error, {}};
+    }
+    std::set<pg_shard_t> to_read;
+    for (auto& [shard, subchunks] : minimum) {
+      if (!chunks.contains(shard)) {
+	to_read.insert(shards.at(shard));
+      }
+    }
+    if (to_read.empty()) {
+      break;
+    }
+    auto results = co_await read_chunks(
+      hoid, chunk_off, chunk_len, flags, to_read);
+    if (chunks.empty() &&
+	std::all_of(results.begin(), results.end(), [](auto& r) {
+	  return r.second.error == -ENOENT;
+	})) {
+      // none of the shards has ever seen the object
+      co_return read_result_t{-ENOENT, {}};
+    }
+    for (auto& [shard, r] : results) {
+      if (r.error < 0) {
+	WARNDPP("failed to read {} from shard {}: {}",
+		dpp, hoid, shard, r.error);
+	failed.insert(shards.at(shard));
+	error = r.error == -ENOENT ? -EIO : r.error;
+      } else {
+	chunks.emplace(shard, std::move(r.data));
+      }
+    }
+  }
+
+  co_return codec.decode(chunks, chunk_len);
+}
+
+void ECBackend::got_ec_sub_read_reply(MOSDECSubOpReadReply& m)
+{
+  LOG_PREFIX(ECBackend::got_ec_sub_read_reply);
+  auto& reply = m.op;
+  auto found = pending_reads.find(reply.tid);
+  if (found == pending_reads.end() ||
+      !found->second.waiting_on.erase(reply.from)) {
+    WARNDPP("cannot find sub read for message {}", dpp, m);
+    return;
+  }
+  auto& pending = found->second;
+  auto& result = pending.results[reply.from.shard];
+  if (!reply.errors.empty()) {
+    result.error = reply.errors.begin()->second;
+  } else {
+    for (auto& [hoid, buffers] : reply.buffers_read) {
+      for (auto& [off, bl] : buffers) {
+	result.data.claim_append(bl);
+      }
+    }
+  }
+  if (pending.waiting_on.empty()) {
+    pending.all_replied.set_value();
+  }
+}
+
+ECBackend::interruptible_future<>
+ECBackend::handle_ec_sub_read(Ref<MOSDECSubOpRead> m)
+{
+  LOG_PREFIX(ECBackend::handle_ec_sub_read);
+  DEBUGDPP("{}", dpp, *m);
+  ECSubReadReply reply;
+  reply.from = whoami;
+  reply.tid = m->op.tid;
+  for (auto& [hoid, extents] : m->op.to_read) {
+    const auto& subchunks = m->op.subchunks[hoid];
+    for (auto& extent : extents) {
+      auto r = co_await read_local_shard(
+	hoid, extent.get<0>(), extent.get<1>(), extent.get<2>(), subchunks);
+      if (r.error < 0) {
+	WARNDPP("error {} reading {}", dpp, r.error, hoid);
+	reply.buffers_read.erase(hoid);
+	reply.errors[hoid] = r.error;
+	break;
+      }
+      reply.buffers_read[hoid].emplace_back(extent.get<0>(), std::move(r.data));
+    }
+  }
+  for (auto& hoid : m->op.attrs_to_read) {
+    using attrs_t = crimson::os::FuturizedStore::Shard::attrs_t;
+    interruptible_future<attrs_t> attrs_fut = interruptor::make_interruptible(
+      store->get_attrs(coll, shard_oid(hoid, whoami.shard))
+    ).handle_error_interruptible<false>(
+      crimson::os::FuturizedStore::Shard::get_attrs_ertr::all_same_way(
+	[](const std::error_code& e) {
+	return seastar::make_ready_future<attrs_t>();
+      }));
+    reply.attrs_read[hoid] = co_await std::move(attrs_fut);
+  }
+
+  const auto map_epoch = pg.get_osdmap_epoch();
+  auto r = crimson::make_message<MOSDECSubOpReadReply>();
+  r->pgid = spg_t{pgid, pg.get_primary().shard};
+  r->map_epoch = map_epoch;
+  r->min_epoch = pg.get_interval_start_epoch();
+  r->op = std::move(reply);
+  co_await interruptor::make_interruptible(
+    shard_services.send_to_osd(m->op.from.osd, std::move(r), map_epoch));
+}
+
+ECBackend::interruptible_future<>
+ECBackend::wait_for_pending_writes(const hobject_t& hoid)
+{
+  std::vector<seastar::future<>> committed;
+  for (auto& [tid, pending_txn] : pending_trans) {
+    if (pending_txn.hoid == hoid && pending_txn.pending) {
+      committed.emplace_back(pending_txn.all_committed.get_shared_future());
+    }
+  }
+  if (committed.empty()) {
+    return seastar::now();
+  }
+  return interruptor::make_interruptible(
+    seastar::when_all_succeed(committed.begin(), committed.end()));
+}
+
+ECBackend::interruptible_future<ECBackend::codec_t::size_result_t>
+ECBackend::get_object_size(const hobject_t& hoid)
+{
+  LOG_PREFIX(ECBackend::get_object_size);
+  using size_result_t = codec_t::size_result_t;
+  // the hinfo of the local shard tells the size of the object, which it
+  // can't while the shard is missing
+  if (pg.get_local_missing().is_missing(hoid)) {
+    ERRORDPP("{} is missing on the primary, which can't recover it on an "
+	     "erasure coded pool yet", dpp, hoid);
+    return seastar::make_ready_future<size_result_t>(
+      size_result_t{-EIO, std::nullopt});
+  }
+  return interruptor::make_interruptible(store->get_attr(
+      coll, shard_oid(hoid, whoami.shard), ECUtil::get_hinfo_key())
+  ).safe_then_interruptible([this](ceph::bufferlist&& bl) {
+    ECUtil::HashInfo hinfo;
+    auto p = bl.cbegin();
+    decode(hinfo, p);
+    return seastar::make_ready_future<size_result_t>(
+      size_result_t{0, hinfo.get_total_logical_size(sinfo)});
+  }, get_attr_errorator::all_same_way([](const std::error_code& e) {
+    // an object without hinfo was created, but not written yet
+    return seastar::make_ready_future<size_result_t>(
+      size_result_t{0, e.value() == ENOENT ?
+		       std::nullopt : std::make_optional<uint64_t>(0)});
+  }));
+}
+
+ECBackend::interruptible_future<ECBackend::read_result_t>
+ECBackend::read_object_stripes(const hobject_t& hoid,
+			       const uint64_t off,
+			       const uint64_t len)
+{
+  co_await wait_for_pending_writes(hoid);
+  co_return co_await read_stripes(hoid, off, len, 0);
+}
+
+ECBackend::prepare_transaction_iertr::future<>
+ECBackend::prepare_transaction(const hobject_t& hoid,
+			       const eversion_t& at_version,
+			       ceph::os::Transaction& txn)
+{
+  // split the transaction now, so the reads of the partially overwritten
+  // stripes can fail the write before it's logged. the writes to an object
+  // are serialized, so whatever is left for hoid was never submitted
+  prepared_writes.erase(hoid);
+  auto split = std::make_unique<codec_t::split_transaction_t>();
+  split->at_version = at_version;
+  auto fut = codec.generate_transactions(txn, *split);
+  return std::move(fut).then_interruptible(
+    [this, hoid, split=std::move(split)](int r) mutable
+    -> prepare_transaction_iertr::future<> {
+    if (r == -EOPNOTSUPP) {
+      return crimson::ct_error::operation_not_supported::make();
+    } else if (r < 0) {
+      return crimson::ct_error::input_output_error::make();
+    }
+    prepared_writes.insert_or_assign(hoid, std::move(*split));
+    return prepare_transaction_iertr::now();
+  });
 }
 
 ECBackend::rep_op_fut_t
 ECBackend::submit_transaction(const std::set<pg_shard_t> &pg_shards,
                               const hobject_t& hoid,
-                              ceph::os::Transaction&& txn,
-                              osd_op_params_t&& osd_op_p,
-                              epoch_t min_epoch, epoch_t max_epoch,
-			      std::vector<pg_log_entry_t>&& log_entries)
-{
-  // todo
-  return make_ready_future<rep_op_ret_t>(seastar::now(),
-	  seastar::make_ready_future<crimson::osd::acked_peers_t>());
+                              ceph::os::Transaction&& t,
+                              osd_op_params_t&& opp,
+                              epoch_t min_epoch, epoch_t map_epoch,
+			      std::vector<pg_log_entry_t>&& logv)
+{
+  LOG_PREFIX(ECBackend::submit_transaction);
+  DEBUGDPP("object {}", dpp, hoid);
+  auto log_entries = std::move(logv);
+  auto txn = std::move(t);
+  auto osd_op_p = std::move(opp);
+  const auto shards = pg_shards;
+  const auto soid = hoid;
+
+  for (auto &le : log_entries) {
+    le.mark_unrollbackable();
+  }
+
+  // the client writes were split by prepare_transaction(), but for the ops
+  // appended since. the other writes are split now, reading the partially
+  // overwritten stripes before sending anything out, so the shards are still
+  // in the state before this transaction
+  codec_t::split_transaction_t split;
+  if (auto p = prepared_writes.find(soid); p != prepared_writes.end()) {
+    if (p->second.at_version == osd_op_p.at_version) {
+      split = std::move(p->second);
+    }
+    prepared_writes.erase(p);
+  }
+  if (int r = co_await codec.generate_transactions(txn, split); r < 0) {
+    // nothing is sent or logged, so the write fails as a whole
+    ERRORDPP("unable to split the transaction of {}: {}", dpp, soid, r);
+    using acked_peers_fut_t =
+      rep_op_iertr::future<crimson::osd::acked_peers_t>;
+    co_return std::make_tuple(
+      interruptor::now(),
+      r == -EOPNOTSUPP ?
+	acked_peers_fut_t{crimson::ct_error::operation_not_supported::make()} :
+	acked_peers_fut_t{crimson::ct_error::input_output_error::make()});
+  }
+  codec.finish_transactions(split);
+  auto& shard_txns = split.txns;
+
+  const ceph_tid_t tid = shard_services.get_tid();
+  auto pending_txn = pending_trans.try_emplace(
+    tid, shards.size(), osd_op_p.at_version, soid).first;
+
+  auto sends = std::make_unique<std::vector<seastar::future<>>>();
+  for (auto pg_shard : shards) {
+    if (pg_shard != whoami) {
+      ECSubWrite sub_write{
+	whoami,
+	tid,
+	osd_op_p.req_id,
+	soid,
+	pg.get_info().stats,
+	pg.should_send_op(pg_shard, soid) ?
+	  shard_txns[pg_shard.shard] : ceph::os::Transaction{},
+	osd_op_p.at_version,
+	osd_op_p.pg_trim_to,
+	osd_op_p.at_version,
+	log_entries,
+	std::nullopt,
+	{},
+	{},
+	false};
+      auto m = crimson::make_message<MOSDECSubOpWrite>(sub_write);
+      m->pgid = spg_t{pgid, pg_shard.shard};
+      m->map_epoch = map_epoch;
+      m->min_epoch = min_epoch;
+      pending_txn->second.acked_peers.push_back({pg_shard, eversion_t{}});
+      sends->emplace_back(
+	shard_services.send_to_osd(
+	  pg_shard.osd, std::move(m), map_epoch));
+    }
+  }
+
+  auto local_txn = std::move(shard_txns[whoami.shard]);
+  co_await pg.update_snap_map(log_entries, local_txn);
+
+  pg.log_operation(
+    std::move(log_entries),
+    osd_op_p.pg_trim_to,
+    osd_op_p.at_version,
+    osd_op_p.min_last_complete_ondisk,
+    true,
+    local_txn,
+    false);
+
+  auto all_completed = interruptor::make_interruptible(
+      shard_services.get_store().do_transaction(coll, std::move(local_txn))
+   ).then_interruptible([FNAME, this,
+			peers=pending_txn->second.weak_from_this()] {
+    if (!peers) {
+      // for now, only actingset_changed can cause peers
+      // to be nullptr
+      ERRORDPP("peers is null, this should be impossible", dpp);
+      assert(0 == "impossible");
+    }
+    if (--peers->pending == 0) {
+      peers->all_committed.set_value();
+      peers->all_committed = {};
+      return seastar::now();
+    }
+    return peers->all_committed.get_shared_future();
+  }).then_interruptible([pending_txn, this] {
+    auto acked_peers = std::move(pending_txn->second.acked_peers);
+    pending_trans.erase(pending_txn);
+    return seastar::make_ready_future<
+      crimson::osd::acked_peers_t>(std::move(acked_peers));
+  });
+
+  auto sends_complete = seastar::when_all_succeed(
+    sends->begin(), sends->end()
+  ).finally([sends=std::move(sends)] {});
+  co_return std::make_tuple(std::move(sends_complete), std::move(all_completed));
+}
+
+void ECBackend::got_ec_sub_write_reply(const MOSDECSubOpWriteReply& m)
+{
+  LOG_PREFIX(ECBackend::got_ec_sub_write_reply);
+  const auto& reply = m.op;
+  auto found = pending_trans.find(reply.tid);
+  if (found == pending_trans.end()) {
+    WARNDPP("cannot find sub write for message {}", dpp, m);
+    return;
+  }
+  auto& peers = found->second;
+  for (auto& peer : peers.acked_peers) {
+    if (peer.shard == reply.from) {
+      peer.last_complete_ondisk = reply.last_complete;
+      if (--peers.pending == 0) {
+        peers.all_committed.set_value();
+        peers.all_committed = {};
+      }
+      return;
+    }
+  }
+}
+
+void ECBackend::on_actingset_changed(bool same_primary)
+{
+  crimson::common::actingset_changed e_actingset_changed{same_primary};
+  for (auto& [tid, pending_txn] : pending_trans) {
+    pending_txn.all_committed.set_exception(e_actingset_changed);
+  }
+  pending_trans.clear();
+  for (auto& [tid, pending_read] : pending_reads) {
+    pending_read.all_replied.set_exception(e_actingset_changed);
+  }
+  pending_reads.clear();
+  prepared_writes.clear();
+}
+
+seastar::future<> ECBackend::stop()
+{
+  LOG_PREFIX(ECBackend::stop);
+  INFODPP("cid {}", dpp, coll->get_cid());
+  for (auto& [tid, pending_on] : pending_trans) {
+    pending_on.all_committed.set_exception(
+	crimson::common::system_shutdown_exception());
+  }
+  pending_trans.clear();
+  for (auto& [tid, pending_read] : pending_reads) {
+    pending_read.all_replied.set_exception(
+	crimson::common::system_shutdown_exception());
+  }
+  pending_reads.clear();
+  prepared_writes.clear();
+  return seastar::now();
+}
+
+seastar::future<>
+ECBackend::request_committed(const osd_reqid_t& reqid,
+			     const eversion_t& at_version)
+{
+  if (std::empty(pending_trans)) {
+    return seastar::now();
+  }
+  auto iter = pending_trans.begin();
+  if (iter->second.at_version > at_version) {
+    return seastar::now();
+  }
+  // see ReplicatedBackend::request_committed()
+  for (; iter->second.at_version < at_version; ++iter);
+  assert(iter != pending_trans.end() && iter->second.at_version == at_version);
+  if (iter->second.pending) {
+    return iter->second.all_committed.get_shared_future();
+  } else {
+    return seastar::now();
+  }
 }
@@ -5,26 +5,64 @@
 
 #include <boost/intrusive_ptr.hpp>
 #include <seastar/core/future.hh>
+#include <seastar/core/shared_future.hh>
+#include <seastar/core/weak_ptr.hh>
 #include "include/buffer_fwd.h"
+#include "erasure-code/ErasureCodeInterface.h"
+#include "messages/MOSDECSubOpRead.h"
+#include "messages/MOSDECSubOpReadReply.h"
+#include "messages/MOSDECSubOpWrite.h"
+#include "messages/MOSDECSubOpWriteReply.h"
+#include "osd/ECUtil.h"
 #include "osd/osd_types.h"
+
+#include "acked_peers.h"
+#include "ec_codec.h"
 #include "pg_backend.h"
 
-class ECBackend : public PGBackend
+namespace crimson::osd {
+  class ShardServices;
+  class PG;
+}
+
+/**
+ * ECBackend
+ *
+ * Stores every object as k data and m coding shards, one per member of the
+ * acting set.  Reads fetch the chunks of the stripes covering the extent
+ * from the minimum set of shards able to decode them, and fall back to the
+ * remaining shards if any of them fails.  Writes are split into per-shard
+ * transactions by ECCodec.
+ */
+class ECBackend : public PGBackend,
+		  private crimson::osd::ECCodec<
+		    crimson::osd::IOInterruptCondition>::ObjectSource
 {
 public:
-  ECBackend(shard_id_t shard,
+  ECBackend(pg_t pgid,
+	    pg_shard_t whoami,
+	    crimson::osd::PG& pg,
 	    CollectionRef coll,
 	    crimson::osd::ShardServices& shard_services,
 	    const ec_profile_t& ec_profile,
 	    uint64_t stripe_width,
 	    DoutPrefixProvider &dpp);
-  seastar::future<> stop() final {
-    return seastar::now();
+  seastar::future<> stop() final;
+  void on_actingset_changed(bool same_primary) final;
+  void got_ec_sub_write_reply(const MOSDECSubOpWriteReply& reply) final;
+  void got_ec_sub_read_reply(MOSDECSubOpReadReply& reply) final;
+  interruptible_future<> handle_ec_sub_read(Ref<MOSDECSubOpRead> m) final;
+  bool is_sparse_read_supported() const final {
+    // the shards only know about the extents of their chunks
+    return false;
   }
-  void on_actingset_changed(bool same_primary) final {}
 private:
   ll_read_ierrorator::future<ceph::bufferlist>
   _read(const hobject_t& hoid, uint64_t off, uint64_t len, uint32_t flags) override;
+  prepare_transaction_iertr::future<>
+  prepare_transaction(const hobject_t& hoid,
+		      const eversion_t& at_version,
+		      ceph::os::Transaction& txn) final;
   rep_op_fut_t
   submit_transaction(const std::set<pg_shard_t> &pg_shards,
 		     const hobject_t& hoid,
@@ -32,9 +70,78 @@ private:
 		     osd_op_params_t&& req,
 		     epoch_t min_epoch, epoch_t max_epoch,
 		     std::vector<pg_log_entry_t>&& log_entries) final;
-  CollectionRef coll;
   seastar::future<> request_committed(const osd_reqid_t& reqid,
-				       const eversion_t& version) final {
-    return seastar::now();
+				       const eversion_t& version) final;
+
+  using codec_t = crimson::osd::ECCodec<crimson::osd::IOInterruptCondition>;
+  using read_result_t = codec_t::read_result_t;
+  using subchunks_t = std::vector<std::pair<int, int>>;
+
+  static ghobject_t shard_oid(const hobject_t& hoid, shard_id_t shard) {
+    return codec_t::shard_oid(hoid, shard);
   }
+
+  interruptible_future<codec_t::size_result_t>
+  get_object_size(const hobject_t& hoid) final;
+  interruptible_future<read_result_t>
+  read_object_stripes(const hobject_t& hoid, uint64_t off, uint64_t len) final;
+
+  interruptible_future<read_result_t> read_local_shard(
+    const hobject_t& hoid,
+    uint64_t off,
+    uint64_t len,
+    uint32_t flags,
+    const subchunks_t& subchunks);
+  /// read the same chunk extent from the given shards
+  interruptible_future<std::map<int, read_result_t>> read_chunks(
+    const hobject_t& hoid,
+    uint64_t chunk_off,
+    uint64_t chunk_len,
+    uint32_t flags,
+    const std::set<pg_shard_t>& shards);
+  /// read and decode the stripe aligned logical extent of hoid
+  interruptible_future<read_result_t> read_stripes(
+    const hobject_t& hoid,
+    uint64_t off,
+    uint64_t len,
+    uint32_t flags);
+
+  /// the writes split by prepare_transaction(), by object
+  std::map<hobject_t, codec_t::split_transaction_t> prepared_writes;
+
+  /// wait until the in-flight writes to hoid are committed by all shards
+  interruptible_future<> wait_for_pending_writes(const hobject_t& hoid);
+
+  const pg_t pgid;
+  const pg_shard_t whoami;
+  crimson::osd::PG& pg;
+  ceph::ErasureCodeInterfaceRef ec_impl;
+  codec_t codec;
+  const ECUtil::stripe_info_t& sinfo;
+
+  class pending_on_t : public seastar::weakly_referencable<pending_on_t> {
+  public:
+    pending_on_t(size_t pending,
+		 const eversion_t& at_version,
+		 const hobject_t& hoid)
+      : pending{static_cast<unsigned>(pending)},
+	at_version(at_version),
+	hoid(hoid)
+    {}
+    unsigned pending;
+    // see ReplicatedBackend::pending_on_t
+    const eversion_t at_version;
+    const hobject_t hoid;
+    crimson::osd::acked_peers_t acked_peers;
+    seastar::shared_promise<> all_committed;
+  };
+  using pending_transactions_t = std::map<ceph_tid_t, pending_on_t>;
+  pending_transactions_t pending_trans;
+
+  struct pending_read_t {
+    std::set<pg_shard_t> waiting_on;
+    std::map<int, read_result_t> results;
+    seastar::promise<> all_replied;
+  };
+  std::map<ceph_tid_t, pending_read_t> pending_reads;
 };
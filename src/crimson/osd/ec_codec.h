@@ -0,0 +1,636 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <set>
+
+#include "erasure-code/ErasureCodeInterface.h"
+#include "include/interval_set.h"
+#include "os/Transaction.h"
+#include "osd/ECUtil.h"
+#include "osd/osd_types.h"
+
+#include "crimson/common/coroutine.h"
+#include "crimson/common/interruptible_future.h"
+#include "crimson/common/log.h"
+
+namespace crimson::osd {
+
+/**
+ * ECCodec
+ *
+ * Splits the transactions of an erasure coded PG into the transactions of
+ * its shards, and decodes the stripes read from them.  The stripes are
+ * encoded by ec_impl, whose chunk mapping tells the shard each of their
+ * chunks goes to: shard s holds the chunk ec_impl keyed by s.
+ *
+ * Partially overwritten stripes are read through the ObjectSource, as they
+ * were before the transactions being split, so every shard transaction
+ * carries whole chunks.
+ */
+template <typename InterruptCond>
+class ECCodec {
+public:
+  template <typename T = void>
+  using interruptible_future =
+    ::crimson::interruptible::interruptible_future<InterruptCond, T>;
+
+  /// the data read from a shard, or the errno it failed with
+  struct read_result_t {
+    int error = 0;
+    ceph::bufferlist data;
+  };
+  /// the logical size of an object, or the errno it can't be told with
+  struct size_result_t {
+    int error = 0;
+    // std::nullopt if the object was created, but not written yet
+    std::optional<uint64_t> size;
+  };
+
+  class ObjectSource {
+  public:
+    /// the logical size recorded by the hinfo of hoid
+    virtual interruptible_future<size_result_t>
+    get_object_size(const hobject_t& hoid) = 0;
+    /// read and decode the stripe aligned logical extent of hoid
+    virtual interruptible_future<read_result_t>
+    read_object_stripes(const hobject_t& hoid, uint64_t off, uint64_t len) = 0;
+  protected:
+    ~ObjectSource() = default;
+  };
+
+  /**
+   * object_image_t
+   *
+   * The logical content of an object while a transaction is being split
+   * into the per-shard transactions.  The stripes written or read by the
+   * earlier operations of the transaction are kept, the other ones are
+   * read from the shards of source as they were before the transaction.
+   */
+  struct object_image_t {
+    bool exists = false;
+    bool dirty = false;
+    // stripe aligned logical size
+    uint64_t size = 0;
+    hobject_t source;
+    // the content of source beyond this offset reads as zeros
+    uint64_t source_size = 0;
+    std::map<uint64_t, ceph::bufferlist> stripes;
+    interval_set<uint64_t> zeroed;
+  };
+  using images_t = std::map<hobject_t, object_image_t>;
+  using shard_transactions_t = std::map<shard_id_t, ceph::os::Transaction>;
+
+  /// the per-shard transactions split from the transaction of a write
+  struct split_transaction_t {
+    eversion_t at_version;
+    // the ops of the transaction split so far
+    unsigned num_ops = 0;
+    shard_transactions_t txns;
+    images_t images;
+  };
+
+  ECCodec(ceph::ErasureCodeInterfaceRef ec_impl,
+	  uint64_t stripe_width,
+	  const coll_t& cid,
+	  ObjectSource& source)
+    : ec_impl{std::move(ec_impl)},
+      sinfo{this->ec_impl->get_data_chunk_count(), stripe_width},
+      cid{cid},
+      source{source}
+  {}
+
+  static ghobject_t shard_oid(const hobject_t& hoid, shard_id_t shard) {
+    return ghobject_t{hoid, ghobject_t::NO_GEN, shard};
+  }
+  const ECUtil::stripe_info_t& get_sinfo() const {
+    return sinfo;
+  }
+  /// the shards holding the data chunks
+  std::set<int> get_want_to_read_shards() const {
+    return get_shards(0, ec_impl->get_data_chunk_count());
+  }
+  /// the shards holding any chunk
+  std::set<int> get_all_shards() const {
+    return get_shards(0, ec_impl->get_chunk_count());
+  }
+
+  /**
+   * decode the stripes from the chunks read by shard, all of them starting
+   * at the same chunk offset, and of up to chunk_len each
+   */
+  read_result_t decode(const std::map<int, ceph::bufferlist>& chunks,
+		       uint64_t chunk_len);
+
+  // the functions below return 0, or the negative errno to fail the write with
+  /// split the ops of txn past split.num_ops
+  interruptible_future<int> generate_transactions(
+    ceph::os::Transaction& txn,
+    split_transaction_t& split);
+  /// set the hinfo of the objects written by split
+  void finish_transactions(split_transaction_t& split);
+
+private:
+  /// the shards holding the chunks [first, end) of every stripe
+  std::set<int> get_shards(unsigned first, unsigned end) const {
+    const std::vector<int>& chunk_mapping = ec_impl->get_chunk_mapping();
+    std::set<int> shards;
+    for (unsigned i = first; i < end; ++i) {
+      shards.insert(chunk_mapping.size() > i ? chunk_mapping[i] : (int)i);
+    }
+    return shards;
+  }
+  interruptible_future<int> load_image(images_t& images, const hobject_t& hoid);
+  /// make the stripes in [off, off + len) of image available in its map
+  interruptible_future<int> load_stripes(
+    object_image_t& image, uint64_t off, uint64_t len);
+  interruptible_future<int> rmw_write(
+    shard_transactions_t& txns,
+    object_image_t& image,
+    const hobject_t& hoid,
+    uint64_t off,
+    ceph::bufferlist bl);
+  interruptible_future<int> rmw_zero(
+    shard_transactions_t& txns,
+    object_image_t& image,
+    const hobject_t& hoid,
+    uint64_t off,
+    uint64_t len);
+  interruptible_future<int> rmw_truncate(
+    shard_transactions_t& txns,
+    object_image_t& image,
+    const hobject_t& hoid,
+    uint64_t off);
+  void write_stripes(
+    shard_transactions_t& txns,
+    const hobject_t& hoid,
+    uint64_t off,
+    ceph::bufferlist& bl);
+
+  ceph::ErasureCodeInterfaceRef ec_impl;
+  const ECUtil::stripe_info_t sinfo;
+  const coll_t cid;
+  ObjectSource& source;
+};
+
+template <typename InterruptCond>
+typename ECCodec<InterruptCond>::read_result_t
+ECCodec<InterruptCond>::decode(const std::map<int, ceph::bufferlist>& chunks,
+			       const uint64_t chunk_len)
+{
+  // all shards are of the same size, but the read may go beyond their end
+  uint64_t length = chunk_len;
+  for (auto& [shard, bl] : chunks) {
+    length = std::min<uint64_t>(length, bl.length());
+  }
+  length -= length % sinfo.get_chunk_size();
+  read_result_t ret;
+  if (length == 0) {
+    return ret;
+  }
+  std::map<int, ceph::bufferlist> to_decode;
+  for (auto& [shard, bl] : chunks) {
+    to_decode[shard].substr_of(bl, 0, length);
+  }
+  ECUtil::decode(sinfo, ec_impl, get_want_to_read_shards(), to_decode,
+		 &ret.data);
+  return ret;
+}
+
+template <typename InterruptCond>
+auto ECCodec<InterruptCond>::load_image(images_t& images,
+					const hobject_t& hoid)
+  -> interruptible_future<int>
+{
+  if (images.contains(hoid)) {
+    co_return 0;
+  }
+  auto r = co_await source.get_object_size(hoid);
+  if (r.error < 0) {
+    co_return r.error;
+  }
+  auto& image = images[hoid];
+  image.exists = r.size.has_value();
+  image.size = r.size.value_or(0);
+  image.source = hoid;
+  image.source_size = image.size;
+  co_return 0;
+}
+
+template <typename InterruptCond>
+auto ECCodec<InterruptCond>::load_stripes(object_image_t& image,
+					  const uint64_t off,
+					  const uint64_t len)
+  -> interruptible_future<int>
+{
+  LOG_PREFIX(ECCodec::load_stripes);
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  std::vector<uint64_t> missing;
+  for (uint64_t s = off; s < off + len; s += stripe_width) {
+    if (image.stripes.contains(s)) {
+      continue;
+    }
+    if (s >= image.source_size || image.zeroed.contains(s, stripe_width)) {
+      image.stripes[s].append_zero(stripe_width);
+    } else {
+      missing.push_back(s);
+    }
+  }
+  if (missing.empty()) {
+    co_return 0;
+  }
+
+  const uint64_t first = missing.front();
+  const uint64_t end = missing.back() + stripe_width;
+  auto r = co_await source.read_object_stripes(
+    image.source, first, end - first);
+  if (r.error < 0 && r.error != -ENOENT) {
+    SUBERROR(osd, "unable to read {} {}~{} to modify it: {}",
+	     image.source, first, end - first, r.error);
+    co_return -EIO;
+  }
+  if (r.data.length() < end - first) {
+    r.data.append_zero(end - first - r.data.length());
+  }
+  for (auto s : missing) {
+    auto& stripe = image.stripes[s];
+    stripe.substr_of(r.data, s - first, stripe_width);
+    if (s + stripe_width > image.source_size) {
+      ceph::bufferlist valid;
+      valid.substr_of(stripe, 0, image.source_size - s);
+      valid.append_zero(s + stripe_width - image.source_size);
+      stripe = std::move(valid);
+    }
+  }
+  co_return 0;
+}
+
+template <typename InterruptCond>
+void ECCodec<InterruptCond>::write_stripes(shard_transactions_t& txns,
+					   const hobject_t& hoid,
+					   const uint64_t off,
+					   ceph::bufferlist& bl)
+{
+  // the chunks are keyed by the shard they go to
+  std::map<int, ceph::bufferlist> chunks;
+  ECUtil::encode(sinfo, ec_impl, bl, get_all_shards(), &chunks);
+  const uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(off);
+  for (auto& [shard, chunk] : chunks) {
+    auto txn = txns.find(shard_id_t(shard));
+    ceph_assert(txn != txns.end());
+    txn->second.write(cid, shard_oid(hoid, txn->first),
+		      chunk_off, chunk.length(), chunk);
+  }
+}
+
+template <typename InterruptCond>
+auto ECCodec<InterruptCond>::rmw_write(shard_transactions_t& txns,
+				       object_image_t& image,
+				       const hobject_t& hoid,
+				       const uint64_t off,
+				       ceph::bufferlist bl)
+  -> interruptible_future<int>
+{
+  const uint64_t len = bl.length();
+  image.exists = true;
+  image.dirty = true;
+  if (len == 0) {
+    for (auto& [shard, t] : txns) {
+      t.touch(cid, shard_oid(hoid, shard));
+    }
+    co_return 0;
+  }
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  const uint64_t start = sinfo.logical_to_prev_stripe_offset(off);
+  const uint64_t end = sinfo.logical_to_next_stripe_offset(off + len);
+  ceph::bufferlist data;
+  if (off != start) {
+    if (int r = co_await load_stripes(image, start, stripe_width); r < 0) {
+      co_return r;
+    }
+    data.substr_of(image.stripes[start], 0, off - start);
+  }
+  data.claim_append(bl);
+  if (off + len != end) {
+    const uint64_t last = end - stripe_width;
+    if (int r = co_await load_stripes(image, last, stripe_width); r < 0) {
+      co_return r;
+    }
+    ceph::bufferlist tail;
+    tail.substr_of(image.stripes[last], off + len - last, end - off - len);
+    data.claim_append(tail);
+  }
+  ceph_assert(data.length() == end - start);
+  for (uint64_t s = start; s < end; s += stripe_width) {
+    image.stripes[s].substr_of(data, s - start, stripe_width);
+  }
+  image.size = std::max(image.size, end);
+  write_stripes(txns, hoid, start, data);
+  co_return 0;
+}
+
+template <typename InterruptCond>
+auto ECCodec<InterruptCond>::rmw_zero(shard_transactions_t& txns,
+				      object_image_t& image,
+				      const hobject_t& hoid,
+				      const uint64_t off,
+				      const uint64_t len)
+  -> interruptible_future<int>
+{
+  if (len == 0) {
+    co_return 0;
+  }
+  const uint64_t first = sinfo.logical_to_next_stripe_offset(off);
+  const uint64_t end = sinfo.logical_to_prev_stripe_offset(off + len);
+  auto zeros = [](uint64_t length) {
+    ceph::bufferlist bl;
+    bl.append_zero(length);
+    return bl;
+  };
+  if (first >= end) {
+    // no stripe is zeroed as a whole
+    co_return co_await rmw_write(txns, image, hoid, off, zeros(len));
+  }
+  if (off != first) {
+    int r = co_await rmw_write(txns, image, hoid, off, zeros(first - off));
+    if (r < 0) {
+      co_return r;
+    }
+  }
+  if (off + len != end) {
+    int r = co_await rmw_write(txns, image, hoid, end, zeros(off + len - end));
+    if (r < 0) {
+      co_return r;
+    }
+  }
+  // the chunks of a stripe of zeros are zeros
+  const uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(first);
+  const uint64_t chunk_len =
+    sinfo.aligned_logical_offset_to_chunk_offset(end - first);
+  for (auto& [shard, t] : txns) {
+    t.zero(cid, shard_oid(hoid, shard), chunk_off, chunk_len);
+  }
+  image.stripes.erase(image.stripes.lower_bound(first),
+		      image.stripes.lower_bound(end));
+  image.zeroed.union_insert(first, end - first);
+  image.size = std::max(image.size, end);
+  image.exists = true;
+  image.dirty = true;
+  co_return 0;
+}
+
+template <typename InterruptCond>
+auto ECCodec<InterruptCond>::rmw_truncate(shard_transactions_t& txns,
+					  object_image_t& image,
+					  const hobject_t& hoid,
+					  const uint64_t off)
+  -> interruptible_future<int>
+{
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  const uint64_t end = sinfo.logical_to_next_stripe_offset(off);
+  const bool partial = off != end && off < image.size;
+  if (partial) {
+    // the last stripe is kept, with the data beyond off zeroed
+    const uint64_t last = end - stripe_width;
+    if (int r = co_await load_stripes(image, last, stripe_width); r < 0) {
+      co_return r;
+    }
+    ceph::bufferlist bl;
+    bl.substr_of(image.stripes[last], 0, off - last);
+    bl.append_zero(end - off);
+    image.stripes[last] = std::move(bl);
+  }
+  image.stripes.erase(image.stripes.lower_bound(end), image.stripes.end());
+  image.source_size = std::min(image.source_size, off);
+  image.size = end;
+  image.exists = true;
+  image.dirty = true;
+  for (auto& [shard, t] : txns) {
+    t.truncate(cid, shard_oid(hoid, shard),
+	       sinfo.logical_to_next_chunk_offset(off));
+  }
+  if (partial) {
+    write_stripes(txns, hoid, end - stripe_width,
+		  image.stripes[end - stripe_width]);
+  }
+  co_return 0;
+}
+
+template <typename InterruptCond>
+auto ECCodec<InterruptCond>::generate_transactions(ceph::os::Transaction& txn,
+						   split_transaction_t& split)
+  -> interruptible_future<int>
+{
+  LOG_PREFIX(ECCodec::generate_transactions);
+  using ceph::os::Transaction;
+  auto& txns = split.txns;
+  auto& images = split.images;
+  for (int shard : get_all_shards()) {
+    txns[shard_id_t(shard)];
+  }
+  unsigned num_ops = 0;
+  for (auto i = txn.begin(); i.have_op(); ++num_ops) {
+    const auto op = i.decode_op();
+    // the ops split already are decoded, but not applied again
+    const bool split_already = num_ops < split.num_ops;
+    int r = 0;
+    switch (op->op) {
+    case Transaction::OP_NOP:
+      break;
+    case Transaction::OP_TOUCH:
+    case Transaction::OP_CREATE:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	if (split_already) {
+	  break;
+	}
+	r = co_await load_image(images, hoid);
+	if (r < 0) {
+	  break;
+	}
+	auto& image = images[hoid];
+	image.exists = true;
+	image.dirty = true;
+	for (auto& [shard, t] : txns) {
+	  t.touch(cid, shard_oid(hoid, shard));
+	}
+      }
+      break;
+    case Transaction::OP_WRITE:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	ceph::bufferlist bl;
+	i.decode_bl(bl);
+	if (split_already) {
+	  break;
+	}
+	r = co_await load_image(images, hoid);
+	if (r < 0) {
+	  break;
+	}
+	r = co_await rmw_write(txns, images[hoid], hoid, op->off, std::move(bl));
+      }
+      break;
+    case Transaction::OP_ZERO:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	if (split_already) {
+	  break;
+	}
+	r = co_await load_image(images, hoid);
+	if (r < 0) {
+	  break;
+	}
+	r = co_await rmw_zero(txns, images[hoid], hoid, op->off, op->len);
+      }
+      break;
+    case Transaction::OP_TRUNCATE:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	if (split_already) {
+	  break;
+	}
+	r = co_await load_image(images, hoid);
+	if (r < 0) {
+	  break;
+	}
+	r = co_await rmw_truncate(txns, images[hoid], hoid, op->off);
+      }
+      break;
+    case Transaction::OP_REMOVE:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	if (split_already) {
+	  break;
+	}
+	for (auto& [shard, t] : txns) {
+	  t.remove(cid, shard_oid(hoid, shard));
+	}
+	images[hoid] = object_image_t{};
+      }
+      break;
+    case Transaction::OP_SETATTR:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	std::string name = i.decode_string();
+	ceph::bufferlist bl;
+	i.decode_bl(bl);
+	if (split_already) {
+	  break;
+	}
+	for (auto& [shard, t] : txns) {
+	  t.setattr(cid, shard_oid(hoid, shard), name, bl);
+	}
+      }
+      break;
+    case Transaction::OP_SETATTRS:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	std::map<std::string, ceph::bufferlist> aset;
+	i.decode_attrset(aset);
+	if (split_already) {
+	  break;
+	}
+	const std::map<std::string, ceph::bufferlist, std::less<>> attrs{
+	  aset.begin(), aset.end()};
+	for (auto& [shard, t] : txns) {
+	  t.setattrs(cid, shard_oid(hoid, shard), attrs);
+	}
+      }
+      break;
+    case Transaction::OP_RMATTR:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	std::string name = i.decode_string();
+	if (split_already) {
+	  break;
+	}
+	for (auto& [shard, t] : txns) {
+	  t.rmattr(cid, shard_oid(hoid, shard), name);
+	}
+      }
+      break;
+    case Transaction::OP_RMATTRS:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	if (split_already) {
+	  break;
+	}
+	for (auto& [shard, t] : txns) {
+	  t.rmattrs(cid, shard_oid(hoid, shard));
+	}
+      }
+      break;
+    case Transaction::OP_CLONE:
+      {
+	const auto& src = i.get_oid(op->oid).hobj;
+	const auto& dst = i.get_oid(op->dest_oid).hobj;
+	if (split_already) {
+	  break;
+	}
+	r = co_await load_image(images, src);
+	if (r < 0) {
+	  break;
+	}
+	// the stripes dst does not overwrite are still read from the source
+	// of src
+	auto image = images[src];
+	image.dirty = true;
+	images[dst] = std::move(image);
+	for (auto& [shard, t] : txns) {
+	  t.clone(cid, shard_oid(src, shard), shard_oid(dst, shard));
+	}
+      }
+      break;
+    case Transaction::OP_SETALLOCHINT:
+      {
+	const auto& hoid = i.get_oid(op->oid).hobj;
+	if (split_already) {
+	  break;
+	}
+	for (auto& [shard, t] : txns) {
+	  t.set_alloc_hint(
+	    cid, shard_oid(hoid, shard),
+	    op->expected_object_size / sinfo.get_data_chunk_count(),
+	    op->expected_write_size,
+	    op->hint);
+	}
+      }
+      break;
+    default:
+      // the ops whose data can't be decoded here can't be skipped either
+      ceph_assert(!split_already);
+      SUBERROR(osd, "unsupported op {} on an erasure coded pool",
+	       (unsigned)op->op);
+      r = -EOPNOTSUPP;
+    }
+    if (r < 0) {
+      co_return r;
+    }
+  }
+  split.num_ops = num_ops;
+  co_return 0;
+}
+
+template <typename InterruptCond>
+void ECCodec<InterruptCond>::finish_transactions(split_transaction_t& split)
+{
+  for (auto& [hoid, image] : split.images) {
+    if (!image.exists || !image.dirty) {
+      continue;
+    }
+    ECUtil::HashInfo hinfo{ec_impl->get_chunk_count()};
+    hinfo.set_total_chunk_size_clear_hash(
+      sinfo.aligned_logical_offset_to_chunk_offset(image.size));
+    ceph::bufferlist bl;
+    encode(hinfo, bl);
+    for (auto& [shard, t] : split.txns) {
+      t.setattr(cid, shard_oid(hoid, shard), ECUtil::get_hinfo_key(), bl);
+    }
+  }
+}
+
+} // namespace crimson::osd
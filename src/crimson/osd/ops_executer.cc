@@ -733,42 +733,38 @@ OpsExecuter::do_execute_op(OSDOp& osd_op)
       return backend.omap_get_vals_by_keys(os, osd_op, delta_stats);
     });
   case CEPH_OSD_OP_OMAPSETVALS:
-#if 0
-    if (!pg.get_pgpool().info.supports_omap()) {
+    if (!pg->get_pgpool().info.supports_omap()) {
       return crimson::ct_error::operation_not_supported::make();
     }
-#endif
     return do_write_op([this, &osd_op](auto& backend, auto& os, auto& txn) {
       return backend.omap_set_vals(os, osd_op, txn, *osd_op_params, delta_stats);
     });
   case CEPH_OSD_OP_OMAPSETHEADER:
-#if 0
-    if (!pg.get_pgpool().info.supports_omap()) {
+    if (!pg->get_pgpool().info.supports_omap()) {
       return crimson::ct_error::operation_not_supported::make();
     }
-#endif
     return do_write_op([this, &osd_op](auto& backend, auto& os, auto& txn) {
       return backend.omap_set_header(os, osd_op, txn, *osd_op_params,
         delta_stats);
     });
   case CEPH_OSD_OP_OMAPRMKEYRANGE:
-#if 0
-    if (!pg.get_pgpool().info.supports_omap()) {
+    if (!pg->get_pgpool().info.supports_omap()) {
       return crimson::ct_error::operation_not_supported::make();
     }
-#endif
     return do_write_op([this, &osd_op](auto& backend, auto& os, auto& txn) {
       return backend.omap_remove_range(os, osd_op, txn, delta_stats);
     });
   case CEPH_OSD_OP_OMAPRMKEYS:
-    /** TODO: Implement supports_omap()
-    if (!pg.get_pgpool().info.supports_omap()) {
+    if (!pg->get_pgpool().info.supports_omap()) {
       return crimson::ct_error::operation_not_supported::make();
-    }*/
+    }
     return do_write_op([&osd_op](auto& backend, auto& os, auto& txn) {
       return backend.omap_remove_key(os, osd_op, txn);
     });
   case CEPH_OSD_OP_OMAPCLEAR:
+    if (!pg->get_pgpool().info.supports_omap()) {
+      return crimson::ct_error::operation_not_supported::make();
+    }
     return do_write_op([this, &osd_op](auto& backend, auto& os, auto& txn) {
       return backend.omap_clear(os, osd_op, txn, *osd_op_params, delta_stats);
     });
@@ -844,6 +840,18 @@ std::vector<pg_log_entry_t> OpsExecuter::prepare_transaction(
   return log_entries;
 }
 
+// Defined here because there is a circular dependency between OpsExecuter and PG
+OpsExecuter::osd_op_ierrorator::future<>
+OpsExecuter::prepare_backend_transaction()
+{
+  if (txn.empty()) {
+    return osd_op_ierrorator::now();
+  }
+  assert(osd_op_params);
+  return pg->get_backend().prepare_transaction(
+    get_target(), osd_op_params->at_version, txn);
+}
+
 // Defined here because there is a circular dependency between OpsExecuter and PG
 uint32_t OpsExecuter::get_pool_stripe_width() const {
   return pg->get_pgpool().info.get_stripe_width();
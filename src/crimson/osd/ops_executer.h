@@ -411,6 +411,8 @@ public:
     MutFunc mut_func) &&;
   std::vector<pg_log_entry_t> prepare_transaction(
     const std::vector<OSDOp>& ops);
+  /// let the backend of the pg fail the write before it's logged
+  osd_op_ierrorator::future<> prepare_backend_transaction();
   void fill_op_params(modified_by m);
 
   ObjectContextRef get_obc() const {
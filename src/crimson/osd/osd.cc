@@ -51,6 +51,7 @@
 #include "crimson/osd/pg_backend.h"
 #include "crimson/osd/pg_meta.h"
 #include "crimson/osd/osd_operations/client_request.h"
+#include "crimson/osd/osd_operations/ec_sub_request.h"
 #include "crimson/osd/osd_operations/peering_event.h"
 #include "crimson/osd/osd_operations/pg_advance_map.h"
 #include "crimson/osd/osd_operations/recovery_subrequest.h"
@@ -867,6 +868,16 @@ OSD::do_ms_dispatch(
     return handle_rep_op(conn, boost::static_pointer_cast<MOSDRepOp>(m));
   case MSG_OSD_REPOPREPLY:
     return handle_rep_op_reply(conn, boost::static_pointer_cast<MOSDRepOpReply>(m));
+  case MSG_OSD_EC_WRITE:
+    [[fallthrough]];
+  case MSG_OSD_EC_READ:
+    return handle_ec_sub_op(
+      conn, boost::static_pointer_cast<MOSDFastDispatchOp>(m));
+  case MSG_OSD_EC_WRITE_REPLY:
+    [[fallthrough]];
+  case MSG_OSD_EC_READ_REPLY:
+    return handle_ec_sub_op_reply(
+      conn, boost::static_pointer_cast<MOSDFastDispatchOp>(m));
   case MSG_OSD_SCRUB2:
     return handle_scrub_command(
       conn, boost::static_pointer_cast<MOSDScrub2>(m));
@@ -886,11 +897,20 @@ OSD::do_ms_dispatch(
   }
 }
 
+void OSD::ms_handle_shard_change(
+  crimson::net::ConnectionRef conn,
+  seastar::shard_id new_shard,
+  bool is_accept_or_connect)
+{
+  pg_shard_manager.release_xcore_connection(conn);
+}
+
 void OSD::ms_handle_reset(crimson::net::ConnectionRef conn, bool is_replace)
 {
   // TODO: cleanup the session attached to this connection
   LOG_PREFIX(OSD::ms_handle_reset);
   WARN("{}", *conn);
+  pg_shard_manager.release_xcore_connection(conn);
 }
 
 void OSD::ms_handle_remote_reset(crimson::net::ConnectionRef conn)
@@ -899,6 +919,11 @@ void OSD::ms_handle_remote_reset(crimson::net::ConnectionRef conn)
   WARN("{}", *conn);
 }
 
+void OSD::ms_handle_mark_down(crimson::net::ConnectionRef conn)
+{
+  pg_shard_manager.release_xcore_connection(conn);
+}
+
 void OSD::handle_authentication(const EntityName& name,
 				const AuthCapsInfo& caps_info)
 {
@@ -1333,6 +1358,33 @@ seastar::future<> OSD::handle_rep_op_reply(
     });
 }
 
+seastar::future<> OSD::handle_ec_sub_op(
+  crimson::net::ConnectionRef conn,
+  Ref<MOSDFastDispatchOp> m)
+{
+  return pg_shard_manager.start_pg_operation<ECSubRequest>(
+    std::move(conn),
+    std::move(m)).second;
+}
+
+seastar::future<> OSD::handle_ec_sub_op_reply(
+  crimson::net::ConnectionRef conn,
+  Ref<MOSDFastDispatchOp> m)
+{
+  LOG_PREFIX(OSD::handle_ec_sub_op_reply);
+  spg_t pgid = m->get_spg();
+  return pg_shard_manager.with_pg(
+    pgid,
+    [FNAME, m=std::move(m)](auto &&pg) {
+      if (pg) {
+	pg->handle_ec_sub_op_reply(m);
+      } else {
+	WARN("stale reply: {}", *m);
+      }
+      return seastar::now();
+    });
+}
+
 seastar::future<> OSD::handle_scrub_command(
   crimson::net::ConnectionRef conn,
   Ref<MOSDScrub2> m)
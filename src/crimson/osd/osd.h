@@ -97,8 +97,13 @@ class OSD final : public crimson::net::Dispatcher,
 
   // Dispatcher methods
   std::optional<seastar::future<>> ms_dispatch(crimson::net::ConnectionRef, MessageRef) final;
+  void ms_handle_shard_change(
+    crimson::net::ConnectionRef conn,
+    seastar::shard_id new_shard,
+    bool is_accept_or_connect) final;
   void ms_handle_reset(crimson::net::ConnectionRef conn, bool is_replace) final;
   void ms_handle_remote_reset(crimson::net::ConnectionRef conn) final;
+  void ms_handle_mark_down(crimson::net::ConnectionRef conn) final;
 
   std::optional<seastar::future<>> do_ms_dispatch(crimson::net::ConnectionRef, MessageRef);
 
@@ -206,6 +211,10 @@ private:
                                   Ref<MOSDRepOp> m);
   seastar::future<> handle_rep_op_reply(crimson::net::ConnectionRef conn,
                                         Ref<MOSDRepOpReply> m);
+  seastar::future<> handle_ec_sub_op(crimson::net::ConnectionRef conn,
+                                     Ref<MOSDFastDispatchOp> m);
+  seastar::future<> handle_ec_sub_op_reply(crimson::net::ConnectionRef conn,
+                                           Ref<MOSDFastDispatchOp> m);
   seastar::future<> handle_peering_op(crimson::net::ConnectionRef conn,
                                       Ref<MOSDPeeringOp> m);
   seastar::future<> handle_recovery_subreq(crimson::net::ConnectionRef conn,
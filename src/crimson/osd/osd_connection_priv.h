@@ -19,6 +19,13 @@ struct OSDConnectionPriv : public crimson::net::Connection::user_private_t {
   ConnectionPipeline peering_request_conn_pipeline;
   ConnectionPipeline replicated_request_conn_pipeline;
   crosscore_ordering_t crosscore_ordering;
+  // the cores holding this connection in PerShardState::xcore_conns
+  std::set<core_id_t> xcore_cached_on;
+  // bumped by each release of the cached entries. an entry is tagged with
+  // the epoch it was cached in, so that a release only drops the entries
+  // cached before it, even if the ones cached after it from the new core
+  // of the connection reach the cache first
+  uint64_t xcore_epoch = 0;
 };
 
 static inline OSDConnectionPriv &get_osd_priv(crimson::net::Connection *conn) {
@@ -137,7 +137,8 @@ size_t OSDOperationRegistry::dump_slowest_historic_client_requests(ceph::Formatt
 }
 
 OperationThrottler::OperationThrottler(ConfigProxy &conf)
-  : scheduler(crimson::osd::scheduler::make_scheduler(conf))
+  : scheduler(crimson::osd::scheduler::make_scheduler(conf)),
+    wake_timer([this] { wake(); })
 {
   conf.add_observer(this);
   update_from_config(conf);
@@ -147,7 +148,16 @@ void OperationThrottler::wake()
 {
   while ((!max_in_progress || in_progress < max_in_progress) &&
 	 !scheduler->empty()) {
-    auto item = scheduler->dequeue();
+    auto work_item = scheduler->dequeue();
+    if (auto when = std::get_if<std::chrono::nanoseconds>(&work_item)) {
+      auto deadline = seastar::timer<>::clock::now() +
+	std::chrono::duration_cast<seastar::timer<>::duration>(*when);
+      if (!wake_timer.armed() || wake_timer.get_timeout() > deadline) {
+	wake_timer.rearm(deadline);
+      }
+      return;
+    }
+    auto &item = std::get<crimson::osd::scheduler::item_t>(work_item);
     item.wake.set_value();
     ++in_progress;
     --pending;
@@ -167,6 +177,8 @@ seastar::future<> OperationThrottler::acquire_throttle(
   crimson::osd::scheduler::item_t item{params, seastar::promise<>()};
   auto fut = item.wake.get_future();
   scheduler->enqueue(std::move(item));
+  ++pending;
+  wake();
   return fut;
 }
 
@@ -174,6 +186,7 @@ void OperationThrottler::dump_detail(Formatter *f) const
 {
   f->dump_unsigned("max_in_progress", max_in_progress);
   f->dump_unsigned("in_progress", in_progress);
+  f->dump_unsigned("pending", pending);
   f->open_object_section("scheduler");
   {
     scheduler->dump(*f);
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <seastar/core/timer.hh>
+
 #include "crimson/common/operation.h"
 #include "crimson/osd/pg_interval_interrupt_condition.h"
 #include "crimson/osd/scheduler/scheduler.h"
@@ -60,6 +62,7 @@ enum class OperationTypeCode {
   scrub_find_range,
   scrub_reserve_range,
   scrub_scan,
+  ec_sub_request,
   last_op
 };
 
@@ -83,6 +86,7 @@ static constexpr const char* const OP_NAMES[] = {
   "scrub_find_range",
   "scrub_reserve_range",
   "scrub_scan",
+  "ec_sub_request",
 };
 
 // prevent the addition of OperationTypeCode-s with no matching OP_NAMES entry:
@@ -242,9 +246,10 @@ private:
 /**
  * Throttles set of currently running operations
  *
- * Very primitive currently, assumes all ops are equally
- * expensive and simply limits the number that can be
- * concurrently active.
+ * Every op is queued in the scheduler, which dispatches it according to
+ * its class and cost, holding it back while its class is at its mclock
+ * limit.  max_in_progress additionally limits the number of dispatched ops
+ * which can be concurrently active, 0 for no limit.
  */
 class OperationThrottler : public BlockerT<OperationThrottler>,
 			private md_config_obs_t {
@@ -256,7 +261,6 @@ class OperationThrottler : public BlockerT<OperationThrottler>,
     OperationT* op,
     crimson::osd::scheduler::params_t params,
     F &&f) {
-    if (!max_in_progress) return f();
     return acquire_throttle(params)
       .then(std::forward<F>(f))
       .then([this](auto x) {
@@ -295,6 +299,41 @@ public:
       with_throttle_while(std::forward<Args>(args)...), *this);
   }
 
+  /// releases the throttle acquired with get_throttle() once destroyed
+  class ThrottleReleaser {
+    OperationThrottler *parent = nullptr;
+  public:
+    ThrottleReleaser(OperationThrottler *parent) : parent(parent) {}
+    ThrottleReleaser(const ThrottleReleaser &) = delete;
+    ThrottleReleaser(ThrottleReleaser &&rhs)
+      : parent(std::exchange(rhs.parent, nullptr)) {}
+    ~ThrottleReleaser() {
+      if (parent) {
+	parent->release_throttle();
+      }
+    }
+  };
+
+  /**
+   * get_throttle
+   *
+   * Waits until the scheduler dispatches an op described by params, for
+   * the ops which cannot be expressed as a single continuation.
+   */
+  seastar::future<ThrottleReleaser> get_throttle(
+    crimson::osd::scheduler::params_t params) {
+    return acquire_throttle(params).then([this] {
+      return ThrottleReleaser{this};
+    });
+  }
+
+  template <class OpT>
+  seastar::future<ThrottleReleaser> get_throttle(
+    BlockingEvent::Trigger<OpT>&& trigger,
+    crimson::osd::scheduler::params_t params) {
+    return trigger.maybe_record_blocking(get_throttle(params), *this);
+  }
+
 private:
   void dump_detail(Formatter *f) const final;
 
@@ -305,6 +344,9 @@ private:
 
   uint64_t pending = 0;
 
+  // fires when the ops held back by their mclock limits become eligible
+  seastar::timer<> wake_timer;
+
   void wake();
 
   seastar::future<> acquire_throttle(
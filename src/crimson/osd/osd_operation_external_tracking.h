@@ -7,6 +7,7 @@
 #include "crimson/osd/osdmap_gate.h"
 #include "crimson/osd/osd_operations/background_recovery.h"
 #include "crimson/osd/osd_operations/client_request.h"
+#include "crimson/osd/osd_operations/ec_sub_request.h"
 #include "crimson/osd/osd_operations/peering_event.h"
 #include "crimson/osd/osd_operations/pg_advance_map.h"
 #include "crimson/osd/osd_operations/recovery_subrequest.h"
@@ -32,6 +33,7 @@ struct LttngBackend
     ClientRequest::PGPipeline::WaitForActive::BlockingEvent::Backend,
     PGActivationBlocker::BlockingEvent::Backend,
     scrub::PGScrubber::BlockingEvent::Backend,
+    OperationThrottler::BlockingEvent::Backend,
     ClientRequest::PGPipeline::RecoverMissing::BlockingEvent::Backend,
     ClientRequest::PGPipeline::RecoverMissing::
       BlockingEvent::ExitBarrierEvent::Backend,
@@ -103,6 +105,11 @@ struct LttngBackend
               const scrub::PGScrubber& blocker) override {
   }
 
+  void handle(OperationThrottler::BlockingEvent& ev,
+              const Operation& op,
+              const OperationThrottler& blocker) override {
+  }
+
   void handle(ClientRequest::PGPipeline::RecoverMissing::BlockingEvent& ev,
               const Operation& op,
               const ClientRequest::PGPipeline::RecoverMissing& blocker) override {
@@ -167,6 +174,7 @@ struct HistoricBackend
     ClientRequest::PGPipeline::WaitForActive::BlockingEvent::Backend,
     PGActivationBlocker::BlockingEvent::Backend,
     scrub::PGScrubber::BlockingEvent::Backend,
+    OperationThrottler::BlockingEvent::Backend,
     ClientRequest::PGPipeline::RecoverMissing::BlockingEvent::Backend,
     ClientRequest::PGPipeline::RecoverMissing::
       BlockingEvent::ExitBarrierEvent::Backend,
@@ -238,6 +246,11 @@ struct HistoricBackend
               const scrub::PGScrubber& blocker) override {
   }
 
+  void handle(OperationThrottler::BlockingEvent& ev,
+              const Operation& op,
+              const OperationThrottler& blocker) override {
+  }
+
   void handle(ClientRequest::PGPipeline::RecoverMissing::BlockingEvent& ev,
               const Operation& op,
               const ClientRequest::PGPipeline::RecoverMissing& blocker) override {
@@ -332,6 +345,13 @@ struct EventBackendRegistry<osd::RepRequest> {
   }
 };
 
+template <>
+struct EventBackendRegistry<osd::ECSubRequest> {
+  static std::tuple<> get_backends() {
+    return {/* no extenral backends */};
+  }
+};
+
 
 template <>
 struct EventBackendRegistry<osd::LogMissingRequest> {
@@ -355,7 +355,20 @@ ClientRequest::process_op(
    * Since get_obc is also an exclusive stage, we can merge both stages into
    * a single stage and avoid stage switching overhead.
    */
-  DEBUGDPP("{}.{}: entering check_already_complete_get_obc",
+  DEBUGDPP("{}.{}: waiting for the scheduler",
+	   *pg, *this, this_instance_id);
+  // take the throttle before the exclusive stage, so that the ops waiting
+  // for the scheduler hold neither the stage of the pg nor the obc locks
+  // needed by recovery
+  std::optional<OperationThrottler::ThrottleReleaser> throttle =
+    co_await ihref.with_blocking_event<
+      OperationThrottler::BlockingEvent, interruptor>(
+	[this](auto &&trigger) {
+	  return shard_services->get_throttle(
+	    std::move(trigger), get_scheduler_params());
+	}, *this);
+
+  DEBUGDPP("{}.{}: scheduled, entering check_already_complete_get_obc",
 	   *pg, *this, this_instance_id);
   co_await ihref.enter_stage<interruptor>(
     client_pp(*pg).check_already_complete_get_obc, *this);
@@ -390,7 +403,7 @@ ClientRequest::process_op(
       client_pp(*pg).lock_obc, *this);
   auto process = pg->with_locked_obc(
     m->get_hobj(), op_info,
-    [FNAME, this, pg, this_instance_id, &ihref] (
+    [FNAME, this, pg, this_instance_id, &ihref, &throttle] (
       auto head, auto obc
     ) -> interruptible_future<> {
       DEBUGDPP("{}.{}: got obc {}, entering process stage",
@@ -398,14 +411,16 @@ ClientRequest::process_op(
       return ihref.enter_stage<interruptor>(
 	client_pp(*pg).process, *this
       ).then_interruptible(
-	[FNAME, this, pg, this_instance_id, obc, &ihref]() mutable {
+	[FNAME, this, pg, this_instance_id, obc, &ihref, &throttle]() mutable {
 	  DEBUGDPP("{}.{}: in process stage, calling do_process",
 		   *pg, *this, this_instance_id);
 	  return do_process(
 	    ihref, pg, obc, this_instance_id
 	  ).handle_error_interruptible(
 	    crimson::ct_error::eagain::handle(
-	      [this, pg, this_instance_id, &ihref]() mutable {
+	      [this, pg, this_instance_id, &ihref, &throttle]() mutable {
+		// the retry waits for the scheduler again
+		throttle.reset();
 		return process_op(ihref, pg, this_instance_id);
 	      })
 	  );
@@ -103,6 +103,7 @@ public:
       PGActivationBlocker::BlockingEvent,
       PGPipeline::RecoverMissing::BlockingEvent,
       scrub::PGScrubber::BlockingEvent,
+      OperationThrottler::BlockingEvent,
       PGPipeline::CheckAlreadyCompleteGetObc::BlockingEvent,
       PGPipeline::GetOBC::BlockingEvent,
       PGPipeline::LockOBC::BlockingEvent,
@@ -255,11 +256,11 @@ public:
     return ret;
   }
 
-  void finish_remote_submission(crimson::net::ConnectionFFRef conn) {
+  void finish_remote_submission(crimson::net::ConnectionXcoreRef conn) {
     assert(conn);
     assert(!l_conn);
     assert(!r_conn);
-    r_conn = make_local_shared_foreign(std::move(conn));
+    r_conn = std::move(conn);
   }
 
   interruptible_future<> with_pg_process_interruptible(
@@ -302,6 +303,16 @@ private:
       unsigned this_instance_id);
   bool is_pg_op() const;
 
+  crimson::osd::scheduler::params_t get_scheduler_params() const {
+    return {
+      static_cast<crimson::osd::scheduler::cost_t>(m->get_cost()),
+      // each client gets its own share of the client class, as with the
+      // classic osd
+      m->get_reqid().name.num(),
+      crimson::osd::scheduler::scheduler_class_t::client
+    };
+  }
+
   PGPipeline &client_pp(PG &pg);
 
   template <typename Errorator>
@@ -0,0 +1,88 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "ec_sub_request.h"
+
+#include "common/Formatter.h"
+
+#include "crimson/osd/osd.h"
+#include "crimson/osd/osd_connection_priv.h"
+#include "crimson/osd/osd_operation_external_tracking.h"
+#include "crimson/osd/pg.h"
+
+SET_SUBSYS(osd);
+
+namespace crimson::osd {
+
+ECSubRequest::ECSubRequest(crimson::net::ConnectionRef&& conn,
+			   Ref<MOSDFastDispatchOp> &&req)
+  : l_conn{std::move(conn)},
+    req{std::move(req)}
+{}
+
+void ECSubRequest::print(std::ostream& os) const
+{
+  os << "ECSubRequest("
+     << "req=" << *req
+     << ")";
+}
+
+void ECSubRequest::dump_detail(Formatter *f) const
+{
+  f->open_object_section("ECSubRequest");
+  f->dump_string("type", req->get_type_name());
+  f->dump_stream("pgid") << req->get_spg();
+  f->dump_unsigned("map_epoch", req->get_map_epoch());
+  f->dump_unsigned("min_epoch", req->get_min_epoch());
+  f->close_section();
+}
+
+ConnectionPipeline &ECSubRequest::get_connection_pipeline()
+{
+  return get_osd_priv(&get_local_connection()
+         ).replicated_request_conn_pipeline;
+}
+
+PerShardPipeline &ECSubRequest::get_pershard_pipeline(
+    ShardServices &shard_services)
+{
+  return shard_services.get_replicated_request_pipeline();
+}
+
+ClientRequest::PGPipeline &ECSubRequest::client_pp(PG &pg)
+{
+  return pg.request_pg_pipeline;
+}
+
+seastar::future<> ECSubRequest::with_pg(
+  ShardServices &shard_services, Ref<PG> pg)
+{
+  LOG_PREFIX(ECSubRequest::with_pg);
+  DEBUGI("{}: pg present", *this);
+  IRef ref = this;
+  return interruptor::with_interruption([this, pg] {
+    return this->template enter_stage<interruptor>(client_pp(*pg).await_map
+    ).then_interruptible([this, pg] {
+      return this->template with_blocking_event<
+        PG_OSDMapGate::OSDMapBlocker::BlockingEvent
+      >([this, pg](auto &&trigger) {
+        return pg->osdmap_gate.wait_for_map(
+          std::move(trigger), req->get_min_epoch());
+      });
+    }).then_interruptible([this, pg] (auto) {
+      return pg->handle_ec_sub_op(req);
+    }).then_interruptible([this] {
+      LOG_PREFIX(ECSubRequest::with_pg);
+      DEBUGI("{}: complete", *this);
+      return handle.complete();
+    });
+  }, [](std::exception_ptr) {
+    return seastar::now();
+  }, pg, pg->get_osdmap_epoch()).finally([this, ref=std::move(ref)] {
+    LOG_PREFIX(ECSubRequest::with_pg);
+    DEBUGI("{}: exit", *this);
+    handle.exit();
+  });
+}
+
+}
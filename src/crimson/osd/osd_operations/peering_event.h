@@ -168,11 +168,11 @@ public:
     return ret;
   }
 
-  void finish_remote_submission(crimson::net::ConnectionFFRef conn) {
+  void finish_remote_submission(crimson::net::ConnectionXcoreRef conn) {
     assert(conn);
     assert(!l_conn);
     assert(!r_conn);
-    r_conn = make_local_shared_foreign(std::move(conn));
+    r_conn = std::move(conn);
   }
 };
 
@@ -149,6 +149,13 @@ ScrubScan::ifut<> ScrubScan::run(PG &pg)
 
   DEBUGDPP("listed {} objects", pg, objects);
   for (const auto &object: objects) {
+    // scrub competes with snap trimming for the best effort share, each
+    // object is charged as a random IO as its size is unknown until stat
+    auto throttle = co_await interruptor::make_interruptible(
+      pg.shard_services.get_throttle(
+	crimson::osd::scheduler::params_t{
+	  1, 0,
+	  crimson::osd::scheduler::scheduler_class_t::background_best_effort}));
     co_await scan_object(
       pg,
       ghobject_t(object, ghobject_t::NO_GEN, pg.get_pgid().shard));
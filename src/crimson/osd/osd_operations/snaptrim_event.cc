@@ -195,7 +195,7 @@ SnapTrimObjSubEvent::remove_clone(
     0);
   txn.remove(
     pg->get_collection_ref()->get_cid(),
-    ghobject_t{coid, ghobject_t::NO_GEN, shard_id_t::NO_SHARD});
+    ghobject_t{coid, ghobject_t::NO_GEN, pg->get_pgid().shard});
   obc->obs.oi = object_info_t(coid);
   return interruptor::now();
 }
@@ -237,7 +237,7 @@ void SnapTrimObjSubEvent::remove_head_whiteout(
   head_obc->obs.exists = false;
   head_obc->obs.oi = object_info_t(head_oid);
   txn.remove(pg->get_collection_ref()->get_cid(),
-             ghobject_t{head_oid, ghobject_t::NO_GEN, shard_id_t::NO_SHARD});
+             ghobject_t{head_oid, ghobject_t::NO_GEN, pg->get_pgid().shard});
 }
 
 SnapTrimObjSubEvent::interruptible_future<>
@@ -260,7 +260,7 @@ SnapTrimObjSubEvent::adjust_snaps(
     pg->get_osdmap()->get_features(CEPH_ENTITY_TYPE_OSD, nullptr));
   txn.setattr(
     pg->get_collection_ref()->get_cid(),
-    ghobject_t{coid, ghobject_t::NO_GEN, shard_id_t::NO_SHARD},
+    ghobject_t{coid, ghobject_t::NO_GEN, pg->get_pgid().shard},
     OI_ATTR,
     bl);
   auto &loge = add_log_entry(
@@ -308,7 +308,7 @@ void SnapTrimObjSubEvent::update_head(
   attrs[OI_ATTR] = std::move(bl);
   txn.setattrs(
     pg->get_collection_ref()->get_cid(),
-    ghobject_t{head_oid, ghobject_t::NO_GEN, shard_id_t::NO_SHARD},
+    ghobject_t{head_oid, ghobject_t::NO_GEN, pg->get_pgid().shard},
     attrs);
 }
 
@@ -395,6 +395,21 @@ SnapTrimObjSubEvent::start()
     handle.exit();
   });
 
+  logger().debug("{}: waiting for the scheduler", *this);
+  // see ClientRequest::process_op(), the throttle is taken before the obcs
+  // are locked
+  auto throttle = co_await interruptor::make_interruptible(
+    this->template with_blocking_event<OperationThrottler::BlockingEvent>(
+      [this](auto &&trigger) {
+	return pg->get_shard_services().get_throttle(
+	  std::move(trigger),
+	  crimson::osd::scheduler::params_t{
+	    crimson::common::local_conf().get_val<Option::size_t>(
+	      "osd_snap_trim_cost"),
+	    0,
+	    crimson::osd::scheduler::scheduler_class_t::background_best_effort});
+      }));
+
   co_await enter_stage<interruptor>(
     client_pp().get_obc);
 
@@ -437,7 +452,9 @@ SnapTrimObjSubEvent::process_and_submit(ObjectContextRef head_obc,
 
   co_await enter_stage<interruptor>(client_pp().wait_repop);
 
-  co_await std::move(all_completed);
+  // the backends can apply the removals and attrs of the trimmed clones
+  co_await std::move(all_completed).handle_error_interruptible(
+    crimson::ct_error::assert_all{"unable to trim the clone"});
 
   co_return;
 }
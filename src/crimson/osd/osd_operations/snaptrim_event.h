@@ -170,6 +170,7 @@ public:
 
   std::tuple<
     StartEvent,
+    OperationThrottler::BlockingEvent,
     CommonPGPipeline::GetOBC::BlockingEvent,
     CommonPGPipeline::Process::BlockingEvent,
     CommonPGPipeline::WaitRepop::BlockingEvent,
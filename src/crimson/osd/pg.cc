@@ -17,6 +17,10 @@
 
 #include "common/hobject.h"
 
+#include "messages/MOSDECSubOpRead.h"
+#include "messages/MOSDECSubOpReadReply.h"
+#include "messages/MOSDECSubOpWrite.h"
+#include "messages/MOSDECSubOpWriteReply.h"
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
 #include "messages/MOSDRepOp.h"
@@ -875,7 +879,9 @@ void PG::mutate_object(
       ceph::bufferlist osv;
       obc->obs.oi.encode_no_oid(osv, CEPH_FEATURES_ALL);
       // TODO: get_osdmap()->get_features(CEPH_ENTITY_TYPE_OSD, nullptr));
-      txn.setattr(coll_ref->get_cid(), ghobject_t{obc->obs.oi.soid}, OI_ATTR, osv);
+      txn.setattr(coll_ref->get_cid(),
+		  ghobject_t{obc->obs.oi.soid, ghobject_t::NO_GEN, pg_whoami.shard},
+		  OI_ATTR, osv);
     }
 
     // snapset
@@ -884,7 +890,9 @@ void PG::mutate_object(
         obc->ssc->snapset, obc->obs.oi.soid);
       ceph::bufferlist bss;
       encode(obc->ssc->snapset, bss);
-      txn.setattr(coll_ref->get_cid(), ghobject_t{obc->obs.oi.soid}, SS_ATTR, bss);
+      txn.setattr(coll_ref->get_cid(),
+		  ghobject_t{obc->obs.oi.soid, ghobject_t::NO_GEN, pg_whoami.shard},
+		  SS_ATTR, bss);
       obc->ssc->exists = true;
     } else {
       logger().debug("no snapset (this is a clone)");
@@ -897,7 +905,7 @@ void PG::mutate_object(
 
 PG::interruptible_future<
   std::tuple<PG::interruptible_future<>,
-             PG::interruptible_future<>>>
+             PGBackend::rep_op_iertr::future<>>>
 PG::submit_transaction(
   ObjectContextRef&& obc,
   ceph::os::Transaction&& txn,
@@ -930,7 +938,7 @@ PG::submit_transaction(
       std::move(log_entries));
   co_return std::make_tuple(
     std::move(submitted),
-    all_completed.then_interruptible(
+    std::move(all_completed).safe_then_interruptible(
       [this, last_complete=peering_state.get_info().last_complete,
       at_version=osd_op_p.at_version](auto acked) {
       for (const auto& peer : acked) {
@@ -996,6 +1004,8 @@ PG::do_osd_ops_execute(
       ox->get_target(),
       ceph_osd_op_name(osd_op.op.op));
     return ox->execute_op(osd_op);
+  }).safe_then_interruptible([ox] {
+    return ox->prepare_backend_transaction();
   }).safe_then_interruptible([this, ox, &ops] {
     logger().debug(
       "do_osd_ops_execute: object {} all operations successful",
@@ -1573,6 +1583,83 @@ void PG::handle_rep_op_reply(const MOSDRepOpReply& m)
   }
 }
 
+PG::interruptible_future<> PG::handle_ec_sub_op(Ref<MOSDFastDispatchOp> m)
+{
+  switch (m->get_type()) {
+  case MSG_OSD_EC_WRITE:
+    return handle_ec_sub_write(boost::static_pointer_cast<MOSDECSubOpWrite>(m));
+  case MSG_OSD_EC_READ:
+    if (can_discard_replica_op(*m, m->get_map_epoch())) {
+      return interruptor::now();
+    }
+    return backend->handle_ec_sub_read(
+      boost::static_pointer_cast<MOSDECSubOpRead>(m));
+  default:
+    ceph_abort_msgf("unexpected message %s", m->get_type_name());
+  }
+}
+
+PG::interruptible_future<> PG::handle_ec_sub_write(Ref<MOSDECSubOpWrite> req)
+{
+  LOG_PREFIX(PG::handle_ec_sub_write);
+  DEBUGDPP("{}", *this, *req);
+  if (can_discard_replica_op(*req)) {
+    co_return;
+  }
+
+  auto& op = req->op;
+  update_stats(op.stats);
+  co_await update_snap_map(op.log_entries, op.t);
+  // the sub-writes are not rollbackable yet, so every entry is rolled
+  // forward as soon as it is applied
+  log_operation(std::move(op.log_entries),
+                op.trim_to,
+                op.roll_forward_to,
+                op.roll_forward_to,
+                !op.t.empty(),
+                op.t,
+                false);
+  DEBUGDPP("{} do_transaction", *this, *req);
+  co_await interruptor::make_interruptible(
+    shard_services.get_store().do_transaction(coll_ref, std::move(op.t))
+  );
+
+  const auto &lcod = peering_state.get_info().last_complete;
+  peering_state.update_last_complete_ondisk(lcod);
+  const auto map_epoch = get_osdmap_epoch();
+  auto reply = crimson::make_message<MOSDECSubOpWriteReply>();
+  reply->pgid = spg_t{get_pgid().pgid, get_primary().shard};
+  reply->map_epoch = map_epoch;
+  reply->min_epoch = get_interval_start_epoch();
+  reply->op.from = pg_whoami;
+  reply->op.tid = op.tid;
+  reply->op.last_complete = lcod;
+  reply->op.committed = true;
+  reply->op.applied = true;
+  co_await interruptor::make_interruptible(
+    shard_services.send_to_osd(op.from.osd, std::move(reply), map_epoch)
+  );
+}
+
+void PG::handle_ec_sub_op_reply(Ref<MOSDFastDispatchOp> m)
+{
+  if (can_discard_replica_op(*m, m->get_map_epoch())) {
+    return;
+  }
+  switch (m->get_type()) {
+  case MSG_OSD_EC_WRITE_REPLY:
+    backend->got_ec_sub_write_reply(
+      *boost::static_pointer_cast<MOSDECSubOpWriteReply>(m));
+    break;
+  case MSG_OSD_EC_READ_REPLY:
+    backend->got_ec_sub_read_reply(
+      *boost::static_pointer_cast<MOSDECSubOpReadReply>(m));
+    break;
+  default:
+    ceph_abort_msgf("unexpected message %s", m->get_type_name());
+  }
+}
+
 PG::interruptible_future<> PG::do_update_log_missing(
   Ref<MOSDPGUpdateLogMissing> m,
   crimson::net::ConnectionXcoreRef conn)
@@ -12,6 +12,7 @@
 #include "common/dout.h"
 #include "include/interval_set.h"
 #include "crimson/net/Fwd.h"
+#include "messages/MOSDECSubOpWrite.h"
 #include "messages/MOSDRepOpReply.h"
 #include "messages/MOSDOpReply.h"
 #include "os/Transaction.h"
@@ -29,6 +30,7 @@
 #include "crimson/osd/pg_interval_interrupt_condition.h"
 #include "crimson/osd/ops_executer.h"
 #include "crimson/osd/osd_operations/client_request.h"
+#include "crimson/osd/osd_operations/ec_sub_request.h"
 #include "crimson/osd/osd_operations/logmissing_request.h"
 #include "crimson/osd/osd_operations/logmissing_request_reply.h"
 #include "crimson/osd/osd_operations/peering_event.h"
@@ -610,6 +612,9 @@ public:
   void replica_clear_repop_obc(
     const std::vector<pg_log_entry_t> &logv);
   void handle_rep_op_reply(const MOSDRepOpReply& m);
+  interruptible_future<> handle_ec_sub_op(Ref<MOSDFastDispatchOp> m);
+  interruptible_future<> handle_ec_sub_write(Ref<MOSDECSubOpWrite> m);
+  void handle_ec_sub_op_reply(Ref<MOSDFastDispatchOp> m);
   interruptible_future<> do_update_log_missing(
     Ref<MOSDPGUpdateLogMissing> m,
     crimson::net::ConnectionXcoreRef conn);
@@ -682,7 +687,7 @@ private:
     FailureFunc&& failure_func);
   interruptible_future<MURef<MOSDOpReply>> do_pg_ops(Ref<MOSDOp> m);
   interruptible_future<
-    std::tuple<interruptible_future<>, interruptible_future<>>>
+    std::tuple<interruptible_future<>, PGBackend::rep_op_iertr::future<>>>
   submit_transaction(
     ObjectContextRef&& obc,
     ceph::os::Transaction&& txn,
@@ -867,6 +872,7 @@ private:
   template <class T>
   friend class PeeringEvent;
   friend class RepRequest;
+  friend class ECSubRequest;
   friend class LogMissingRequest;
   friend class LogMissingRequestReply;
   friend class BackfillRecovery;
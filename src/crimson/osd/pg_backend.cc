@@ -59,9 +59,10 @@ PGBackend::create(pg_t pgid,
 					       coll, shard_services,
 					       dpp);
   case pg_pool_t::TYPE_ERASURE:
-    return std::make_unique<ECBackend>(pg_shard.shard, coll, shard_services,
-                                       std::move(ec_profile),
-                                       pool.stripe_width,
+    return std::make_unique<ECBackend>(pgid, pg_shard, pg,
+				       coll, shard_services,
+				       ec_profile,
+				       pool.stripe_width,
 				       dpp);
   default:
     throw runtime_error(seastar::format("unsupported pool type '{}'",
@@ -253,12 +254,36 @@ PGBackend::sparse_read(const ObjectState& os, OSDOp& osd_op,
   }
   logger().trace("sparse_read: {} {}~{}",
                  os.oi.soid, (uint64_t)op.extent.offset, (uint64_t)op.extent.length);
-  return interruptor::make_interruptible(store->fiemap(coll, ghobject_t{os.oi.soid},
+  if (!is_sparse_read_supported()) {
+    // report the whole extent as data, like the classic EC pools do
+    return _read(os.oi.soid, offset, adjusted_length, op.flags
+    ).safe_then_interruptible_tuple(
+      [&delta_stats, &os, &osd_op, offset](auto&& bl) -> read_errorator::future<> {
+      if (!_read_verify_data(os.oi, bl)) {
+        // crc mismatches
+        return crimson::ct_error::object_corrupted::make();
+      }
+      std::map<uint64_t, uint64_t> extents;
+      if (bl.length()) {
+        extents.emplace(offset, bl.length());
+      }
+      osd_op.op.extent.length = bl.length();
+      ceph::encode(extents, osd_op.outdata);
+      encode_destructively(bl, osd_op.outdata);
+      delta_stats.num_rd++;
+      delta_stats.num_rd_kb += shift_round_up(osd_op.op.extent.length, 10);
+      return read_errorator::make_ready_future<>();
+    }, crimson::ct_error::input_output_error::handle([] {
+      return read_errorator::future<>{crimson::ct_error::object_corrupted::make()};
+    }),
+    read_errorator::pass_further{});
+  }
+  return interruptor::make_interruptible(store->fiemap(coll, ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard},
     offset, adjusted_length)).safe_then_interruptible(
     [&delta_stats, &os, &osd_op, this](auto&& m) {
     return seastar::do_with(interval_set<uint64_t>{std::move(m)},
 			    [&delta_stats, &os, &osd_op, this](auto&& extents) {
-      return interruptor::make_interruptible(store->readv(coll, ghobject_t{os.oi.soid},
+      return interruptor::make_interruptible(store->readv(coll, ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard},
                           extents, osd_op.op.flags)).safe_then_interruptible_tuple(
         [&delta_stats, &os, &osd_op, &extents](auto&& bl) -> read_errorator::future<> {
         if (_read_verify_data(os.oi, bl)) {
@@ -450,7 +475,7 @@ PGBackend::write_iertr::future<> PGBackend::_writefull(
   const bool existing = maybe_create_new_object(os, txn, delta_stats);
   if (existing && bl.length() < os.oi.size) {
 
-    txn.truncate(coll->get_cid(), ghobject_t{os.oi.soid}, bl.length());
+    txn.truncate(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}, bl.length());
     truncate_update_size_and_usage(delta_stats, os.oi, truncate_size);
 
     osd_op_params.clean_regions.mark_data_region_dirty(
@@ -459,7 +484,7 @@ PGBackend::write_iertr::future<> PGBackend::_writefull(
   }
   if (bl.length()) {
     txn.write(
-      coll->get_cid(), ghobject_t{os.oi.soid}, 0, bl.length(),
+      coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}, 0, bl.length(),
       bl, flags);
     update_size_and_usage(
       delta_stats,
@@ -499,7 +524,7 @@ PGBackend::write_iertr::future<> PGBackend::_truncate(
   if (os.oi.size != offset) {
     txn.truncate(
       coll->get_cid(),
-      ghobject_t{os.oi.soid}, offset);
+      ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}, offset);
     if (os.oi.size > offset) {
       interval_set<uint64_t> trim;
       trim.insert(offset, os.oi.size - offset);
@@ -530,7 +555,7 @@ bool PGBackend::maybe_create_new_object(
     os.exists = true;
     os.oi.new_object();
 
-    txn.touch(coll->get_cid(), ghobject_t{os.oi.soid});
+    txn.touch(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard});
     delta_stats.num_objects++;
     return false;
   } else if (os.oi.is_whiteout()) {
@@ -603,7 +628,7 @@ PGBackend::interruptible_future<> PGBackend::set_allochint(
   os.oi.expected_write_size = osd_op.op.alloc_hint.expected_write_size;
   os.oi.alloc_hint_flags = osd_op.op.alloc_hint.flags;
   txn.set_alloc_hint(coll->get_cid(),
-                     ghobject_t{os.oi.soid},
+                     ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard},
                      os.oi.expected_object_size,
                      os.oi.expected_write_size,
                      os.oi.alloc_hint_flags);
@@ -648,7 +673,7 @@ PGBackend::write_iertr::future<> PGBackend::write(
     // write arrives before trimtrunc
     if (os.exists && !os.oi.is_whiteout()) {
       txn.truncate(coll->get_cid(),
-                   ghobject_t{os.oi.soid}, op.extent.truncate_size);
+                   ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}, op.extent.truncate_size);
       if (op.extent.truncate_size != os.oi.size) {
         os.oi.size = length;
         if (op.extent.truncate_size < os.oi.size) {
@@ -669,13 +694,13 @@ PGBackend::write_iertr::future<> PGBackend::write(
   maybe_create_new_object(os, txn, delta_stats);
   if (length == 0) {
     if (offset > os.oi.size) {
-      txn.truncate(coll->get_cid(), ghobject_t{os.oi.soid}, op.extent.offset);
+      txn.truncate(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}, op.extent.offset);
       truncate_update_size_and_usage(delta_stats, os.oi, op.extent.offset);
     } else {
       txn.nop();
     }
   } else {
-    txn.write(coll->get_cid(), ghobject_t{os.oi.soid},
+    txn.write(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard},
 	      offset, length, std::move(buf), op.flags);
     update_size_and_usage(delta_stats, osd_op_params.modified_ranges,
                           os.oi, offset, length);
@@ -709,7 +734,7 @@ PGBackend::interruptible_future<> PGBackend::write_same(
     repeated_indata.append(osd_op.indata);
   }
   maybe_create_new_object(os, txn, delta_stats);
-  txn.write(coll->get_cid(), ghobject_t{os.oi.soid},
+  txn.write(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard},
             op.writesame.offset, len,
             std::move(repeated_indata), op.flags);
   update_size_and_usage(delta_stats, osd_op_params.modified_ranges,
@@ -789,8 +814,8 @@ PGBackend::rollback_iertr::future<> PGBackend::rollback(
                                   ghobject_t::NO_GEN, shard});
     }
     // 2) Clone correct snapshot into head
-    txn.clone(coll->get_cid(), ghobject_t{resolved_obc->obs.oi.soid},
-                               ghobject_t{os.oi.soid});
+    txn.clone(coll->get_cid(), ghobject_t{resolved_obc->obs.oi.soid, ghobject_t::NO_GEN, shard},
+                               ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard});
     //    Copy clone obc.os.oi to os.oi
     os.oi.clear_flag(object_info_t::FLAG_WHITEOUT);
     os.oi.copy_user_bits(resolved_obc->obs.oi);
@@ -851,7 +876,7 @@ PGBackend::append_ierrorator::future<> PGBackend::append(
   }
   maybe_create_new_object(os, txn, delta_stats);
   if (op.extent.length) {
-    txn.write(coll->get_cid(), ghobject_t{os.oi.soid},
+    txn.write(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard},
               os.oi.size /* offset */, op.extent.length,
               std::move(osd_op.indata), op.flags);
     update_size_and_usage(delta_stats,
@@ -910,7 +935,7 @@ PGBackend::write_iertr::future<> PGBackend::zero(
   }
 
   txn.zero(coll->get_cid(),
-           ghobject_t{os.oi.soid},
+           ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard},
            op.extent.offset,
            op.extent.length);
   interval_set<uint64_t> ch;
@@ -1089,7 +1114,7 @@ PGBackend::setxattr_ierrorator::future<> PGBackend::setxattr(
     bp.copy(osd_op.op.xattr.value_len, val);
   }
   logger().debug("setxattr on obj={} for attr={}", os.oi.soid, name);
-  txn.setattr(coll->get_cid(), ghobject_t{os.oi.soid}, name, val);
+  txn.setattr(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}, name, val);
   delta_stats.num_wr++;
   return seastar::now();
 }
@@ -1123,7 +1148,7 @@ PGBackend::getxattr(
   const hobject_t& soid,
   std::string_view key) const
 {
-  return store->get_attr(coll, ghobject_t{soid}, key);
+  return store->get_attr(coll, ghobject_t{soid, ghobject_t::NO_GEN, shard}, key);
 }
 
 PGBackend::get_attr_ierrorator::future<ceph::bufferlist>
@@ -1132,7 +1157,7 @@ PGBackend::getxattr(
   std::string&& key) const
 {
   return seastar::do_with(key, [this, &soid](auto &key) {
-    return store->get_attr(coll, ghobject_t{soid}, key);
+    return store->get_attr(coll, ghobject_t{soid, ghobject_t::NO_GEN, shard}, key);
   });
 }
 
@@ -1141,7 +1166,7 @@ PGBackend::get_attr_ierrorator::future<> PGBackend::get_xattrs(
   OSDOp& osd_op,
   object_stat_sum_t& delta_stats) const
 {
-  return store->get_attrs(coll, ghobject_t{os.oi.soid}).safe_then(
+  return store->get_attrs(coll, ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}).safe_then(
     [&delta_stats, &osd_op](auto&& attrs) {
     std::vector<std::pair<std::string, bufferlist>> user_xattrs;
     ceph::bufferlist bl;
@@ -1279,7 +1304,7 @@ PGBackend::rm_xattr(
   auto bp = osd_op.indata.cbegin();
   string attr_name{"_"};
   bp.copy(osd_op.op.xattr.name_len, attr_name);
-  txn.rmattr(coll->get_cid(), ghobject_t{os.oi.soid}, attr_name);
+  txn.rmattr(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}, attr_name);
   return rm_xattr_iertr::now();
 }
 
@@ -1290,13 +1315,13 @@ void PGBackend::clone(
   ceph::os::Transaction& txn)
 {
   // See OpsExecutor::execute_clone documentation
-  txn.clone(coll->get_cid(), ghobject_t{os.oi.soid}, ghobject_t{d_os.oi.soid});
+  txn.clone(coll->get_cid(), ghobject_t{os.oi.soid, ghobject_t::NO_GEN, shard}, ghobject_t{d_os.oi.soid, ghobject_t::NO_GEN, shard});
   {
     ceph::bufferlist bv;
     snap_oi.encode_no_oid(bv, CEPH_FEATURES_ALL);
-    txn.setattr(coll->get_cid(), ghobject_t{d_os.oi.soid}, OI_ATTR, bv);
+    txn.setattr(coll->get_cid(), ghobject_t{d_os.oi.soid, ghobject_t::NO_GEN, shard}, OI_ATTR, bv);
   }
-  txn.rmattr(coll->get_cid(), ghobject_t{d_os.oi.soid}, SS_ATTR);
+  txn.rmattr(coll->get_cid(), ghobject_t{d_os.oi.soid, ghobject_t::NO_GEN, shard}, SS_ATTR);
 }
 
 using get_omap_ertr =
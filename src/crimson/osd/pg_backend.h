@@ -14,6 +14,7 @@
 #include "crimson/os/futurized_collection.h"
 #include "crimson/osd/acked_peers.h"
 #include "crimson/common/shared_lru.h"
+#include "crimson/common/type_helpers.h"
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
 #include "os/Transaction.h"
@@ -23,6 +24,9 @@
 #include "crimson/osd/osd_operations/osdop_params.h"
 
 struct hobject_t;
+class MOSDECSubOpRead;
+class MOSDECSubOpReadReply;
+class MOSDECSubOpWriteReply;
 
 namespace ceph::os {
   class Transaction;
@@ -60,9 +64,18 @@ public:
   using interruptible_future =
     ::crimson::interruptible::interruptible_future<
       ::crimson::osd::IOInterruptCondition, T>;
+  using rep_op_ertr = crimson::errorator<
+    crimson::ct_error::operation_not_supported,
+    crimson::ct_error::input_output_error>;
+  using rep_op_iertr =
+    ::crimson::interruptible::interruptible_errorator<
+      ::crimson::osd::IOInterruptCondition,
+      rep_op_ertr>;
+  // the write fails through the second future if the backend can't apply
+  // its transaction, before anything is sent or logged
   using rep_op_ret_t = 
     std::tuple<interruptible_future<>,
-	       interruptible_future<crimson::osd::acked_peers_t>>;
+	       rep_op_iertr::future<crimson::osd::acked_peers_t>>;
   using rep_op_fut_t = interruptible_future<rep_op_ret_t>;
   PGBackend(shard_id_t shard, CollectionRef coll,
             crimson::osd::ShardServices &shard_services,
@@ -411,6 +424,22 @@ public:
     ceph::os::Transaction& trans,
     osd_op_params_t& osd_op_params,
     object_stat_sum_t& delta_stats);
+  using prepare_transaction_ertr = rep_op_ertr;
+  using prepare_transaction_iertr =
+    ::crimson::interruptible::interruptible_errorator<
+      ::crimson::osd::IOInterruptCondition,
+      prepare_transaction_ertr>;
+  /**
+   * called with the transaction of a client write once its ops are
+   * executed, before anything is logged, so that a backend unable to apply
+   * it fails the write instead of submit_transaction()
+   */
+  virtual prepare_transaction_iertr::future<>
+  prepare_transaction(const hobject_t& hoid,
+		      const eversion_t& at_version,
+		      ceph::os::Transaction& txn) {
+    return prepare_transaction_iertr::now();
+  }
   virtual rep_op_fut_t
   submit_transaction(const std::set<pg_shard_t> &pg_shards,
 		     const hobject_t& hoid,
@@ -420,6 +449,15 @@ public:
 		     std::vector<pg_log_entry_t>&& log_entries) = 0;
 
   virtual void got_rep_op_reply(const MOSDRepOpReply&) {}
+  virtual void got_ec_sub_write_reply(const MOSDECSubOpWriteReply&) {}
+  virtual void got_ec_sub_read_reply(MOSDECSubOpReadReply&) {}
+  virtual interruptible_future<> handle_ec_sub_read(Ref<MOSDECSubOpRead>) {
+    return seastar::now();
+  }
+  /// whether the extents of the objects can be read from the local store
+  virtual bool is_sparse_read_supported() const {
+    return true;
+  }
   virtual seastar::future<> stop() = 0;
   virtual void on_actingset_changed(bool same_primary) = 0;
 protected:
@@ -183,14 +183,17 @@ public:
       F &&f) {
     ceph_assert(op->use_count() == 1);
     if (seastar::this_shard_id() == core) {
+      ++get_local_state().op_routing_stats.ops_local;
       auto f_conn = op->prepare_remote_submission();
-      op->finish_remote_submission(std::move(f_conn));
+      op->finish_remote_submission(
+        make_local_shared_foreign(std::move(f_conn)));
       auto &target_shard_services = shard_services.local();
       return std::invoke(
         std::move(f),
         target_shard_services,
         std::move(op));
     }
+    ++get_local_state().op_routing_stats.ops_crosscore;
     // Note: the ordering in only preserved until f is invoked.
     auto &opref = *op;
     auto &crosscore_ordering = get_osd_priv(
@@ -203,13 +206,45 @@ public:
     ).then([this, core, cc_seq,
             op=std::move(op), f=std::move(f)]() mutable {
       get_local_state().registry.remove_from_registry(*op);
+      auto conn = &op->get_local_connection();
+      // only the client connections are lossy, so they are always reset or
+      // marked down before going away and the cached references can be
+      // dropped then
+      const bool cached = conn->get_peer_name().is_client();
+      const uint64_t epoch = cached ? get_osd_priv(conn).xcore_epoch : 0;
       auto f_conn = op->prepare_remote_submission();
+      if (cached && !get_osd_priv(conn).xcore_cached_on.insert(core).second) {
+        // the remote core holds the connection already, release it here
+        // instead of sending the foreign_ptr there and back
+        f_conn.reset();
+      }
       return shard_services.invoke_on(
         core,
-        [this, cc_seq,
+        [this, cc_seq, conn, cached, epoch,
          f=std::move(f), op=std::move(op), f_conn=std::move(f_conn)
         ](auto &target_shard_services) mutable {
-        op->finish_remote_submission(std::move(f_conn));
+        if (cached) {
+          auto &xcore_conn = target_shard_services.local_state.xcore_conns[conn];
+          if (f_conn) {
+            auto ref = make_local_shared_foreign(std::move(f_conn));
+            // the last op of the previous core of a moved conn may come
+            // after the first one of its new core, and must not replace
+            // the entry that only a later release drops
+            if (!xcore_conn.conn || epoch >= xcore_conn.epoch) {
+              xcore_conn = {ref, epoch};
+            }
+            op->finish_remote_submission(std::move(ref));
+          } else {
+            // the ops of a core reach this one in order after the one that
+            // cached conn, and a release from the previous core of conn
+            // never drops what its new core cached
+            ceph_assert(xcore_conn.conn);
+            op->finish_remote_submission(xcore_conn.conn);
+          }
+        } else {
+          op->finish_remote_submission(
+            make_local_shared_foreign(std::move(f_conn)));
+        }
         target_shard_services.local_state.registry.add_to_registry(*op);
         return this->template process_ordered_op_remotely<T>(
             cc_seq, target_shard_services, std::move(op), std::move(f));
@@ -217,6 +252,35 @@ public:
     });
   }
 
+  /**
+   * release_xcore_connection
+   *
+   * Drops the references to conn cached by the other cores, must be called
+   * on the core of conn once it is reset, marked down or moved to another
+   * core.
+   */
+  void release_xcore_connection(crimson::net::ConnectionRef conn) {
+    if (!conn->has_user_private()) {
+      return;
+    }
+    auto &priv = get_osd_priv(conn.get());
+    auto cores = std::move(priv.xcore_cached_on);
+    priv.xcore_cached_on.clear();
+    const uint64_t epoch = priv.xcore_epoch++;
+    for (auto core : cores) {
+      // ordered after the ops forwarded to core before, but not after the
+      // ones forwarded from the new core of a moved conn
+      std::ignore = shard_services.invoke_on(
+        core, [conn=conn.get(), epoch](auto &target_shard_services) {
+        auto &xcore_conns = target_shard_services.local_state.xcore_conns;
+        if (auto i = xcore_conns.find(conn);
+            i != xcore_conns.end() && i->second.epoch <= epoch) {
+          xcore_conns.erase(i);
+        }
+      });
+    }
+  }
+
   /// Runs opref on the appropriate core, creating the pg as necessary.
   template <typename T>
   seastar::future<> run_with_pg_maybe_create(
@@ -16,6 +16,8 @@
 #include <memory>
 #include <functional>
 
+#include <fmt/format.h>
+
 #include "crimson/osd/scheduler/mclock_scheduler.h"
 #include "common/dout.h"
 
@@ -30,36 +32,107 @@ using namespace std::placeholders;
 
 namespace crimson::osd::scheduler {
 
-mClockScheduler::mClockScheduler(ConfigProxy &conf) :
+mClockScheduler::mClockScheduler(
+  ConfigProxy &conf,
+  uint32_t num_shards,
+  bool is_rotational) :
+  conf(conf),
+  num_shards(num_shards),
+  is_rotational(is_rotational),
   scheduler(
     std::bind(&mClockScheduler::ClientRegistry::get_info,
 	      &client_registry,
 	      _1),
-    dmc::AtLimit::Allow,
+    dmc::AtLimit::Wait,
     conf.get_val<double>("osd_mclock_scheduler_anticipation_timeout"))
 {
+  ceph_assert(num_shards > 0);
   conf.add_observer(this);
-  client_registry.update_from_config(conf);
+  update_configuration(conf);
+}
+
+mClockScheduler::~mClockScheduler()
+{
+  conf.remove_observer(this);
 }
 
-void mClockScheduler::ClientRegistry::update_from_config(const ConfigProxy &conf)
+void mClockScheduler::set_osd_capacity_params_from_config(
+  const ConfigProxy &conf)
 {
-  default_external_client_info.update(
-    conf.get_val<double>("osd_mclock_scheduler_client_res"),
-    conf.get_val<uint64_t>("osd_mclock_scheduler_client_wgt"),
-    conf.get_val<double>("osd_mclock_scheduler_client_lim"));
+  auto [bandwidth, iops] = [&, this] {
+    if (is_rotational) {
+      return std::make_tuple(
+	conf.get_val<Option::size_t>("osd_mclock_max_sequential_bandwidth_hdd"),
+	conf.get_val<double>("osd_mclock_max_capacity_iops_hdd"));
+    } else {
+      return std::make_tuple(
+	conf.get_val<Option::size_t>("osd_mclock_max_sequential_bandwidth_ssd"),
+	conf.get_val<double>("osd_mclock_max_capacity_iops_ssd"));
+    }
+  }();
+  uint64_t osd_bandwidth_capacity = std::max<uint64_t>(1, bandwidth);
+  double osd_iop_capacity = std::max<double>(1.0, iops);
+
+  osd_bandwidth_cost_per_io =
+    static_cast<double>(osd_bandwidth_capacity) / osd_iop_capacity;
+  osd_bandwidth_capacity_per_shard =
+    static_cast<double>(osd_bandwidth_capacity) / num_shards;
+}
+
+mClockScheduler::mclock_profile_t mClockScheduler::get_profile(
+  const ConfigProxy &conf)
+{
+  // see the built-in profiles of the classic mClockScheduler
+  const auto profile = conf.get_val<std::string>("osd_mclock_profile");
+  if (profile == "high_client_ops") {
+    return {{.6, 2, 0}, {.4, 1, 0}, {0, 1, .7}};
+  } else if (profile == "high_recovery_ops") {
+    return {{.3, 1, 0}, {.7, 2, 0}, {0, 1, 0}};
+  } else if (profile == "balanced") {
+    return {{.5, 1, 0}, {.5, 1, 0}, {0, 1, .9}};
+  }
+  ceph_assert(profile == "custom");
+  auto get_class = [&conf](const std::string &klass) {
+    return class_profile_t{
+      conf.get_val<double>(fmt::format("osd_mclock_scheduler_{}_res", klass)),
+      conf.get_val<uint64_t>(fmt::format("osd_mclock_scheduler_{}_wgt", klass)),
+      conf.get_val<double>(fmt::format("osd_mclock_scheduler_{}_lim", klass))};
+  };
+  return {
+    get_class("client"),
+    get_class("background_recovery"),
+    get_class("background_best_effort")};
+}
 
-  internal_client_infos[
-    static_cast<size_t>(scheduler_class_t::background_recovery)].update(
-    conf.get_val<double>("osd_mclock_scheduler_background_recovery_res"),
-    conf.get_val<uint64_t>("osd_mclock_scheduler_background_recovery_wgt"),
-    conf.get_val<double>("osd_mclock_scheduler_background_recovery_lim"));
+void mClockScheduler::update_configuration(const ConfigProxy &conf)
+{
+  set_osd_capacity_params_from_config(conf);
+  client_registry.update_from_profile(
+    get_profile(conf), osd_bandwidth_capacity_per_shard);
+}
 
-  internal_client_infos[
-    static_cast<size_t>(scheduler_class_t::background_best_effort)].update(
-    conf.get_val<double>("osd_mclock_scheduler_background_best_effort_res"),
-    conf.get_val<uint64_t>("osd_mclock_scheduler_background_best_effort_wgt"),
-    conf.get_val<double>("osd_mclock_scheduler_background_best_effort_lim"));
+/* mclock expects limit and reservation to have units of <cost>/second
+ * (bytes/second), but the profiles express them as ratios of the OSD's
+ * capacity, 0 meaning no reservation or no limit.
+ */
+void mClockScheduler::ClientRegistry::update_from_profile(
+  const mclock_profile_t &profile,
+  double capacity_per_shard)
+{
+  auto update = [capacity_per_shard](dmc::ClientInfo &info,
+				     const class_profile_t &p) {
+    info.update(
+      p.reservation ? p.reservation * capacity_per_shard : default_min,
+      p.weight,
+      p.limit ? p.limit * capacity_per_shard : default_max);
+  };
+  update(default_external_client_info, profile.client);
+  update(internal_client_infos[
+    static_cast<size_t>(scheduler_class_t::background_recovery)],
+    profile.background_recovery);
+  update(internal_client_infos[
+    static_cast<size_t>(scheduler_class_t::background_best_effort)],
+    profile.background_best_effort);
 }
 
 const dmc::ClientInfo *mClockScheduler::ClientRegistry::get_external_client(
@@ -89,12 +162,26 @@ const dmc::ClientInfo *mClockScheduler::ClientRegistry::get_info(
 
 void mClockScheduler::dump(ceph::Formatter &f) const
 {
+  f.dump_float("cost_per_io", osd_bandwidth_cost_per_io);
+  f.dump_float("capacity_per_shard", osd_bandwidth_capacity_per_shard);
+  f.dump_unsigned("immediate_queue_size", immediate.size());
+  f.dump_unsigned("scheduler_client_count", scheduler.client_count());
+  f.dump_unsigned("scheduler_queue_size", scheduler.request_count());
+}
+
+cost_t mClockScheduler::calc_scaled_cost(
+  cost_t item_cost) const
+{
+  // every op costs at least a random IO, however small it is
+  return std::max<cost_t>(
+    std::max<cost_t>(1, item_cost),
+    static_cast<cost_t>(osd_bandwidth_cost_per_io));
 }
 
 void mClockScheduler::enqueue(item_t&& item)
 {
   auto id = get_scheduler_id(item);
-  auto cost = item.params.cost;
+  auto cost = calc_scaled_cost(item.params.cost);
 
   if (scheduler_class_t::immediate == item.params.klass) {
     immediate.push_front(std::move(item));
@@ -113,7 +200,7 @@ void mClockScheduler::enqueue_front(item_t&& item)
   // putting the item back in the queue
 }
 
-item_t mClockScheduler::dequeue()
+work_item_t mClockScheduler::dequeue()
 {
   if (!immediate.empty()) {
     auto ret = std::move(immediate.back());
@@ -122,13 +209,14 @@ item_t mClockScheduler::dequeue()
   } else {
     mclock_queue_t::PullReq result = scheduler.pull_request();
     if (result.is_future()) {
-      ceph_assert(
-	0 == "Not implemented, user would have to be able to be woken up");
-      return std::move(*(item_t*)nullptr);
+      // all queued ops are held back by their limits
+      std::chrono::duration<double> wait{
+	std::max(0.0, result.getTime() - dmc::get_time())};
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(wait);
     } else if (result.is_none()) {
       ceph_assert(
 	0 == "Impossible, must have checked empty() first");
-      return std::move(*(item_t*)nullptr);
+      return std::chrono::nanoseconds{0};
     } else {
       ceph_assert(result.is_retn());
 
@@ -150,6 +238,11 @@ const char** mClockScheduler::get_tracked_conf_keys() const
     "osd_mclock_scheduler_background_best_effort_res",
     "osd_mclock_scheduler_background_best_effort_wgt",
     "osd_mclock_scheduler_background_best_effort_lim",
+    "osd_mclock_max_capacity_iops_hdd",
+    "osd_mclock_max_capacity_iops_ssd",
+    "osd_mclock_max_sequential_bandwidth_hdd",
+    "osd_mclock_max_sequential_bandwidth_ssd",
+    "osd_mclock_profile",
     NULL
   };
   return KEYS;
@@ -159,7 +252,7 @@ void mClockScheduler::handle_conf_change(
   const ConfigProxy& conf,
   const std::set<std::string> &changed)
 {
-  client_registry.update_from_config(conf);
+  update_configuration(conf);
 }
 
 }
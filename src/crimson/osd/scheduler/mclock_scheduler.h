@@ -15,6 +15,8 @@
 
 #pragma once
 
+#include <limits>
+#include <list>
 #include <ostream>
 #include <map>
 #include <vector>
@@ -46,12 +48,50 @@ struct scheduler_id_t {
   auto operator<=>(const scheduler_id_t&) const = default;
 };
 
+constexpr double default_min = 0.0;
+constexpr double default_max = std::numeric_limits<double>::is_iec559 ?
+  std::numeric_limits<double>::infinity() :
+  std::numeric_limits<double>::max();
+
 /**
  * Scheduler implementation based on mclock.
  *
- * TODO: explain configs
+ * As with the classic OSD, the costs are expressed in bytes, and every op
+ * is charged at least osd_bandwidth_cost_per_io for the random IO it
+ * implies.  The reservations and limits of the classes are configured as
+ * fractions of the bandwidth of the OSD, which is derived from
+ * osd_mclock_max_capacity_iops_(hdd|ssd) and
+ * osd_mclock_max_sequential_bandwidth_(hdd|ssd), and split evenly among
+ * the reactors.  Unless osd_mclock_profile is "custom", the reservation,
+ * weight and limit of the classes come from the built-in profile instead
+ * of the osd_mclock_scheduler_* options.
+ *
+ * Scrub, snap trimming and pg removal share background_best_effort, the
+ * recovery initiated by peering is background_recovery.
  */
 class mClockScheduler : public Scheduler, md_config_obs_t {
+  ConfigProxy &conf;
+  const uint32_t num_shards;
+  const bool is_rotational;
+
+  /// bytes/io, the cost charged for an op in addition to its size
+  double osd_bandwidth_cost_per_io = 0.0;
+  /// bytes/second, the share of the OSD bandwidth served by this shard
+  double osd_bandwidth_capacity_per_shard = 0.0;
+
+  struct class_profile_t {
+    double reservation;
+    uint64_t weight;
+    double limit;
+  };
+  struct mclock_profile_t {
+    class_profile_t client;
+    class_profile_t background_recovery;
+    class_profile_t background_best_effort;
+  };
+  /// the built-in profile named by osd_mclock_profile, or the configured
+  /// values if it is "custom"
+  static mclock_profile_t get_profile(const ConfigProxy &conf);
 
   class ClientRegistry {
     std::array<
@@ -69,7 +109,9 @@ class mClockScheduler : public Scheduler, md_config_obs_t {
     const crimson::dmclock::ClientInfo *get_external_client(
       const client_profile_id_t &client) const;
   public:
-    void update_from_config(const ConfigProxy &conf);
+    void update_from_profile(
+      const mclock_profile_t &profile,
+      double capacity_per_shard);
     const crimson::dmclock::ClientInfo *get_info(
       const scheduler_id_t &id) const;
   } client_registry;
@@ -93,8 +135,13 @@ class mClockScheduler : public Scheduler, md_config_obs_t {
     };
   }
 
+  void set_osd_capacity_params_from_config(const ConfigProxy &conf);
+  void update_configuration(const ConfigProxy &conf);
+  cost_t calc_scaled_cost(cost_t item_cost) const;
+
 public:
-  mClockScheduler(ConfigProxy &conf);
+  mClockScheduler(ConfigProxy &conf, uint32_t num_shards, bool is_rotational);
+  ~mClockScheduler() override;
 
   // Enqueue op in the back of the regular queue
   void enqueue(item_t &&item) final;
@@ -102,8 +149,8 @@ public:
   // Enqueue the op in the front of the regular queue
   void enqueue_front(item_t &&item) final;
 
-  // Return an op to be dispatch
-  item_t dequeue() final;
+  // Return an op to be dispatched, or how long to wait for one
+  work_item_t dequeue() final;
 
   // Returns if the queue is empty
   bool empty() const final {
@@ -117,6 +164,13 @@ public:
     ostream << "mClockScheduler";
   }
 
+  double get_cost_per_io() const {
+    return osd_bandwidth_cost_per_io;
+  }
+  double get_capacity_per_shard() const {
+    return osd_bandwidth_capacity_per_shard;
+  }
+
   const char** get_tracked_conf_keys() const final;
   void handle_conf_change(const ConfigProxy& conf,
 			  const std::set<std::string> &changed) final;
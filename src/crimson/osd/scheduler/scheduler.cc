@@ -15,6 +15,7 @@
 #include <ostream>
 
 #include <seastar/core/print.hh>
+#include <seastar/core/smp.hh>
 
 #include "crimson/osd/scheduler/scheduler.h"
 #include "crimson/osd/scheduler/mclock_scheduler.h"
@@ -128,7 +129,7 @@ public:
     return queue.empty();
   }
 
-  item_t dequeue() final {
+  work_item_t dequeue() final {
     return queue.dequeue();
   }
 
@@ -166,7 +167,10 @@ SchedulerRef make_scheduler(ConfigProxy &conf)
 	conf->osd_op_pq_min_cost
       );
   } else if (*type == "mclock_scheduler") {
-    return std::make_unique<mClockScheduler>(conf);
+    // every reactor runs its own scheduler. seastore is designed for
+    // ssd and nvme devices, so the OSD is not considered rotational
+    return std::make_unique<mClockScheduler>(
+      conf, seastar::smp::count, false);
   } else {
     ceph_assert("Invalid choice of wq" == 0);
     return std::unique_ptr<mClockScheduler>();
@@ -15,7 +15,9 @@
 #pragma once
 
 #include <seastar/core/future.hh>
+#include <chrono>
 #include <ostream>
+#include <variant>
 
 #include "crimson/common/config_proxy.h"
 
@@ -45,6 +47,9 @@ struct item_t {
   seastar::promise<> wake;
 };
 
+/// the item to dispatch, or how long to wait until one is eligible
+using work_item_t = std::variant<item_t, std::chrono::nanoseconds>;
+
 /**
  * Base interface for classes responsible for choosing
  * op processing order in the OSD.
@@ -61,8 +66,9 @@ public:
   // Returns true iff there are no ops scheduled
   virtual bool empty() const = 0;
 
-  // Return next op to be processed
-  virtual item_t dequeue() = 0;
+  // Return next op to be processed, or the time to wait before calling
+  // dequeue() again if all queued ops are held back by their limits
+  virtual work_item_t dequeue() = 0;
 
   // Dump formatted representation for the queue
   virtual void dump(ceph::Formatter &f) const = 0;
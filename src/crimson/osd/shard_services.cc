@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include <boost/smart_ptr/make_local_shared.hpp>
+#include <seastar/core/metrics.hh>
 
 #include "crimson/osd/shard_services.h"
 
@@ -49,7 +50,25 @@ PerShardState::PerShardState(
       static_cast<ceph_tid_t>(seastar::this_shard_id()) <<
       (std::numeric_limits<ceph_tid_t>::digits - 8)),
     startup_time(startup_time)
-{}
+{
+  register_metrics();
+}
+
+void PerShardState::register_metrics()
+{
+  namespace sm = seastar::metrics;
+  metrics.add_group("osd", {
+    sm::make_counter(
+      "ops_local", op_routing_stats.ops_local,
+      sm::description("ops received on the core owning their PG")),
+    sm::make_counter(
+      "ops_crosscore", op_routing_stats.ops_crosscore,
+      sm::description("ops forwarded to the core owning their PG")),
+    sm::make_gauge(
+      "xcore_connections", [this] { return xcore_conns.size(); },
+      sm::description("connections of other cores cached by this core")),
+  });
+}
 
 seastar::future<> PerShardState::dump_ops_in_flight(Formatter *f) const
 {
@@ -658,7 +677,12 @@ seastar::future<Ref<PG>> ShardServices::handle_pg_create_info(
 	  }
 	  return make_pg(
 	    startmap, pgid, true
-	  ).then([startmap=std::move(startmap)](auto pg) mutable {
+	  ).handle_exception([FNAME, pgid, this](auto ep) {
+	    // e.g. the erasure code plugin of the pool failed to load
+	    ERROR("unable to create pg {}: {}", pgid, ep);
+	    local_state.pg_map.pg_creation_canceled(pgid);
+	    return seastar::make_ready_future<Ref<PG>>(Ref<PG>());
+	  }).then([startmap=std::move(startmap)](auto pg) mutable {
 	    return seastar::make_ready_future<
 	      std::tuple<Ref<PG>, OSDMapService::cached_map_t>
 	      >(std::make_tuple(std::move(pg), std::move(startmap)));
@@ -7,6 +7,7 @@
 
 #include <boost/intrusive_ptr.hpp>
 #include <seastar/core/future.hh>
+#include <seastar/core/metrics_registration.hh>
 
 #include "include/common_fwd.h"
 #include "osd_operation.h"
@@ -116,6 +117,35 @@ class PerShardState {
     return registry.stop();
   }
 
+  /**
+   * xcore_conns
+   *
+   * The connections of the other cores which forwarded ops to this core.
+   * The ops forwarded later share the cached reference instead of each
+   * wrapping the connection in a foreign_ptr which has to be released on
+   * the core of the connection again.  See
+   * PGShardManager::with_remote_shard_state_and_op().
+   *
+   * An entry keeps its connection alive, so its address can't be reused by
+   * another connection until PGShardManager::release_xcore_connection()
+   * drops the entry once the connection is reset, marked down or moved.
+   */
+  struct xcore_conn_t {
+    crimson::net::ConnectionXcoreRef conn;
+    // OSDConnectionPriv::xcore_epoch when it was cached
+    uint64_t epoch = 0;
+  };
+  std::map<crimson::net::Connection*, xcore_conn_t> xcore_conns;
+
+  struct {
+    // ops received on the core owning their PG
+    uint64_t ops_local = 0;
+    // ops forwarded from this core to the core owning their PG
+    uint64_t ops_crosscore = 0;
+  } op_routing_stats;
+  seastar::metrics::metric_group metrics;
+  void register_metrics();
+
   // PGMap state
   PGMap pg_map;
 
@@ -588,6 +618,7 @@ public:
 
   FORWARD_TO_OSD_SINGLETON(get_pool_info)
   FORWARD(with_throttle_while, with_throttle_while, local_state.throttler)
+  FORWARD(get_throttle, get_throttle, local_state.throttler)
 
   FORWARD_TO_OSD_SINGLETON(build_incremental_map_msg)
   FORWARD_TO_OSD_SINGLETON(send_incremental_map)
@@ -0,0 +1,151 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 smarttab
+
+// Measures the round trip latency of the tasks submitted to the alien
+// ThreadPool used by AlienStore, compared with running the same work inline
+// on the reactor, so that the cost of the handoff to the alien threads and
+// back can be told apart from the cost of the work itself.
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/program_options.hpp>
+#include <fmt/format.h>
+
+#include <seastar/core/app-template.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/util/defer.hh>
+
+#include "crimson/common/config_proxy.h"
+#include "crimson/os/alienstore/thread_pool.h"
+
+namespace bpo = boost::program_options;
+using crimson::os::ThreadPool;
+using clock_type = std::chrono::steady_clock;
+using latencies_t = std::vector<std::chrono::nanoseconds>;
+
+namespace {
+
+struct perf_config_t {
+  unsigned threads;
+  unsigned queue_size;
+  unsigned concurrency;
+  unsigned ops;
+  std::chrono::microseconds work;
+};
+
+void do_work(std::chrono::microseconds work)
+{
+  auto until = clock_type::now() + work;
+  while (clock_type::now() < until) {
+    // busy wait like a short ObjectStore call
+  }
+}
+
+template <typename Submit>
+seastar::future<latencies_t> run_shard(const perf_config_t &config,
+                                       Submit submit)
+{
+  return seastar::do_with(latencies_t{}, [&config, submit](auto &latencies) {
+    latencies.reserve(config.concurrency * config.ops);
+    return seastar::parallel_for_each(
+      boost::make_counting_iterator(0u),
+      boost::make_counting_iterator(config.concurrency),
+      [&config, &latencies, submit](unsigned) {
+      return seastar::do_for_each(
+        boost::make_counting_iterator(0u),
+        boost::make_counting_iterator(config.ops),
+        [&latencies, submit](unsigned) {
+        auto start = clock_type::now();
+        return submit().then([&latencies, start] {
+          latencies.push_back(clock_type::now() - start);
+        });
+      });
+    }).then([&latencies] {
+      return std::move(latencies);
+    });
+  });
+}
+
+template <typename Submit>
+void run(std::string_view name, const perf_config_t &config, Submit submit)
+{
+  auto start = clock_type::now();
+  auto latencies = seastar::map_reduce(
+    boost::make_counting_iterator(0u),
+    boost::make_counting_iterator(seastar::smp::count),
+    [&config, submit](unsigned shard) {
+      return seastar::smp::submit_to(shard, [&config, submit] {
+        return run_shard(config, submit);
+      });
+    },
+    latencies_t{},
+    [](latencies_t all, latencies_t shard) {
+      all.insert(all.end(), shard.begin(), shard.end());
+      return all;
+    }).get();
+  std::chrono::duration<double> elapsed = clock_type::now() - start;
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    auto index = static_cast<size_t>(p * (latencies.size() - 1));
+    return std::chrono::duration<double, std::micro>(latencies[index]).count();
+  };
+  fmt::print("{}: {} ops in {:.3f}s, {:.0f} ops/s, latency(us) "
+             "p50={:.1f} p99={:.1f} p999={:.1f} max={:.1f}\n",
+             name, latencies.size(), elapsed.count(),
+             latencies.size() / elapsed.count(),
+             percentile(0.5), percentile(0.99), percentile(0.999),
+             percentile(1));
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  seastar::app_template app;
+  app.add_options()
+    ("threads", bpo::value<unsigned>()->default_value(6),
+     "number of alien threads")
+    ("queue-size", bpo::value<unsigned>()->default_value(128),
+     "depth of the pending queue, shared by all the reactors")
+    ("concurrency", bpo::value<unsigned>()->default_value(1),
+     "tasks in flight per reactor")
+    ("ops", bpo::value<unsigned>()->default_value(100000),
+     "tasks to submit per fiber")
+    ("work-us", bpo::value<unsigned>()->default_value(0),
+     "busy time of each task in microseconds");
+  return app.run(argc, argv, [&app] {
+    auto &conf = app.configuration();
+    perf_config_t config{
+      conf["threads"].as<unsigned>(),
+      conf["queue-size"].as<unsigned>(),
+      conf["concurrency"].as<unsigned>(),
+      conf["ops"].as<unsigned>(),
+      std::chrono::microseconds(conf["work-us"].as<unsigned>())};
+    return seastar::async([config] {
+      crimson::common::sharded_conf().start(
+        EntityName{}, std::string_view{"ceph"}).get();
+      auto stop_conf = seastar::defer([] () noexcept {
+        crimson::common::sharded_conf().stop().get();
+      });
+      auto work = config.work;
+      run("inline", config, [work] {
+        do_work(work);
+        return seastar::now();
+      });
+      ThreadPool tp{config.threads, config.queue_size, std::nullopt};
+      tp.start().get();
+      run("alien", config, [&tp, work] {
+        return tp.submit([work] {
+          do_work(work);
+        });
+      });
+      tp.stop().get();
+    });
+  });
+}
@@ -0,0 +1,317 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 smarttab
+
+// Writes objects through the ObjectDataHandler of an ephemeral seastore and
+// reports the write and read throughput together with the space the object
+// data occupies on disk, to compare the compression algorithms on data that
+// resembles RGW logs and bucket index entries.
+
+#include <random>
+
+#include <boost/program_options.hpp>
+#include <fmt/format.h>
+
+#include <seastar/core/app-template.hh>
+#include <seastar/core/thread.hh>
+
+#include "crimson/common/config_proxy.h"
+#include "crimson/common/log.h"
+#include "crimson/common/perf_counters_collection.h"
+#include "crimson/os/seastore/object_data_handler.h"
+#include "crimson/os/seastore/onode.h"
+
+#include "test/crimson/seastore/transaction_manager_test_state.h"
+
+using namespace crimson::os::seastore;
+namespace bpo = boost::program_options;
+
+namespace {
+
+seastar::logger& logger() {
+  return crimson::get_logger(ceph_subsys_test);
+}
+
+class PerfOnode final : public Onode {
+  onode_layout_t layout;
+
+public:
+  PerfOnode(uint32_t ddr, uint32_t dmr) : Onode(ddr, dmr, hobject_t()) {}
+  const onode_layout_t &get_layout() const final {
+    return layout;
+  }
+  bool is_alive() const final {
+    return true;
+  }
+  laddr_t get_hint() const final { return L_ADDR_MIN; }
+  void update_onode_size(Transaction &, uint32_t size) final {
+    layout.size = size;
+  }
+  void update_omap_root(Transaction &, omap_root_t &oroot) final {
+    layout.omap_root.update(oroot);
+  }
+  void update_xattr_root(Transaction &, omap_root_t &xroot) final {
+    layout.xattr_root.update(xroot);
+  }
+  void update_object_data(Transaction &, object_data_t &odata) final {
+    layout.object_data.update(odata);
+  }
+  void update_object_info(Transaction &, ceph::bufferlist &) final {}
+  void clear_object_info(Transaction &) final {}
+  void update_snapset(Transaction &, ceph::bufferlist &) final {}
+  void clear_snapset(Transaction &) final {}
+};
+
+/// text lines like those of the rgw ops log
+ceph::bufferlist make_log_data(std::mt19937 &gen, size_t len)
+{
+  static const char *ops[] = {"get_obj", "put_obj", "list_bucket",
+                              "delete_obj", "head_obj"};
+  static const char *agents[] = {"aws-sdk-java/1.12", "Boto3/1.26",
+                                 "rclone/v1.62", "s3cmd/2.3.0"};
+  std::uniform_int_distribution<> op(0, std::size(ops) - 1);
+  std::uniform_int_distribution<> agent(0, std::size(agents) - 1);
+  std::uniform_int_distribution<uint32_t> num;
+  std::string s;
+  uint64_t ts = 1700000000000;
+  while (s.size() < len) {
+    ts += num(gen) % 1000;
+    s += fmt::format(
+      "{{\"time\":{},\"bucket\":\"bucket-{}\",\"object\":\"obj-{:08x}\","
+      "\"operation\":\"{}\",\"http_status\":\"{}\",\"bytes_sent\":{},"
+      "\"user_agent\":\"{}\",\"trans_id\":\"tx{:016x}\"}}\n",
+      ts, num(gen) % 16, num(gen), ops[op(gen)],
+      num(gen) % 10 ? 200 : 404, num(gen) % (4 << 20),
+      agents[agent(gen)], (uint64_t(num(gen)) << 32) | num(gen));
+  }
+  ceph::bufferlist bl;
+  bl.append(s.data(), len);
+  return bl;
+}
+
+/// bucket index like entries, sorted keys sharing long prefixes
+ceph::bufferlist make_index_data(std::mt19937 &gen, size_t len)
+{
+  std::uniform_int_distribution<uint32_t> num;
+  std::string s;
+  uint32_t key = num(gen) % 1000;
+  while (s.size() < len) {
+    key += 1 + num(gen) % 7;
+    s += fmt::format(
+      "photos/2023/{:02}/{:02}/IMG_{:06}.jpg\x01size={}\x01mtime={}"
+      "\x01etag={:08x}{:08x}\x01owner=tenant$user-{}\x02",
+      1 + key % 12, 1 + key % 28, key, num(gen) % (8 << 20),
+      1690000000 + key * 13, num(gen), num(gen), num(gen) % 4);
+  }
+  ceph::bufferlist bl;
+  bl.append(s.data(), len);
+  return bl;
+}
+
+ceph::bufferlist make_random_data(std::mt19937 &gen, size_t len)
+{
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::string s(len, '\0');
+  for (auto &c : s) {
+    c = byte(gen);
+  }
+  ceph::bufferlist bl;
+  bl.append(s);
+  return bl;
+}
+
+struct perf_config_t {
+  std::string data;
+  std::string algorithm;
+  double required_ratio;
+  unsigned objects;
+  uint32_t object_size;
+  uint32_t write_size;
+};
+
+class PerfCompression : public TMTestState {
+public:
+  PerfCompression(const perf_config_t &config) : config(config) {}
+
+  seastar::future<> run() {
+    return tm_setup().then([this] {
+      return seastar::async([this] {
+        generate();
+        write_all();
+        restart();
+        read_all();
+        report_space();
+      });
+    }).then([this] {
+      return tm_teardown();
+    });
+  }
+
+private:
+  void generate() {
+    std::mt19937 gen(0);
+    for (unsigned i = 0; i < config.objects; ++i) {
+      if (config.data == "log") {
+        contents.push_back(make_log_data(gen, config.object_size));
+      } else if (config.data == "index") {
+        contents.push_back(make_index_data(gen, config.object_size));
+      } else {
+        ceph_assert(config.data == "random");
+        contents.push_back(make_random_data(gen, config.object_size));
+      }
+      onodes.push_back(new PerfOnode(config.object_size, 0));
+    }
+  }
+
+  ObjectDataHandler make_handler() const {
+    compression_params_t params;
+    params.algorithm = Compressor::get_comp_alg_type(config.algorithm
+    ).value_or(Compressor::COMP_ALG_NONE);
+    params.required_ratio = config.required_ratio;
+    return ObjectDataHandler(config.object_size, params);
+  }
+
+  void write_all() {
+    auto start = mono_clock::now();
+    for (unsigned i = 0; i < config.objects; ++i) {
+      for (uint32_t off = 0; off < config.object_size;
+           off += config.write_size) {
+        auto len = std::min(config.write_size, config.object_size - off);
+        ceph::bufferlist bl;
+        bl.substr_of(contents[i], off, len);
+        auto t = create_mutate_transaction();
+        with_trans_intr(*t, [&](auto &t) {
+          return seastar::do_with(
+            make_handler(),
+            std::move(bl),
+            [&, off](auto &handler, auto &bl) {
+            return handler.write(
+              ObjectDataHandler::context_t{*tm, t, *onodes[i]},
+              off,
+              bl);
+          });
+        }).unsafe_get();
+        submit_transaction(std::move(t));
+      }
+    }
+    report("write", mono_clock::now() - start);
+  }
+
+  void read_all() {
+    auto start = mono_clock::now();
+    for (unsigned i = 0; i < config.objects; ++i) {
+      auto t = create_read_transaction();
+      auto bl = with_trans_intr(*t, [&](auto &t) {
+        return make_handler().read(
+          ObjectDataHandler::context_t{*tm, t, *onodes[i]},
+          0,
+          config.object_size);
+      }).unsafe_get();
+      ceph_assert(bl.contents_equal(contents[i]));
+    }
+    report("read", mono_clock::now() - start);
+  }
+
+  void report(std::string_view what, mono_clock::duration d) const {
+    std::chrono::duration<double> secs = d;
+    uint64_t bytes = uint64_t(config.objects) * config.object_size;
+    fmt::print("{} {} MiB in {:.3f}s, {:.1f} MiB/s\n",
+               what, bytes >> 20, secs.count(),
+               bytes / secs.count() / (1 << 20));
+  }
+
+  void report_space() {
+    uint64_t raw = 0;
+    uint64_t stored = 0;
+    unsigned compressed = 0;
+    unsigned extents = 0;
+    auto t = create_read_transaction();
+    for (auto &onode : onodes) {
+      auto odata = onode->get_layout().object_data.get();
+      auto pins = with_trans_intr(*t, [&](auto &t) {
+        return tm->get_pins(
+          t,
+          odata.get_reserved_data_base(),
+          odata.get_reserved_data_len());
+      }).unsafe_get();
+      for (auto &pin : pins) {
+        if (pin->get_val().is_zero()) {
+          continue;
+        }
+        ++extents;
+        raw += pin->get_length();
+        if (pin->is_compressed()) {
+          ++compressed;
+          stored += pin->get_compressed_length();
+        } else {
+          stored += pin->get_length();
+        }
+      }
+    }
+    fmt::print("data={} algorithm={} extents={} compressed={} "
+               "raw={} KiB stored={} KiB saved={:.1f}%\n",
+               config.data, config.algorithm, extents, compressed,
+               raw >> 10, stored >> 10,
+               raw ? 100.0 * (raw - stored) / raw : 0.0);
+  }
+
+  const perf_config_t config;
+  std::vector<ceph::bufferlist> contents;
+  std::vector<OnodeRef> onodes;
+};
+
+seastar::future<> run(const bpo::variables_map &config)
+{
+  return seastar::async([&config] {
+    perf_config_t perf_config{
+      config["data"].as<std::string>(),
+      config["algorithm"].as<std::string>(),
+      config["required-ratio"].as<double>(),
+      config["objects"].as<unsigned>(),
+      config["object-size"].as<uint32_t>(),
+      config["write-size"].as<uint32_t>()};
+    ceph_assert(perf_config.write_size > 0);
+    ceph_assert(perf_config.data == "log" ||
+                perf_config.data == "index" ||
+                perf_config.data == "random");
+
+    using crimson::common::sharded_conf;
+    sharded_conf().start(EntityName{}, std::string_view{"ceph"}).get();
+    seastar::engine().at_exit([] {
+      return sharded_conf().stop();
+    });
+
+    using crimson::common::sharded_perf_coll;
+    sharded_perf_coll().start().get();
+    seastar::engine().at_exit([] {
+      return sharded_perf_coll().stop();
+    });
+
+    logger().info("running with {} {}", perf_config.data,
+                  perf_config.algorithm);
+    PerfCompression perf{perf_config};
+    perf.run().get();
+  });
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  seastar::app_template app;
+  app.add_options()
+    ("data", bpo::value<std::string>()->default_value("log"),
+     "object contents: log, index, random")
+    ("algorithm", bpo::value<std::string>()->default_value("snappy"),
+     "compression algorithm: none, snappy, zlib, zstd, lz4")
+    ("required-ratio", bpo::value<double>()->default_value(0.875),
+     "store an extent compressed only if it shrinks below this ratio")
+    ("objects", bpo::value<unsigned>()->default_value(32),
+     "number of objects")
+    ("object-size", bpo::value<uint32_t>()->default_value(1 << 20),
+     "size of each object")
+    ("write-size", bpo::value<uint32_t>()->default_value(64 << 10),
+     "size of each write");
+  return app.run(argc, argv, [&app] {
+    return run(app.configuration());
+  });
+}
@@ -1867,7 +1867,8 @@ inline std::enable_if_t<traits::supported && !traits::featured> decode_nohead(
   _denc_start(p, &struct_v, &struct_compat, &_denc_pchar, &_denc_u32);	\
   do {
 
-// For the only type that is with compat 2: unittest.
+// For the types that are with compat 2: unittest, and seastore_meta_t, whose
+// older decoders must not mount the stores of the newer format.
 #define DENC_START_COMPAT_2(v, compat, p)				\
   __u8 struct_v = v;							\
   __u8 struct_compat = compat;						\
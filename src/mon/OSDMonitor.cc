@@ -8096,8 +8096,9 @@ int OSDMonitor::prepare_new_pool(string& name,
   }
 
   if (crimson) {
-    /* crimson-osd requires that the pool be replicated and that pg_num/pgp_num
-     * be static.  User must also have specified set-allow-crimson */
+    /* crimson-osd requires that pg_num/pgp_num be static, and that the pool
+     * be replicated unless 'crimson-ec' is an enabled experimental feature.
+     * User must also have specified set-allow-crimson */
     const auto *suffix = " (--crimson specified or osd_pool_default_crimson set)";
     if (pg_autoscale_mode != "off") {
       *ss << "crimson-osd does not support changing pg_num or pgp_num, "
@@ -8107,6 +8108,13 @@ int OSDMonitor::prepare_new_pool(string& name,
       *ss << "set-allow-crimson must be set to create a pool with the "
 	  << "crimson flag" << suffix;
       return -EINVAL;
+    } else if (pool_type == pg_pool_t::TYPE_ERASURE &&
+	       !g_ceph_context->check_experimental_feature_enabled("crimson-ec")) {
+      *ss << "crimson-osd support for erasure coded pools is experimental, "
+	  << "it lacks recovery, backfill and rollback of divergent writes. "
+	  << "add 'crimson-ec' to the experimental features config to create "
+	  << "one anyway" << suffix;
+      return -EINVAL;
     }
   }
 
@@ -30,12 +30,72 @@ using ceph::ref_t;
 #undef dout_prefix
 #define dout_prefix *_dout << "-- " << msgr->get_myaddrs() << " "
 
+DispatchQueue::DispatchQueue(CephContext *cct, Messenger *msgr,
+			     std::string &name)
+  : cct(cct), msgr(msgr),
+    next_id(1),
+    local_delivery_lock(ceph::make_mutex("Messenger::DispatchQueue::local_delivery_lock" + name)),
+    stop_local_delivery(false),
+    local_delivery_thread(this),
+    dispatch_throttler(cct, std::string("msgr_dispatch_throttler-") + name,
+		       cct->_conf->ms_dispatch_throttle_bytes),
+    stop(false)
+{
+  unsigned num_shards = std::max<uint64_t>(
+    1, cct->_conf.get_val<uint64_t>("ms_dispatch_threads"));
+  for (unsigned i = 0; i < num_shards; i++) {
+    shards.emplace_back(std::make_unique<DispatchShard>(cct, this, i, name));
+  }
+
+  PerfCountersBuilder plb(cct, std::string("msgr_dispatch_queue-") + name,
+			  l_msgr_dq_first, l_msgr_dq_last);
+  plb.add_u64_counter(l_msgr_dq_dispatched, "dispatched",
+		      "Messages and events dispatched from the queue");
+  plb.add_time_avg(l_msgr_dq_queue_lat, "queue_lat",
+		   "Time spent waiting in the dispatch queue");
+  PerfHistogramCommon::axis_config_d lat_x_axis_config{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    10000,  ///< Quantization unit is 10usec
+    32,
+  };
+  PerfHistogramCommon::axis_config_d size_y_axis_config{
+    "Message size (bytes)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    512,
+    32,
+  };
+  plb.add_u64_counter_histogram(
+    l_msgr_dq_queue_lat_histogram, "queue_lat_size_histogram",
+    lat_x_axis_config, size_y_axis_config,
+    "Histogram of dispatch queue latency and message size");
+  logger = plb.create_perf_counters();
+  cct->get_perfcounters_collection()->add(logger);
+}
+
+DispatchQueue::~DispatchQueue()
+{
+  for (auto& shard : shards) {
+    ceph_assert(shard->mqueue.empty());
+    ceph_assert(shard->marrival.empty());
+  }
+  ceph_assert(local_messages.empty());
+  cct->get_perfcounters_collection()->remove(logger);
+  delete logger;
+}
+
 double DispatchQueue::get_max_age(utime_t now) const {
-  std::lock_guard l{lock};
-  if (marrival.empty())
-    return 0;
-  else
-    return (now - marrival.begin()->first);
+  double max_age = 0;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard->lock};
+    if (!shard->marrival.empty()) {
+      max_age = std::max<double>(max_age,
+				 now - shard->marrival.begin()->first);
+    }
+  }
+  return max_age;
 }
 
 uint64_t DispatchQueue::pre_dispatch(const ref_t<Message>& m)
@@ -82,18 +142,19 @@ void DispatchQueue::fast_preprocess(const ref_t<Message>& m)
 
 void DispatchQueue::enqueue(const ref_t<Message>& m, int priority, uint64_t id)
 {
-  std::lock_guard l{lock};
+  auto& shard = shard_of(m->get_connection().get());
+  std::lock_guard l{shard.lock};
   if (stop) {
     return;
   }
   ldout(cct,20) << "queue " << m << " prio " << priority << dendl;
-  add_arrival(m);
+  shard.add_arrival(m);
   if (priority >= CEPH_MSG_PRIO_LOW) {
-    mqueue.enqueue_strict(id, priority, QueueItem(m));
+    shard.mqueue.enqueue_strict(id, priority, QueueItem(m));
   } else {
-    mqueue.enqueue(id, priority, m->get_cost(), QueueItem(m));
+    shard.mqueue.enqueue(id, priority, m->get_cost(), QueueItem(m));
   }
-  cond.notify_all();
+  shard.cond.notify_all();
 }
 
 void DispatchQueue::local_delivery(const ref_t<Message>& m, int priority)
@@ -153,16 +214,27 @@ void DispatchQueue::dispatch_throttle_release(uint64_t msize)
  * end of the queue. If the queue is empty; it's removed.
  * The message is then delivered and the process starts again.
  */
-void DispatchQueue::entry()
+void DispatchQueue::entry(unsigned shard_id)
 {
-  std::unique_lock l{lock};
+  auto& shard = *shards[shard_id];
+  std::unique_lock l{shard.lock};
   while (true) {
-    while (!mqueue.empty()) {
-      QueueItem qitem = mqueue.dequeue();
+    while (!shard.mqueue.empty()) {
+      QueueItem qitem = shard.mqueue.dequeue();
       if (!qitem.is_code())
-	remove_arrival(qitem.get_message());
+	shard.remove_arrival(qitem.get_message());
       l.unlock();
 
+      auto queue_lat = ceph::mono_clock::now() - qitem.get_enqueue_stamp();
+      logger->inc(l_msgr_dq_dispatched);
+      logger->tinc(l_msgr_dq_queue_lat, queue_lat);
+      logger->hinc(l_msgr_dq_queue_lat_histogram,
+		   std::chrono::nanoseconds(queue_lat).count(),
+		   qitem.is_code() ? 0 :
+		   qitem.get_message()->get_payload().length() +
+		   qitem.get_message()->get_middle().length() +
+		   qitem.get_message()->get_data().length());
+
       if (qitem.is_code()) {
 	if (cct->_conf->ms_inject_internal_delays &&
 	    cct->_conf->ms_inject_delay_probability &&
@@ -209,34 +281,42 @@ void DispatchQueue::entry()
       break;
 
     // wait for something to be put on queue
-    cond.wait(l);
+    shard.cond.wait(l);
   }
 }
 
 void DispatchQueue::discard_queue(uint64_t id) {
-  std::lock_guard l{lock};
-  std::list<QueueItem> removed;
-  mqueue.remove_by_class(id, &removed);
-  for (auto i = removed.begin(); i != removed.end(); ++i) {
-    ceph_assert(!(i->is_code())); // We don't discard id 0, ever!
-    const ref_t<Message>& m = i->get_message();
-    remove_arrival(m);
-    dispatch_throttle_release(m->get_dispatch_throttle_size());
+  // the id doesn't tell which connection (and thus shard) it belongs to
+  for (auto& shard : shards) {
+    std::lock_guard l{shard->lock};
+    std::list<QueueItem> removed;
+    shard->mqueue.remove_by_class(id, &removed);
+    for (auto i = removed.begin(); i != removed.end(); ++i) {
+      ceph_assert(!(i->is_code())); // We don't discard id 0, ever!
+      const ref_t<Message>& m = i->get_message();
+      shard->remove_arrival(m);
+      dispatch_throttle_release(m->get_dispatch_throttle_size());
+    }
   }
 }
 
 void DispatchQueue::start()
 {
   ceph_assert(!stop);
-  ceph_assert(!dispatch_thread.is_started());
-  dispatch_thread.create("ms_dispatch");
+  ceph_assert(!is_started());
+  for (unsigned i = 0; i < shards.size(); i++) {
+    shards[i]->dispatch_thread.create(
+      i == 0 ? "ms_dispatch" : ("ms_dispatch" + std::to_string(i)).c_str());
+  }
   local_delivery_thread.create("ms_local");
 }
 
 void DispatchQueue::wait()
 {
   local_delivery_thread.join();
-  dispatch_thread.join();
+  for (auto& shard : shards) {
+    shard->dispatch_thread.join();
+  }
 }
 
 void DispatchQueue::discard_local()
@@ -252,10 +332,10 @@ void DispatchQueue::shutdown()
     stop_local_delivery = true;
     local_delivery_cond.notify_all();
   }
-  // stop my dispatch thread
-  {
-    std::scoped_lock l{lock};
-    stop = true;
-    cond.notify_all();
+  // stop my dispatch threads
+  stop = true;
+  for (auto& shard : shards) {
+    std::scoped_lock l{shard->lock};
+    shard->cond.notify_all();
   }
 }
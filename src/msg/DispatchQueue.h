@@ -17,12 +17,16 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <queue>
+#include <vector>
 #include <boost/intrusive_ptr.hpp>
 #include "include/ceph_assert.h"
 #include "include/common_fwd.h"
 #include "common/Throttle.h"
 #include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "common/perf_counters.h"
 #include "common/Thread.h"
 #include "common/PrioritizedQueue.h"
 
@@ -31,17 +35,33 @@
 class Messenger;
 struct Connection;
 
+enum {
+  l_msgr_dq_first = 96000,
+  l_msgr_dq_dispatched,
+  l_msgr_dq_queue_lat,
+  l_msgr_dq_queue_lat_histogram,
+  l_msgr_dq_last,
+};
+
 /**
  * The DispatchQueue contains all the connections which have Messages
  * they want to be dispatched, carefully organized by Message priority
  * and permitted to deliver in a round-robin fashion.
  * See Messenger::dispatch_entry for details.
+ *
+ * With ms_dispatch_threads > 1 the queue is split into shards, each with
+ * its own PrioritizedQueue and DispatchThread. A connection's messages and
+ * events always land in the same shard, so per-connection ordering is kept
+ * while different connections are dispatched concurrently. Only daemons
+ * whose Dispatchers cope with concurrent ms_dispatch() calls should enable
+ * this.
  */
 class DispatchQueue {
   class QueueItem {
     int type;
     ConnectionRef con;
     ceph::ref_t<Message> m;
+    ceph::mono_time enqueued = ceph::mono_clock::now();
   public:
     explicit QueueItem(const ceph::ref_t<Message>& m) : type(-1), con(0), m(m) {}
     QueueItem(int type, Connection *con) : type(type), con(con), m(0) {}
@@ -60,48 +80,75 @@ class DispatchQueue {
       ceph_assert(is_code());
       return con.get();
     }
+    ceph::mono_time get_enqueue_stamp() const {
+      return enqueued;
+    }
   };
 
   CephContext *cct;
   Messenger *msgr;
-  mutable ceph::mutex lock;
-  ceph::condition_variable cond;
-
-  PrioritizedQueue<QueueItem, uint64_t> mqueue;
-
-  std::set<std::pair<double, ceph::ref_t<Message>>> marrival;
-  std::map<ceph::ref_t<Message>, decltype(marrival)::iterator> marrival_map;
-  void add_arrival(const ceph::ref_t<Message>& m) {
-    marrival_map.insert(
-      make_pair(
-	m,
-	marrival.insert(std::make_pair(m->get_recv_stamp(), m)).first
-	)
-      );
-  }
-  void remove_arrival(const ceph::ref_t<Message>& m) {
-    auto it = marrival_map.find(m);
-    ceph_assert(it != marrival_map.end());
-    marrival.erase(it->second);
-    marrival_map.erase(it);
-  }
-
-  std::atomic<uint64_t> next_id;
-
-  enum { D_CONNECT = 1, D_ACCEPT, D_BAD_REMOTE_RESET, D_BAD_RESET, D_CONN_REFUSED, D_NUM_CODES };
+  PerfCounters *logger = nullptr;
 
   /**
-   * The DispatchThread runs dispatch_entry to empty out the dispatch_queue.
+   * The DispatchThread runs dispatch_entry to empty out its shard.
    */
   class DispatchThread : public Thread {
     DispatchQueue *dq;
+    unsigned shard_id;
   public:
-    explicit DispatchThread(DispatchQueue *dq) : dq(dq) {}
+    DispatchThread(DispatchQueue *dq, unsigned shard_id)
+      : dq(dq), shard_id(shard_id) {}
     void *entry() override {
-      dq->entry();
+      dq->entry(shard_id);
       return 0;
     }
-  } dispatch_thread;
+  };
+
+  struct DispatchShard {
+    mutable ceph::mutex lock;
+    ceph::condition_variable cond;
+
+    PrioritizedQueue<QueueItem, uint64_t> mqueue;
+
+    std::set<std::pair<double, ceph::ref_t<Message>>> marrival;
+    std::map<ceph::ref_t<Message>, decltype(marrival)::iterator> marrival_map;
+    void add_arrival(const ceph::ref_t<Message>& m) {
+      marrival_map.insert(
+	make_pair(
+	  m,
+	  marrival.insert(std::make_pair(m->get_recv_stamp(), m)).first
+	  )
+	);
+    }
+    void remove_arrival(const ceph::ref_t<Message>& m) {
+      auto it = marrival_map.find(m);
+      ceph_assert(it != marrival_map.end());
+      marrival.erase(it->second);
+      marrival_map.erase(it);
+    }
+
+    DispatchThread dispatch_thread;
+
+    DispatchShard(CephContext *cct, DispatchQueue *dq, unsigned id,
+		  const std::string &name)
+      : lock(ceph::make_mutex("Messenger::DispatchQueue::lock" + name +
+			      (id ? "-" + std::to_string(id) : ""))),
+	mqueue(cct->_conf->ms_pq_max_tokens_per_priority,
+	       cct->_conf->ms_pq_min_cost),
+	dispatch_thread(dq, id) {}
+  };
+  std::vector<std::unique_ptr<DispatchShard>> shards;
+
+  DispatchShard& shard_of(const Connection *con) {
+    // connections are allocated far apart, mix the pointer bits before
+    // picking a shard
+    uint64_t h = reinterpret_cast<uintptr_t>(con) * 0x9E3779B97F4A7C15ull;
+    return *shards[(h >> 32) % shards.size()];
+  }
+
+  std::atomic<uint64_t> next_id;
+
+  enum { D_CONNECT = 1, D_ACCEPT, D_BAD_REMOTE_RESET, D_BAD_RESET, D_CONN_REFUSED, D_NUM_CODES };
 
   ceph::mutex local_delivery_lock;
   ceph::condition_variable local_delivery_cond;
@@ -120,12 +167,24 @@ class DispatchQueue {
   uint64_t pre_dispatch(const ceph::ref_t<Message>& m);
   void post_dispatch(const ceph::ref_t<Message>& m, uint64_t msize);
 
+  void queue_code(int code, Connection *con) {
+    auto& shard = shard_of(con);
+    std::lock_guard l{shard.lock};
+    if (stop)
+      return;
+    shard.mqueue.enqueue_strict(
+      0,
+      CEPH_MSG_PRIO_HIGHEST,
+      QueueItem(code, con));
+    shard.cond.notify_all();
+  }
+
  public:
 
   /// Throttle preventing us from building up a big backlog waiting for dispatch
   Throttle dispatch_throttler;
 
-  bool stop;
+  std::atomic<bool> stop;
   void local_delivery(const ceph::ref_t<Message>& m, int priority);
   void local_delivery(Message* m, int priority) {
     return local_delivery(ceph::ref_t<Message>(m, false), priority); /* consume ref */
@@ -135,8 +194,12 @@ class DispatchQueue {
   double get_max_age(utime_t now) const;
 
   int get_queue_len() const {
-    std::lock_guard l{lock};
-    return mqueue.length();
+    int len = 0;
+    for (auto& shard : shards) {
+      std::lock_guard l{shard->lock};
+      len += shard->mqueue.length();
+    }
+    return len;
   }
 
   /**
@@ -147,54 +210,19 @@ class DispatchQueue {
   void dispatch_throttle_release(uint64_t msize);
 
   void queue_connect(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_CONNECT, con));
-    cond.notify_all();
+    queue_code(D_CONNECT, con);
   }
   void queue_accept(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_ACCEPT, con));
-    cond.notify_all();
+    queue_code(D_ACCEPT, con);
   }
   void queue_remote_reset(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_BAD_REMOTE_RESET, con));
-    cond.notify_all();
+    queue_code(D_BAD_REMOTE_RESET, con);
   }
   void queue_reset(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_BAD_RESET, con));
-    cond.notify_all();
+    queue_code(D_BAD_RESET, con);
   }
   void queue_refused(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_CONN_REFUSED, con));
-    cond.notify_all();
+    queue_code(D_CONN_REFUSED, con);
   }
 
   bool can_fast_dispatch(const ceph::cref_t<Message> &m) const;
@@ -213,30 +241,15 @@ class DispatchQueue {
     return next_id++;
   }
   void start();
-  void entry();
+  void entry(unsigned shard_id);
   void wait();
   void shutdown();
-  bool is_started() const {return dispatch_thread.is_started();}
-
-  DispatchQueue(CephContext *cct, Messenger *msgr, std::string &name)
-    : cct(cct), msgr(msgr),
-      lock(ceph::make_mutex("Messenger::DispatchQueue::lock" + name)),
-      mqueue(cct->_conf->ms_pq_max_tokens_per_priority,
-	     cct->_conf->ms_pq_min_cost),
-      next_id(1),
-      dispatch_thread(this),
-      local_delivery_lock(ceph::make_mutex("Messenger::DispatchQueue::local_delivery_lock" + name)),
-      stop_local_delivery(false),
-      local_delivery_thread(this),
-      dispatch_throttler(cct, std::string("msgr_dispatch_throttler-") + name,
-                         cct->_conf->ms_dispatch_throttle_bytes),
-      stop(false)
-    {}
-  ~DispatchQueue() {
-    ceph_assert(mqueue.empty());
-    ceph_assert(marrival.empty());
-    ceph_assert(local_messages.empty());
+  bool is_started() const {
+    return shards.front()->dispatch_thread.is_started();
   }
+
+  DispatchQueue(CephContext *cct, Messenger *msgr, std::string &name);
+  ~DispatchQueue();
 };
 
 #endif
@@ -68,7 +68,9 @@ class C_handle_read : public EventCallback {
  public:
   explicit C_handle_read(AsyncConnectionRef c): conn(c) {}
   void do_request(uint64_t fd_or_id) override {
+    auto start = ceph::mono_clock::now();
     conn->process();
+    conn->account_busy(start);
   }
 };
 
@@ -78,7 +80,9 @@ class C_handle_write : public EventCallback {
  public:
   explicit C_handle_write(AsyncConnectionRef c): conn(c) {}
   void do_request(uint64_t fd) override {
+    auto start = ceph::mono_clock::now();
     conn->handle_write();
+    conn->account_busy(start);
   }
 };
 
@@ -376,6 +380,11 @@ bool AsyncConnection::inject_network_congestion() const {
 
 void AsyncConnection::process() {
   std::lock_guard<std::mutex> l(lock);
+  if (!center->in_thread()) {
+    // queued before we were migrated to another worker, follow the connection
+    center->dispatch_event_external(read_handler);
+    return;
+  }
   last_active = ceph::coarse_mono_clock::now();
   recv_start_time = ceph::mono_clock::now();
 
@@ -728,11 +737,23 @@ void AsyncConnection::mark_down()
 void AsyncConnection::handle_write()
 {
   ldout(async_msgr->cct, 10) << __func__ << dendl;
+  {
+    // center only changes under write_lock in our own thread, see _migrate()
+    std::lock_guard<std::mutex> l(write_lock);
+    if (!center->in_thread()) {
+      center->dispatch_event_external(write_handler);
+      return;
+    }
+  }
   protocol->write_event();
 }
 
 void AsyncConnection::handle_write_callback() {
   std::lock_guard<std::mutex> l(lock);
+  if (!center->in_thread()) {
+    center->dispatch_event_external(write_callback_handler);
+    return;
+  }
   last_active = ceph::coarse_mono_clock::now();
   recv_start_time = ceph::mono_clock::now();
   write_lock.lock();
@@ -811,3 +832,88 @@ void AsyncConnection::tick(uint64_t id)
     }
   }
 }
+
+double AsyncConnection::sample_load()
+{
+  auto now = ceph::mono_clock::now();
+  uint64_t busy = busy_ns.load();
+  double load = 0;
+  if (last_sample_time != ceph::mono_time()) {
+    double elapsed =
+      std::chrono::duration<double, std::nano>(now - last_sample_time).count();
+    if (elapsed > 0) {
+      load = (busy - last_sample_busy_ns) / elapsed;
+    }
+  }
+  last_sample_busy_ns = busy;
+  last_sample_time = now;
+  return load;
+}
+
+void AsyncConnection::migrate_to(Worker *w, double load)
+{
+  std::lock_guard<std::mutex> l(lock);
+  if (state != STATE_CONNECTION_ESTABLISHED || w == worker) {
+    return;
+  }
+  center->submit_to(
+    center->get_id(),
+    [conn=AsyncConnectionRef(this), w, load] {
+      conn->_migrate(w, load);
+    }, true);
+}
+
+void AsyncConnection::_migrate(Worker *w, double load)
+{
+  std::lock_guard<std::mutex> l(lock);
+  ceph_assert(center->in_thread());
+  ceph_assert(async_msgr->get_stack()->support_connection_migration());
+  if (state != STATE_CONNECTION_ESTABLISHED || w == worker || !cs ||
+      delay_state || !register_time_events.empty()) {
+    ldout(async_msgr->cct, 10) << __func__ << " not migratable" << dendl;
+    return;
+  }
+  std::lock_guard<std::mutex> wl(write_lock);
+  if (open_write || is_queued() || writeCallback ||
+      !protocol->is_migratable()) {
+    ldout(async_msgr->cct, 10) << __func__ << " busy, not migrating" << dendl;
+    return;
+  }
+
+  ldout(async_msgr->cct, 5) << __func__ << " from worker " << worker->id
+                            << " to worker " << w->id << dendl;
+  center->delete_file_event(cs.fd(), EVENT_READABLE | EVENT_WRITABLE);
+  if (last_tick_id) {
+    center->delete_time_event(last_tick_id);
+    last_tick_id = 0;
+  }
+  async_msgr->get_stack()->account_migration(load);
+  logger->dec(l_msgr_active_connections);
+  worker->release_worker();
+  ++w->references;
+  worker = w;
+  center = &w->center;
+  logger = w->get_perf_counter();
+  labeled_logger = w->get_labeled_perf_counter();
+  logger->inc(l_msgr_active_connections);
+  logger->inc(l_msgr_migrated_connections);
+  // anybody sending from now on dispatches to the new center, after us
+  center->submit_to(
+    center->get_id(),
+    [conn=AsyncConnectionRef(this)] {
+      conn->_finish_migrate();
+    }, true);
+}
+
+void AsyncConnection::_finish_migrate()
+{
+  std::lock_guard<std::mutex> l(lock);
+  if (state != STATE_CONNECTION_ESTABLISHED || !cs) {
+    // faulted or stopped while in flight, the usual paths clean up
+    return;
+  }
+  center->create_file_event(cs.fd(), EVENT_READABLE, read_handler);
+  last_tick_id = center->create_time_event(inactive_timeout_us, tick_handler);
+  // pick up whatever arrived while the socket was detached
+  center->dispatch_event_external(read_handler);
+}
@@ -141,6 +141,28 @@ public:
 
   int get_con_mode() const override;
 
+  Worker *get_worker() const {
+    return worker;
+  }
+
+  /**
+   * Move this connection to another worker's event center.
+   *
+   * Used to even out load between messenger threads. The move is carried
+   * out asynchronously in the owning worker's thread, and is silently
+   * skipped unless the connection is established, idle on the write side
+   * and waiting for the next frame.
+   */
+  void migrate_to(Worker *w, double load);
+
+  /// busy time accounting, see account_busy()
+  void account_busy(ceph::mono_time start) {
+    busy_ns += std::chrono::nanoseconds(ceph::mono_clock::now() - start).count();
+  }
+  /// fraction of wall time this connection kept its worker busy since the
+  /// previous call
+  double sample_load();
+
   bool is_unregistered() const {
     return unregistered;
   }
@@ -223,6 +245,13 @@ private:
 
   std::unique_ptr<Protocol> protocol;
 
+  std::atomic<uint64_t> busy_ns = {0};
+  uint64_t last_sample_busy_ns = 0;
+  ceph::mono_time last_sample_time;
+
+  void _migrate(Worker *w, double load);
+  void _finish_migrate();
+
   std::optional<std::function<void(ssize_t)>> writeCallback;
   std::function<void(char *, ssize_t)> readCallback;
   std::optional<unsigned> pendingReadLen;
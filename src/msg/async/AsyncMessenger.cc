@@ -21,6 +21,7 @@
 
 #include "AsyncMessenger.h"
 
+#include "common/admin_socket.h"
 #include "common/config.h"
 #include "common/Timer.h"
 #include "common/errno.h"
@@ -40,6 +41,11 @@ static std::ostream& _prefix(std::ostream *_dout, Processor *p) {
   return *_dout << " Processor -- ";
 }
 
+struct StackSingleton;
+static std::ostream& _prefix(std::ostream *_dout, StackSingleton *s) {
+  return *_dout << " stack -- ";
+}
+
 
 /*******************
  * Processor
@@ -247,20 +253,59 @@ void Processor::stop()
 }
 
 
+class NetworkStackHook : public AdminSocketHook {
+  NetworkStack *stack;
+ public:
+  explicit NetworkStackHook(NetworkStack *s) : stack(s) {}
+  int call(std::string_view command, const cmdmap_t& cmdmap,
+	   const bufferlist&,
+	   Formatter *f,
+	   std::ostream& ss,
+	   bufferlist& out) override {
+    stack->dump_workers(f);
+    return 0;
+  }
+};
+
 struct StackSingleton {
   CephContext *cct;
   std::shared_ptr<NetworkStack> stack;
+  std::unique_ptr<NetworkStackHook> hook;
 
   explicit StackSingleton(CephContext *c): cct(c) {}
   void ready(std::string &type) {
-    if (!stack)
+    if (!stack) {
       stack = NetworkStack::create(cct, type);
+      hook = std::make_unique<NetworkStackHook>(stack.get());
+      int r = cct->get_admin_socket()->register_command(
+	"messenger dump_workers",
+	hook.get(),
+	"dump per-worker load and connection count of the async messenger");
+      if (r < 0) {
+	// another transport's stack in this process already owns it
+	ldout(cct, 1) << __func__ << " not registering dump_workers for "
+		      << type << ": " << cpp_strerror(r) << dendl;
+      }
+    }
   }
   ~StackSingleton() {
+    if (hook) {
+      cct->get_admin_socket()->unregister_commands(hook.get());
+    }
     stack->stop();
   }
 };
 
+class C_handle_rebalance : public EventCallback {
+  AsyncMessenger *msgr;
+
+  public:
+  explicit C_handle_rebalance(AsyncMessenger *m): msgr(m) {}
+  void do_request(uint64_t id) override {
+    msgr->rebalance_connections();
+  }
+};
+
 
 class C_handle_reap : public EventCallback {
   AsyncMessenger *msgr;
@@ -288,6 +333,8 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
     transport_type = "rdma";
   else if (type.find("dpdk") != std::string::npos)
     transport_type = "dpdk";
+  else if (type.find("shm") != std::string::npos)
+    transport_type = "shm";
 
   auto single = &cct->lookup_or_create_singleton_object<StackSingleton>(
     "AsyncMessenger::NetworkStack::" + transport_type, true, cct);
@@ -299,11 +346,13 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
 					 local_worker, true, true);
   init_local_connection();
   reap_handler = new C_handle_reap(this);
+  rebalance_handler = new C_handle_rebalance(this);
   unsigned processor_num = 1;
   if (stack->support_local_listen_table())
     processor_num = stack->get_num_worker();
   for (unsigned i = 0; i < processor_num; ++i)
     processors.push_back(new Processor(this, stack->get_worker(i), cct));
+  cct->_conf.add_observer(this);
 }
 
 /**
@@ -312,12 +361,46 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
  */
 AsyncMessenger::~AsyncMessenger()
 {
+  cct->_conf.remove_observer(this);
   delete reap_handler;
+  delete rebalance_handler;
   ceph_assert(!did_bind); // either we didn't bind or we shut down the Processor
   for (auto &&p : processors)
     delete p;
 }
 
+const char** AsyncMessenger::get_tracked_conf_keys() const
+{
+  static const char *keys[] = {
+    "ms_async_rebalance_interval",
+    nullptr
+  };
+  return keys;
+}
+
+void AsyncMessenger::handle_conf_change(const ConfigProxy& conf,
+                                        const std::set<std::string>& changed)
+{
+  if (changed.count("ms_async_rebalance_interval") &&
+      stack->support_connection_migration()) {
+    std::lock_guard l{lock};
+    if (started && !stopped) {
+      // re-arm the timer with the new interval, or cancel it
+      local_worker->center.submit_to(local_worker->center.get_id(), [this] {
+        std::lock_guard l{lock};
+        if (stopped) {
+          return;
+        }
+        if (rebalance_timer_id) {
+          local_worker->center.delete_time_event(rebalance_timer_id);
+          rebalance_timer_id = 0;
+        }
+        schedule_rebalance();
+      }, true);
+    }
+  }
+}
+
 void AsyncMessenger::ready()
 {
   ldout(cct,10) << __func__ << " " << get_myaddrs() << dendl;
@@ -353,6 +436,12 @@ int AsyncMessenger::shutdown()
   stop_cond.notify_all();
   stopped = true;
   lock.unlock();
+  local_worker->center.submit_to(local_worker->center.get_id(), [this] {
+    if (rebalance_timer_id) {
+      local_worker->center.delete_time_event(rebalance_timer_id);
+      rebalance_timer_id = 0;
+    }
+  }, false);
   stack->drain();
   return 0;
 }
@@ -572,9 +661,73 @@ int AsyncMessenger::start()
     _init_local_connection();
   }
 
+  if (cct->_conf.get_val<double>("ms_async_rebalance_interval") > 0 &&
+      stack->support_connection_migration()) {
+    local_worker->center.submit_to(local_worker->center.get_id(), [this] {
+      schedule_rebalance();
+    }, true);
+  }
+
   return 0;
 }
 
+void AsyncMessenger::schedule_rebalance()
+{
+  ceph_assert(local_worker->center.in_thread());
+  double interval = cct->_conf.get_val<double>("ms_async_rebalance_interval");
+  if (interval > 0 && !rebalance_timer_id) {
+    rebalance_timer_id = local_worker->center.create_time_event(
+      interval * 1000000, rebalance_handler);
+  }
+}
+
+void AsyncMessenger::rebalance_connections()
+{
+  rebalance_timer_id = 0;
+  double interval = cct->_conf.get_val<double>("ms_async_rebalance_interval");
+  double threshold = cct->_conf.get_val<double>("ms_async_rebalance_threshold");
+  {
+    std::lock_guard l{lock};
+    if (stopped) {
+      return;
+    }
+
+    // every connection is sampled each round to keep its window aligned
+    // with the workers' one
+    std::vector<std::pair<AsyncConnectionRef, double>> loads;
+    loads.reserve(conns.size());
+    for (auto& [addrs, conn] : conns) {
+      if (!conn->is_unregistered()) {
+        loads.emplace_back(conn, conn->sample_load());
+      }
+    }
+
+    Worker *hot, *cold;
+    double budget;
+    if (interval > 0 &&
+        stack->get_rebalance_pair(ceph::make_timespan(interval), threshold,
+                                  &hot, &cold, &budget)) {
+      // move the busiest connection that still fits into the budget, so a
+      // single move cannot flip the imbalance the other way round
+      AsyncConnectionRef best;
+      double best_load = 0;
+      for (auto& [conn, load] : loads) {
+        if (conn->get_worker() == hot && load <= budget && load > best_load) {
+          best = conn;
+          best_load = load;
+        }
+      }
+      if (best) {
+        ldout(cct, 5) << __func__ << " moving " << best << " load "
+                      << best_load << " from worker " << hot->id
+                      << " to worker " << cold->id << dendl;
+        best->migrate_to(cold, best_load);
+      }
+    }
+  }
+  schedule_rebalance();
+}
+
 void AsyncMessenger::wait()
 {
   {
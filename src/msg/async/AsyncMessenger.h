@@ -29,6 +29,7 @@
 #include "common/ceph_mutex.h"
 #include "common/Cond.h"
 #include "common/Thread.h"
+#include "common/config_obs.h"
 
 #include "msg/SimplePolicyMessenger.h"
 #include "msg/DispatchQueue.h"
@@ -71,7 +72,8 @@ class Processor {
  *
  */
 
-class AsyncMessenger : public SimplePolicyMessenger {
+class AsyncMessenger : public SimplePolicyMessenger,
+		       public md_config_obs_t {
   // First we have the public Messenger interface implementation...
 public:
   /**
@@ -91,6 +93,10 @@ public:
    */
   ~AsyncMessenger() override;
 
+  const char** get_tracked_conf_keys() const override;
+  void handle_conf_change(const ConfigProxy& conf,
+                          const std::set<std::string>& changed) override;
+
   /** @defgroup Accessors
    * @{
    */
@@ -299,6 +305,11 @@ private:
 
   EventCallbackRef reap_handler;
 
+  /// periodic worker load rebalancing, only touched in local_worker's thread
+  EventCallbackRef rebalance_handler;
+  uint64_t rebalance_timer_id = 0;
+  void schedule_rebalance();
+
   /// internal cluster protocol version, if any, for talking to entities of the same type.
   int cluster_protocol = 0;
 
@@ -425,6 +436,15 @@ public:
    */
   void reap_dead();
 
+  /**
+   * Even out the load of the stack's workers
+   *
+   * Runs periodically (ms_async_rebalance_interval) in local_worker's
+   * thread and moves at most one of our connections from the busiest to
+   * the idlest worker, based on measured per-connection event handling time.
+   */
+  void rebalance_connections();
+
   /**
    * @} // AsyncMessenger Internals
    */
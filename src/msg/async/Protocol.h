@@ -131,6 +131,9 @@ public:
   virtual void read_event() = 0;
   virtual void write_event() = 0;
   virtual bool is_queued() = 0;
+  // true -> connection may be moved to another worker right now;
+  // called with both connection locks held
+  virtual bool is_migratable() const { return false; }
 
   int get_con_mode() const {
     return auth_meta->con_mode;
@@ -101,7 +101,13 @@ ProtocolV2::ProtocolV2(AsyncConnection *connection)
       rx_frame_asm(&session_stream_handlers, false, cct->_conf->ms_crc_data,
                    &session_compression_handlers),
       next_tag(static_cast<Tag>(0)),
-      keepalive(false) {
+      keepalive(false),
+      send_batch_max_messages(
+        cct->_conf.get_val<uint64_t>("ms_async_send_batch_max_messages")),
+      send_batch_max_bytes(
+        cct->_conf.get_val<Option::size_t>("ms_async_send_batch_bytes")),
+      send_batch_budget(std::chrono::microseconds(
+        cct->_conf.get_val<uint64_t>("ms_async_send_batch_usec"))) {
 }
 
 ProtocolV2::~ProtocolV2() {
@@ -520,7 +526,7 @@ ProtocolV2::out_queue_entry_t ProtocolV2::_get_next_outgoing() {
   return out_entry;
 }
 
-ssize_t ProtocolV2::write_message(Message *m, bool more) {
+ssize_t ProtocolV2::write_message(Message *m) {
   FUNCTRACE(cct);
   ceph_assert(connection->center->in_thread());
   m->set_seq(++out_seq);
@@ -559,29 +565,37 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
                  << " src=" << entity_name_t(messenger->get_myname())
                  << " off=" << header2.data_off
                  << dendl;
+
+#if defined(WITH_EVENTTRACE)
+  if (m->get_type() == CEPH_MSG_OSD_OP)
+    OID_EVENT_TRACE_WITH_MSG(m, "SEND_MSG_OSD_OP_END", false);
+  else if (m->get_type() == CEPH_MSG_OSD_OPREPLY)
+    OID_EVENT_TRACE_WITH_MSG(m, "SEND_MSG_OSD_OPREPLY_END", false);
+#endif
+  m->put();
+
+  return 0;
+}
+
+// hand the frames of the last `batched` messages (and whatever else has
+// been appended since, e.g. an ack) to the socket in one go
+ssize_t ProtocolV2::flush_batch(unsigned &batched, bool more) {
   ssize_t total_send_size = connection->outgoing_bl.length();
   ssize_t rc = connection->_try_send(more);
   if (rc < 0) {
-    ldout(cct, 1) << __func__ << " error sending " << m << ", "
+    ldout(cct, 1) << __func__ << " error sending " << batched << " messages, "
                   << cpp_strerror(rc) << dendl;
-  } else {
+  } else if (batched) {
     const auto sent_bytes = total_send_size - connection->outgoing_bl.length();
     connection->logger->inc(l_msgr_send_bytes, sent_bytes);
     if (session_stream_handlers.tx) {
       connection->logger->inc(l_msgr_send_encrypted_bytes, sent_bytes);
     }
-    ldout(cct, 10) << __func__ << " sending " << m
+    connection->logger->inc(l_msgr_send_messages_per_syscall, batched);
+    ldout(cct, 10) << __func__ << " sending " << batched << " messages"
                    << (rc ? " continuely." : " done.") << dendl;
   }
-
-#if defined(WITH_EVENTTRACE)
-  if (m->get_type() == CEPH_MSG_OSD_OP)
-    OID_EVENT_TRACE_WITH_MSG(m, "SEND_MSG_OSD_OP_END", false);
-  else if (m->get_type() == CEPH_MSG_OSD_OPREPLY)
-    OID_EVENT_TRACE_WITH_MSG(m, "SEND_MSG_OSD_OPREPLY_END", false);
-#endif
-  m->put();
-
+  batched = 0;
   return rc;
 }
 
@@ -657,9 +671,12 @@ void ProtocolV2::write_event() {
     }
 
     auto start = ceph::mono_clock::now();
+    auto batch_start = start;
+    // messages appended to outgoing_bl but not yet handed to the socket
+    unsigned batched = 0;
     bool more;
     do {
-      if (connection->is_queued()) {
+      if (!batched && connection->is_queued()) {
 	if (r = connection->_try_send(); r!= 0) {
 	  // either fails to send or not all queued buffer is sent
 	  break;
@@ -679,6 +696,9 @@ void ProtocolV2::write_event() {
       more = !out_queue.empty();
       connection->write_lock.unlock();
 
+      if (!batched) {
+        batch_start = ceph::mono_clock::now();
+      }
       // send_message or requeue messages may not encode message
       if (!out_entry.is_prepared) {
         prepare_send_message(connection->get_features(), out_entry.m);
@@ -690,7 +710,17 @@ void ProtocolV2::write_event() {
 				 out_entry.m->queue_start);
       }
 
-      r = write_message(out_entry.m, more);
+      r = write_message(out_entry.m);
+      if (r == 0) {
+        // keep appending while more messages are queued, the last batch is
+        // flushed below together with the ack
+        ++batched;
+        if (batched >= send_batch_max_messages ||
+            connection->outgoing_bl.length() >= send_batch_max_bytes ||
+            ceph::mono_clock::now() - batch_start >= send_batch_budget) {
+          r = flush_batch(batched, more);
+        }
+      }
 
       connection->write_lock.lock();
       if (r == 0) {
@@ -716,12 +746,12 @@ void ProtocolV2::write_event() {
         if (append_frame(ack_frame)) {
           ack_left -= left;
           left = ack_left;
-          r = connection->_try_send(left);
+          r = flush_batch(batched, left);
         } else {
           r = -EILSEQ;
         }
-      } else if (is_queued()) {
-        r = connection->_try_send();
+      } else if (batched || is_queued()) {
+        r = flush_batch(batched, false);
       }
     }
     connection->write_lock.unlock();
@@ -766,6 +796,13 @@ bool ProtocolV2::is_queued() {
   return !out_queue.empty() || connection->is_queued();
 }
 
+bool ProtocolV2::is_migratable() const {
+  // in READY we are only waiting for the next frame's preamble, nothing
+  // refers to the event center until the socket becomes readable again
+  return state == READY && !replacing && !write_in_progress &&
+    !keepalive && out_queue.empty();
+}
+
 CtPtr ProtocolV2::read(CONTINUATION_RXBPTR_TYPE<ProtocolV2> &next,
                        rx_buffer_t &&buffer) {
   const auto len = buffer->length();
@@ -122,6 +122,11 @@ private:
   bool keepalive;
   bool write_in_progress = false;
 
+  // send side batching, see ms_async_send_batch_*
+  const uint64_t send_batch_max_messages;
+  const uint64_t send_batch_max_bytes;
+  const ceph::timespan send_batch_budget;
+
   CompConnectionMeta comp_meta;
   std::ostream& _conn_prefix(std::ostream *_dout);
   void run_continuation(Ct<ProtocolV2> *pcontinuation);
@@ -150,7 +155,8 @@ private:
   void reset_session();
   void prepare_send_message(uint64_t features, Message *m);
   out_queue_entry_t _get_next_outgoing();
-  ssize_t write_message(Message *m, bool more);
+  ssize_t write_message(Message *m);
+  ssize_t flush_batch(unsigned &batched, bool more);
   void handle_message_ack(uint64_t seq);
   void reset_compression();
 
@@ -217,6 +223,7 @@ public:
   virtual void read_event() override;
   virtual void write_event() override;
   virtual bool is_queued() override;
+  virtual bool is_migratable() const override;
 
 private:
   // Client Protocol
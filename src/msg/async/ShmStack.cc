@@ -0,0 +1,693 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <memory>
+
+#include "ShmStack.h"
+
+#include "common/ceph_time.h"
+#include "common/errno.h"
+#include "common/dout.h"
+#include "include/buffer.h"
+
+#define dout_subsys ceph_subsys_ms
+#undef dout_prefix
+#define dout_prefix *_dout << "ShmStack "
+
+namespace {
+
+constexpr uint32_t SHM_MAGIC = 0x63736d31;
+constexpr uint32_t SHM_VERSION = 1;
+// the ring headers live in front of the ring data
+constexpr size_t SHM_DATA_OFFSET = 4096;
+constexpr uint64_t SHM_MAX_RING_SIZE = 1ull << 30;
+// how long an accepted peer has to send its hello
+constexpr auto SHM_HELLO_TIMEOUT = std::chrono::seconds(1);
+
+// one direction of a connection, the writer only moves head and the
+// reader only moves tail
+struct shm_ring_t {
+  alignas(64) std::atomic<uint64_t> head;
+  alignas(64) std::atomic<uint64_t> tail;
+  // set by the reader before it waits for the doorbell
+  alignas(64) std::atomic<uint32_t> reader_waiting;
+  // set by the writer when it found the ring full
+  std::atomic<uint32_t> writer_waiting;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+	      std::atomic<uint32_t>::is_always_lock_free,
+	      "ring indexes are shared between processes");
+static_assert(2 * sizeof(shm_ring_t) <= SHM_DATA_OFFSET);
+
+// sent by the connector along with the memfd of the segment
+struct shm_hello_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ring_size;
+  sockaddr_storage addr;  // reported to the acceptor as the peer address
+};
+
+std::string shm_socket_name(const entity_addr_t &addr)
+{
+  return "ceph-msgr-shm:" + addr.ip_n_port_to_str();
+}
+
+socklen_t make_unix_addr(const std::string &name, sockaddr_un *un)
+{
+  memset(un, 0, sizeof(*un));
+  un->sun_family = AF_UNIX;
+  // abstract namespace: no file to clean up, gone with the listener
+  size_t len = std::min(name.size(), sizeof(un->sun_path) - 1);
+  memcpy(un->sun_path + 1, name.data(), len);
+  return offsetof(sockaddr_un, sun_path) + 1 + len;
+}
+
+bool is_local_addr(const entity_addr_t &addr)
+{
+  if (addr.is_ipv4()) {
+    if ((ntohl(addr.in4_addr().sin_addr.s_addr) >> 24) == IN_LOOPBACKNET)
+      return true;
+  } else if (addr.is_ipv6()) {
+    if (IN6_IS_ADDR_LOOPBACK(&addr.in6_addr().sin6_addr))
+      return true;
+  } else {
+    return false;
+  }
+
+  ifaddrs *ifa;
+  if (getifaddrs(&ifa) < 0)
+    return false;
+  bool local = false;
+  for (auto p = ifa; p && !local; p = p->ifa_next) {
+    entity_addr_t a;
+    if (p->ifa_addr && a.set_sockaddr(p->ifa_addr) && a.is_same_host(addr))
+      local = true;
+  }
+  freeifaddrs(ifa);
+  return local;
+}
+
+size_t segment_len(uint64_t ring_size)
+{
+  return SHM_DATA_OFFSET + 2 * ring_size;
+}
+
+int map_segment(int memfd, uint64_t ring_size, char **seg)
+{
+  if (ring_size == 0 || ring_size > SHM_MAX_RING_SIZE ||
+      !std::has_single_bit(ring_size))
+    return -EINVAL;
+  // the peer must not be able to shrink the segment under us, touching
+  // truncated pages would raise SIGBUS
+  int seals = ::fcntl(memfd, F_GET_SEALS);
+  if (seals < 0)
+    return -errno;
+  if (!(seals & F_SEAL_SHRINK))
+    return -EPERM;
+  struct stat st;
+  if (::fstat(memfd, &st) < 0)
+    return -errno;
+  if (static_cast<uint64_t>(st.st_size) < segment_len(ring_size))
+    return -EINVAL;
+  void *p = ::mmap(nullptr, segment_len(ring_size), PROT_READ | PROT_WRITE,
+		   MAP_SHARED, memfd, 0);
+  if (p == MAP_FAILED)
+    return -errno;
+  *seg = static_cast<char*>(p);
+  return 0;
+}
+
+int create_segment(uint64_t ring_size, int *memfd, char **seg)
+{
+  int fd = ::memfd_create("ceph-msgr-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0)
+    return -errno;
+  int r = 0;
+  if (::ftruncate(fd, segment_len(ring_size)) < 0 ||
+      ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+    r = -errno;
+  } else {
+    r = map_segment(fd, ring_size, seg);
+  }
+  if (r < 0) {
+    ::close(fd);
+    return r;
+  }
+  auto rings = reinterpret_cast<shm_ring_t*>(*seg);
+  for (int i = 0; i < 2; i++) {
+    new (&rings[i]) shm_ring_t{};
+    // nobody has read yet, so make the first write ring the doorbell
+    rings[i].reader_waiting = 1;
+  }
+  *memfd = fd;
+  return 0;
+}
+
+// only peers running as the same user, or as root, may map our memory and
+// claim an address of this host, whether they accept or connect
+int check_peer(int sd)
+{
+  ucred cred;
+  socklen_t len = sizeof(cred);
+  if (::getsockopt(sd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+    return -errno;
+  if (cred.uid != ::geteuid() && cred.uid != 0)
+    return -EPERM;
+  return 0;
+}
+
+// returns -EAGAIN until the hello arrives
+int recv_hello(int sd, shm_hello_t *hello, int *memfd)
+{
+  iovec iov = {hello, sizeof(*hello)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t n = ::recvmsg(sd, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+  if (n < 0)
+    return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+  for (auto c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS &&
+	c->cmsg_len == CMSG_LEN(sizeof(int))) {
+      memcpy(memfd, CMSG_DATA(c), sizeof(int));
+    }
+  }
+  if (*memfd < 0 || n != sizeof(*hello) || (msg.msg_flags & MSG_CTRUNC))
+    return -EINVAL;
+  if (hello->magic != SHM_MAGIC || hello->version != SHM_VERSION)
+    return -EPROTO;
+  entity_addr_t addr;
+  if (!addr.set_sockaddr(reinterpret_cast<sockaddr*>(&hello->addr)) ||
+      !is_local_addr(addr))
+    return -EINVAL;
+  return 0;
+}
+
+} // anonymous namespace
+
+class ShmConnectedSocketImpl final : public ConnectedSocketImpl {
+  CephContext *cct;
+  int _fd;  // unix socket, only carries doorbells after the hello
+  char *seg;
+  const uint64_t ring_size;
+  shm_ring_t *tx, *rx;
+  char *tx_data, *rx_data;
+  // our own copies of the indexes we move, the peer cannot be trusted
+  // with them
+  uint64_t tx_head = 0;
+  uint64_t rx_tail = 0;
+  bool peer_closed = false;
+  bool shut = false;
+
+  int ring_doorbell() {
+    char c = 0;
+    ssize_t r = ::send(_fd, &c, 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (r < 0 && errno != EAGAIN && errno != EINTR) {
+      return -errno;
+    }
+    // on EAGAIN the peer has plenty of unread doorbells already
+    return 0;
+  }
+
+  int drain_doorbell() {
+    char buf[64];
+    while (true) {
+      ssize_t r = ::recv(_fd, buf, sizeof(buf), MSG_DONTWAIT);
+      if (r > 0) {
+	continue;
+      } else if (r == 0) {
+	peer_closed = true;
+	return 0;
+      } else if (errno == EINTR) {
+	continue;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	return 0;
+      }
+      return -errno;
+    }
+  }
+
+ public:
+  ShmConnectedSocketImpl(CephContext *cct, int fd, char *seg,
+			 uint64_t ring_size, bool connector)
+    : cct(cct), _fd(fd), seg(seg), ring_size(ring_size) {
+    auto rings = reinterpret_cast<shm_ring_t*>(seg);
+    char *data = seg + SHM_DATA_OFFSET;
+    tx = &rings[connector ? 0 : 1];
+    rx = &rings[connector ? 1 : 0];
+    tx_data = data + (connector ? 0 : ring_size);
+    rx_data = data + (connector ? ring_size : 0);
+  }
+  ~ShmConnectedSocketImpl() override {
+    close();
+  }
+
+  int is_connected() override {
+    return 1;
+  }
+
+  ssize_t read(char *buf, size_t len) override {
+    uint64_t avail = rx->head.load(std::memory_order_acquire) - rx_tail;
+    if (avail == 0) {
+      // about to wait: ask the writer for a doorbell, then look again so
+      // that data produced in the meantime is not missed
+      if (int r = drain_doorbell(); r < 0) {
+	return r;
+      }
+      rx->reader_waiting.store(1);
+      avail = rx->head.load() - rx_tail;
+      if (avail == 0) {
+	return peer_closed ? 0 : -EAGAIN;
+      }
+    }
+    if (avail > ring_size) {
+      lderr(cct) << __func__ << " peer corrupted the ring, "
+		 << avail << " bytes pending" << dendl;
+      return -EIO;
+    }
+
+    size_t n = std::min<uint64_t>(len, avail);
+    size_t off = rx_tail & (ring_size - 1);
+    size_t first = std::min<size_t>(n, ring_size - off);
+    memcpy(buf, rx_data + off, first);
+    memcpy(buf + first, rx_data, n - first);
+    rx_tail += n;
+    rx->tail.store(rx_tail);
+
+    if (rx->writer_waiting.load()) {
+      // consuming the writer's doorbell makes its socket writable again
+      if (int r = drain_doorbell(); r < 0) {
+	return r;
+      }
+    }
+    return n;
+  }
+
+  // writes as much as fits into the ring; when it is full the writer waits
+  // for EVENT_WRITABLE like with a regular socket, which the reader triggers
+  // by consuming the doorbell we send it
+  ssize_t send(ceph::buffer::list &bl, bool more) override {
+    if (shut || peer_closed) {
+      return -EPIPE;
+    }
+    uint64_t used = tx_head - tx->tail.load(std::memory_order_acquire);
+    if (used > ring_size) {
+      lderr(cct) << __func__ << " peer corrupted the ring, "
+		 << used << " bytes in use" << dendl;
+      return -EIO;
+    }
+
+    size_t n = std::min<uint64_t>(bl.length(), ring_size - used);
+    if (n == 0) {
+      if (bl.length() && tx->writer_waiting.exchange(1) == 0) {
+	if (int r = ring_doorbell(); r < 0) {
+	  return r;
+	}
+      }
+      return 0;
+    }
+
+    auto p = bl.cbegin();
+    size_t off = tx_head & (ring_size - 1);
+    size_t first = std::min<size_t>(n, ring_size - off);
+    p.copy(first, tx_data + off);
+    p.copy(n - first, tx_data);
+    tx_head += n;
+    tx->head.store(tx_head);
+    tx->writer_waiting.store(0, std::memory_order_relaxed);
+
+    if (tx->reader_waiting.load() && tx->reader_waiting.exchange(0)) {
+      if (int r = ring_doorbell(); r < 0) {
+	return r;
+      }
+    }
+
+    if (n < bl.length()) {
+      ceph::buffer::list swapped;
+      bl.splice(n, bl.length() - n, &swapped);
+      bl.swap(swapped);
+    } else {
+      bl.clear();
+    }
+    return static_cast<ssize_t>(n);
+  }
+
+  void shutdown() override {
+    shut = true;
+    ::shutdown(_fd, SHUT_RDWR);
+  }
+  void close() override {
+    if (_fd >= 0) {
+      ::close(_fd);
+      _fd = -1;
+    }
+    if (seg) {
+      ::munmap(seg, segment_len(ring_size));
+      seg = nullptr;
+    }
+  }
+  // the traffic never hits the IP stack
+  void set_priority(int sd, int prio, int domain) override {}
+  int fd() const override {
+    return _fd;
+  }
+};
+
+class ShmServerSocketImpl : public ServerSocketImpl {
+  CephContext *cct;
+  ServerSocket tcp;
+  int unix_fd;
+  int ep_fd;  // polls both listening sockets and the pending hellos
+
+  // accepted unix sockets whose hello has not arrived yet. they are polled
+  // by ep_fd, so that accept() is called again once it does
+  struct pending_t {
+    int sd;
+    ceph::coarse_mono_time deadline;
+  };
+  std::list<pending_t> pending;
+
+  int accept_shm(ConnectedSocket *sock, entity_addr_t *out);
+  int finish_hello(int sd, ConnectedSocket *sock, entity_addr_t *out);
+  void drop_pending(std::list<pending_t>::iterator p);
+
+ public:
+  ShmServerSocketImpl(CephContext *cct, const entity_addr_t &listen_addr,
+		      unsigned slot, ServerSocket &&tcp, int unix_fd, int ep_fd)
+    : ServerSocketImpl(listen_addr.get_type(), slot),
+      cct(cct), tcp(std::move(tcp)), unix_fd(unix_fd), ep_fd(ep_fd) {}
+  ~ShmServerSocketImpl() override {
+    while (!pending.empty()) {
+      drop_pending(pending.begin());
+    }
+  }
+  int accept(ConnectedSocket *sock, const SocketOptions &opt,
+	     entity_addr_t *out, Worker *w) override {
+    int r = accept_shm(sock, out);
+    if (r != -EAGAIN) {
+      return r;
+    }
+    return tcp.accept(sock, opt, out, w);
+  }
+  void abort_accept() override {
+    if (tcp) {
+      tcp.abort_accept();
+    }
+    while (!pending.empty()) {
+      drop_pending(pending.begin());
+    }
+    if (unix_fd >= 0) {
+      ::close(unix_fd);
+      unix_fd = -1;
+    }
+    if (ep_fd >= 0) {
+      ::close(ep_fd);
+      ep_fd = -1;
+    }
+  }
+  int fd() const override {
+    return ep_fd;
+  }
+};
+
+void ShmServerSocketImpl::drop_pending(std::list<pending_t>::iterator p)
+{
+  if (ep_fd >= 0) {
+    ::epoll_ctl(ep_fd, EPOLL_CTL_DEL, p->sd, nullptr);
+  }
+  ::close(p->sd);
+  pending.erase(p);
+}
+
+// takes over sd, unless the hello has not arrived yet
+int ShmServerSocketImpl::finish_hello(int sd, ConnectedSocket *sock,
+				      entity_addr_t *out)
+{
+  shm_hello_t hello;
+  int memfd = -1;
+  char *seg = nullptr;
+  int r = recv_hello(sd, &hello, &memfd);
+  if (r == -EAGAIN) {
+    return r;
+  }
+  if (r == 0) {
+    r = map_segment(memfd, hello.ring_size, &seg);
+  }
+  if (memfd >= 0) {
+    ::close(memfd);
+  }
+  if (r < 0) {
+    ldout(cct, 1) << __func__ << " rejecting shared memory connection: "
+		  << cpp_strerror(r) << dendl;
+    ::close(sd);
+    // a misbehaving local peer must not count as an accept failure
+    return -ECONNABORTED;
+  }
+
+  out->set_type(addr_type);
+  out->set_sockaddr(reinterpret_cast<sockaddr*>(&hello.addr));
+  ldout(cct, 10) << __func__ << " accepted shared memory connection from "
+		 << *out << " ring_size " << hello.ring_size << dendl;
+  *sock = ConnectedSocket(std::make_unique<ShmConnectedSocketImpl>(
+    cct, sd, seg, hello.ring_size, false));
+  return 0;
+}
+
+// never waits for a hello: the connections whose hello is not there yet
+// are finished by a later call, once ep_fd reports it
+int ShmServerSocketImpl::accept_shm(ConnectedSocket *sock, entity_addr_t *out)
+{
+  ceph_assert(sock);
+  ceph_assert(out);
+  // the silent peers are only dropped here, but there are no more of them
+  // than the listen backlog
+  const auto now = ceph::coarse_mono_clock::now();
+  for (auto p = pending.begin(); p != pending.end();) {
+    const int sd = p->sd;
+    int r = finish_hello(sd, sock, out);
+    if (r == -EAGAIN) {
+      if (now < p->deadline) {
+	++p;
+      } else {
+	ldout(cct, 1) << __func__ << " rejecting shared memory connection: "
+		      << "no hello" << dendl;
+	drop_pending(p++);
+      }
+      continue;
+    }
+    // a rejected socket is closed, hence out of ep_fd already
+    if (r == 0) {
+      ::epoll_ctl(ep_fd, EPOLL_CTL_DEL, sd, nullptr);
+    }
+    pending.erase(p);
+    return r;
+  }
+
+  while (true) {
+    int sd = ::accept4(unix_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (sd < 0) {
+      return -errno;
+    }
+    if (int r = check_peer(sd); r < 0) {
+      ldout(cct, 1) << __func__ << " rejecting shared memory connection: "
+		    << cpp_strerror(r) << dendl;
+      ::close(sd);
+      return -ECONNABORTED;
+    }
+    // the connector sends its hello right after connecting, so it is
+    // usually there already
+    int r = finish_hello(sd, sock, out);
+    if (r != -EAGAIN) {
+      return r;
+    }
+    epoll_event ee = {};
+    ee.events = EPOLLIN;
+    ee.data.fd = sd;
+    if (pending.size() >= static_cast<size_t>(cct->_conf->ms_tcp_listen_backlog) ||
+	::epoll_ctl(ep_fd, EPOLL_CTL_ADD, sd, &ee) < 0) {
+      ldout(cct, 1) << __func__ << " rejecting shared memory connection: "
+		    << "unable to wait for its hello" << dendl;
+      ::close(sd);
+      return -ECONNABORTED;
+    }
+    pending.push_back({sd, ceph::coarse_mono_clock::now() + SHM_HELLO_TIMEOUT});
+  }
+}
+
+int ShmWorker::listen(entity_addr_t &sa,
+		      unsigned addr_slot,
+		      const SocketOptions &opt,
+		      ServerSocket *sock)
+{
+  ServerSocket tcp;
+  int r = PosixWorker::listen(sa, addr_slot, opt, &tcp);
+  if (r < 0 || !sa.get_port()) {
+    *sock = std::move(tcp);
+    return r;
+  }
+
+  int unix_fd = -1, ep_fd = -1;
+  auto add_fd = [&ep_fd](int fd) {
+    epoll_event ee = {};
+    ee.events = EPOLLIN;
+    ee.data.fd = fd;
+    return ::epoll_ctl(ep_fd, EPOLL_CTL_ADD, fd, &ee);
+  };
+  sockaddr_un un;
+  socklen_t len = make_unix_addr(shm_socket_name(sa), &un);
+  if ((unix_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ||
+      ::bind(unix_fd, reinterpret_cast<sockaddr*>(&un), len) < 0 ||
+      ::listen(unix_fd, cct->_conf->ms_tcp_listen_backlog) < 0 ||
+      (ep_fd = ::epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+      add_fd(tcp.fd()) < 0 ||
+      add_fd(unix_fd) < 0) {
+    r = -errno;
+    ldout(cct, 1) << __func__ << " unable to listen for shared memory "
+		  << "connections on " << sa << ": " << cpp_strerror(r)
+		  << ", accepting tcp connections only" << dendl;
+    if (unix_fd >= 0)
+      ::close(unix_fd);
+    if (ep_fd >= 0)
+      ::close(ep_fd);
+    *sock = std::move(tcp);
+    return 0;
+  }
+
+  *sock = ServerSocket(std::make_unique<ShmServerSocketImpl>(
+    cct, sa, addr_slot, std::move(tcp), unix_fd, ep_fd));
+  return 0;
+}
+
+int ShmWorker::shm_connect(const entity_addr_t &addr, const SocketOptions &opts,
+			   ConnectedSocket *socket)
+{
+  // the peer may listen on the address itself or on the wildcard address
+  entity_addr_t any;
+  any.set_family(addr.get_family());
+  any.set_port(addr.get_port());
+
+  int sd = -1;
+  int r = -ECONNREFUSED;
+  for (const auto &target : {addr, any}) {
+    sd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sd < 0) {
+      return -errno;
+    }
+    sockaddr_un un;
+    socklen_t len = make_unix_addr(shm_socket_name(target), &un);
+    if (::connect(sd, reinterpret_cast<sockaddr*>(&un), len) == 0) {
+      break;
+    }
+    r = -errno;
+    ::close(sd);
+    sd = -1;
+  }
+  if (sd < 0) {
+    return r;
+  }
+  // abstract socket names have no permissions: whoever binds the name first
+  // would get our memory, so only hand it to the users check_peer() trusts
+  if (check_peer(sd) < 0) {
+    ldout(cct, 1) << __func__ << " refusing to map shared memory to the "
+		  << "listener of " << addr << ": untrusted peer" << dendl;
+    ::close(sd);
+    return -EPERM;
+  }
+
+  uint64_t ring_size =
+    cct->_conf.get_val<Option::size_t>("ms_async_shm_ring_size");
+  ring_size = std::bit_ceil(ring_size);
+  int memfd = -1;
+  char *seg = nullptr;
+  r = create_segment(ring_size, &memfd, &seg);
+  if (r < 0) {
+    ::close(sd);
+    return r;
+  }
+
+  shm_hello_t hello;
+  memset(&hello, 0, sizeof(hello));
+  hello.magic = SHM_MAGIC;
+  hello.version = SHM_VERSION;
+  hello.ring_size = ring_size;
+  // what the peer would have seen as our address over tcp
+  entity_addr_t self = addr;
+  if (opts.connect_bind_addr.is_ip() && !opts.connect_bind_addr.is_blank_ip()) {
+    self = opts.connect_bind_addr;
+  }
+  self.set_port(0);
+  hello.addr = self.get_sockaddr_storage();
+
+  iovec iov = {&hello, sizeof(hello)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  memset(control, 0, sizeof(control));
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr *c = CMSG_FIRSTHDR(&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(c), &memfd, sizeof(int));
+  ssize_t n = ::sendmsg(sd, &msg, MSG_NOSIGNAL);
+  r = n < 0 ? -errno : 0;
+  // the mapping and the in-flight message keep the segment alive
+  ::close(memfd);
+  if (n != sizeof(hello)) {
+    ::munmap(seg, segment_len(ring_size));
+    ::close(sd);
+    return r < 0 ? r : -EIO;
+  }
+
+  *socket = ConnectedSocket(std::make_unique<ShmConnectedSocketImpl>(
+    cct, sd, seg, ring_size, true));
+  return 0;
+}
+
+int ShmWorker::connect(const entity_addr_t &addr, const SocketOptions &opts,
+		       ConnectedSocket *socket)
+{
+  if (is_local_addr(addr)) {
+    int r = shm_connect(addr, opts, socket);
+    if (r == 0) {
+      ldout(cct, 10) << __func__ << " connected to " << addr
+		     << " over shared memory" << dendl;
+      return 0;
+    }
+    ldout(cct, 10) << __func__ << " no shared memory path to " << addr
+		   << ": " << cpp_strerror(r) << ", using tcp" << dendl;
+  }
+  return PosixWorker::connect(addr, opts, socket);
+}
@@ -0,0 +1,57 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MSG_ASYNC_SHMSTACK_H
+#define CEPH_MSG_ASYNC_SHMSTACK_H
+
+#include "PosixStack.h"
+
+/*
+ * Shared memory transport for peers on the same host.
+ *
+ * Every listening socket is backed by a TCP socket, as with the posix stack,
+ * and by an abstract unix domain socket named after the listen address.
+ * When connecting to an address that belongs to this host, the connector
+ * creates a sealed memfd holding one ring buffer per direction and passes it
+ * over the unix socket; afterwards payload only goes through the rings and
+ * the unix socket is merely used as a doorbell to wake up a sleeping reader
+ * or a writer waiting for ring space.  Remote peers, and local peers that do
+ * not run this stack, are reached over TCP.  Both ends only share memory
+ * with peers running as the same user or as root.  The acceptor never blocks
+ * waiting for the memory of a connector: the hellos that are not there yet
+ * are finished by a later accept() once the listening epoll fd reports them.
+ */
+class ShmWorker : public PosixWorker {
+  int shm_connect(const entity_addr_t &addr, const SocketOptions &opts,
+		  ConnectedSocket *socket);
+ public:
+  ShmWorker(CephContext *c, unsigned i)
+    : PosixWorker(c, i) {}
+  int listen(entity_addr_t &sa,
+	     unsigned addr_slot,
+	     const SocketOptions &opt,
+	     ServerSocket *socks) override;
+  int connect(const entity_addr_t &addr, const SocketOptions &opts,
+	      ConnectedSocket *socket) override;
+};
+
+class ShmNetworkStack : public PosixNetworkStack {
+  Worker* create_worker(CephContext *c, unsigned worker_id) override {
+    return new ShmWorker(c, worker_id);
+  }
+
+ public:
+  explicit ShmNetworkStack(CephContext *c)
+    : PosixNetworkStack(c) {}
+};
+
+#endif //CEPH_MSG_ASYNC_SHMSTACK_H
@@ -19,7 +19,11 @@
 #include "include/compat.h"
 #include "common/Cond.h"
 #include "common/errno.h"
+#include "common/Formatter.h"
 #include "PosixStack.h"
+#ifdef __linux__
+#include "ShmStack.h"
+#endif
 #ifdef HAVE_RDMA
 #include "rdma/RDMAStack.h"
 #endif
@@ -54,6 +58,7 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
           // TODO do something?
         }
         w->perf_logger->tinc(l_msgr_running_total_time, dur);
+        w->busy_ns += std::chrono::nanoseconds(dur).count();
       }
       w->reset();
       w->destroy();
@@ -67,6 +72,10 @@ std::shared_ptr<NetworkStack> NetworkStack::create(CephContext *c,
 
   if (t == "posix")
     stack.reset(new PosixNetworkStack(c));
+#ifdef __linux__
+  else if (t == "shm")
+    stack.reset(new ShmNetworkStack(c));
+#endif
 #ifdef HAVE_RDMA
   else if (t == "rdma")
     stack.reset(new RDMAStack(c));
@@ -167,6 +176,72 @@ void NetworkStack::stop()
   started = false;
 }
 
+bool NetworkStack::get_rebalance_pair(ceph::timespan interval,
+                                      double threshold,
+                                      Worker **hot, Worker **cold,
+                                      double *budget)
+{
+  std::lock_guard lk(pool_spin);
+  auto now = ceph::mono_clock::now();
+  if (last_load_sample == ceph::mono_time() ||
+      now - last_load_sample >= interval) {
+    double elapsed = last_load_sample == ceph::mono_time() ? 0 :
+      std::chrono::duration<double, std::nano>(now - last_load_sample).count();
+    last_load_sample = now;
+    rebalance_hot = rebalance_cold = nullptr;
+    rebalance_budget = 0;
+    for (Worker* worker : workers) {
+      uint64_t busy = worker->busy_ns.load();
+      worker->load = elapsed > 0 ? (busy - worker->last_busy_ns) / elapsed : 0;
+      worker->last_busy_ns = busy;
+      if (!rebalance_hot || worker->load > rebalance_hot->load) {
+        rebalance_hot = worker;
+      }
+      if (!rebalance_cold || worker->load < rebalance_cold->load) {
+        rebalance_cold = worker;
+      }
+    }
+    if (rebalance_hot && rebalance_hot->load - rebalance_cold->load > threshold) {
+      rebalance_budget = (rebalance_hot->load - rebalance_cold->load) / 2;
+      ldout(cct, 10) << __func__ << " worker " << rebalance_hot->id
+                     << " load " << rebalance_hot->load
+                     << " worker " << rebalance_cold->id
+                     << " load " << rebalance_cold->load
+                     << " budget " << rebalance_budget << dendl;
+    }
+  }
+  if (rebalance_budget <= 0) {
+    return false;
+  }
+  *hot = rebalance_hot;
+  *cold = rebalance_cold;
+  *budget = rebalance_budget;
+  return true;
+}
+
+void NetworkStack::account_migration(double load)
+{
+  std::lock_guard lk(pool_spin);
+  rebalance_budget -= load;
+}
+
+void NetworkStack::dump_workers(ceph::Formatter *f)
+{
+  std::lock_guard lk(pool_spin);
+  f->open_array_section("workers");
+  for (Worker* worker : workers) {
+    f->open_object_section("worker");
+    f->dump_unsigned("id", worker->id);
+    f->dump_unsigned("connections", worker->references.load());
+    f->dump_float("load", worker->load);
+    f->dump_unsigned("busy_ns", worker->busy_ns.load());
+    f->dump_unsigned("migrated_connections",
+                     worker->perf_logger->get(l_msgr_migrated_connections));
+    f->close_section();
+  }
+  f->close_section();
+}
+
 class C_drain : public EventCallback {
   ceph::mutex drain_lock = ceph::make_mutex("C_drain::drain_lock");
   ceph::condition_variable drain_cond;
@@ -213,6 +213,10 @@ enum {
   l_msgr_recv_encrypted_bytes,
   l_msgr_send_encrypted_bytes,
 
+  l_msgr_migrated_connections,
+
+  l_msgr_send_messages_per_syscall,
+
   l_msgr_last,
 };
 
@@ -241,6 +245,12 @@ class Worker {
   std::atomic_uint references;
   EventCenter center;
 
+  /// nanoseconds spent processing events, fed to the load rebalancer
+  std::atomic<uint64_t> busy_ns = {0};
+  // the following are protected by NetworkStack::pool_spin
+  uint64_t last_busy_ns = 0;
+  double load = 0;   ///< fraction of wall time busy over the last sample
+
   Worker(const Worker&) = delete;
   Worker& operator=(const Worker&) = delete;
 
@@ -271,6 +281,10 @@ class Worker {
     plb.add_u64_counter(l_msgr_recv_encrypted_bytes, "msgr_recv_encrypted_bytes", "Network received encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_msgr_send_encrypted_bytes, "msgr_send_encrypted_bytes", "Network sent encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
 
+    plb.add_u64_counter(l_msgr_migrated_connections, "msgr_migrated_connections", "Connections moved to this worker by load rebalancing");
+
+    plb.add_u64_avg(l_msgr_send_messages_per_syscall, "msgr_send_messages_per_syscall", "Messages handed to the socket per send call");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
 
@@ -345,6 +359,12 @@ class NetworkStack {
   ceph::spinlock pool_spin;
   bool started = false;
 
+  // load rebalancing state, protected by pool_spin
+  ceph::mono_time last_load_sample;
+  Worker *rebalance_hot = nullptr;
+  Worker *rebalance_cold = nullptr;
+  double rebalance_budget = 0;
+
   std::function<void ()> add_thread(Worker* w);
 
   virtual Worker* create_worker(CephContext *c, unsigned i) = 0;
@@ -379,6 +399,11 @@ class NetworkStack {
   // need to let each thread do binding port.
   virtual bool support_local_listen_table() const { return false; }
   virtual bool nonblock_connect_need_writable_event() const { return true; }
+  // backend need to override this method if its connected sockets only
+  // depend on their fd, so a connection can be moved to another worker by
+  // registering the fd with the event center of that worker. dpdk and rdma
+  // sockets keep their state in the worker they were created on.
+  virtual bool support_connection_migration() const { return false; }
 
   void start();
   void stop();
@@ -391,6 +416,23 @@ class NetworkStack {
     return workers.size();
   }
 
+  /**
+   * Find a pair of workers worth rebalancing connections between.
+   *
+   * Worker loads (fraction of wall time spent handling events) are
+   * resampled at most once per @p interval, so every messenger sharing this
+   * stack sees the same picture. If the busiest and the idlest worker differ
+   * by more than @p threshold, they are returned along with the budget, i.e.
+   * the load that should move from @p hot to @p cold to even them out.
+   * Callers report what they actually moved through account_migration().
+   *
+   * @return true if a migration is worthwhile
+   */
+  bool get_rebalance_pair(ceph::timespan interval, double threshold,
+                          Worker **hot, Worker **cold, double *budget);
+  void account_migration(double load);
+  void dump_workers(ceph::Formatter *f);
+
   // direct is used in tests only
   virtual void spawn_worker(std::function<void ()> &&) = 0;
   virtual void join_worker(unsigned i) = 0;
@@ -19,6 +19,9 @@ static constexpr const std::size_t AESGCM_IV_LEN{12};
 static constexpr const std::size_t AESGCM_TAG_LEN{16};
 static constexpr const std::size_t AESGCM_BLOCK_LEN{16};
 
+// keep in sync with ms_crypto_tx_coalesce_size
+static constexpr const std::size_t DEFAULT_TX_COALESCE_SIZE{16 << 10};
+
 struct nonce_t {
   ceph_le32 fixed;
   ceph_le64 counter;
@@ -44,15 +47,34 @@ class AES128GCM_OnWireTxHandler : public ceph::crypto::onwire::TxHandler {
   bool new_nonce_format;  // 64-bit counter?
   static_assert(sizeof(nonce) == AESGCM_IV_LEN);
 
+  // A frame is typically made of many tiny buffers (preamble, ceph_msg_header,
+  // footer, small payloads, epilogue). Feeding them to EVP_EncryptUpdate()
+  // one by one is dominated by the per-call overhead and keeps OpenSSL off
+  // its stitched AES-NI/VAES GCM kernels, which only kick in for inputs of
+  // a few hundred bytes. Small fragments are therefore gathered here and
+  // encrypted with a single update. Because the output buffer is reserved
+  // up-front in reset_tx_handler(), the staged ciphertext always lands at
+  // staged_out .. staged_out + staged_len in one contiguous region. The
+  // staging buffer is allocated by the first fragment staged.
+  std::unique_ptr<unsigned char[]> staging;
+  std::size_t staging_cap;
+  std::size_t staged_len = 0;
+  char* staged_out = nullptr;
+
+  void encrypt_into(char* out, const unsigned char* in, std::size_t len);
+  void flush_staged();
+
 public:
   AES128GCM_OnWireTxHandler(CephContext* const cct,
 			    const key_t& key,
 			    const nonce_t& nonce,
-			    bool new_nonce_format)
+			    bool new_nonce_format,
+			    std::size_t coalesce_size)
     : cct(cct),
       ectx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free),
       nonce(nonce), initial_nonce(nonce), used_initial_nonce(false),
-      new_nonce_format(new_nonce_format) {
+      new_nonce_format(new_nonce_format),
+      staging_cap(coalesce_size) {
     ceph_assert_always(ectx);
     ceph_assert_always(key.size() * CHAR_BIT == 128);
 
@@ -70,6 +92,9 @@ public:
   ~AES128GCM_OnWireTxHandler() override {
     ::TOPNSPC::crypto::zeroize_for_security(&nonce, sizeof(nonce));
     ::TOPNSPC::crypto::zeroize_for_security(&initial_nonce, sizeof(initial_nonce));
+    if (staging) {
+      ::TOPNSPC::crypto::zeroize_for_security(staging.get(), staging_cap);
+    }
   }
 
   void reset_tx_handler(const uint32_t* first, const uint32_t* last) override;
@@ -94,6 +119,7 @@ void AES128GCM_OnWireTxHandler::reset_tx_handler(const uint32_t* first,
   }
 
   ceph_assert(buffer.get_append_buffer_unused_tail_length() == 0);
+  ceph_assert(staged_len == 0);
   buffer.reserve(std::accumulate(first, last, AESGCM_TAG_LEN));
 
   if (!new_nonce_format) {
@@ -105,6 +131,32 @@ void AES128GCM_OnWireTxHandler::reset_tx_handler(const uint32_t* first,
   }
 }
 
+void AES128GCM_OnWireTxHandler::encrypt_into(char* out,
+                                             const unsigned char* in,
+                                             std::size_t len)
+{
+  int update_len = 0;
+
+  if(1 != EVP_EncryptUpdate(ectx.get(),
+	reinterpret_cast<unsigned char*>(out),
+	&update_len,
+	in,
+	len)) {
+    throw std::runtime_error("EVP_EncryptUpdate failed");
+  }
+  ceph_assert_always(update_len >= 0);
+  ceph_assert(static_cast<unsigned>(update_len) == len);
+}
+
+void AES128GCM_OnWireTxHandler::flush_staged()
+{
+  if (staged_len > 0) {
+    encrypt_into(staged_out, staging.get(), staged_len);
+    staged_len = 0;
+    staged_out = nullptr;
+  }
+}
+
 void AES128GCM_OnWireTxHandler::authenticated_encrypt_update(
   const ceph::bufferlist& plaintext)
 {
@@ -113,28 +165,42 @@ void AES128GCM_OnWireTxHandler::authenticated_encrypt_update(
   auto filler = buffer.append_hole(plaintext.length());
 
   for (const auto& plainbuf : plaintext.buffers()) {
-    int update_len = 0;
-
-    if(1 != EVP_EncryptUpdate(ectx.get(),
-	reinterpret_cast<unsigned char*>(filler.c_str()),
-	&update_len,
-	reinterpret_cast<const unsigned char*>(plainbuf.c_str()),
-	plainbuf.length())) {
-      throw std::runtime_error("EVP_EncryptUpdate failed");
+    const auto len = plainbuf.length();
+    if (len < staging_cap) {
+      if (staged_len + len > staging_cap) {
+        flush_staged();
+      }
+      if (staged_len == 0) {
+        staged_out = filler.c_str();
+      }
+      ceph_assert(staged_out + staged_len == filler.c_str());
+      if (!staging) {
+        staging.reset(new unsigned char[staging_cap]);
+      }
+      ::memcpy(staging.get() + staged_len, plainbuf.c_str(), len);
+      staged_len += len;
+    } else {
+      // GCM is a stream mode: whatever is staged must hit the cipher
+      // before the bytes that follow it.
+      flush_staged();
+      encrypt_into(filler.c_str(),
+		   reinterpret_cast<const unsigned char*>(plainbuf.c_str()),
+		   len);
     }
-    ceph_assert_always(update_len >= 0);
-    ceph_assert(static_cast<unsigned>(update_len) == plainbuf.length());
-    filler.advance(update_len);
+    filler.advance(len);
   }
 
   ldout(cct, 15) << __func__
 		 << " plaintext.length()=" << plaintext.length()
 		 << " buffer.length()=" << buffer.length()
+		 << " staged_len=" << staged_len
 		 << dendl;
 }
 
 ceph::bufferlist AES128GCM_OnWireTxHandler::authenticated_encrypt_final()
 {
+  flush_staged();
+
   int final_len = 0;
   ceph_assert(buffer.get_append_buffer_unused_tail_length() ==
               AESGCM_BLOCK_LEN);
@@ -295,11 +361,17 @@ ceph::crypto::onwire::rxtx_t ceph::crypto::onwire::rxtx_t::create_handler_pair(
       secbuf += sizeof(tx_nonce);
     }
 
+    // crimson has no CephContext here, fall back to the option's default
+    const std::size_t coalesce_size = cct ?
+      cct->_conf.get_val<Option::size_t>("ms_crypto_tx_coalesce_size") :
+      DEFAULT_TX_COALESCE_SIZE;
+
     return {
       std::make_unique<AES128GCM_OnWireRxHandler>(
 	cct, key, crossed ? tx_nonce : rx_nonce, new_nonce_format),
       std::make_unique<AES128GCM_OnWireTxHandler>(
-	cct, key, crossed ? rx_nonce : tx_nonce, new_nonce_format)
+	cct, key, crossed ? rx_nonce : tx_nonce, new_nonce_format,
+	coalesce_size)
     };
   } else {
     return { nullptr, nullptr };
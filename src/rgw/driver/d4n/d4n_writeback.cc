@@ -0,0 +1,582 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "d4n_writeback.h"
+
+#include <fcntl.h>
+#include <algorithm>
+#include <unistd.h>
+#include <filesystem>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "common/async/completion.h"
+#include "common/errno.h"
+#include "rgw_sal.h"
+#include "driver/d4n/d4n_directory.h"
+
+#define dout_subsys ceph_subsys_rgw
+#define dout_context g_ceph_context
+
+namespace efs = std::filesystem;
+
+namespace rgw { namespace d4n {
+
+static constexpr auto min_flush_backoff = std::chrono::milliseconds(1);
+static constexpr auto max_flush_backoff = std::chrono::milliseconds(50);
+static constexpr auto min_retry_delay = std::chrono::milliseconds(100);
+
+WritebackJournal::WritebackJournal(std::string _path) : path(std::move(_path))
+{
+  if (path.empty() || path.back() != '/') {
+    path.push_back('/');
+  }
+}
+
+int WritebackJournal::init(const DoutPrefixProvider* dpp)
+{
+  std::error_code ec;
+  efs::create_directories(path, ec);
+  if (ec) {
+    ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to create "
+		      << path << ": " << ec.message() << dendl;
+    return -ec.value();
+  }
+  return 0;
+}
+
+std::string WritebackJournal::get_id(const rgw_bucket& bucket, const rgw_obj_key& key)
+{
+  return calc_hash_sha256(bucket.get_key() + "/" + key.get_oid()).to_str();
+}
+
+static std::string tmp_name(const std::string& id, uint64_t gen)
+{
+  return "." + id + "." + std::to_string(gen);
+}
+
+int WritebackJournal::prepare(const DoutPrefixProvider* dpp, const std::string& id,
+			      uint64_t gen, const WritebackRecord& record)
+{
+  const std::string tmp = path + tmp_name(id, gen);
+  bufferlist bl;
+  encode(record, bl);
+
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    int r = -errno;
+    ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to open "
+		      << tmp << ": " << cpp_strerror(-r) << dendl;
+    return r;
+  }
+  int r = bl.write_fd(fd);
+  if (r >= 0 && ::fsync(fd) < 0) {
+    r = -errno;
+  }
+  ::close(fd);
+  if (r < 0) {
+    ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to write "
+		      << tmp << ": " << cpp_strerror(-r) << dendl;
+    ::unlink(tmp.c_str());
+    return r;
+  }
+  return 0;
+}
+
+int WritebackJournal::commit(const DoutPrefixProvider* dpp, const std::string& id, uint64_t gen)
+{
+  const std::string tmp = path + tmp_name(id, gen);
+  if (::rename(tmp.c_str(), (path + id).c_str()) < 0) {
+    int r = -errno;
+    ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to rename "
+		      << tmp << ": " << cpp_strerror(-r) << dendl;
+    ::unlink(tmp.c_str());
+    return r;
+  }
+  return 0;
+}
+
+void WritebackJournal::abort(const DoutPrefixProvider* dpp, const std::string& id, uint64_t gen)
+{
+  const std::string tmp = path + tmp_name(id, gen);
+  if (::unlink(tmp.c_str()) < 0) {
+    ldpp_dout(dpp, 10) << "WritebackJournal::" << __func__ << "(): failed to remove "
+		       << tmp << ": " << cpp_strerror(errno) << dendl;
+  }
+}
+
+int WritebackJournal::remove(const DoutPrefixProvider* dpp, const std::string& id)
+{
+  if (::unlink((path + id).c_str()) < 0 && errno != ENOENT) {
+    int r = -errno;
+    ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to remove "
+		      << path << id << ": " << cpp_strerror(-r) << dendl;
+    return r;
+  }
+  return 0;
+}
+
+int WritebackJournal::sync_dir(const DoutPrefixProvider* dpp)
+{
+  int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    int r = -errno;
+    ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to open "
+		      << path << ": " << cpp_strerror(-r) << dendl;
+    return r;
+  }
+  int r = 0;
+  if (::fsync(fd) < 0) {
+    r = -errno;
+    ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to sync "
+		      << path << ": " << cpp_strerror(-r) << dendl;
+  }
+  ::close(fd);
+  return r;
+}
+
+int WritebackJournal::load(const DoutPrefixProvider* dpp,
+			   std::map<std::string, WritebackRecord>& records)
+{
+  std::error_code ec;
+  for (const auto& entry : efs::directory_iterator(path, ec)) {
+    const std::string name = entry.path().filename().string();
+    if (name.starts_with(".")) {
+      /* never committed, so never acknowledged */
+      ::unlink(entry.path().c_str());
+      continue;
+    }
+    bufferlist bl;
+    std::string err;
+    int r = bl.read_file(entry.path().c_str(), &err);
+    if (r < 0) {
+      ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to read "
+			<< entry.path() << ": " << err << dendl;
+      continue;
+    }
+    WritebackRecord record;
+    try {
+      auto p = bl.cbegin();
+      decode(record, p);
+    } catch (const buffer::error& e) {
+      ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to decode "
+			<< entry.path() << ": " << e.what() << dendl;
+      continue;
+    }
+    records.emplace(name, std::move(record));
+  }
+  if (ec) {
+    ldpp_dout(dpp, 0) << "ERROR: WritebackJournal::" << __func__ << "(): failed to list "
+		      << path << ": " << ec.message() << dendl;
+    return -ec.value();
+  }
+  return 0;
+}
+
+Writeback::Writeback(CephContext* _cct, rgw::sal::Driver* _next, ObjectDirectory* _dir) :
+  Writeback(_cct, _next, _dir, std::make_unique<WritebackJournal>(
+	      _cct->_conf.get_val<std::string>("rgw_d4n_writeback_journal_path")))
+{
+}
+
+Writeback::Writeback(CephContext* _cct, rgw::sal::Driver* _next, ObjectDirectory* _dir,
+		     std::unique_ptr<WritebackJournal> _journal) :
+  cct(_cct),
+  next(_next),
+  dir(_dir),
+  journal(std::move(_journal)),
+  max_object_size(cct->_conf.get_val<Option::size_t>("rgw_d4n_writeback_max_object_size")),
+  max_dirty_bytes(cct->_conf->rgw_d4n_l1_datacache_size *
+		  cct->_conf.get_val<double>("rgw_d4n_writeback_max_dirty_ratio")),
+  num_flushers(std::max<uint64_t>(1, cct->_conf.get_val<uint64_t>("rgw_d4n_writeback_flush_threads"))),
+  max_retry_delay(cct->_conf.get_val<std::chrono::seconds>("rgw_d4n_writeback_max_retry_interval")),
+  journal_pool(std::max<uint64_t>(1, cct->_conf.get_val<uint64_t>("rgw_d4n_writeback_journal_threads")))
+{
+}
+
+Writeback::~Writeback()
+{
+  stop();
+  /* the suspended add() calls resume once their journal I/O is done */
+  journal_pool.join();
+}
+
+int Writeback::init(const DoutPrefixProvider* dpp)
+{
+  int r = journal->init(dpp);
+  if (r < 0) {
+    return r;
+  }
+
+  std::map<std::string, WritebackRecord> records;
+  r = journal->load(dpp, records);
+  if (r < 0) {
+    return r;
+  }
+  if (!records.empty()) {
+    ldpp_dout(dpp, 1) << "Writeback::" << __func__ << "(): writing back " << records.size()
+		      << " objects left dirty" << dendl;
+  }
+
+  std::lock_guard l{lock};
+  for (auto& [id, record] : records) {
+    auto& e = dirty[id];
+    e.gen = ++last_gen;
+    dirty_bytes += record.data.length();
+    e.record = std::make_shared<const WritebackRecord>(std::move(record));
+    queue.push_back(id);
+  }
+  for (uint64_t i = 0; i < num_flushers; ++i) {
+    flushers.emplace_back(&Writeback::flusher, this);
+  }
+  return 0;
+}
+
+void Writeback::stop()
+{
+  {
+    std::lock_guard l{lock};
+    stopping = true;
+  }
+  cond.notify_all();
+  for (auto& t : flushers) {
+    t.join();
+  }
+  flushers.clear();
+}
+
+int Writeback::add(const DoutPrefixProvider* dpp, WritebackRecord&& record, optional_yield y)
+{
+  if (!y) {
+    return add_sync(dpp, std::move(record));
+  }
+
+  /* The record is written and synced to the journal, which would block the
+   * other requests of the frontend thread for as long. */
+  using Completion = ceph::async::Completion<void(boost::system::error_code, int)>;
+  auto yield = y.get_yield_context();
+  boost::system::error_code ec;
+  return boost::asio::async_initiate<decltype(yield[ec]),
+				     void(boost::system::error_code, int)>(
+      [this, dpp, &record, &yield] (auto handler) {
+	auto c = Completion::create(yield.get_executor(), std::move(handler));
+	boost::asio::post(journal_pool, [this, dpp, &record, c = std::move(c)] () mutable {
+	    int r = add_sync(dpp, std::move(record));
+	    ceph::async::post(std::move(c), boost::system::error_code{}, r);
+	  });
+      }, yield[ec]);
+}
+
+int Writeback::add_sync(const DoutPrefixProvider* dpp, WritebackRecord&& record)
+{
+  const std::string id = WritebackJournal::get_id(record.bucket, record.key);
+  const uint64_t size = record.data.length();
+  uint64_t gen;
+  {
+    std::lock_guard l{lock};
+    if (stopping || dirty_bytes + size > max_dirty_bytes) {
+      return -ENOSPC;
+    }
+    dirty_bytes += size;
+    gen = ++last_gen;
+    ++adding[id].count;
+  }
+
+  /* the data is written and synced without the lock */
+  int r = journal->prepare(dpp, id, gen, record);
+
+  std::unique_lock l{lock};
+  auto a = adding.find(id);
+  /* A later PUT of the object may have been acknowledged first, and even
+   * written back already, which leaves no entry to compare gens with. */
+  const bool stale = r == 0 && a->second.gen > gen;
+  if (r == 0 && !stale) {
+    r = journal->commit(dpp, id, gen);
+    if (r == 0) {
+      a->second.gen = gen;
+    }
+  }
+  if (--a->second.count == 0) {
+    adding.erase(a);
+  }
+  if (r < 0 || stale) {
+    if (stale) {
+      journal->abort(dpp, id, gen);
+    }
+    dirty_bytes -= size;
+    return r;
+  }
+  auto [i, inserted] = dirty.try_emplace(id);
+  auto& e = i->second;
+  if (!inserted) {
+    /* still queued, or requeued once the running flush sees the new gen */
+    dirty_bytes -= e.record->data.length();
+  } else {
+    queue.push_back(id);
+  }
+  e.record = std::make_shared<const WritebackRecord>(std::move(record));
+  e.gen = gen;
+  l.unlock();
+
+  if (inserted) {
+    cond.notify_one();
+  }
+  return journal->sync(dpp);
+}
+
+int Writeback::flush(const DoutPrefixProvider* dpp, const rgw_bucket& bucket,
+		     const rgw_obj_key& key, optional_yield y)
+{
+  const std::string id = WritebackJournal::get_id(bucket, key);
+  {
+    std::unique_lock l{lock};
+    if (dirty.contains(id)) {
+      return flush_locked(dpp, l, id, y);
+    }
+  }
+  return check_owner(dpp, bucket, key, y);
+}
+
+std::shared_ptr<const WritebackRecord> Writeback::get_dirty(const rgw_bucket& bucket,
+							   const rgw_obj_key& key)
+{
+  const std::string id = WritebackJournal::get_id(bucket, key);
+  std::lock_guard l{lock};
+  auto i = dirty.find(id);
+  if (i == dirty.end()) {
+    return nullptr;
+  }
+  return i->second.record;
+}
+
+int Writeback::check_owner(const DoutPrefixProvider* dpp, const rgw_bucket& bucket,
+			   const rgw_obj_key& key, optional_yield y)
+{
+  if (!dir) {
+    return 0;
+  }
+
+  /* Another gateway may have acknowledged a PUT of the object that it has not
+   * written back yet. Its write back would land after whatever this request
+   * does, and the backing store does not have the data to read. */
+  CacheObj object = CacheObj{
+    .objName = key.get_oid(),
+    .bucketName = bucket.name
+  };
+  int r = dir->get(&object, y);
+  if (r < 0) {
+    if (r != -ENOENT) {
+      ldpp_dout(dpp, 10) << "Writeback::" << __func__ << "(): ObjectDirectory get method failed: "
+			 << cpp_strerror(-r) << dendl;
+    }
+    return 0;
+  }
+  /* the flag is set before the record is journaled here, so a PUT of this
+   * gateway may not have made it dirty yet */
+  if (object.dirty && !object.hostsList.empty() &&
+      object.hostsList.front() != cct->_conf->rgw_d4n_l1_datacache_address) {
+    ldpp_dout(dpp, 10) << "Writeback::" << __func__ << "(): " << bucket << "/" << key
+		       << " is dirty on " << object.hostsList.front() << dendl;
+    return -EBUSY;
+  }
+  return 0;
+}
+
+int Writeback::wait_flushed(std::unique_lock<std::mutex>& l, ceph::timespan& backoff,
+			    optional_yield y)
+{
+  if (!y) {
+    flushed.wait(l);
+    return 0;
+  }
+  /* The flushers run outside of the frontend, so there is no handler to
+   * complete; poll for the end of the flush without blocking the thread. */
+  l.unlock();
+  auto& yield = y.get_yield_context();
+  boost::asio::steady_timer timer{yield.get_executor(), backoff};
+  boost::system::error_code ec;
+  timer.async_wait(yield[ec]);
+  backoff = std::min<ceph::timespan>(backoff * 2, max_flush_backoff);
+  l.lock();
+  return -ec.value();
+}
+
+int Writeback::flush_locked(const DoutPrefixProvider* dpp, std::unique_lock<std::mutex>& l,
+			    const std::string& id, optional_yield y)
+{
+  ceph::timespan backoff = min_flush_backoff;
+  auto i = dirty.find(id);
+  while (i != dirty.end() && i->second.flushing) {
+    int r = wait_flushed(l, backoff, y);
+    if (r < 0) {
+      return r;
+    }
+    i = dirty.find(id);
+  }
+  if (i == dirty.end()) {
+    return 0;
+  }
+
+  /* only the flush that set flushing erases the entry */
+  i->second.flushing = true;
+  auto record = i->second.record;
+  const uint64_t gen = i->second.gen;
+  l.unlock();
+
+  int r = write_back(dpp, *record, y);
+
+  l.lock();
+  i = dirty.find(id);
+  i->second.flushing = false;
+  bool clean = false;
+  if (i->second.gen != gen) {
+    /* overwritten while it was written back, the new record starts its
+     * backoff over */
+    i->second.failures = 0;
+    queue.push_back(id);
+    cond.notify_one();
+  } else if (r < 0 && r != -ENOENT && r != -ERR_NO_SUCH_BUCKET) {
+    /* The PUT was acknowledged, so the record stays until it is written back
+     * however long the backing store fails. The flushers retry it with a
+     * backoff, while the bound on dirty bytes holds the new PUTs back. */
+    const auto delay = std::min<ceph::timespan>(
+      min_retry_delay * (1ull << std::min(i->second.failures, 16u)), max_retry_delay);
+    ++i->second.failures;
+    ldpp_dout(dpp, 1) << "Writeback::" << __func__ << "(): failed to write back "
+		      << record->bucket << "/" << record->key << " " << i->second.failures
+		      << " times, retrying in " << delay << ": " << cpp_strerror(-r) << dendl;
+    retries.emplace(ceph::mono_clock::now() + delay, id);
+    cond.notify_one();
+  } else {
+    if (r < 0) {
+      ldpp_dout(dpp, 0) << "ERROR: Writeback::" << __func__ << "(): dropping "
+			<< record->bucket << "/" << record->key
+			<< ", its bucket is gone: " << cpp_strerror(-r) << dendl;
+    }
+    if (journal->remove(dpp, id) < 0) {
+      ldpp_dout(dpp, 0) << "ERROR: Writeback::" << __func__ << "(): the record of "
+			<< record->bucket << "/" << record->key
+			<< " will be written back again on restart" << dendl;
+    }
+    dirty_bytes -= record->data.length();
+    dirty.erase(i);
+    clean = true;
+  }
+  flushed.notify_all();
+  if (!clean) {
+    return r;
+  }
+
+  l.unlock();
+  journal->sync(dpp);
+  mark_clean(dpp, *record, y);
+  l.lock();
+  return r;
+}
+
+void Writeback::mark_clean(const DoutPrefixProvider* dpp, const WritebackRecord& record,
+			   optional_yield y)
+{
+  CacheObj object = CacheObj{
+    .objName = record.key.get_oid(),
+    .bucketName = record.bucket.name
+  };
+  if (dir && dir->update_field(&object, "dirty", "0", y) < 0) {
+    ldpp_dout(dpp, 10) << "Writeback::" << __func__ << "(): ObjectDirectory update_field method failed." << dendl;
+  }
+}
+
+int Writeback::write_back(const DoutPrefixProvider* dpp, const WritebackRecord& record,
+			  optional_yield y)
+{
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+  int r = next->load_bucket(dpp, record.bucket, &bucket, y);
+  if (r < 0) {
+    ldpp_dout(dpp, 0) << "ERROR: Writeback::" << __func__ << "(): failed to load bucket "
+		      << record.bucket << ": " << cpp_strerror(-r) << dendl;
+    return r;
+  }
+  std::unique_ptr<rgw::sal::Object> obj = bucket->get_object(record.key);
+  const rgw_placement_rule* ptail_placement_rule =
+    record.tail_placement ? &*record.tail_placement : nullptr;
+  std::unique_ptr<rgw::sal::Writer> writer =
+    next->get_atomic_writer(dpp, y, obj.get(), record.owner,
+			    ptail_placement_rule, record.olh_epoch, record.unique_tag);
+
+  r = writer->prepare(y);
+  if (r < 0) {
+    return r;
+  }
+  bufferlist data = record.data;
+  r = writer->process(std::move(data), 0);
+  if (r < 0) {
+    return r;
+  }
+  r = writer->process({}, record.data.length());
+  if (r < 0) {
+    return r;
+  }
+
+  ceph::real_time mtime;
+  std::map<std::string, bufferlist> attrs = record.attrs;
+  bool canceled = false;
+  const req_context rctx{dpp, y, nullptr};
+  r = writer->complete(record.accounted_size, record.etag, &mtime, record.mtime,
+		       attrs, record.cksum, record.delete_at, nullptr, nullptr,
+		       nullptr, nullptr, &canceled, rctx, record.flags);
+  if (r < 0) {
+    ldpp_dout(dpp, 0) << "ERROR: Writeback::" << __func__ << "(): failed to write "
+		      << record.bucket << "/" << record.key << ": " << cpp_strerror(-r) << dendl;
+    return r;
+  }
+  if (canceled) {
+    ldpp_dout(dpp, 10) << "Writeback::" << __func__ << "(): write of " << record.bucket
+		       << "/" << record.key << " lost to a racing write" << dendl;
+  }
+  return 0;
+}
+
+void Writeback::flusher()
+{
+  DoutPrefix dp(cct, dout_subsys, "d4n writeback: ");
+  std::unique_lock l{lock};
+  for (;;) {
+    if (stopping) {
+      /* what is still dirty is written back on the next start */
+      break;
+    }
+    const auto now = ceph::mono_clock::now();
+    while (!retries.empty() && retries.begin()->first <= now) {
+      queue.push_back(std::move(retries.begin()->second));
+      retries.erase(retries.begin());
+    }
+    if (queue.empty()) {
+      if (retries.empty()) {
+	cond.wait(l);
+      } else {
+	cond.wait_until(l, retries.begin()->first);
+      }
+      continue;
+    }
+    std::string id = std::move(queue.front());
+    queue.pop_front();
+    auto i = dirty.find(id);
+    if (i == dirty.end() || i->second.flushing) {
+      continue;
+    }
+    /* a failure is retried from retries */
+    flush_locked(&dp, l, id, null_yield);
+  }
+}
+
+} } // namespace rgw::d4n
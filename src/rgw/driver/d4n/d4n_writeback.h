@@ -0,0 +1,224 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/thread_pool.hpp>
+
+#include "rgw_acl.h"
+#include "rgw_cksum.h"
+#include "rgw_common.h"
+#include "rgw_sal_fwd.h"
+
+namespace rgw { namespace d4n {
+
+class ObjectDirectory;
+
+/* What a PUT completed in write-back mode keeps to write the object to the
+ * backing store later, as the request would have. */
+struct WritebackRecord {
+  rgw_bucket bucket;
+  rgw_obj_key key;
+  ACLOwner owner;
+  std::optional<rgw_placement_rule> tail_placement;
+  uint64_t olh_epoch = 0;
+  std::string unique_tag;
+  uint64_t accounted_size = 0;
+  std::string etag;
+  ceph::real_time mtime;
+  ceph::real_time delete_at;
+  std::optional<rgw::cksum::Cksum> cksum;
+  std::map<std::string, bufferlist> attrs;
+  uint32_t flags = 0;
+  bufferlist data;
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(bucket, bl);
+    encode(key, bl);
+    encode(owner, bl);
+    encode(tail_placement, bl);
+    encode(olh_epoch, bl);
+    encode(unique_tag, bl);
+    encode(accounted_size, bl);
+    encode(etag, bl);
+    encode(mtime, bl);
+    encode(delete_at, bl);
+    encode(cksum, bl);
+    encode(attrs, bl);
+    encode(flags, bl);
+    encode(data, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(bucket, bl);
+    decode(key, bl);
+    decode(owner, bl);
+    decode(tail_placement, bl);
+    decode(olh_epoch, bl);
+    decode(unique_tag, bl);
+    decode(accounted_size, bl);
+    decode(etag, bl);
+    decode(mtime, bl);
+    decode(delete_at, bl);
+    decode(cksum, bl);
+    decode(attrs, bl);
+    decode(flags, bl);
+    decode(data, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(WritebackRecord)
+
+/* Keeps the record of each dirty object in a file of its own, written to a
+ * temporary file and renamed over the previous record once synced, so that
+ * a restart finds the last record acknowledged for each object. */
+class WritebackJournal {
+  private:
+    std::string path;
+
+    int sync_dir(const DoutPrefixProvider* dpp);
+
+  public:
+    explicit WritebackJournal(std::string path);
+    virtual ~WritebackJournal() = default;
+
+    int init(const DoutPrefixProvider* dpp);
+
+    /* The name of the record of an object. */
+    static std::string get_id(const rgw_bucket& bucket, const rgw_obj_key& key);
+
+    /* Write and sync the record to a temporary file. */
+    virtual int prepare(const DoutPrefixProvider* dpp, const std::string& id, uint64_t gen,
+			const WritebackRecord& record);
+    /* Replace the record of the object by the prepared one; sync() makes the
+     * change durable. */
+    int commit(const DoutPrefixProvider* dpp, const std::string& id, uint64_t gen);
+    void abort(const DoutPrefixProvider* dpp, const std::string& id, uint64_t gen);
+    int remove(const DoutPrefixProvider* dpp, const std::string& id);
+    int sync(const DoutPrefixProvider* dpp) { return sync_dir(dpp); }
+
+    /* Read all the records, dropping the ones left prepared. */
+    int load(const DoutPrefixProvider* dpp, std::map<std::string, WritebackRecord>& records);
+};
+
+/* Acknowledges the small PUTs once their object is journaled locally, and
+ * writes the objects to the backing store from a pool of flusher threads.
+ * The reads of a dirty object are served from its record; it is written back
+ * before it is overwritten through the backing store or deleted. Without an
+ * object directory, the dirty objects are only known to this gateway, and
+ * the reads through another gateway see the backing store until the write
+ * back in any case. */
+class Writeback {
+  private:
+    struct Entry {
+      std::shared_ptr<const WritebackRecord> record;
+      uint64_t gen = 0;
+      bool flushing = false;
+      unsigned failures = 0; // of the write backs of this gen, for the backoff
+    };
+
+    CephContext* const cct;
+    rgw::sal::Driver* const next;
+    ObjectDirectory* const dir;
+    const std::unique_ptr<WritebackJournal> journal;
+    const uint64_t max_object_size;
+    const uint64_t max_dirty_bytes;
+    const uint64_t num_flushers;
+    const ceph::timespan max_retry_delay;
+
+    std::mutex lock;
+    std::condition_variable cond; // for the flushers
+    std::condition_variable flushed; // for the threads waiting on a flush without a yield
+    std::map<std::string, Entry> dirty;
+    struct Adding {
+      unsigned count = 0; // of the add() calls journaling the object
+      uint64_t gen = 0; // of the last record they committed
+    };
+    std::map<std::string, Adding> adding;
+    std::deque<std::string> queue;
+    /* the objects whose write back failed, by the time to retry them */
+    std::multimap<ceph::mono_time, std::string> retries;
+    uint64_t dirty_bytes = 0;
+    uint64_t last_gen = 0;
+    bool stopping = false;
+    std::vector<std::thread> flushers;
+    /* runs the journal I/O of the add() calls from a coroutine */
+    boost::asio::thread_pool journal_pool;
+
+    void flusher();
+    int add_sync(const DoutPrefixProvider* dpp, WritebackRecord&& record);
+    /* Write back the dirty object id, with lock held on entry and exit. */
+    int flush_locked(const DoutPrefixProvider* dpp, std::unique_lock<std::mutex>& l,
+		     const std::string& id, optional_yield y);
+    /* Wait for the running flush of an object, with lock held on entry and exit. */
+    int wait_flushed(std::unique_lock<std::mutex>& l, ceph::timespan& backoff, optional_yield y);
+    void mark_clean(const DoutPrefixProvider* dpp, const WritebackRecord& record, optional_yield y);
+
+  protected:
+    /* Write the object to the backing store through the next driver. */
+    virtual int write_back(const DoutPrefixProvider* dpp, const WritebackRecord& record,
+			   optional_yield y);
+
+  public:
+    Writeback(CephContext* cct, rgw::sal::Driver* next, ObjectDirectory* dir);
+    Writeback(CephContext* cct, rgw::sal::Driver* next, ObjectDirectory* dir,
+	      std::unique_ptr<WritebackJournal> journal);
+    virtual ~Writeback();
+
+    /* Queue the records left by a previous run and start the flushers. */
+    int init(const DoutPrefixProvider* dpp);
+    /* Stop the flushers; the objects still dirty stay in the journal. */
+    void stop();
+
+    uint64_t get_max_object_size() const { return max_object_size; }
+    uint64_t get_dirty_bytes() {
+      std::lock_guard l{lock};
+      return dirty_bytes;
+    }
+
+    /* Journal the record and queue its write back; returns -ENOSPC if it
+     * would pass the bound on dirty bytes, in which case the PUT must be
+     * written through. With a yield, the journal is written on the threads
+     * of rgw_d4n_writeback_journal_threads while the coroutine is suspended. */
+    int add(const DoutPrefixProvider* dpp, WritebackRecord&& record, optional_yield y);
+    /* Write back the object now if it is dirty. An object stays dirty while its
+     * write back fails, unless its bucket is gone, in which case it is dropped.
+     * Returns -EBUSY if the object directory has the object dirty on another
+     * gateway, until that one writes it back. */
+    int flush(const DoutPrefixProvider* dpp, const rgw_bucket& bucket, const rgw_obj_key& key,
+	      optional_yield y);
+    /* The record of the object if it is dirty here, null otherwise. It stays
+     * valid once the object is written back. */
+    std::shared_ptr<const WritebackRecord> get_dirty(const rgw_bucket& bucket,
+						     const rgw_obj_key& key);
+    /* Returns -EBUSY if the object is dirty on another gateway. The requests
+     * on an object that is not dirty here call it before they read or write
+     * the backing store. */
+    int check_owner(const DoutPrefixProvider* dpp, const rgw_bucket& bucket,
+		    const rgw_obj_key& key, optional_yield y);
+};
+
+} } // namespace rgw::d4n
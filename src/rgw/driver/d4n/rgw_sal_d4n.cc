@@ -14,6 +14,7 @@
  */
 
 #include "rgw_sal_d4n.h"
+#include "common/errno.h"
 
 namespace rgw { namespace sal {
 
@@ -33,6 +34,41 @@ static inline Object* nextObject(Object* t)
   return dynamic_cast<FilterObject*>(t)->get_next();
 }
 
+/* The preconditions of a read of a dirty object, checked against its record
+ * as RGWRados::Object::Read::prepare() does against the object state. */
+static int check_dirty_conditions(const DoutPrefixProvider* dpp,
+				  const Object::ReadOp::Params& params,
+				  const rgw::d4n::WritebackRecord& record)
+{
+  auto weight = [&params] (ceph::real_time t) {
+    return params.high_precision_time ? t :
+      ceph::real_clock::from_time_t(ceph::real_clock::to_time_t(t));
+  };
+
+  if (params.mod_ptr && !params.if_nomatch &&
+      !(weight(*params.mod_ptr) < weight(record.mtime))) {
+    return -ERR_NOT_MODIFIED;
+  }
+  if (params.unmod_ptr && !params.if_match &&
+      weight(*params.unmod_ptr) < weight(record.mtime)) {
+    return -ERR_PRECONDITION_FAILED;
+  }
+  if (params.if_match &&
+      rgw_string_unquote(params.if_match).compare(0, record.etag.length(), record.etag) != 0) {
+    return -ERR_PRECONDITION_FAILED;
+  }
+  if (params.if_nomatch &&
+      rgw_string_unquote(params.if_nomatch).compare(0, record.etag.length(), record.etag) == 0) {
+    return -ERR_NOT_MODIFIED;
+  }
+  if (params.lastmod) {
+    *params.lastmod = record.mtime;
+  }
+  ldpp_dout(dpp, 20) << "D4NFilterObject::D4NFilterReadOp::" << __func__ << "(): reading "
+		     << record.bucket << "/" << record.key << " from its write-back record" << dendl;
+  return 0;
+}
+
 D4NFilterDriver::D4NFilterDriver(Driver* _next, boost::asio::io_context& io_context) : FilterDriver(_next),
                                                                                        io_context(io_context) 
 {
@@ -52,6 +88,9 @@ D4NFilterDriver::D4NFilterDriver(Driver* _next, boost::asio::io_context& io_cont
 
 D4NFilterDriver::~D4NFilterDriver()
 {
+  /* the flushers use the connection */
+  writeback.reset();
+
   // call cancel() on the connection's executor
   boost::asio::dispatch(conn->get_executor(), [c = conn] { c->cancel(); });
 
@@ -86,6 +125,17 @@ int D4NFilterDriver::initialize(CephContext *cct, const DoutPrefixProvider *dpp)
   blockDir->init(cct);
   policyDriver->get_cache_policy()->init(cct, dpp, io_context);
 
+  if (cct->_conf.get_val<bool>("rgw_d4n_writeback_enabled")) {
+    writeback = std::make_unique<rgw::d4n::Writeback>(cct, next, objDir);
+    int ret = writeback->init(dpp);
+    if (ret < 0) {
+      ldpp_dout(dpp, 0) << "ERROR: D4NFilterDriver::" << __func__ << "(): Writeback init method failed: "
+			<< cpp_strerror(-ret) << dendl;
+      writeback.reset();
+      return ret;
+    }
+  }
+
   return 0;
 }
 
@@ -110,9 +160,63 @@ int D4NFilterBucket::create(const DoutPrefixProvider* dpp,
   return next->create(dpp, params, y);
 }
 
+int D4NFilterObject::write_back(const DoutPrefixProvider* dpp, optional_yield y)
+{
+  rgw::d4n::Writeback* writeback = driver->get_writeback();
+  if (!writeback || !get_bucket())
+    return 0;
+
+  return writeback->flush(dpp, get_bucket()->get_key(), get_key(), y);
+}
+
+int D4NFilterObject::check_owner(const DoutPrefixProvider* dpp, optional_yield y)
+{
+  rgw::d4n::Writeback* writeback = driver->get_writeback();
+  if (!writeback || !get_bucket())
+    return 0;
+
+  return writeback->check_owner(dpp, get_bucket()->get_key(), get_key(), y);
+}
+
+std::shared_ptr<const rgw::d4n::WritebackRecord> D4NFilterObject::load_dirty()
+{
+  rgw::d4n::Writeback* writeback = driver->get_writeback();
+  if (!writeback || !get_bucket())
+    return nullptr;
+
+  auto record = writeback->get_dirty(get_bucket()->get_key(), get_key());
+  if (!record)
+    return nullptr;
+
+  /* the backing store does not have the object yet */
+  ceph::real_time mtime = record->mtime;
+  set_mtime(mtime);
+  set_obj_size(record->data.length());
+  set_accounted_size(record->accounted_size);
+  set_attrs(record->attrs);
+  return record;
+}
+
+int D4NFilterObject::load_obj_state(const DoutPrefixProvider* dpp, optional_yield y,
+                                    bool follow_olh)
+{
+  if (load_dirty())
+    return 0;
+
+  int ret = check_owner(dpp, y);
+  if (ret < 0)
+    return ret;
+
+  return next->load_obj_state(dpp, y, follow_olh);
+}
+
 int D4NFilterObject::set_obj_attrs(const DoutPrefixProvider* dpp, Attrs* setattrs,
                             Attrs* delattrs, optional_yield y, uint32_t flags)
 {
+  int ret = write_back(dpp, y);
+  if (ret < 0)
+    return ret;
+
   if (setattrs != NULL) {
     /* Ensure setattrs and delattrs do not overlap */
     if (delattrs != NULL) {
@@ -148,6 +252,13 @@ int D4NFilterObject::set_obj_attrs(const DoutPrefixProvider* dpp, Attrs* setattr
 int D4NFilterObject::get_obj_attrs(optional_yield y, const DoutPrefixProvider* dpp,
                                 rgw_obj* target_obj)
 {
+  if (load_dirty())
+    return 0;
+
+  int ret = check_owner(dpp, y);
+  if (ret < 0)
+    return ret;
+
   rgw::sal::Attrs attrs;
 
   if (driver->get_cache_driver()->get_attrs(dpp, this->get_key().get_oid(), attrs, y) < 0) {
@@ -208,6 +319,10 @@ int D4NFilterObject::get_obj_attrs(optional_yield y, const DoutPrefixProvider* d
 int D4NFilterObject::modify_obj_attrs(const char* attr_name, bufferlist& attr_val,
                                optional_yield y, const DoutPrefixProvider* dpp) 
 {
+  int ret = write_back(dpp, y);
+  if (ret < 0)
+    return ret;
+
   Attrs update;
   update[(std::string)attr_name] = attr_val;
 
@@ -220,6 +335,10 @@ int D4NFilterObject::modify_obj_attrs(const char* attr_name, bufferlist& attr_va
 int D4NFilterObject::delete_obj_attrs(const DoutPrefixProvider* dpp, const char* attr_name,
                                optional_yield y)
 {
+  int ret = write_back(dpp, y);
+  if (ret < 0)
+    return ret;
+
   buffer::list bl;
   Attrs delattr;
   delattr.insert({attr_name, bl});
@@ -257,7 +376,12 @@ std::unique_ptr<Writer> D4NFilterDriver::get_atomic_writer(const DoutPrefixProvi
 							   owner, ptail_placement_rule,
 							   olh_epoch, unique_tag);
 
-  return std::make_unique<D4NFilterWriter>(std::move(writer), this, obj, dpp, true, y);
+  auto d4n_writer = std::make_unique<D4NFilterWriter>(std::move(writer), this, obj, dpp, true, y);
+  /* the PUTs to versioned buckets are written through */
+  if (writeback && obj->get_bucket() && !obj->get_bucket()->versioned())
+    d4n_writer->set_writeback(owner, ptail_placement_rule, olh_epoch, unique_tag);
+
+  return d4n_writer;
 }
 
 std::unique_ptr<Object::ReadOp> D4NFilterObject::get_read_op()
@@ -274,6 +398,14 @@ std::unique_ptr<Object::DeleteOp> D4NFilterObject::get_delete_op()
 
 int D4NFilterObject::D4NFilterReadOp::prepare(optional_yield y, const DoutPrefixProvider* dpp)
 {
+  dirty = source->load_dirty();
+  if (dirty)
+    return check_dirty_conditions(dpp, params, *dirty);
+
+  int ret = source->check_owner(dpp, y);
+  if (ret < 0)
+    return ret;
+
   next->params.mod_ptr = params.mod_ptr;
   next->params.unmod_ptr = params.unmod_ptr;
   next->params.high_precision_time = params.high_precision_time;
@@ -282,7 +414,7 @@ int D4NFilterObject::D4NFilterReadOp::prepare(optional_yield y, const DoutPrefix
   next->params.if_match = params.if_match;
   next->params.if_nomatch = params.if_nomatch;
   next->params.lastmod = params.lastmod;
-  int ret = next->prepare(y, dpp);
+  ret = next->prepare(y, dpp);
 
   rgw::sal::Attrs attrs;
 
@@ -417,9 +549,38 @@ int D4NFilterObject::D4NFilterReadOp::flush(const DoutPrefixProvider* dpp, rgw::
   return 0;
 }
 
+int D4NFilterObject::D4NFilterReadOp::read(int64_t ofs, int64_t end, bufferlist& bl,
+                        optional_yield y, const DoutPrefixProvider* dpp)
+{
+  if (!dirty)
+    return next->read(ofs, end, bl, y, dpp);
+
+  bl.substr_of(dirty->data, ofs, end - ofs + 1);
+  return bl.length();
+}
+
+int D4NFilterObject::D4NFilterReadOp::get_attr(const DoutPrefixProvider* dpp, const char* name,
+                        bufferlist& dest, optional_yield y)
+{
+  if (!dirty)
+    return next->get_attr(dpp, name, dest, y);
+
+  auto attr = dirty->attrs.find(name);
+  if (attr == dirty->attrs.end())
+    return -ENODATA;
+  dest = attr->second;
+  return 0;
+}
+
 int D4NFilterObject::D4NFilterReadOp::iterate(const DoutPrefixProvider* dpp, int64_t ofs, int64_t end,
                         RGWGetDataCB* cb, optional_yield y) 
 {
+  if (dirty) {
+    bufferlist bl;
+    bl.substr_of(dirty->data, ofs, end - ofs + 1);
+    return cb->handle_data(bl, 0, bl.length());
+  }
+
   const uint64_t window_size = g_conf()->rgw_get_obj_window_size;
   std::string version = source->get_object_version();
   std::string prefix;
@@ -762,6 +923,10 @@ int D4NFilterObject::D4NFilterReadOp::D4NFilterGetCB::handle_data(bufferlist& bl
 int D4NFilterObject::D4NFilterDeleteOp::delete_obj(const DoutPrefixProvider* dpp,
                                                    optional_yield y, uint32_t flags)
 {
+  int ret = source->write_back(dpp, y);
+  if (ret < 0)
+    return ret;
+
   rgw::d4n::CacheObj obj = rgw::d4n::CacheObj{ // TODO: Add logic to ObjectDirectory del method to also delete all blocks belonging to that object
 			     .objName = source->get_key().get_oid(),
 			     .bucketName = source->get_bucket()->get_name()
@@ -785,8 +950,41 @@ int D4NFilterObject::D4NFilterDeleteOp::delete_obj(const DoutPrefixProvider* dpp
   return next->delete_obj(dpp, y, flags);
 }
 
+void D4NFilterWriter::set_writeback(const ACLOwner& owner, const rgw_placement_rule *ptail_placement_rule,
+				    uint64_t olh_epoch, const std::string& unique_tag)
+{
+  this->buffering = true;
+  this->owner = owner;
+  if (ptail_placement_rule)
+    this->tail_placement = *ptail_placement_rule;
+  this->olh_epoch = olh_epoch;
+  this->unique_tag = unique_tag;
+}
+
+int D4NFilterWriter::write_through()
+{
+  buffering = false;
+
+  /* an older write back of the object must not land after this PUT */
+  int ret = driver->get_writeback()->flush(save_dpp, obj->get_bucket()->get_key(), obj->get_key(), y);
+  if (ret < 0)
+    return ret;
+
+  if (buffered.length() == 0)
+    return 0;
+
+  return next->process(std::move(buffered), 0);
+}
+
 int D4NFilterWriter::prepare(optional_yield y) 
 {
+  /* a buffering writer flushes the object if it ends up written through */
+  if (!buffering && driver->get_writeback() && obj->get_bucket()) {
+    int ret = driver->get_writeback()->flush(save_dpp, obj->get_bucket()->get_key(), obj->get_key(), y);
+    if (ret < 0)
+      return ret;
+  }
+
   if (driver->get_cache_driver()->delete_data(save_dpp, obj->get_key().get_oid(), y) < 0) 
     ldpp_dout(save_dpp, 10) << "D4NFilterWriter::" << __func__ << "(): CacheDriver delete_data method failed." << dendl;
 
@@ -805,9 +1003,81 @@ int D4NFilterWriter::process(bufferlist&& data, uint64_t offset)
     ldpp_dout(save_dpp, 20) << "D4N Filter: Cache append data operation succeeded." << dendl;
   }*/
 
+  if (buffering) {
+    if (buffered.length() + data.length() <= driver->get_writeback()->get_max_object_size()) {
+      buffered.claim_append(data);
+      return 0;
+    }
+
+    /* Too large for write-back */
+    int ret = write_through();
+    if (ret < 0)
+      return ret;
+  }
+
   return next->process(std::move(data), offset);
 }
 
+int D4NFilterWriter::complete_dirty(size_t accounted_size, const std::string& etag,
+                       ceph::real_time *mtime, ceph::real_time set_mtime,
+                       std::map<std::string, bufferlist>& attrs,
+		       const std::optional<rgw::cksum::Cksum>& cksum,
+                       ceph::real_time delete_at, bool *canceled,
+                       const req_context& rctx, uint32_t flags)
+{
+  /* the write through that follows fails as well while another gateway has it dirty */
+  int ret = driver->get_writeback()->check_owner(save_dpp, obj->get_bucket()->get_key(), obj->get_key(), rctx.y);
+  if (ret < 0)
+    return ret;
+
+  const ceph::real_time now = ceph::real_clock::is_zero(set_mtime) ? ceph::real_clock::now() : set_mtime;
+
+  /* Marked dirty first, so that a flush racing with add() leaves it clean */
+  rgw::d4n::CacheObj object = rgw::d4n::CacheObj{
+				 .objName = obj->get_key().get_oid(),
+				 .bucketName = obj->get_bucket()->get_name(),
+				 .creationTime = to_iso_8601(now),
+				 .dirty = true,
+				 .hostsList = { g_conf()->rgw_d4n_l1_datacache_address }
+                               };
+
+  if (driver->get_obj_dir()->set(&object, rctx.y) < 0)
+    ldpp_dout(save_dpp, 10) << "D4NFilterWriter::" << __func__ << "(): ObjectDirectory set method failed." << dendl;
+
+  rgw::d4n::WritebackRecord record;
+  record.bucket = obj->get_bucket()->get_key();
+  record.key = obj->get_key();
+  record.owner = owner;
+  record.tail_placement = tail_placement;
+  record.olh_epoch = olh_epoch;
+  record.unique_tag = unique_tag;
+  record.accounted_size = accounted_size;
+  record.etag = etag;
+  record.mtime = now;
+  record.delete_at = delete_at;
+  record.cksum = cksum;
+  record.attrs = attrs;
+  record.flags = flags;
+  record.data = buffered;
+
+  ret = driver->get_writeback()->add(save_dpp, std::move(record), rctx.y);
+  if (ret < 0) {
+    ldpp_dout(save_dpp, 10) << "D4NFilterWriter::" << __func__ << "(): Writeback add method failed, writing through: "
+			    << cpp_strerror(-ret) << dendl;
+    /* the other gateways would wait for a write back that never comes */
+    if (driver->get_obj_dir()->update_field(&object, "dirty", "0", rctx.y) < 0)
+      ldpp_dout(save_dpp, 10) << "D4NFilterWriter::" << __func__ << "(): ObjectDirectory update_field method failed." << dendl;
+    return ret;
+  }
+
+  if (mtime)
+    *mtime = now;
+  if (canceled)
+    *canceled = false;
+
+  return 0;
+}
+
 int D4NFilterWriter::complete(size_t accounted_size, const std::string& etag,
                        ceph::real_time *mtime, ceph::real_time set_mtime,
                        std::map<std::string, bufferlist>& attrs,
@@ -819,6 +1089,22 @@ int D4NFilterWriter::complete(size_t accounted_size, const std::string& etag,
                        const req_context& rctx,
                        uint32_t flags)
 {
+  if (buffering) {
+    /* Conditional PUTs are checked against the backing store */
+    if (!if_match && !if_nomatch &&
+	complete_dirty(accounted_size, etag, mtime, set_mtime, attrs, cksum,
+		       delete_at, canceled, rctx, flags) == 0)
+      return 0;
+
+    const uint64_t len = buffered.length();
+    int ret = write_through();
+    if (ret < 0)
+      return ret;
+    ret = next->process({}, len);
+    if (ret < 0)
+      return ret;
+  }
+
   rgw::d4n::CacheObj object = rgw::d4n::CacheObj{
 				 .objName = obj->get_key().get_oid(), 
 				 .bucketName = obj->get_bucket()->get_name(),
@@ -25,6 +25,7 @@
 
 #include "driver/d4n/d4n_directory.h"
 #include "driver/d4n/d4n_policy.h"
+#include "driver/d4n/d4n_writeback.h"
 
 #include <boost/intrusive/list.hpp>
 #include <boost/asio/io_context.hpp>
@@ -46,6 +47,7 @@ class D4NFilterDriver : public FilterDriver {
     rgw::d4n::ObjectDirectory* objDir;
     rgw::d4n::BlockDirectory* blockDir;
     rgw::d4n::PolicyDriver* policyDriver;
+    std::unique_ptr<rgw::d4n::Writeback> writeback;
     boost::asio::io_context& io_context;
 
   public:
@@ -68,6 +70,8 @@ class D4NFilterDriver : public FilterDriver {
     rgw::d4n::ObjectDirectory* get_obj_dir() { return objDir; }
     rgw::d4n::BlockDirectory* get_block_dir() { return blockDir; }
     rgw::d4n::PolicyDriver* get_policy_driver() { return policyDriver; }
+    /* null unless rgw_d4n_writeback_enabled */
+    rgw::d4n::Writeback* get_writeback() { return writeback.get(); }
 };
 
 class D4NFilterUser : public FilterUser {
@@ -143,10 +147,16 @@ class D4NFilterObject : public FilterObject {
 	virtual ~D4NFilterReadOp() = default;
 
 	virtual int prepare(optional_yield y, const DoutPrefixProvider* dpp) override;
+	virtual int read(int64_t ofs, int64_t end, bufferlist& bl, optional_yield y,
+	  const DoutPrefixProvider* dpp) override;
 	virtual int iterate(const DoutPrefixProvider* dpp, int64_t ofs, int64_t end,
 	  RGWGetDataCB* cb, optional_yield y) override;
+	virtual int get_attr(const DoutPrefixProvider* dpp, const char* name,
+	  bufferlist& dest, optional_yield y) override;
 
       private:
+	/* set by prepare() if the object is dirty here, to be read from its record */
+	std::shared_ptr<const rgw::d4n::WritebackRecord> dirty;
 	RGWGetDataCB* client_cb;
 	std::unique_ptr<D4NFilterGetCB> cb;
         std::unique_ptr<rgw::Aio> aio;
@@ -186,6 +196,8 @@ class D4NFilterObject : public FilterObject {
                                optional_yield y, const DoutPrefixProvider* dpp) override;
     virtual int delete_obj_attrs(const DoutPrefixProvider* dpp, const char* attr_name,
                                optional_yield y) override;
+    virtual int load_obj_state(const DoutPrefixProvider* dpp, optional_yield y,
+                               bool follow_olh = true) override;
     virtual ceph::real_time get_mtime(void) const override { return next->get_mtime(); };
 
     virtual std::unique_ptr<ReadOp> get_read_op() override;
@@ -196,6 +208,15 @@ class D4NFilterObject : public FilterObject {
 
     void set_prefix(const std::string& prefix) { this->prefix = prefix; }
     const std::string get_prefix() { return this->prefix; }
+
+    /* Write the object to the backing store if it is dirty in the cache. */
+    int write_back(const DoutPrefixProvider* dpp, optional_yield y);
+    /* The record of the object if it is dirty in the cache of this gateway,
+     * with the state of the object set from it. */
+    std::shared_ptr<const rgw::d4n::WritebackRecord> load_dirty();
+    /* Returns -EBUSY while the object is dirty on another gateway, whose
+     * backing store copy is stale. */
+    int check_owner(const DoutPrefixProvider* dpp, optional_yield y);
 };
 
 class D4NFilterWriter : public FilterWriter {
@@ -204,6 +225,21 @@ class D4NFilterWriter : public FilterWriter {
     const DoutPrefixProvider* save_dpp;
     bool atomic;
     optional_yield y;
+    /* set by set_writeback(), for a PUT that may complete in write-back mode */
+    bool buffering = false;
+    bufferlist buffered;
+    ACLOwner owner;
+    std::optional<rgw_placement_rule> tail_placement;
+    uint64_t olh_epoch = 0;
+    std::string unique_tag;
+
+    int complete_dirty(size_t accounted_size, const std::string& etag,
+		       ceph::real_time *mtime, ceph::real_time set_mtime,
+		       std::map<std::string, bufferlist>& attrs,
+		       const std::optional<rgw::cksum::Cksum>& cksum,
+		       ceph::real_time delete_at, bool *canceled,
+		       const req_context& rctx, uint32_t flags);
+    int write_through();
 
   public:
     D4NFilterWriter(std::unique_ptr<Writer> _next, D4NFilterDriver* _driver, Object* _obj, 
@@ -228,6 +264,8 @@ class D4NFilterWriter : public FilterWriter {
 			 rgw_zone_set *zones_trace, bool *canceled,
 			 const req_context& rctx,
 			 uint32_t flags) override;
+   void set_writeback(const ACLOwner& owner, const rgw_placement_rule *ptail_placement_rule,
+		      uint64_t olh_epoch, const std::string& unique_tag);
    bool is_atomic() { return atomic; };
    const DoutPrefixProvider* dpp() { return save_dpp; } 
 };
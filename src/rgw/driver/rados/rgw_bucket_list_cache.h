@@ -0,0 +1,157 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "cls/rgw/cls_rgw_ops.h"
+
+namespace rgw::bucket_list {
+
+// identifies the ordered listings a page can be continued by
+struct Key {
+  std::string bucket;  // bucket instance key
+  uint64_t gen = 0;    // index layout generation
+  int shard_id = -1;
+  std::string prefix;
+  std::string delimiter;
+  bool list_versions = false;
+
+  auto operator<=>(const Key&) const = default;
+};
+
+// an index entry read from a shard, with the position the merge of the
+// shards consumed it at
+struct ShardEntry {
+  static constexpr uint32_t UNMERGED = std::numeric_limits<uint32_t>::max();
+
+  uint32_t pos = UNMERGED;
+  std::string name;
+  rgw_bucket_dir_entry entry;
+};
+
+struct Shard {
+  // all the entries read from the shard in index order
+  std::vector<ShardEntry> entries;
+  bool is_truncated = false;
+  bool cls_filtered = true;
+};
+
+// what an ordered listing read from the bucket index shards, so that the
+// following page can resume the merge without reading them again
+struct Page {
+  // the keys a following page may start after, and their merge position
+  std::map<cls_rgw_obj_key, uint32_t> markers;
+  // shard id -> entries
+  std::map<int, Shard> shards;
+};
+
+// a bounded cache of the pages recently returned by ordered listings,
+// found by the marker of the page following them; a page is handed out
+// at most once, and is dropped once it is older than the given ttl
+class Cache {
+  struct Item {
+    Key key;
+    ceph::coarse_mono_time stamp;
+    Page page;
+  };
+  using lru_t = std::list<Item>;
+
+  ceph::mutex mutex = ceph::make_mutex("rgw::bucket_list::Cache");
+  lru_t lru; // most recently inserted first
+  std::multimap<Key, lru_t::iterator> index;
+
+  void erase(lru_t::iterator i) {
+    auto range = index.equal_range(i->key);
+    for (auto j = range.first; j != range.second; ++j) {
+      if (j->second == i) {
+	index.erase(j);
+	break;
+      }
+    }
+    lru.erase(i);
+  }
+
+ public:
+  void insert(Key key, Page&& page, size_t max_size) {
+    const auto now = ceph::coarse_mono_clock::now();
+    std::lock_guard l{mutex};
+    lru.push_front(Item{key, now, std::move(page)});
+    index.emplace(std::move(key), lru.begin());
+    while (lru.size() > max_size) {
+      erase(std::prev(lru.end()));
+    }
+  }
+
+  // if a page of the listing identified by key contains marker, fill
+  // results with what each shard read after it, and forget the page
+  bool take(const Key& key, const cls_rgw_obj_key& marker,
+	    ceph::timespan ttl,
+	    std::map<int, rgw_cls_list_ret>& results) {
+    const auto now = ceph::coarse_mono_clock::now();
+    Page page;
+    {
+      std::lock_guard l{mutex};
+      // drop the expired pages from the tail of the lru first
+      while (!lru.empty() && lru.back().stamp + ttl < now) {
+	erase(std::prev(lru.end()));
+      }
+      auto range = index.equal_range(key);
+      auto found = range.second;
+      for (auto i = range.first; i != range.second; ++i) {
+	if (i->second->page.markers.count(marker)) {
+	  found = i;
+	  break;
+	}
+      }
+      if (found == range.second) {
+	return false;
+      }
+      auto item = found->second;
+      index.erase(found);
+      page = std::move(item->page);
+      lru.erase(item);
+    }
+
+    const uint32_t pos = page.markers[marker];
+    for (auto& [shard_id, shard] : page.shards) {
+      auto& result = results[shard_id];
+      result.is_truncated = shard.is_truncated;
+      result.cls_filtered = shard.cls_filtered;
+      auto& m = result.dir.m;
+      auto i = std::partition_point(
+	shard.entries.begin(), shard.entries.end(),
+	[pos] (const ShardEntry& e) { return e.pos <= pos; });
+      m.reserve(std::distance(i, shard.entries.end()));
+      for (; i != shard.entries.end(); ++i) {
+	m.emplace_hint(m.end(), std::move(i->name), std::move(i->entry));
+      }
+    }
+    return true;
+  }
+
+  size_t size() {
+    std::lock_guard l{mutex};
+    return lru.size();
+  }
+};
+
+} // namespace rgw::bucket_list
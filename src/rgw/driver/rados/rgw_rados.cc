@@ -52,6 +52,7 @@
 #include "rgw_worker.h"
 #include "rgw_notify.h"
 #include "rgw_http_errors.h"
+#include "rgw_perf_counters.h"
 
 #undef fork // fails to compile RGWPeriod::fork() below
 
@@ -61,8 +62,10 @@
 #include <iostream>
 #include <vector>
 #include <atomic>
+#include <condition_variable>
 #include <list>
 #include <map>
+#include <thread>
 #include "include/random.h"
 
 #include "rgw_gc.h"
@@ -767,6 +770,7 @@ struct complete_op_data {
   string tag;
   rgw_bucket_entry_ver ver;
   cls_rgw_obj_key key;
+  string locator;
   rgw_bucket_dir_entry_meta dir_meta;
   list<cls_rgw_obj_key> remove_objs;
   bool log_op;
@@ -781,6 +785,13 @@ struct complete_op_data {
   }
 };
 
+// the complete ops waiting to be sent together to an index shard
+struct complete_op_batch {
+  rgw_rados_ref ref;
+  std::vector<complete_op_data*> ops;
+  std::chrono::steady_clock::time_point deadline;
+};
+
 class RGWIndexCompletionManager {
   RGWRados* const store;
   const uint32_t num_shards;
@@ -798,11 +809,34 @@ class RGWIndexCompletionManager {
   // around back to 0 without issue
   std::atomic<uint32_t> cur_shard {0};
 
+  // the complete ops of the same index shard arriving within
+  // batch_window of the first one are sent to it together
+  const std::chrono::microseconds batch_window;
+  const size_t batch_max;
+  // cleared once an osd turns out not to support the batches
+  std::atomic<bool> batch_supported{true};
+  std::mutex batch_lock;
+  std::condition_variable batch_cond;
+  bool batch_stop{false};
+  std::map<rgw_raw_obj, std::unique_ptr<complete_op_batch>> batches;
+  std::thread batch_thread;
+
   void process();
+  void process_batches();
+  void send_batch(std::unique_ptr<complete_op_batch> batch);
   
   void add_completion(complete_op_data *completion);
   
   void stop() {
+    if (batch_thread.joinable()) {
+      {
+        std::lock_guard l{batch_lock};
+        batch_stop = true;
+      }
+      batch_cond.notify_all();
+      batch_thread.join();
+    }
+
     if (retry_thread.joinable()) {
       _stop = true;
       cond.notify_all();
@@ -833,8 +867,17 @@ public:
 				std::to_string(i));
       })},
     completions(num_shards),
-    retry_thread(&RGWIndexCompletionManager::process, this)
-    {}
+    retry_thread(&RGWIndexCompletionManager::process, this),
+    batch_window(store->ctx()->_conf.get_val<uint64_t>(
+      "rgw_bucket_index_complete_batch_window")),
+    batch_max(store->ctx()->_conf.get_val<uint64_t>(
+      "rgw_bucket_index_complete_batch_max"))
+    {
+      if (batch_window.count() > 0) {
+        batch_thread = std::thread(&RGWIndexCompletionManager::process_batches,
+                                   this);
+      }
+    }
 
   ~RGWIndexCompletionManager() {
     stop();
@@ -848,31 +891,75 @@ public:
                          list<cls_rgw_obj_key> *remove_objs, bool log_op,
                          uint16_t bilog_op,
                          rgw_zone_set *zones_trace,
+                         const std::string& locator,
+                         bool batched,
                          complete_op_data **result);
 
-  bool handle_completion(completion_t cb, complete_op_data *arg);
+  bool handle_completion(int r, complete_op_data *arg);
+
+  bool batching() const {
+    return batch_thread.joinable() && batch_supported;
+  }
+  // queue a completion created as batched for the index shard at ref
+  void add_batched(const rgw_rados_ref& ref, complete_op_data *completion);
+  void disable_batching(const rgw_raw_obj& obj);
 
   CephContext* ctx() {
     return store->ctx();
   }
 };
 
-static void obj_complete_cb(completion_t cb, void *arg)
+static void complete_op_done(complete_op_data *completion, int r)
 {
-  complete_op_data *completion = reinterpret_cast<complete_op_data*>(arg);
   completion->lock.lock();
   if (completion->stopped) {
     completion->lock.unlock(); /* can drop lock, no one else is referencing us */
     delete completion;
     return;
   }
-  bool need_delete = completion->manager->handle_completion(cb, completion);
+  bool need_delete = completion->manager->handle_completion(r, completion);
   completion->lock.unlock();
   if (need_delete) {
     delete completion;
   }
 }
 
+static void obj_complete_cb(completion_t cb, void *arg)
+{
+  complete_op_data *completion = reinterpret_cast<complete_op_data*>(arg);
+  complete_op_done(completion, rados_aio_get_return_value(cb));
+}
+
+static void complete_batch_done(complete_op_batch *batch, int r)
+{
+  std::unique_ptr<complete_op_batch> up{batch};
+  if (r == -EOPNOTSUPP) {
+    // an osd that does not know about the batches; the ops are retried
+    // one by one
+    auto c = batch->ops.front();
+    std::lock_guard l{c->lock};
+    if (!c->stopped) {
+      c->manager->disable_batching(batch->ref.obj);
+    }
+    r = -ERR_BUSY_RESHARDING;
+  } else if (r < 0) {
+    // the ops that fail on their own are skipped by the osd, so this is
+    // the shard failing the whole batch, e.g. removed by a reshard that
+    // completed while the batch was pending. none of the ops was applied;
+    // the retry completes each one alone, with a result of its own
+    r = -ERR_BUSY_RESHARDING;
+  }
+  for (auto c : batch->ops) {
+    complete_op_done(c, r);
+  }
+}
+
+static void obj_complete_batch_cb(completion_t cb, void *arg)
+{
+  auto batch = reinterpret_cast<complete_op_batch*>(arg);
+  complete_batch_done(batch, rados_aio_get_return_value(cb));
+}
+
 void RGWIndexCompletionManager::process()
 {
   DoutPrefix dpp(store->ctx(), dout_subsys, "rgw index completion thread: ");
@@ -917,7 +1004,7 @@ void RGWIndexCompletionManager::process()
 			       o.assert_exists();
 			       cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
 			       cls_rgw_bucket_complete_op(o, c->op, c->tag, c->ver, c->key, c->dir_meta, &c->remove_objs,
-							  c->log_op, c->bilog_op, &c->zones_trace);
+							  c->log_op, c->bilog_op, &c->zones_trace, c->locator);
 			       int ret = bs->bucket_obj.operate(&dpp, &o, null_yield);
 			       ldout_bitx(bitx, &dpp, 10) <<
 				 "EXITING " << __func__ << ": ret=" << dendl_bitx;
@@ -946,6 +1033,8 @@ void RGWIndexCompletionManager::create_completion(const rgw_obj& obj,
                                                   list<cls_rgw_obj_key> *remove_objs, bool log_op,
                                                   uint16_t bilog_op,
                                                   rgw_zone_set *zones_trace,
+                                                  const std::string& locator,
+                                                  bool batched,
                                                   complete_op_data **result)
 {
   complete_op_data *entry = new complete_op_data;
@@ -959,6 +1048,7 @@ void RGWIndexCompletionManager::create_completion(const rgw_obj& obj,
   entry->tag = tag;
   entry->ver = ver;
   entry->key = key;
+  entry->locator = locator;
   entry->dir_meta = dir_meta;
   entry->log_op = log_op;
   entry->bilog_op = bilog_op;
@@ -977,7 +1067,9 @@ void RGWIndexCompletionManager::create_completion(const rgw_obj& obj,
 
   *result = entry;
 
-  entry->rados_completion = librados::Rados::aio_create_completion(entry, obj_complete_cb);
+  if (!batched) {
+    entry->rados_completion = librados::Rados::aio_create_completion(entry, obj_complete_cb);
+  }
 
   std::lock_guard l{locks[shard_id]};
   const auto ok = completions[shard_id].insert(entry).second;
@@ -992,7 +1084,7 @@ void RGWIndexCompletionManager::add_completion(complete_op_data *completion) {
   cond.notify_all();
 }
 
-bool RGWIndexCompletionManager::handle_completion(completion_t cb, complete_op_data *arg)
+bool RGWIndexCompletionManager::handle_completion(int r, complete_op_data *arg)
 {
   int shard_id = arg->manager_shard_id;
   {
@@ -1009,7 +1101,6 @@ bool RGWIndexCompletionManager::handle_completion(completion_t cb, complete_op_d
     comps.erase(iter);
   }
 
-  int r = rados_aio_get_return_value(cb);
   if (r != -ERR_BUSY_RESHARDING) {
     ldout(arg->manager->ctx(), 20) << __func__ << "(): completion " << 
       (r == 0 ? "ok" : "failed with " + to_string(r)) << 
@@ -1021,6 +1112,120 @@ bool RGWIndexCompletionManager::handle_completion(completion_t cb, complete_op_d
   return false;
 }
 
+void RGWIndexCompletionManager::add_batched(const rgw_rados_ref& ref,
+                                            complete_op_data *completion)
+{
+  std::unique_ptr<complete_op_batch> full;
+  {
+    std::lock_guard l{batch_lock};
+    auto& batch = batches[ref.obj];
+    if (!batch) {
+      batch = std::make_unique<complete_op_batch>();
+      batch->ref = ref;
+      batch->deadline = std::chrono::steady_clock::now() + batch_window;
+      batch_cond.notify_one();
+    }
+    batch->ops.push_back(completion);
+    if (batch->ops.size() >= batch_max) {
+      full = std::move(batch);
+      batches.erase(ref.obj);
+    }
+  }
+  if (full) {
+    send_batch(std::move(full));
+  }
+}
+
+void RGWIndexCompletionManager::process_batches()
+{
+  std::unique_lock l{batch_lock};
+  while (!batch_stop) {
+    if (batches.empty()) {
+      batch_cond.wait(l);
+      continue;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    auto next = std::chrono::steady_clock::time_point::max();
+    std::vector<std::unique_ptr<complete_op_batch>> due;
+    for (auto i = batches.begin(); i != batches.end();) {
+      if (i->second->deadline <= now) {
+        due.push_back(std::move(i->second));
+        i = batches.erase(i);
+      } else {
+        next = std::min(next, i->second->deadline);
+        ++i;
+      }
+    }
+    if (due.empty()) {
+      batch_cond.wait_until(l, next);
+      continue;
+    }
+    l.unlock();
+    for (auto& batch : due) {
+      send_batch(std::move(batch));
+    }
+    l.lock();
+  }
+  // send what is left before stopping
+  auto left = std::move(batches);
+  batches.clear();
+  l.unlock();
+  for (auto& [obj, batch] : left) {
+    send_batch(std::move(batch));
+  }
+}
+
+void RGWIndexCompletionManager::send_batch(std::unique_ptr<complete_op_batch> batch)
+{
+  std::vector<rgw_cls_obj_complete_op> ops;
+  ops.reserve(batch->ops.size());
+  for (auto c : batch->ops) {
+    rgw_cls_obj_complete_op call;
+    call.op = c->op;
+    call.tag = c->tag;
+    call.key = c->key;
+    call.ver = c->ver;
+    call.locator = c->locator;
+    call.meta = c->dir_meta;
+    call.log_op = c->log_op;
+    call.bilog_flags = c->bilog_op;
+    call.remove_objs = c->remove_objs;
+    call.zones_trace = c->zones_trace;
+    ops.push_back(std::move(call));
+  }
+
+  librados::ObjectWriteOperation o;
+  o.assert_exists(); // bucket index shard must exist
+  cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
+  cls_rgw_bucket_complete_ops(o, ops);
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_index_complete_batch);
+    perfcounter->inc(l_rgw_index_complete_batch_ops, ops.size());
+  }
+  ldout(ctx(), 20) << __func__ << "(): sending " << ops.size() <<
+    " complete ops to " << batch->ref.obj << dendl;
+
+  auto ref = batch->ref;
+  librados::AioCompletion *completion =
+    librados::Rados::aio_create_completion(batch.get(), obj_complete_batch_cb);
+  int r = ref.aio_operate(completion, &o);
+  completion->release();
+  if (r < 0) {
+    complete_batch_done(batch.release(), r);
+  } else {
+    // released by obj_complete_batch_cb()
+    batch.release();
+  }
+}
+
+void RGWIndexCompletionManager::disable_batching(const rgw_raw_obj& obj)
+{
+  if (batch_supported.exchange(false)) {
+    ldout(ctx(), 0) << "WARNING: " << __func__ << "(): " << obj <<
+      " does not support batched complete ops, sending them one by one" << dendl;
+  }
+}
+
 void RGWRados::finalize()
 {
   /* Before joining any sync threads, drain outstanding requests &
@@ -7249,11 +7454,29 @@ int RGWRados::Object::Read::read(int64_t ofs, int64_t end,
   return bl.length();
 }
 
+ceph::timespan get_obj_data::hedge_delay() const {
+  if (hedge_ratio <= 0) {
+    return ceph::timespan::zero();
+  }
+  ceph::timespan delay = hedge_min_delay;
+  if (window) {
+    const auto latency = window->get_latency();
+    delay = std::max(delay, std::chrono::duration_cast<ceph::timespan>(
+                                latency * hedge_ratio));
+  }
+  return delay;
+}
+
 int get_obj_data::flush(rgw::AioResultList&& results) {
   int r = rgw::check_for_errors(results);
   if (r < 0) {
     return r;
   }
+  if (window) {
+    for (const auto& result : results) {
+      window->add_read(result.latency);
+    }
+  }
   std::list<bufferlist> bl_list;
 
   auto cmp = [](const auto& lhs, const auto& rhs) { return lhs.id < rhs.id; };
@@ -7265,10 +7488,14 @@ int get_obj_data::flush(rgw::AioResultList&& results) {
 
     bl_list.push_back(bl);
     offset += bl.length();
+    const auto start = ceph::mono_clock::now();
     int r = client_cb->handle_data(bl, 0, bl.length());
     if (r < 0) {
       return r;
     }
+    if (window) {
+      window->add_client(bl.length(), ceph::mono_clock::now() - start);
+    }
 
     if (rgwrados->get_use_datacache()) {
       const std::lock_guard l(d3n_get_data.d3n_lock);
@@ -7338,14 +7565,31 @@ int RGWRados::get_obj_iterate_cb(const DoutPrefixProvider *dpp,
   }
 
   ldpp_dout(dpp, 20) << "rados->get_obj_iterate_cb oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
-  op.read(read_ofs, len, nullptr, nullptr);
 
   const uint64_t cost = len;
   const uint64_t id = obj_ofs; // use logical object offset for sorting replies
 
-  auto completed = d->aio->get(obj.obj, rgw::Aio::librados_op(obj.ioctx, std::move(op), d->yield), cost, id);
+  rgw::Aio::OpFunc read;
+  auto hedge_after = d->hedge_delay();
+  bool requires_alignment = false;
+  if (hedge_after != ceph::timespan::zero() &&
+      obj.ioctx.pool_requires_alignment2(&requires_alignment) == 0 &&
+      !requires_alignment && !is_head_obj) {
+    // the objecter sends the balanced reads of erasure coded pools, which
+    // require alignment without overwrites, to the primary anyway
+    read = rgw::Aio::librados_hedged_read(obj.ioctx, read_ofs, len, d->yield,
+                                          hedge_after);
+  } else {
+    op.read(read_ofs, len, nullptr, nullptr);
+    read = rgw::Aio::librados_op(obj.ioctx, std::move(op), d->yield);
+  }
 
-  return d->flush(std::move(completed));
+  auto completed = d->aio->get(obj.obj, std::move(read), cost, id);
+  int ret = d->flush(std::move(completed));
+  if (d->window) {
+    d->aio->set_window(d->window->get());
+  }
+  return ret;
 }
 
 int RGWRados::Object::Read::iterate(const DoutPrefixProvider *dpp, int64_t ofs, int64_t end, RGWGetDataCB *cb,
@@ -7358,6 +7602,15 @@ int RGWRados::Object::Read::iterate(const DoutPrefixProvider *dpp, int64_t ofs,
 
   auto aio = rgw::make_throttle(window_size, y);
   get_obj_data data(store, cb, &*aio, ofs, y);
+  // a max_window_size of no more than window_size leaves the window fixed,
+  // while the latency of the reads still times their hedges
+  data.window.emplace(window_size,
+      cct->_conf.get_val<Option::size_t>("rgw_get_obj_max_window_size"));
+  if (cct->_conf.get_val<bool>("rgw_get_obj_hedge_reads")) {
+    data.hedge_ratio = cct->_conf.get_val<double>("rgw_get_obj_hedge_latency_ratio");
+    data.hedge_min_delay =
+      cct->_conf.get_val<std::chrono::milliseconds>("rgw_get_obj_hedge_min_delay");
+  }
 
   int r = store->iterate_obj(dpp, source->get_ctx(), source->get_bucket_info(), state.obj,
                              ofs, end, chunk_size, _get_obj_iterate_cb, &data, y);
@@ -9360,6 +9613,27 @@ int RGWRados::trim_reshard_log_entries(const DoutPrefixProvider *dpp, RGWBucketI
   return CLSRGWIssueReshardLogTrim(index_pool, bucket_objs, cct->_conf->rgw_bucket_index_max_aio)();
 }
 
+int RGWRados::trim_reshard_log_entries(const DoutPrefixProvider *dpp,
+                                       const RGWBucketInfo& bucket_info,
+                                       int shard_id,
+                                       std::vector<rgw_cls_bi_entry> entries,
+                                       optional_yield y)
+{
+  BucketShard bs(this);
+  int ret = bs.init(dpp, bucket_info,
+		    bucket_info.layout.current_index,
+		    shard_id, y);
+  if (ret < 0) {
+    ldpp_dout(dpp, 5) << "bs.init() returned ret=" << ret << dendl;
+    return ret;
+  }
+
+  librados::ObjectWriteOperation op;
+  op.assert_exists(); // bucket index shard must exist
+  cls_rgw_reshard_log_trim_entries(op, std::move(entries));
+  return bs.bucket_obj.operate(dpp, &op, y);
+}
+
 int RGWRados::gc_operate(const DoutPrefixProvider *dpp, string& oid, librados::ObjectWriteOperation *op, optional_yield y)
 {
   return rgw_rados_operate(dpp, gc_pool_ctx, oid, op, y);
@@ -9439,9 +9713,6 @@ int RGWRados::cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModify
     ", log_op=" << log_op << dendl_bitx;
   ldout_bitx_c(bitx, cct, 25) << "BACKTRACE: " << __func__ << ": " << ClibBackTrace(0) << dendl_bitx;
 
-  ObjectWriteOperation o;
-  o.assert_exists(); // bucket index shard must exist
-
   rgw_bucket_dir_entry_meta dir_meta;
   dir_meta = ent.meta;
   dir_meta.category = category;
@@ -9456,12 +9727,22 @@ int RGWRados::cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModify
   ver.pool = pool;
   ver.epoch = epoch;
   cls_rgw_obj_key key(ent.key.name, ent.key.instance);
+  const bool batched = index_completion_manager->batching();
+  complete_op_data *arg;
+  index_completion_manager->create_completion(obj, op, tag, ver, key, dir_meta, remove_objs,
+                                              log_op, bilog_flags, &zones_trace,
+                                              obj.key.get_loc(), batched, &arg);
+  if (batched) {
+    // the batch is sent asynchronously like the single complete op
+    index_completion_manager->add_batched(bs.bucket_obj, arg);
+    ldout_bitx_c(bitx, cct, 10) << "EXITING " << __func__ << ": batched" << dendl_bitx;
+    return 0;
+  }
+  ObjectWriteOperation o;
+  o.assert_exists(); // bucket index shard must exist
   cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
   cls_rgw_bucket_complete_op(o, op, tag, ver, key, dir_meta, remove_objs,
                              log_op, bilog_flags, &zones_trace, obj.key.get_loc());
-  complete_op_data *arg;
-  index_completion_manager->create_completion(obj, op, tag, ver, key, dir_meta, remove_objs,
-                                              log_op, bilog_flags, &zones_trace, &arg);
   librados::AioCompletion *completion = arg->rados_completion;
   int ret = bs.bucket_obj.aio_operate(arg->rados_completion, &o);
   completion->release(); /* can't reference arg here, as it might have already been released */
@@ -9647,17 +9928,48 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     num_entries << " total entries" << dendl;
 
   auto& ioctx = index_pool;
+  const uint32_t max_aio = cct->_conf->rgw_bucket_index_max_aio;
+
+  // the pages of the listing are cached for the clients paginating
+  // through it, as long as they come back within the ttl
+  const uint64_t cache_size =
+    cct->_conf.get_val<uint64_t>("rgw_bucket_listing_cache_size");
+  const ceph::timespan cache_ttl = std::chrono::seconds(
+    cct->_conf.get_val<uint64_t>("rgw_bucket_listing_cache_ttl"));
+  const bool use_cache = cache_size > 0 && cache_ttl > ceph::timespan::zero();
+  rgw::bucket_list::Key cache_key;
+  if (use_cache) {
+    cache_key = rgw::bucket_list::Key{bucket_info.bucket.get_key(),
+				      idx_layout.gen, shard_id, prefix,
+				      delimiter, list_versions};
+  }
+
   std::map<int, rgw_cls_list_ret> shard_list_results;
   cls_rgw_obj_key start_after_key(start_after.name, start_after.instance);
-  r = CLSRGWIssueBucketList(ioctx, start_after_key, prefix, delimiter,
-			    num_entries_per_shard,
-			    list_versions, shard_oids, shard_list_results,
-			    cct->_conf->rgw_bucket_index_max_aio)();
-  if (r < 0) {
-    ldpp_dout(dpp, 0) << __func__ <<
-      ": CLSRGWIssueBucketList for " << bucket_info.bucket <<
-      " failed" << dendl;
-    return r;
+  bool from_cache = false;
+  if (use_cache && !start_after_key.empty()) {
+    from_cache = bucket_list_cache.take(cache_key, start_after_key, cache_ttl,
+					shard_list_results);
+    if (from_cache && shard_list_results.size() != shard_oids.size()) {
+      // the cached page does not cover the shards we list
+      shard_list_results.clear();
+      from_cache = false;
+    }
+  }
+  if (from_cache) {
+    ldpp_dout(dpp, 20) << __func__ <<
+      ": resuming the listing cached for marker " << start_after_key << dendl;
+  } else {
+    r = CLSRGWIssueBucketList(ioctx, start_after_key, prefix, delimiter,
+			      num_entries_per_shard,
+			      list_versions, shard_oids, shard_list_results,
+			      max_aio)();
+    if (r < 0) {
+      ldpp_dout(dpp, 0) << __func__ <<
+	": CLSRGWIssueBucketList for " << bucket_info.bucket <<
+	" failed" << dendl;
+      return r;
+    }
   }
 
   // to manage the iterators through each shard's list results
@@ -9667,6 +9979,8 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     const std::string& oid_name;
     RGWRados::ent_map_t::iterator cursor;
     RGWRados::ent_map_t::iterator end;
+    // the entries consumed so far, kept only when the listing is cached
+    std::vector<rgw::bucket_list::ShardEntry> consumed;
 
     // manages an iterator through a shard and provides other
     // accessors
@@ -9698,6 +10012,15 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     inline bool at_end() const {
       return cursor == end;
     }
+    inline size_t remaining() const {
+      return end - cursor;
+    }
+    // replace what is left of the shard's results with the next ones
+    void refill(rgw_cls_list_ret&& next) {
+      result = std::move(next);
+      cursor = result.dir.m.begin();
+      end = result.dir.m.end();
+    }
   }; // ShardTracker
 
   // add the next unique candidate, or return false if we reach the end
@@ -9715,14 +10038,64 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
   results_trackers.reserve(shard_list_results.size());
   for (auto& r : shard_list_results) {
     results_trackers.emplace_back(r.first, r.second, shard_oids[r.first]);
+  }
+
+  // read the next entries of the given shards after marker in a single
+  // batch of concurrent requests, rather than restarting the listing of
+  // all the shards from there
+  uint32_t num_refills = 0;
+  auto refill = [&] (const std::vector<size_t>& idxs,
+		     const cls_rgw_obj_key& marker) {
+    std::map<int, std::string> oids;
+    for (auto idx : idxs) {
+      const auto& t = results_trackers.at(idx);
+      oids.emplace(t.shard_idx, t.oid_name);
+    }
+    std::map<int, rgw_cls_list_ret> results;
+    int r = CLSRGWIssueBucketList(ioctx, marker, prefix, delimiter,
+				  num_entries_per_shard, list_versions,
+				  oids, results, max_aio)();
+    if (r < 0) {
+      ldpp_dout(dpp, 0) << __func__ <<
+	": CLSRGWIssueBucketList for " << bucket_info.bucket <<
+	" failed to refill " << idxs.size() << " shard(s)" << dendl;
+      return r;
+    }
+    for (auto idx : idxs) {
+      auto& t = results_trackers.at(idx);
+      t.refill(std::move(results[t.shard_idx]));
+    }
+    ++num_refills;
+    ldpp_dout(dpp, 20) << __func__ << ": refilled " << idxs.size() <<
+      " shard(s) after " << marker << dendl;
+    return 0;
+  };
+
+  if (from_cache) {
+    // the shards whose cached entries all precede the marker
+    std::vector<size_t> exhausted;
+    for (size_t idx = 0; idx < results_trackers.size(); ++idx) {
+      const auto& t = results_trackers[idx];
+      if (t.at_end() && t.is_truncated()) {
+	exhausted.push_back(idx);
+      }
+    }
+    if (!exhausted.empty()) {
+      r = refill(exhausted, start_after_key);
+      if (r < 0) {
+	return r;
+      }
+    }
+  }
 
+  for (const auto& t : results_trackers) {
     // if any *one* shard's result is truncated, the entire result is
     // truncated
-    *is_truncated = *is_truncated || r.second.is_truncated;
+    *is_truncated = *is_truncated || t.is_truncated();
 
     // unless *all* are shards are cls_filtered, the entire result is
     // not filtered
-    *cls_filtered = *cls_filtered && r.second.cls_filtered;
+    *cls_filtered = *cls_filtered && t.result.cls_filtered;
   }
 
   // create a map to track the next candidate entry from ShardTracker
@@ -9741,8 +10114,15 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     ++tracker_idx;
   }
 
-  rgw_bucket_dir_entry*
-    last_entry_visited = nullptr; // to set last_entry (marker)
+  // a shard running lower than this on entries is refilled together
+  // with a shard that ran out, to save a round trip for it later
+  const size_t refill_low_water = num_entries_per_shard / 4;
+
+  // the key of the last entry visited (to set last_entry (marker))
+  std::optional<cls_rgw_obj_key> last_key_visited;
+  // merge position of each entry visited, when the listing is cached
+  std::map<cls_rgw_obj_key, uint32_t> cache_markers;
+  uint32_t pos = 0;
   std::map<std::string, bufferlist> updates;
   uint32_t count = 0;
   while (count < num_entries && !candidates.empty()) {
@@ -9759,6 +10139,24 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     ldpp_dout(dpp, 20) << __func__ << ": currently processing " <<
       dirent.key << " from shard " << tracker.shard_idx << dendl;
 
+    // collect the trackers whose next entry this is
+    vidx.clear();
+    auto range = candidates.equal_range(name);
+    for (auto i = range.first; i != range.second; ++i) {
+      vidx.push_back(i->second);
+    }
+    candidates.erase(range.first, range.second);
+    if (use_cache) {
+      // keep the entries as they were read, before they are checked
+      // and moved into the result
+      for (auto idx : vidx) {
+	auto& t = results_trackers.at(idx);
+	t.consumed.push_back({pos, t.entry_name(), t.dir_entry()});
+      }
+      cache_markers.emplace(dirent.key, pos);
+    }
+    ++pos;
+
     const bool force_check =
       force_check_filter && force_check_filter(dirent.key.name);
 
@@ -9788,6 +10186,7 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     }
 
     const cls_rgw_obj_key dirent_key = dirent.key;
+    last_key_visited = dirent_key;
 
     // at this point either r >= 0 or r == -ENOENT
     if (r >= 0) { // i.e., if r != -ENOENT
@@ -9795,7 +10194,6 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
 	dirent_key << dendl;
 
       auto [it, inserted] = m.insert_or_assign(name, std::move(dirent));
-      last_entry_visited = &it->second;
       if (inserted) {
 	++count;
       } else {
@@ -9806,30 +10204,60 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     } else {
       ldpp_dout(dpp, 10) << __func__ << ": skipping " <<
 	dirent.key.name << "[" << dirent.key.instance << "]" << dendl;
-      last_entry_visited = &tracker.dir_entry();
     }
 
     // refresh the candidates map
-    vidx.clear();
-    bool need_to_stop = false;
-    auto range = candidates.equal_range(name);
-    for (auto i = range.first; i != range.second; ++i) {
-      vidx.push_back(i->second);
-    } 
-    candidates.erase(range.first, range.second);
+    std::vector<size_t> exhausted;
     for (auto idx : vidx) {
       auto& tracker_match = results_trackers.at(idx);
       tracker_match.advance();
       next_candidate(cct, tracker_match, candidates, idx);
       if (tracker_match.at_end() && tracker_match.is_truncated()) {
-        need_to_stop = true;
-        break;
+	exhausted.push_back(idx);
+      }
+    }
+    if (exhausted.empty() || count >= num_entries) {
+      continue;
+    }
+
+    // once we exhaust one shard that is truncated, we cannot be
+    // certain that one of the next entries does not need to come from
+    // that shard, so read its next entries before going on; the other
+    // truncated shards about to run out are read in the same batch
+    std::vector<size_t> to_refill = std::move(exhausted);
+    for (size_t idx = 0; idx < results_trackers.size(); ++idx) {
+      auto& t = results_trackers[idx];
+      if (t.at_end() || !t.is_truncated() ||
+	  t.remaining() >= refill_low_water) {
+	continue;
+      }
+      // everything it has left follows dirent_key, and is read again
+      auto crange = candidates.equal_range(t.entry_name());
+      for (auto i = crange.first; i != crange.second; ++i) {
+	if (i->second == idx) {
+	  candidates.erase(i);
+	  break;
+	}
+      }
+      to_refill.push_back(idx);
+    }
+    r = refill(to_refill, dirent_key);
+    if (r < 0) {
+      return r;
+    }
+
+    bool need_to_stop = false;
+    for (auto idx : to_refill) {
+      auto& t = results_trackers.at(idx);
+      next_candidate(cct, t, candidates, idx);
+      *cls_filtered = *cls_filtered && t.result.cls_filtered;
+      if (t.at_end() && t.is_truncated()) {
+	need_to_stop = true;
       }
     }
     if (need_to_stop) {
-      // once we exhaust one shard that is truncated, we need to stop,
-      // as we cannot be certain that one of the next entries needs to
-      // come from that shard; S3 and swift protocols allow returning
+      // a shard that is still truncated but returned nothing does not
+      // let us make progress; S3 and swift protocols allow returning
       // fewer than what was requested
       ldpp_dout(dpp, 10) << __func__ <<
 	": stopped accumulating results at count=" << count <<
@@ -9867,7 +10295,7 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
 
   ldpp_dout(dpp, 20) << __func__ <<
     ": returning, count=" << count << ", is_truncated=" << *is_truncated <<
-    dendl;
+    ", refills=" << num_refills << dendl;
 
   if (*is_truncated && count < num_entries) {
     ldpp_dout(dpp, 10) << __func__ <<
@@ -9875,8 +10303,8 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       count << ", which is truncated" << dendl;
   }
 
-  if (last_entry_visited != nullptr && last_entry) {
-    *last_entry = last_entry_visited->key;
+  if (last_key_visited && last_entry) {
+    *last_entry = *last_key_visited;
     ldpp_dout(dpp, 20) << __func__ <<
       ": returning, last_entry=" << *last_entry << dendl;
   } else {
@@ -9884,6 +10312,27 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       ": returning, last_entry NOT SET" << dendl;
   }
 
+  if (use_cache && *is_truncated && !cache_markers.empty()) {
+    // keep what the shards read past the entries returned, along with
+    // the entries themselves, as the client may ask for the next page
+    // after any of them
+    rgw::bucket_list::Page page;
+    page.markers = std::move(cache_markers);
+    for (auto& t : results_trackers) {
+      auto& shard = page.shards[t.shard_idx];
+      shard.entries = std::move(t.consumed);
+      shard.entries.reserve(shard.entries.size() + t.remaining());
+      for (; !t.at_end(); t.advance()) {
+	shard.entries.push_back({rgw::bucket_list::ShardEntry::UNMERGED,
+				 t.entry_name(), std::move(t.dir_entry())});
+      }
+      shard.is_truncated = t.is_truncated();
+      shard.cls_filtered = t.result.cls_filtered;
+    }
+    bucket_list_cache.insert(std::move(cache_key), std::move(page),
+			     cache_size);
+  }
+
   ldout_bitx(bitx, dpp, 10) << "EXITING " << __func__ << dendl_bitx;
   return 0;
 } // RGWRados::cls_bucket_list_ordered
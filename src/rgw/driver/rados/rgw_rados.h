@@ -32,6 +32,8 @@
 #include "rgw_service.h"
 #include "rgw_sal_store.h"
 #include "rgw_aio.h"
+#include "rgw_aio_throttle.h"
+#include "rgw_bucket_list_cache.h"
 #include "rgw_d3n_cacherequest.h"
 
 #include "services/svc_bi_rados.h"
@@ -400,6 +402,10 @@ class RGWRados
   // This field represents the number of bucket index object shards
   uint32_t bucket_index_max_shards{0};
 
+  // the pages of the ordered bucket listings recently returned, for the
+  // clients paginating through them
+  rgw::bucket_list::Cache bucket_list_cache;
+
   std::string get_cluster_fsid(const DoutPrefixProvider *dpp, optional_yield y);
 
   int get_obj_head_ref(const DoutPrefixProvider *dpp, const rgw_placement_rule& target_placement_rule, const rgw_obj& obj, rgw_rados_ref *ref);
@@ -1543,6 +1549,11 @@ public:
   int bi_remove(const DoutPrefixProvider *dpp, BucketShard& bs);
 
   int trim_reshard_log_entries(const DoutPrefixProvider *dpp, RGWBucketInfo& bucket_info, optional_yield y);
+  // remove the given entries from the reshard log of a current index shard,
+  // unless they were overwritten since listed
+  int trim_reshard_log_entries(const DoutPrefixProvider *dpp, const RGWBucketInfo& bucket_info,
+                               int shard_id, std::vector<rgw_cls_bi_entry> entries,
+                               optional_yield y);
 
   int cls_obj_usage_log_add(const DoutPrefixProvider *dpp, const std::string& oid, rgw_usage_log_info& info, optional_yield y);
   int cls_obj_usage_log_read(const DoutPrefixProvider *dpp, const std::string& oid, const std::string& user, const std::string& bucket, uint64_t start_epoch,
@@ -1703,10 +1714,19 @@ struct get_obj_data {
   uint64_t offset; // next offset to write to client
   rgw::AioResultList completed; // completed read results, sorted by offset
   optional_yield yield;
+  // sizes aio's window from the latency of the reads and the client's rate
+  std::optional<rgw::AdaptiveWindow> window;
+  // the reads of replicated tail objects slower than hedge_ratio times the
+  // average are hedged, after hedge_min_delay at least
+  double hedge_ratio = 0;
+  ceph::timespan hedge_min_delay = ceph::timespan::zero();
 
   get_obj_data(RGWRados* rgwrados, RGWGetDataCB* cb, rgw::Aio* aio,
                uint64_t offset, optional_yield yield)
                : rgwrados(rgwrados), client_cb(cb), aio(aio), offset(offset), yield(yield) {}
+
+  // the delay before the read of a tail object is hedged, zero for none
+  ceph::timespan hedge_delay() const;
   ~get_obj_data() {
     if (rgwrados->get_use_datacache()) {
       const std::lock_guard l(d3n_get_data.d3n_lock);
@@ -1212,6 +1212,92 @@ int RGWBucketReshard::reshard_process(const rgw::bucket_index_layout_generation&
   return 0;
 }
 
+int RGWBucketReshard::catch_up_reshard_log(const rgw::bucket_index_layout_generation& current,
+                                           int max_op_entries,
+                                           BucketReshardManager& target_shards_mgr,
+                                           uint64_t& copied,
+                                           const DoutPrefixProvider *dpp, optional_yield y)
+{
+  copied = 0;
+  const uint32_t num_source_shards = rgw::num_shards(current.layout.normal);
+  const std::string null_object_filter; // empty string since we're not filtering by object
+  const bool process_log = true;
+  for (uint32_t i = 0; i < num_source_shards; ++i) {
+    std::vector<rgw_cls_bi_entry> logged;
+    list<rgw_cls_bi_entry> entries;
+    string marker;
+    bool is_truncated = true;
+    while (is_truncated) {
+      entries.clear();
+      int ret = store->getRados()->bi_list(dpp, bucket_info, i, null_object_filter,
+                                           marker, max_op_entries, &entries,
+                                           &is_truncated, process_log, y);
+      if (ret == -ENOENT) {
+        ldpp_dout(dpp, 1) << "WARNING: " << __func__ << " failed to find shard "
+            << i << ", skipping" << dendl;
+        break;
+      } else if (ret < 0) {
+        derr << "ERROR: bi_list(): " << cpp_strerror(-ret) << dendl;
+        return ret;
+      }
+
+      for (auto& entry : entries) {
+        marker = entry.idx;
+
+        cls_rgw_obj_key cls_key;
+        RGWObjCategory category;
+        rgw_bucket_category_stats stats;
+        bool account = entry.get_info(&cls_key, &category, &stats);
+        rgw_obj_key key(cls_key);
+        if (entry.type != BIIndexType::OLH || !key.empty()) {
+          int shard_index;
+          ret = calc_target_shard(bucket_info, key, shard_index, dpp);
+          if (ret < 0) {
+            return ret;
+          }
+          ret = target_shards_mgr.add_entry(shard_index, entry, account,
+                                            category, stats, process_log);
+          if (ret < 0) {
+            return ret;
+          }
+          ++copied;
+        }
+        logged.push_back(std::move(entry));
+
+        ret = renew_lock_if_needed(dpp);
+        if (ret < 0) {
+          return ret;
+        }
+      }
+    }
+
+    if (logged.empty()) {
+      continue;
+    }
+    // the entries must be written to the target shards before they are
+    // trimmed from the log
+    int ret = target_shards_mgr.finish(process_log, this, dpp);
+    if (ret < 0) {
+      ldpp_dout(dpp, -1) << "ERROR: failed to reshard: " << ret << dendl;
+      return -EIO;
+    }
+    for (auto begin = logged.begin(); begin != logged.end();) {
+      auto end = begin + std::min<ptrdiff_t>(max_op_entries,
+                                             std::distance(begin, logged.end()));
+      ret = store->getRados()->trim_reshard_log_entries(
+          dpp, bucket_info, i, {std::make_move_iterator(begin),
+                                std::make_move_iterator(end)}, y);
+      if (ret < 0) {
+        ldpp_dout(dpp, 0) << "ERROR: " << __func__ << " failed to trim reshard "
+            "log entries of shard " << i << ": " << cpp_strerror(ret) << dendl;
+        return ret;
+      }
+      begin = end;
+    }
+  }
+  return 0;
+}
+
 int RGWBucketReshard::do_reshard(const rgw::bucket_index_layout_generation& current,
                                  const rgw::bucket_index_layout_generation& target,
                                  int max_op_entries, // max num to process per op
@@ -1247,6 +1333,31 @@ int RGWBucketReshard::do_reshard(const rgw::bucket_index_layout_generation& curr
       return ret;
     }
 
+    // copy what was logged meanwhile with the writes still going on, so
+    // that few entries are left to copy once the writes are blocked
+    const auto max_passes = store->ctx()->_conf.get_val<uint64_t>(
+        "rgw_reshard_log_catch_up_passes");
+    const auto min_entries = store->ctx()->_conf.get_val<uint64_t>(
+        "rgw_reshard_log_catch_up_min_entries");
+    for (uint64_t pass = 0; pass < max_passes; ++pass) {
+      uint64_t copied = 0;
+      ret = catch_up_reshard_log(current, max_op_entries, target_shards_mgr,
+                                 copied, dpp, y);
+      if (ret == -EOPNOTSUPP) {
+        ldpp_dout(dpp, 1) << __func__ << ": reshard log entries cannot be "
+            "trimmed, copying the whole log with writes blocked" << dendl;
+        break;
+      } else if (ret < 0) {
+        ldpp_dout(dpp, 0) << __func__ << ": failed to copy the reshard log ret = " << ret << dendl;
+        return ret;
+      }
+      ldpp_dout(dpp, 10) << __func__ << ": reshard log pass " << pass
+          << " copied " << copied << " entries" << dendl;
+      if (copied < min_entries) {
+        break;
+      }
+    }
+
     ret = change_reshard_state(store, bucket_info, bucket_attrs, fault, dpp, y);
     if (ret < 0) {
       return ret;
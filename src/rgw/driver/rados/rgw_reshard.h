@@ -94,6 +94,13 @@ class RGWBucketReshard {
                       std::ostream *out,
                       Formatter *formatter, rgw::BucketReshardState reshard_stage,
                       const DoutPrefixProvider *dpp, optional_yield y);
+  // copy the entries recorded in the reshard log so far to the target
+  // shards and trim them, while the writes are still being recorded
+  int catch_up_reshard_log(const rgw::bucket_index_layout_generation& current,
+                           int max_entries,
+                           BucketReshardManager& target_shards_mgr,
+                           uint64_t& copied,
+                           const DoutPrefixProvider *dpp, optional_yield y);
 
   int do_reshard(const rgw::bucket_index_layout_generation& current,
                  const rgw::bucket_index_layout_generation& target,
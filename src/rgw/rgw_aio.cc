@@ -20,6 +20,8 @@
 #include "rgw_aio.h"
 #include "rgw_d3n_cacherequest.h"
 #include "rgw_cache_driver.h"
+#include "rgw_hedged_read.h"
+#include "rgw_perf_counters.h"
 
 namespace rgw {
 
@@ -139,6 +141,44 @@ Aio::OpFunc Aio::librados_op(librados::IoCtx ctx,
   return aio_abstract(std::move(ctx), std::move(op), y, trace_ctx);
 }
 
+Aio::OpFunc Aio::librados_hedged_read(librados::IoCtx ctx,
+                                      uint64_t ofs, uint64_t len,
+                                      optional_yield y,
+                                      ceph::timespan hedge_after) {
+  if (!y || hedge_after == ceph::timespan::zero()) {
+    librados::ObjectReadOperation op;
+    op.read(ofs, len, nullptr, nullptr);
+    return aio_abstract(std::move(ctx), std::move(op), y);
+  }
+  auto yield = y.get_yield_context();
+  return [ctx = std::move(ctx), ofs, len, yield, hedge_after] (Aio* aio, AioResult& r) mutable {
+      // both reads and the timer complete on the yield_context's strand
+      auto ex = yield.get_executor();
+      auto read = [ctx, oid = r.obj.oid, ofs, len, yield] (bool hedge, auto&& cb) mutable {
+          librados::ObjectReadOperation op;
+          op.read(ofs, len, nullptr, nullptr);
+          // the objecter picks any of the acting set, which may be the
+          // primary the first read is waiting on
+          const int flags = hedge ? librados::OPERATION_BALANCE_READS : 0;
+          librados::async_operate(yield, ctx, oid, &op, flags, nullptr,
+                                  std::move(cb));
+        };
+      async_hedged_read(ex, hedge_after, std::move(read),
+          [aio, &r] (boost::system::error_code ec, bufferlist bl,
+                     bool hedged, bool hedge_won) {
+            if (hedged && perfcounter) {
+              perfcounter->inc(l_rgw_get_obj_hedged);
+              if (hedge_won) {
+                perfcounter->inc(l_rgw_get_obj_hedge_won);
+              }
+            }
+            r.result = -ec.value();
+            r.data = std::move(bl);
+            aio->put(r);
+          });
+    };
+}
+
 Aio::OpFunc Aio::d3n_cache_op(const DoutPrefixProvider *dpp, optional_yield y,
                               off_t read_ofs, off_t read_len, std::string& cache_location) {
   return d3n_cache_aio_abstract(dpp, y, read_ofs, read_len, cache_location);
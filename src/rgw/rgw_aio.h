@@ -22,6 +22,7 @@
 #include <boost/intrusive/list.hpp>
 #include "include/rados/librados_fwd.hpp"
 #include "common/async/yield_context.h"
+#include "common/ceph_time.h"
 
 #include "rgw_common.h"
 
@@ -40,6 +41,7 @@ struct AioResult {
   uint64_t id = 0; // id allows caller to associate a result with its request
   bufferlist data; // result buffer for reads
   int result = 0;
+  ceph::timespan latency = ceph::timespan::zero(); // set by the throttles
   std::aligned_storage_t<3 * sizeof(void*)> user_data;
 
   AioResult() = default;
@@ -95,12 +97,26 @@ class Aio {
   // wait for all outstanding completions and return their results
   virtual AioResultList drain() = 0;
 
+  // change the cost of the operations in flight that get() waits for
+  virtual void set_window(uint64_t window) = 0;
+
   static OpFunc librados_op(librados::IoCtx ctx,
                             librados::ObjectReadOperation&& op,
                             optional_yield y);
   static OpFunc librados_op(librados::IoCtx ctx,
                             librados::ObjectWriteOperation&& op,
                             optional_yield y, jspan_context *trace_ctx = nullptr);
+  // a read of len bytes at ofs that, without a reply after hedge_after, is
+  // sent again to a replica picked at random with OPERATION_BALANCE_READS.
+  // only a coroutine hedges; without one, or with a zero hedge_after, it is
+  // a plain read. librados can't exclude the primary from the pick, so the
+  // hedge goes to the slow primary again for one in pool size reads, and
+  // the read that loses isn't cancelled: its reply is dropped when it
+  // arrives, and the osd serves it in full
+  static OpFunc librados_hedged_read(librados::IoCtx ctx,
+                                     uint64_t ofs, uint64_t len,
+                                     optional_yield y,
+                                     ceph::timespan hedge_after);
   static OpFunc d3n_cache_op(const DoutPrefixProvider *dpp, optional_yield y,
                              off_t read_ofs, off_t read_len, std::string& location);
 };
@@ -52,6 +52,7 @@ AioResultList BlockingAioThrottle::get(rgw_raw_obj obj,
 
     // register the pending write and attach a completion
     p->parent = this;
+    p->started = ceph::mono_clock::now();
     pending.push_back(*p);
     lock.unlock();
     std::move(f)(this, *static_cast<AioResult*>(p.get()));
@@ -65,6 +66,7 @@ AioResultList BlockingAioThrottle::get(rgw_raw_obj obj,
 void BlockingAioThrottle::put(AioResult& r)
 {
   auto& p = static_cast<Pending&>(r);
+  p.latency = ceph::mono_clock::now() - p.started;
   std::scoped_lock lock{mutex};
 
   // move from pending to completed
@@ -108,6 +110,12 @@ AioResultList BlockingAioThrottle::drain()
   return std::move(completed);
 }
 
+void BlockingAioThrottle::set_window(uint64_t window)
+{
+  std::scoped_lock lock{mutex};
+  this->window = window;
+}
+
 template <typename CompletionToken>
 auto YieldingAioThrottle::async_wait(CompletionToken&& token)
 {
@@ -144,6 +152,7 @@ AioResultList YieldingAioThrottle::get(rgw_raw_obj obj,
     }
 
     // register the pending write and initiate the operation
+    p->started = ceph::mono_clock::now();
     pending.push_back(*p);
     std::move(f)(this, *static_cast<AioResult*>(p.get()));
   }
@@ -155,6 +164,7 @@ AioResultList YieldingAioThrottle::get(rgw_raw_obj obj,
 void YieldingAioThrottle::put(AioResult& r)
 {
   auto& p = static_cast<Pending&>(r);
+  p.latency = ceph::mono_clock::now() - p.started;
 
   // move from pending to completed
   pending.erase(pending.iterator_to(p));
@@ -199,4 +209,47 @@ AioResultList YieldingAioThrottle::drain()
   }
   return std::move(completed);
 }
+
+void YieldingAioThrottle::set_window(uint64_t window)
+{
+  this->window = window;
+}
+
+void AdaptiveWindow::update()
+{
+  if (latency == 0) {
+    return;
+  }
+  // twice the bytes that the client takes over a read, with an unknown rate
+  // taken as unbounded
+  double target = rate > 0 ? 2 * rate * latency : max;
+  target = std::clamp<double>(target, min, max);
+  window = std::min<uint64_t>(target, 2 * window);
+}
+
+ceph::timespan AdaptiveWindow::get_latency() const
+{
+  return std::chrono::duration_cast<ceph::timespan>(
+      std::chrono::duration<double>(latency));
+}
+
+void AdaptiveWindow::add_read(ceph::timespan l)
+{
+  // weigh the samples as tcp does its round-trip times
+  const double sample = std::chrono::duration<double>(l).count();
+  latency = latency == 0 ? sample : latency + (sample - latency) / 8;
+  update();
+}
+
+void AdaptiveWindow::add_client(uint64_t bytes, ceph::timespan elapsed)
+{
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  if (seconds <= 0) {
+    return; // no measure of the rate
+  }
+  const double sample = bytes / seconds;
+  rate = rate == 0 ? sample : rate + (sample - rate) / 8;
+  update();
+}
+
 } // namespace rgw
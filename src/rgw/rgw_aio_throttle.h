@@ -15,8 +15,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
 #include "common/async/completion.h"
 #include "common/async/yield_context.h"
 #include "rgw_aio.h"
@@ -25,7 +27,7 @@ namespace rgw {
 
 class Throttle {
  protected:
-  const uint64_t window;
+  uint64_t window;
   uint64_t pending_size = 0;
 
   AioResultList pending;
@@ -59,6 +61,7 @@ class BlockingAioThrottle final : public Aio, private Throttle {
   struct Pending : AioResultEntry {
     BlockingAioThrottle *parent = nullptr;
     uint64_t cost = 0;
+    ceph::mono_time started;
   };
  public:
   BlockingAioThrottle(uint64_t window) : Throttle(window) {}
@@ -75,6 +78,8 @@ class BlockingAioThrottle final : public Aio, private Throttle {
   AioResultList wait() override final;
 
   AioResultList drain() override final;
+
+  void set_window(uint64_t window) override final;
 };
 
 // a throttle that yields the coroutine instead of blocking. all public
@@ -90,7 +95,10 @@ class YieldingAioThrottle final : public Aio, private Throttle {
   template <typename CompletionToken>
   auto async_wait(CompletionToken&& token);
 
-  struct Pending : AioResultEntry { uint64_t cost = 0; };
+  struct Pending : AioResultEntry {
+    uint64_t cost = 0;
+    ceph::mono_time started;
+  };
 
  public:
   YieldingAioThrottle(uint64_t window, boost::asio::yield_context yield)
@@ -109,6 +117,34 @@ class YieldingAioThrottle final : public Aio, private Throttle {
   AioResultList wait() override final;
 
   AioResultList drain() override final;
+
+  void set_window(uint64_t window) override final;
+};
+
+// sizes the window of the reads of a stream by Little's law: the bytes in
+// flight that keep up with the rate at which the client takes the data,
+// given the latency of the reads. the window follows a slow client down to
+// min, and grows toward max for a fast client, by at most twice per read
+class AdaptiveWindow {
+  const uint64_t min;
+  const uint64_t max;
+  uint64_t window;
+  double latency = 0; // average seconds per read
+  double rate = 0; // average bytes per second taken by the client
+
+  void update();
+
+ public:
+  AdaptiveWindow(uint64_t min, uint64_t max)
+    : min(min), max(std::max(min, max)), window(min) {}
+
+  uint64_t get() const { return window; }
+  // zero until a read completed
+  ceph::timespan get_latency() const;
+
+  void add_read(ceph::timespan latency);
+  // the client took bytes in elapsed
+  void add_client(uint64_t bytes, ceph::timespan elapsed);
 };
 
 // return a smart pointer to Aio
@@ -447,12 +447,20 @@ int rgw::AppMain::init_frontends2(RGWLib* rgwlib)
   ratelimiter.reset(new ActiveRateLimiter{dpp->get_cct()});
   ratelimiter->start();
 
+  const auto hash_threads =
+    g_conf().get_val<uint64_t>("rgw_put_obj_hash_threads");
+  if (hash_threads > 0) {
+    hash_pool = std::make_unique<rgw::putobj::HashPool>(
+        hash_threads, g_conf().get_val<bool>("rgw_put_obj_md5_multi_buffer"));
+  }
+
   // initialize RGWProcessEnv
   env.rest = &rest;
   env.olog = olog;
   env.auth_registry = rgw::auth::StrategyRegistry::create(
       dpp->get_cct(), *implicit_tenant_context, env.driver);
   env.ratelimiting = ratelimiter.get();
+  env.hash_pool = hash_pool.get();
 
   int fe_count = 0;
   for (multimap<string, RGWFrontendConfig *>::iterator fiter = fe_map.begin();
@@ -627,4 +635,5 @@ void rgw::AppMain::shutdown(std::function<void(void)> finalize_async_signals)
   implicit_tenant_context.reset(); // deletes
   rgw_perf_stop(g_ceph_context);
   ratelimiter.reset(); // deletes--ensure this happens before we destruct
+  hash_pool.reset(); // joins, once no request uses it
 } /* AppMain::shutdown */
@@ -5,6 +5,8 @@
 #include <ctime>
 #include <list>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/bind_cancellation_slot.hpp>
@@ -23,6 +25,7 @@
 #include <boost/context/protected_fixedsize_stack.hpp>
 #include <boost/asio/spawn.hpp>
 
+#include "common/async/context_pool.h"
 #include "common/async/shared_mutex.h"
 #include "common/errno.h"
 #include "common/strtol.h"
@@ -30,6 +33,7 @@
 #include "rgw_asio_client.h"
 #include "rgw_asio_frontend.h"
 #include "rgw_asio_thread.h"
+#include "rgw_asio_zerocopy.h"
 
 #ifdef WITH_RADOSGW_BEAST_OPENSSL
 #include <boost/asio/ssl.hpp>
@@ -115,16 +119,29 @@ class StreamIO : public rgw::asio::ClientIO {
   timeout_timer& timeout;
   boost::asio::yield_context yield;
   parse_buffer& buffer;
+  rgw::asio::ZeroCopySender* zerocopy;
   boost::system::error_code fatal_ec;
+
+  [[noreturn]] void write_failed(boost::system::error_code ec) {
+    if (ec == boost::asio::error::broken_pipe) {
+      boost::system::error_code ec_ignored;
+      stream.lowest_layer().shutdown(tcp::socket::shutdown_both, ec_ignored);
+    }
+    if (!fatal_ec) {
+      fatal_ec = ec;
+    }
+    throw rgw::io::Exception(ec.value(), std::system_category());
+  }
  public:
   StreamIO(CephContext *cct, Stream& stream, timeout_timer& timeout,
            rgw::asio::parser_type& parser, boost::asio::yield_context yield,
            parse_buffer& buffer, bool is_ssl,
+           rgw::asio::ZeroCopySender* zerocopy,
            const tcp::endpoint& local_endpoint,
            const tcp::endpoint& remote_endpoint)
       : ClientIO(parser, is_ssl, local_endpoint, remote_endpoint),
         cct(cct), stream(stream), timeout(timeout), yield(yield),
-        buffer(buffer)
+        buffer(buffer), zerocopy(zerocopy)
   {}
 
   boost::system::error_code get_fatal_error_code() const { return fatal_ec; }
@@ -137,14 +154,31 @@ class StreamIO : public rgw::asio::ClientIO {
     timeout.cancel();
     if (ec) {
       ldout(cct, 4) << "write_data failed: " << ec.message() << dendl;
-      if (ec == boost::asio::error::broken_pipe) {
-        boost::system::error_code ec_ignored;
-        stream.lowest_layer().shutdown(tcp::socket::shutdown_both, ec_ignored);
-      }
-      if (!fatal_ec) {
-        fatal_ec = ec;
+      write_failed(ec);
+    }
+    return bytes;
+  }
+
+  size_t send_body_list(const ceph::bufferlist& bl) override {
+    boost::system::error_code ec;
+    size_t bytes = 0;
+    timeout.start();
+    if (zerocopy && zerocopy->enabled() &&
+        bl.length() >= rgw::asio::ZeroCopySender::min_size) {
+      bytes = zerocopy->send(bl, yield, ec);
+    } else {
+      // write the buffers at once, without copying them together
+      std::vector<boost::asio::const_buffer> buffers;
+      buffers.reserve(bl.get_num_buffers());
+      for (const auto& ptr : bl.buffers()) {
+        buffers.emplace_back(ptr.c_str(), ptr.length());
       }
-      throw rgw::io::Exception(ec.value(), std::system_category());
+      bytes = boost::asio::async_write(stream, buffers, yield[ec]);
+    }
+    timeout.cancel();
+    if (ec) {
+      ldout(cct, 4) << "send_body_list failed: " << ec.message() << dendl;
+      write_failed(ec);
     }
     return bytes;
   }
@@ -240,6 +274,7 @@ void handle_connection(boost::asio::io_context& context,
                        RGWProcessEnv& env, Stream& stream,
                        timeout_timer& timeout, size_t header_limit,
                        parse_buffer& buffer, bool is_ssl,
+                       rgw::asio::ZeroCopySender* zerocopy,
                        SharedMutex& pause_mutex,
                        rgw::dmclock::Scheduler *scheduler,
                        const std::string& uri_prefix,
@@ -315,7 +350,7 @@ void handle_connection(boost::asio::io_context& context,
       }
 
       StreamIO real_client{cct, stream, timeout, parser, yield, buffer,
-                           is_ssl, local_endpoint, remote_endpoint};
+                           is_ssl, zerocopy, local_endpoint, remote_endpoint};
 
       auto real_client_io = rgw::io::add_reordering(
                               rgw::io::add_buffering(cct,
@@ -397,14 +432,37 @@ struct Connection : boost::intrusive::list_base_hook<>,
 {
   tcp::socket socket;
   parse_buffer buffer;
+  // with tcp_zerocopy, destroyed before the socket it reads notifications from.
+  // only the coroutine uses it, on its own executor
+  std::optional<rgw::asio::ZeroCopySender> zerocopy;
+  const bool use_zerocopy;
+  // by close() or time_out(), for the coroutine to abort the sends the peer
+  // hasn't taken
+  std::atomic<bool> closed = false;
 
-  explicit Connection(tcp::socket&& socket) noexcept
-      : socket(std::move(socket)) {}
+  explicit Connection(tcp::socket&& socket, bool use_zerocopy = false) noexcept
+      : socket(std::move(socket)), use_zerocopy(use_zerocopy) {}
 
   void close(boost::system::error_code& ec) {
+    closed = true;
+    if (use_zerocopy) {
+      // leave the socket open for the coroutine to drain the notifications
+      // of its sends, and make it give up on the connection
+      socket.cancel(ec);
+      socket.shutdown(tcp::socket::shutdown_both, ec);
+      return;
+    }
     socket.close(ec);
   }
 
+  // by the timeout_timer of a request
+  void time_out() {
+    closed = true;
+    boost::system::error_code ec_ignored;
+    socket.cancel(ec_ignored);
+    socket.shutdown(tcp::socket::shutdown_both, ec_ignored);
+  }
+
   tcp::socket& get_socket() { return socket; }
 };
 
@@ -435,7 +493,7 @@ class ConnectionList {
   void close(boost::system::error_code& ec) {
     std::lock_guard lock{mutex};
     for (auto& conn : connections) {
-      conn.socket.close(ec);
+      conn.close(ec);
     }
     connections.clear();
   }
@@ -462,16 +520,25 @@ class AsioFrontend {
   SharedMutex pause_mutex;
   std::unique_ptr<rgw::dmclock::Scheduler> scheduler;
 
+  // with num_io_contexts, each io_context runs on a thread of its own, and
+  // accepts and serves its connections without handing them to other threads
+  std::list<ceph::async::io_context_pool> shards;
+
   struct Listener {
+    boost::asio::io_context& context;
     tcp::endpoint endpoint;
     tcp::acceptor acceptor;
     tcp::socket socket;
     boost::asio::cancellation_signal signal;
+    RGWAsioBackoff backoff;
     bool use_ssl = false;
     bool use_nodelay = false;
+    bool use_zerocopy = false;
+    bool use_reuseport = false; // shares the endpoint with other shards
 
     explicit Listener(boost::asio::io_context& context)
-      : acceptor(context), socket(context) {}
+      : context(context), acceptor(context), socket(context),
+        backoff(context) {}
   };
   std::list<Listener> listeners;
 
@@ -479,7 +546,6 @@ class AsioFrontend {
 
   std::atomic<bool> going_down{false};
 
-  RGWAsioBackoff backoff;
   CephContext* ctx() const { return cct.get(); }
   std::optional<dmc::ClientCounters> client_counters;
   std::unique_ptr<dmc::ClientConfig> client_config;
@@ -492,8 +558,7 @@ class AsioFrontend {
 	       dmc::SchedulerCtx& sched_ctx,
 	       boost::asio::io_context& context)
     : env(env), conf(conf), context(context),
-      pause_mutex(context.get_executor()),
-      backoff(context)
+      pause_mutex(context.get_executor())
   {
     auto sched_t = dmc::get_scheduler_t(ctx());
     switch(sched_t){
@@ -515,9 +580,7 @@ class AsioFrontend {
   }
 
   int init();
-  int run() {
-    return 0;
-  }
+  int run();
   void stop();
   void join();
   void pause();
@@ -685,7 +748,46 @@ int AsioFrontend::init()
       l.use_nodelay = (nodelay->second == "1");
     }
   }
-  
+  // parse tcp zerocopy, which doesn't apply to ssl
+  auto zerocopy = config.find("tcp_zerocopy");
+  if (zerocopy != config.end()) {
+    for (auto& l : listeners) {
+      l.use_zerocopy = !l.use_ssl && (zerocopy->second == "1");
+    }
+  }
+
+  // parse num_io_contexts
+  if (auto i = config.find("num_io_contexts"); i != config.end()) {
+    auto num = ceph::parse<uint16_t>(i->second);
+    if (!num) {
+      lderr(ctx()) << "failed to parse num_io_contexts=" << i->second << dendl;
+      return -EINVAL;
+    }
+    if (*num > 0) {
+#ifdef SO_REUSEPORT
+      for (uint16_t n = 0; n < *num; n++) {
+        shards.emplace_back();
+      }
+      // replace each listener with one per shard, all bound to its endpoint
+      std::list<Listener> sharded;
+      for (const auto& l : listeners) {
+        for (auto& shard : shards) {
+          auto& s = sharded.emplace_back(shard.get_io_context());
+          s.endpoint = l.endpoint;
+          s.use_ssl = l.use_ssl;
+          s.use_nodelay = l.use_nodelay;
+          s.use_zerocopy = l.use_zerocopy;
+          s.use_reuseport = true;
+        }
+      }
+      listeners.swap(sharded);
+#else
+      lderr(ctx()) << "num_io_contexts requires SO_REUSEPORT" << dendl;
+      return -EOPNOTSUPP;
+#endif
+    }
+  }
+
 
   bool socket_bound = false;
   // start listeners
@@ -712,6 +814,19 @@ int AsioFrontend::init()
     }
 
     l.acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+    if (l.use_reuseport) {
+      // the kernel spreads the connections over the acceptors of the shards
+      using reuse_port = boost::asio::detail::socket_option::boolean<
+          SOL_SOCKET, SO_REUSEPORT>;
+      l.acceptor.set_option(reuse_port(true), ec);
+      if (ec) {
+        lderr(ctx()) << "failed to set SO_REUSEPORT socket option: "
+            << ec.message() << dendl;
+        return -ec.value();
+      }
+    }
+#endif
     l.acceptor.bind(l.endpoint, ec);
     if (ec) {
       lderr(ctx()) << "failed to bind address " << l.endpoint
@@ -732,11 +847,11 @@ int AsioFrontend::init()
     l.acceptor.listen(max_connection_backlog);
 
     // spawn a cancellable coroutine to the run the accept loop
-    boost::asio::spawn(context,
+    boost::asio::spawn(l.context,
       [this, &l] (boost::asio::yield_context yield) mutable {
         accept(l, yield);
       }, bind_cancellation_slot(l.signal.slot(),
-             bind_executor(context, boost::asio::detached)));
+             bind_executor(l.context, boost::asio::detached)));
 
     ldout(ctx(), 4) << "frontend listening on " << l.endpoint << dendl;
     socket_bound = true;
@@ -749,6 +864,17 @@ int AsioFrontend::init()
   return drop_privileges(ctx());
 }
 
+int AsioFrontend::run()
+{
+  for (auto& shard : shards) {
+    shard.start(1, [] {
+        // request warnings on synchronous librados calls in this thread
+        is_asio_thread = true;
+      });
+  }
+  return 0;
+}
+
 #ifdef WITH_RADOSGW_BEAST_OPENSSL
 
 static string config_val_prefix = "config://";
@@ -1070,14 +1196,14 @@ void AsioFrontend::accept(Listener& l, boost::asio::yield_context yield)
           ec == boost::system::errc::no_buffer_space ||
           ec == boost::system::errc::not_enough_memory) {
         // always retry accept() if we hit a resource limit
-        backoff.backoff_sleep(yield);
+        l.backoff.backoff_sleep(yield);
         continue;
       }
       ldout(ctx(), 0) << "accept stopped due to error: " << ec.message() << dendl;
       return;
     }
 
-    backoff.reset();
+    l.backoff.reset();
     on_accept(l, std::move(l.socket));
   }
 }
@@ -1086,12 +1212,19 @@ void AsioFrontend::on_accept(Listener& l, tcp::socket stream)
 {
   boost::system::error_code ec;
   stream.set_option(tcp::no_delay(l.use_nodelay), ec);
-  
+
+  // the connection needs a strand of its own, unless its io_context runs on
+  // a single thread
+  auto& context = l.context;
+  auto ex = l.use_reuseport
+      ? boost::asio::any_io_executor{context.get_executor()}
+      : boost::asio::any_io_executor{make_strand(context)};
+
   // spawn a coroutine to handle the connection
 #ifdef WITH_RADOSGW_BEAST_OPENSSL
   if (l.use_ssl) {
-    boost::asio::spawn(make_strand(context), std::allocator_arg, make_stack_allocator(),
-      [this, s=std::move(stream)] (boost::asio::yield_context yield) mutable {
+    boost::asio::spawn(ex, std::allocator_arg, make_stack_allocator(),
+      [this, &context, s=std::move(stream)] (boost::asio::yield_context yield) mutable {
         auto conn = boost::intrusive_ptr{new Connection(std::move(s))};
         auto c = connections.add(*conn);
         // wrap the tcp stream in an ssl stream
@@ -1109,8 +1242,8 @@ void AsioFrontend::on_accept(Listener& l, tcp::socket stream)
         }
         conn->buffer.consume(bytes);
         handle_connection(context, env, stream, timeout, header_limit,
-                          conn->buffer, true, pause_mutex, scheduler.get(),
-                          uri_prefix, ec, yield);
+                          conn->buffer, true, nullptr, pause_mutex,
+                          scheduler.get(), uri_prefix, ec, yield);
 
         if (!ec || ec == http::error::end_of_stream) {
           // ssl shutdown (ignoring errors)
@@ -1125,15 +1258,47 @@ void AsioFrontend::on_accept(Listener& l, tcp::socket stream)
 #else
   {
 #endif // WITH_RADOSGW_BEAST_OPENSSL
-    boost::asio::spawn(make_strand(context), std::allocator_arg, make_stack_allocator(),
-      [this, s=std::move(stream)] (boost::asio::yield_context yield) mutable {
-        auto conn = boost::intrusive_ptr{new Connection(std::move(s))};
+    boost::asio::spawn(ex, std::allocator_arg, make_stack_allocator(),
+      [this, &context, use_zerocopy=l.use_zerocopy, s=std::move(stream)]
+      (boost::asio::yield_context yield) mutable {
+        auto conn = boost::intrusive_ptr{new Connection(std::move(s), use_zerocopy)};
         auto c = connections.add(*conn);
         auto timeout = timeout_timer{context.get_executor(), request_timeout, conn};
         boost::system::error_code ec;
+        auto& zerocopy = conn->zerocopy;
+        if (use_zerocopy) {
+          zerocopy.emplace(conn->socket);
+          zerocopy->enable(ec);
+          if (ec) {
+            ldout(ctx(), 1) << "failed to set SO_ZEROCOPY socket option: "
+                << ec.message() << dendl;
+            zerocopy.reset();
+            ec.clear();
+          }
+        }
         handle_connection(context, env, conn->socket, timeout, header_limit,
-                          conn->buffer, false, pause_mutex, scheduler.get(),
-                          uri_prefix, ec, yield);
+                          conn->buffer, false, zerocopy ? &*zerocopy : nullptr,
+                          pause_mutex, scheduler.get(), uri_prefix, ec, yield);
+        if (zerocopy && conn->closed) {
+          // reset the connection rather than wait on the peer to take the
+          // rest of the responses
+          zerocopy->abort(ec);
+          if (ec) {
+            ldout(ctx(), 4) << "failed to reset zerocopy connection: "
+                << ec.message() << dendl;
+            ec.clear();
+          }
+        }
+        if (zerocopy) {
+          // the kernel may still read from the buffers of the last responses
+          const auto drain_timeout = request_timeout != ceph::timespan::zero()
+              ? request_timeout : std::chrono::milliseconds(REQUEST_TIMEOUT);
+          zerocopy->drain(drain_timeout, yield, ec);
+          if (ec) {
+            ldout(ctx(), 4) << "failed to drain zerocopy sends: "
+                << ec.message() << dendl;
+          }
+        }
         conn->socket.shutdown(tcp::socket::shutdown_both, ec);
       }, [] (std::exception_ptr eptr) {
         if (eptr) std::rethrow_exception(eptr);
@@ -1159,6 +1324,12 @@ void AsioFrontend::stop()
   // close all connections
   connections.close(ec);
   pause_mutex.cancel();
+
+  // wait for the requests of the shards, which don't run on the context that
+  // radosgw finishes before it closes the storage
+  for (auto& shard : shards) {
+    shard.finish();
+  }
 }
 
 void AsioFrontend::join()
@@ -1200,11 +1371,11 @@ void AsioFrontend::unpause()
 
   // start accepting connections again
   for (auto& l : listeners) {
-    boost::asio::spawn(context,
+    boost::asio::spawn(l.context,
       [this, &l] (boost::asio::yield_context yield) mutable {
         accept(l, yield);
       }, bind_cancellation_slot(l.signal.slot(),
-             bind_executor(context, boost::asio::detached)));
+             bind_executor(l.context, boost::asio::detached)));
 
   }
 
@@ -7,7 +7,8 @@
 
 namespace rgw {
 
-// a WaitHandler that closes a stream if the timeout expires
+// a WaitHandler that times out a stream if the timeout expires. the stream's
+// time_out() must make its pending and later operations fail
 template <typename Stream>
 struct timeout_handler {
   // this handler may outlive the timer/stream, so we need to hold a reference
@@ -19,9 +20,7 @@ struct timeout_handler {
 
   void operator()(boost::system::error_code ec) {
     if (!ec) { // wait was not canceled
-      boost::system::error_code ec_ignored;
-      stream->get_socket().cancel();
-      stream->get_socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec_ignored);
+      stream->time_out();
     }
   }
 };
@@ -0,0 +1,333 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw_asio_zerocopy.h"
+
+#include <algorithm>
+#include <climits>
+#include <mutex>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace rgw::asio {
+
+static constexpr auto min_backoff = std::chrono::microseconds(100);
+static constexpr auto max_backoff = std::chrono::milliseconds(10);
+
+std::mutex ZeroCopySender::orphan_mutex;
+std::deque<ZeroCopySender::Orphan> ZeroCopySender::orphans;
+
+ZeroCopySender::ZeroCopySender(boost::asio::ip::tcp::socket& socket)
+  : socket(socket), timer(socket.get_executor())
+{}
+
+ZeroCopySender::~ZeroCopySender()
+{
+  Orphan orphan{-1, {}};
+  if (socket.is_open()) {
+    reap();
+    if (sent.empty()) {
+      reap_orphans();
+      return;
+    }
+    // the kernel drops what it hasn't sent yet, and reports on it
+    boost::system::error_code ec;
+    abort(ec);
+    // the duplicate keeps the socket and its error queue once it's closed
+    orphan.fd = ::fcntl(socket.native_handle(), F_DUPFD_CLOEXEC, 0);
+  } else if (sent.empty()) {
+    return;
+  }
+  orphan.sent = std::move(sent);
+
+  std::unique_lock lock{orphan_mutex};
+  reap_orphans_locked();
+  orphans.push_back(std::move(orphan));
+  while (orphans.size() > max_orphans) {
+    if (orphans.front().fd >= 0) {
+      ::close(orphans.front().fd);
+    }
+    orphans.pop_front();
+  }
+}
+
+void ZeroCopySender::reap_orphans()
+{
+  std::unique_lock lock{orphan_mutex, std::try_to_lock};
+  if (lock) {
+    reap_orphans_locked();
+  }
+}
+
+void ZeroCopySender::reap_orphans_locked()
+{
+  for (auto i = orphans.begin(); i != orphans.end(); ) {
+    if (i->fd < 0) {
+      // released by max_orphans only
+      ++i;
+      continue;
+    }
+    reap(i->fd, i->sent);
+    if (i->sent.empty()) {
+      ::close(i->fd);
+      i = orphans.erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+size_t ZeroCopySender::orphaned()
+{
+  std::lock_guard lock{orphan_mutex};
+  return orphans.size();
+}
+
+void ZeroCopySender::enable(boost::system::error_code& ec)
+{
+  reap_orphans();
+  const int one = 1;
+  if (::setsockopt(socket.native_handle(), SOL_SOCKET, SO_ZEROCOPY,
+                   &one, sizeof(one)) < 0) {
+    ec.assign(errno, boost::system::system_category());
+    return;
+  }
+  use_zerocopy = true;
+}
+
+// skip the first n bytes of the iovecs from i
+static void advance(std::vector<iovec>::iterator& i,
+                    std::vector<iovec>::iterator end, size_t n)
+{
+  while (n > 0 && i != end) {
+    const size_t len = std::min(n, i->iov_len);
+    i->iov_base = static_cast<char*>(i->iov_base) + len;
+    i->iov_len -= len;
+    n -= len;
+    if (i->iov_len == 0) {
+      ++i;
+    }
+  }
+}
+
+size_t ZeroCopySender::send(const ceph::bufferlist& bl,
+                            boost::asio::yield_context yield,
+                            boost::system::error_code& ec)
+{
+  std::vector<iovec> iov;
+  iov.reserve(bl.get_num_buffers());
+  for (const auto& ptr : bl.buffers()) {
+    if (ptr.length()) {
+      iov.push_back({const_cast<char*>(ptr.c_str()), ptr.length()});
+    }
+  }
+
+  // track bl before the first sendmsg(), as reap() may see its notifications
+  // before the last
+  auto& cur = sent.emplace_back(Sent{next_id, 0, 0, true, bl});
+
+  const int fd = socket.native_handle();
+  auto wait = ceph::timespan{min_backoff};
+  size_t bytes = 0;
+  auto i = iov.begin();
+  while (i != iov.end()) {
+    msghdr msg{};
+    msg.msg_iov = &*i;
+    msg.msg_iovlen = std::min<size_t>(iov.end() - i, IOV_MAX);
+    constexpr int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+    ssize_t r = ::sendmsg(fd, &msg, flags | MSG_ZEROCOPY);
+    if (r >= 0) {
+      ++next_id;
+      ++cur.count;
+      ++cur.remaining;
+    } else if (errno == ENOBUFS && sent.size() == 1 && cur.remaining == 0) {
+      // the socket can't take a notification even without any outstanding,
+      // so copy this part instead
+      r = ::sendmsg(fd, &msg, flags);
+    }
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // wait for room in the socket buffer
+        socket.async_wait(boost::asio::ip::tcp::socket::wait_write, yield[ec]);
+        if (ec) {
+          break;
+        }
+        reap();
+        continue;
+      } else if (errno == ENOBUFS) {
+        // too many notifications outstanding, wait for some to be read
+        reap();
+        backoff(wait, yield, ec);
+        if (ec) {
+          break;
+        }
+        continue;
+      }
+      ec.assign(errno, boost::system::system_category());
+      break;
+    }
+    bytes += r;
+    advance(i, iov.end(), r);
+  }
+
+  // whatever the outcome, the kernel may still read from these buffers
+  cur.sending = false;
+  reap();
+  return bytes;
+}
+
+void ZeroCopySender::complete(std::deque<Sent>& sent, uint32_t lo, uint32_t hi)
+{
+  // the notification covers the ids [lo, hi], which may span several
+  // bufferlists. ids wrap around, so compare their offsets
+  const uint64_t n = uint64_t(hi - lo) + 1;
+  for (auto& s : sent) {
+    const uint32_t ahead = s.first_id - lo; // of s after lo
+    const uint32_t behind = lo - s.first_id; // of lo into s
+    uint64_t overlap = 0;
+    if (ahead < n) {
+      overlap = std::min<uint64_t>(s.count, n - ahead);
+    } else if (behind < s.count) {
+      overlap = std::min<uint64_t>(s.count - behind, n);
+    }
+    s.remaining -= std::min<uint64_t>(overlap, s.remaining);
+  }
+}
+
+void ZeroCopySender::reap()
+{
+  if (!reap(socket.native_handle(), sent)) {
+    // the kernel copied the data anyway, so later sends copy it up front
+    use_zerocopy = false;
+  }
+}
+
+bool ZeroCopySender::reap(int fd, std::deque<Sent>& sent)
+{
+  bool zerocopy = true;
+  for (;;) {
+    char control[128];
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      break; // EAGAIN once the queue is empty
+    }
+    for (auto cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+          !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      const auto serr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        zerocopy = false;
+      }
+      complete(sent, serr->ee_info, serr->ee_data);
+    }
+  }
+  // release in order, once the kernel is done with everything before
+  while (!sent.empty() && !sent.front().sending &&
+         sent.front().remaining == 0) {
+    sent.pop_front();
+  }
+  return zerocopy;
+}
+
+void ZeroCopySender::backoff(ceph::timespan& wait,
+                             boost::asio::yield_context yield,
+                             boost::system::error_code& ec)
+{
+  // the notifications wake the socket for errors, which the reactor doesn't
+  // track reliably, so poll for them instead
+  timer.expires_after(wait);
+  timer.async_wait(yield[ec]);
+  wait = std::min<ceph::timespan>(wait * 2, max_backoff);
+}
+
+void ZeroCopySender::abort(boost::system::error_code& ec)
+{
+  if (aborted) {
+    return;
+  }
+  const int fd = socket.native_handle();
+  // reset on close as well, should the disconnect below fail
+  const linger lg{1, 0};
+  if (::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg)) < 0) {
+    ec.assign(errno, boost::system::system_category());
+    return;
+  }
+  // connecting to AF_UNSPEC disconnects the socket without closing it: the
+  // kernel sends a reset and frees its send queue, and the notifications of
+  // the buffers in that queue still arrive on the error queue
+  sockaddr addr{};
+  addr.sa_family = AF_UNSPEC;
+  if (::connect(fd, &addr, sizeof(addr)) < 0) {
+    ec.assign(errno, boost::system::system_category());
+    return;
+  }
+  aborted = true;
+}
+
+void ZeroCopySender::drain(ceph::timespan timeout,
+                           boost::asio::yield_context yield,
+                           boost::system::error_code& ec)
+{
+  auto deadline = ceph::mono_clock::now() + timeout;
+  auto wait = ceph::timespan{min_backoff};
+  bool timed_out = false;
+  reap();
+  while (!sent.empty()) {
+    if (!socket.is_open()) {
+      // the notifications can't be read anymore, so the destructor keeps
+      // what's left until max_orphans pushes it out
+      ec = boost::asio::error::bad_descriptor;
+      return;
+    }
+    if (ceph::mono_clock::now() >= deadline) {
+      if (timed_out) {
+        ec = boost::asio::error::timed_out;
+        return;
+      }
+      // the peer isn't reading. reset the connection so the kernel drops the
+      // rest of the send queue, then wait for it to report on those buffers
+      timed_out = true;
+      abort(ec);
+      if (ec) {
+        return;
+      }
+      deadline = ceph::mono_clock::now() + timeout;
+      wait = min_backoff;
+    }
+    backoff(wait, yield, ec);
+    if (ec) {
+      return;
+    }
+    reap();
+  }
+  if (timed_out) {
+    ec = boost::asio::error::timed_out;
+  }
+}
+
+} // namespace rgw::asio
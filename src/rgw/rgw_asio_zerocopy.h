@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "common/ceph_time.h"
+#include "include/buffer.h"
+
+namespace rgw::asio {
+
+// sends bufferlists on a tcp socket with MSG_ZEROCOPY, so the kernel reads
+// their buffers in place instead of copying them into the socket buffer.
+// each bufferlist stays referenced until the kernel reports on the error
+// queue of the socket that it is done with its buffers. the socket must stay
+// open until then, so connections with sends pending are reset with abort()
+// rather than closed, and the sends a sender is destroyed with are kept with
+// a duplicate of its socket until the kernel reports on them
+class ZeroCopySender {
+ public:
+  // sends of less than this cost more in page pinning and notifications
+  // than the copy they save
+  static constexpr size_t min_size = 16384;
+
+  // past this many destroyed senders with sends pending, the bufferlists of
+  // the oldest are released without a report. their connection was reset, so
+  // whatever the kernel may still read from them never reaches the peer
+  static constexpr size_t max_orphans = 1024;
+
+  explicit ZeroCopySender(boost::asio::ip::tcp::socket& socket);
+  // resets the connection if the kernel hasn't reported on every bufferlist,
+  // and keeps the rest for reap_orphans()
+  ~ZeroCopySender();
+
+  // sets SO_ZEROCOPY on the socket
+  void enable(boost::system::error_code& ec);
+  // false until enabled, and once the kernel reports that it had to copy
+  // the data anyway, as it does over loopback
+  bool enabled() const { return use_zerocopy; }
+
+  // send all of bl, waiting on yield while the socket buffer is full
+  size_t send(const ceph::bufferlist& bl, boost::asio::yield_context yield,
+              boost::system::error_code& ec);
+
+  // release the bufferlists the kernel is done with, without waiting
+  void reap();
+
+  // reset the connection without closing the socket, so the kernel discards
+  // the data it hasn't sent yet and reports that it's done with its buffers
+  void abort(boost::system::error_code& ec);
+
+  // wait up to timeout for the kernel to be done with every bufferlist. past
+  // the timeout, abort() the connection and wait up to timeout again for the
+  // kernel to release the rest, then fail with timed_out
+  void drain(ceph::timespan timeout, boost::asio::yield_context yield,
+             boost::system::error_code& ec);
+
+  // the bufferlists not released yet
+  size_t pending() const { return sent.size(); }
+
+  // release the bufferlists of the destroyed senders the kernel is done with.
+  // called as senders are enabled and destroyed
+  static void reap_orphans();
+  // the destroyed senders with bufferlists not released yet
+  static size_t orphaned();
+
+ private:
+  boost::asio::ip::tcp::socket& socket;
+  boost::asio::steady_timer timer;
+  bool use_zerocopy = false;
+  bool aborted = false;
+  uint32_t next_id = 0; // of the next sendmsg() with MSG_ZEROCOPY
+
+  struct Sent {
+    uint32_t first_id; // of the sendmsg() calls for bl
+    uint32_t count;
+    uint32_t remaining; // calls without a notification
+    bool sending; // until send() returns
+    ceph::bufferlist bl;
+  };
+  std::deque<Sent> sent;
+
+  // the sends of a destroyed sender, and a duplicate of its socket to read
+  // the reports on them from, if it was still open
+  struct Orphan {
+    int fd;
+    std::deque<Sent> sent;
+  };
+  static std::mutex orphan_mutex;
+  static std::deque<Orphan> orphans;
+
+  // read the reports of the kernel on fd, and release the bufferlists it is
+  // done with. returns false if it reported copying the data
+  static bool reap(int fd, std::deque<Sent>& sent);
+  static void complete(std::deque<Sent>& sent, uint32_t lo, uint32_t hi);
+  // with orphan_mutex held
+  static void reap_orphans_locked();
+  // sleep a little before looking for notifications again
+  void backoff(ceph::timespan& wait, boost::asio::yield_context yield,
+               boost::system::error_code& ec);
+};
+
+} // namespace rgw::asio
@@ -54,9 +54,11 @@ namespace rgw::putobj {
 
   int RGWPutObj_Cksum::process(ceph::buffer::list &&data, uint64_t logical_offset)
   {
-    for (const auto& ptr : data.buffers()) {
-      _digest->Update(reinterpret_cast<const unsigned char*>(ptr.c_str()),
-                      ptr.length());
+    if (hash_data) {
+      for (const auto& ptr : data.buffers()) {
+	_digest->Update(reinterpret_cast<const unsigned char*>(ptr.c_str()),
+			ptr.length());
+      }
     }
     return Pipe::process(std::move(data), logical_offset);
   }
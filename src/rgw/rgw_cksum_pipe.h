@@ -96,6 +96,7 @@ namespace rgw::putobj {
     cksum::Digest* _digest;
     cksum::Cksum _cksum;
     cksum_hdr_t cksum_hdr;
+    bool hash_data = true;
 
   public:
 
@@ -113,6 +114,9 @@ namespace rgw::putobj {
     cksum::Digest* digest() const { return _digest; }
     const cksum::Cksum& cksum() { return _cksum; };
 
+    /* the digest is updated by a HashPipe upstream */
+    void set_hashed_upstream() { hash_data = false; }
+
     const cksum_hdr_t& header() const {
       return cksum_hdr;
     }
@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include <boost/asio/basic_waitable_timer.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "common/ceph_time.h"
+#include "include/buffer.h"
+
+namespace rgw {
+
+// start a read, and if it has no reply after delay, start it again as a
+// hedge, which the caller sends elsewhere. the first reply goes to the
+// handler, and the other is dropped on arrival: the read that loses is not
+// cancelled, and keeps the state alive until it completes.
+// read(hedge, callback) must call the callback with (error_code, bufferlist)
+// on ex, which must not run handlers concurrently, such as the strand of a
+// coroutine. the handler is called on ex with (error_code, bufferlist,
+// bool hedged, bool hedge_won)
+template <typename Executor, typename Read, typename Handler>
+void async_hedged_read(const Executor& ex, ceph::timespan delay,
+		       Read&& read, Handler&& handler)
+{
+  using Timer = boost::asio::basic_waitable_timer<ceph::coarse_mono_clock>;
+
+  struct State {
+    Timer timer;
+    std::decay_t<Read> read;
+    std::decay_t<Handler> handler;
+    bool done = false;
+    bool hedged = false;
+
+    State(const Executor& ex, Read&& read, Handler&& handler)
+      : timer(ex), read(std::forward<Read>(read)),
+	handler(std::forward<Handler>(handler)) {}
+
+    static void start(std::shared_ptr<State> s, const Executor& ex, bool hedge) {
+      s->read(hedge, boost::asio::bind_executor(ex,
+	  [s, hedge] (boost::system::error_code ec, bufferlist bl) {
+	    if (s->done) {
+	      return; // the other read replied first
+	    }
+	    s->done = true;
+	    s->timer.cancel();
+	    s->handler(ec, std::move(bl), s->hedged, hedge);
+	  }));
+    }
+  };
+
+  auto s = std::make_shared<State>(ex, std::forward<Read>(read),
+				   std::forward<Handler>(handler));
+  State::start(s, ex, false);
+  if (s->done || delay == ceph::timespan::zero()) {
+    return;
+  }
+  s->timer.expires_after(delay);
+  s->timer.async_wait(boost::asio::bind_executor(ex,
+      [s, ex] (boost::system::error_code ec) {
+	if (ec || s->done) {
+	  return;
+	}
+	s->hedged = true;
+	State::start(s, ex, true);
+      }));
+}
+
+} // namespace rgw
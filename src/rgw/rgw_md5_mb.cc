@@ -0,0 +1,546 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw_md5_mb.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define MD5_MB_X86 1
+#define MD5_MB_AVX2 __attribute__((target("avx2")))
+#define MD5_MB_AVX512 __attribute__((target("avx512f")))
+// inlines the generic kernel and its vector ops into the function built for
+// the instruction set
+#define MD5_MB_FLATTEN __attribute__((flatten))
+#endif
+
+namespace rgw::md5_mb {
+
+namespace {
+
+constexpr unsigned MAX_LANES = 16;
+constexpr size_t BLOCK = 64;
+constexpr size_t MAX_SCALAR_BLOCKS = 256;
+
+inline uint32_t load_le32(const unsigned char* p)
+{
+  return uint32_t(p[0]) | uint32_t(p[1]) << 8 |
+    uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+inline void store_le32(unsigned char* p, uint32_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+// the 64 steps of the MD5 compression function, on any type of word O::T:
+// a scalar, or a vector of words from the blocks of several lanes
+#define MD5_F(b, c, d) O::xor_(d, O::and_(b, O::xor_(c, d)))
+#define MD5_G(b, c, d) O::xor_(c, O::and_(d, O::xor_(b, c)))
+#define MD5_H(b, c, d) O::xor_(O::xor_(b, c), d)
+#define MD5_I(b, c, d) O::xor_(c, O::or_(b, O::not_(d)))
+#define MD5_STEP(f, a, b, c, d, k, s, t) \
+  a = O::add(b, O::template rol<s>(O::add(O::add(a, f(b, c, d)), \
+					   O::add(m[k], O::set1(t)))))
+
+#define MD5_ROUNDS \
+  MD5_STEP(MD5_F, a, b, c, d,  0,  7, 0xd76aa478); \
+  MD5_STEP(MD5_F, d, a, b, c,  1, 12, 0xe8c7b756); \
+  MD5_STEP(MD5_F, c, d, a, b,  2, 17, 0x242070db); \
+  MD5_STEP(MD5_F, b, c, d, a,  3, 22, 0xc1bdceee); \
+  MD5_STEP(MD5_F, a, b, c, d,  4,  7, 0xf57c0faf); \
+  MD5_STEP(MD5_F, d, a, b, c,  5, 12, 0x4787c62a); \
+  MD5_STEP(MD5_F, c, d, a, b,  6, 17, 0xa8304613); \
+  MD5_STEP(MD5_F, b, c, d, a,  7, 22, 0xfd469501); \
+  MD5_STEP(MD5_F, a, b, c, d,  8,  7, 0x698098d8); \
+  MD5_STEP(MD5_F, d, a, b, c,  9, 12, 0x8b44f7af); \
+  MD5_STEP(MD5_F, c, d, a, b, 10, 17, 0xffff5bb1); \
+  MD5_STEP(MD5_F, b, c, d, a, 11, 22, 0x895cd7be); \
+  MD5_STEP(MD5_F, a, b, c, d, 12,  7, 0x6b901122); \
+  MD5_STEP(MD5_F, d, a, b, c, 13, 12, 0xfd987193); \
+  MD5_STEP(MD5_F, c, d, a, b, 14, 17, 0xa679438e); \
+  MD5_STEP(MD5_F, b, c, d, a, 15, 22, 0x49b40821); \
+  MD5_STEP(MD5_G, a, b, c, d,  1,  5, 0xf61e2562); \
+  MD5_STEP(MD5_G, d, a, b, c,  6,  9, 0xc040b340); \
+  MD5_STEP(MD5_G, c, d, a, b, 11, 14, 0x265e5a51); \
+  MD5_STEP(MD5_G, b, c, d, a,  0, 20, 0xe9b6c7aa); \
+  MD5_STEP(MD5_G, a, b, c, d,  5,  5, 0xd62f105d); \
+  MD5_STEP(MD5_G, d, a, b, c, 10,  9, 0x02441453); \
+  MD5_STEP(MD5_G, c, d, a, b, 15, 14, 0xd8a1e681); \
+  MD5_STEP(MD5_G, b, c, d, a,  4, 20, 0xe7d3fbc8); \
+  MD5_STEP(MD5_G, a, b, c, d,  9,  5, 0x21e1cde6); \
+  MD5_STEP(MD5_G, d, a, b, c, 14,  9, 0xc33707d6); \
+  MD5_STEP(MD5_G, c, d, a, b,  3, 14, 0xf4d50d87); \
+  MD5_STEP(MD5_G, b, c, d, a,  8, 20, 0x455a14ed); \
+  MD5_STEP(MD5_G, a, b, c, d, 13,  5, 0xa9e3e905); \
+  MD5_STEP(MD5_G, d, a, b, c,  2,  9, 0xfcefa3f8); \
+  MD5_STEP(MD5_G, c, d, a, b,  7, 14, 0x676f02d9); \
+  MD5_STEP(MD5_G, b, c, d, a, 12, 20, 0x8d2a4c8a); \
+  MD5_STEP(MD5_H, a, b, c, d,  5,  4, 0xfffa3942); \
+  MD5_STEP(MD5_H, d, a, b, c,  8, 11, 0x8771f681); \
+  MD5_STEP(MD5_H, c, d, a, b, 11, 16, 0x6d9d6122); \
+  MD5_STEP(MD5_H, b, c, d, a, 14, 23, 0xfde5380c); \
+  MD5_STEP(MD5_H, a, b, c, d,  1,  4, 0xa4beea44); \
+  MD5_STEP(MD5_H, d, a, b, c,  4, 11, 0x4bdecfa9); \
+  MD5_STEP(MD5_H, c, d, a, b,  7, 16, 0xf6bb4b60); \
+  MD5_STEP(MD5_H, b, c, d, a, 10, 23, 0xbebfbc70); \
+  MD5_STEP(MD5_H, a, b, c, d, 13,  4, 0x289b7ec6); \
+  MD5_STEP(MD5_H, d, a, b, c,  0, 11, 0xeaa127fa); \
+  MD5_STEP(MD5_H, c, d, a, b,  3, 16, 0xd4ef3085); \
+  MD5_STEP(MD5_H, b, c, d, a,  6, 23, 0x04881d05); \
+  MD5_STEP(MD5_H, a, b, c, d,  9,  4, 0xd9d4d039); \
+  MD5_STEP(MD5_H, d, a, b, c, 12, 11, 0xe6db99e5); \
+  MD5_STEP(MD5_H, c, d, a, b, 15, 16, 0x1fa27cf8); \
+  MD5_STEP(MD5_H, b, c, d, a,  2, 23, 0xc4ac5665); \
+  MD5_STEP(MD5_I, a, b, c, d,  0,  6, 0xf4292244); \
+  MD5_STEP(MD5_I, d, a, b, c,  7, 10, 0x432aff97); \
+  MD5_STEP(MD5_I, c, d, a, b, 14, 15, 0xab9423a7); \
+  MD5_STEP(MD5_I, b, c, d, a,  5, 21, 0xfc93a039); \
+  MD5_STEP(MD5_I, a, b, c, d, 12,  6, 0x655b59c3); \
+  MD5_STEP(MD5_I, d, a, b, c,  3, 10, 0x8f0ccc92); \
+  MD5_STEP(MD5_I, c, d, a, b, 10, 15, 0xffeff47d); \
+  MD5_STEP(MD5_I, b, c, d, a,  1, 21, 0x85845dd1); \
+  MD5_STEP(MD5_I, a, b, c, d,  8,  6, 0x6fa87e4f); \
+  MD5_STEP(MD5_I, d, a, b, c, 15, 10, 0xfe2ce6e0); \
+  MD5_STEP(MD5_I, c, d, a, b,  6, 15, 0xa3014314); \
+  MD5_STEP(MD5_I, b, c, d, a, 13, 21, 0x4e0811a1); \
+  MD5_STEP(MD5_I, a, b, c, d,  4,  6, 0xf7537e82); \
+  MD5_STEP(MD5_I, d, a, b, c, 11, 10, 0xbd3af235); \
+  MD5_STEP(MD5_I, c, d, a, b,  2, 15, 0x2ad7d2bb); \
+  MD5_STEP(MD5_I, b, c, d, a,  9, 21, 0xeb86d391)
+
+struct ScalarOps {
+  using T = uint32_t;
+  static T add(T x, T y) { return x + y; }
+  static T and_(T x, T y) { return x & y; }
+  static T or_(T x, T y) { return x | y; }
+  static T xor_(T x, T y) { return x ^ y; }
+  static T not_(T x) { return ~x; }
+  static T set1(uint32_t x) { return x; }
+  template <int s> static T rol(T x) { return (x << s) | (x >> (32 - s)); }
+};
+
+void md5_block(uint32_t* state, const unsigned char* p)
+{
+  using O = ScalarOps;
+  uint32_t m[16];
+  for (int i = 0; i < 16; ++i) {
+    m[i] = load_le32(p + 4 * i);
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  MD5_ROUNDS;
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+}
+
+void hash_scalar(uint32_t* state, const unsigned char* data, size_t blocks)
+{
+  for (; blocks > 0; --blocks, data += BLOCK) {
+    md5_block(state, data);
+  }
+}
+
+#ifdef MD5_MB_X86
+
+// the vectors only cross the calls that flatten inlines, and gcc 12 warns
+// about the undefined source of _mm512_rol_epi32
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+struct Avx2Ops {
+  using T = __m256i;
+  static constexpr unsigned lanes = 8;
+  MD5_MB_AVX2 static T add(T x, T y) { return _mm256_add_epi32(x, y); }
+  MD5_MB_AVX2 static T and_(T x, T y) { return _mm256_and_si256(x, y); }
+  MD5_MB_AVX2 static T or_(T x, T y) { return _mm256_or_si256(x, y); }
+  MD5_MB_AVX2 static T xor_(T x, T y) { return _mm256_xor_si256(x, y); }
+  MD5_MB_AVX2 static T not_(T x) { return _mm256_xor_si256(x, _mm256_set1_epi32(-1)); }
+  MD5_MB_AVX2 static T set1(uint32_t x) { return _mm256_set1_epi32(x); }
+  template <int s> MD5_MB_AVX2 static T rol(T x) {
+    return _mm256_or_si256(_mm256_slli_epi32(x, s), _mm256_srli_epi32(x, 32 - s));
+  }
+  MD5_MB_AVX2 static T load(const uint32_t* p) {
+    return _mm256_load_si256(reinterpret_cast<const T*>(p));
+  }
+  MD5_MB_AVX2 static void store(uint32_t* p, T x) {
+    _mm256_store_si256(reinterpret_cast<T*>(p), x);
+  }
+};
+
+struct Avx512Ops {
+  using T = __m512i;
+  static constexpr unsigned lanes = 16;
+  MD5_MB_AVX512 static T add(T x, T y) { return _mm512_add_epi32(x, y); }
+  MD5_MB_AVX512 static T and_(T x, T y) { return _mm512_and_si512(x, y); }
+  MD5_MB_AVX512 static T or_(T x, T y) { return _mm512_or_si512(x, y); }
+  MD5_MB_AVX512 static T xor_(T x, T y) { return _mm512_xor_si512(x, y); }
+  MD5_MB_AVX512 static T not_(T x) { return _mm512_xor_si512(x, _mm512_set1_epi32(-1)); }
+  MD5_MB_AVX512 static T set1(uint32_t x) { return _mm512_set1_epi32(x); }
+  template <int s> MD5_MB_AVX512 static T rol(T x) { return _mm512_rol_epi32(x, s); }
+  MD5_MB_AVX512 static T load(const uint32_t* p) { return _mm512_load_si512(p); }
+  MD5_MB_AVX512 static void store(uint32_t* p, T x) { _mm512_store_si512(p, x); }
+};
+
+// hash the blocks of O::lanes streams at once; the words of each block are
+// transposed so that a vector holds the same word of all the lanes. the
+// blocks of a lane are stride bytes apart, which is 0 for an idle lane
+template <typename O>
+inline void hash_lanes(uint32_t* const* state, const unsigned char* const* data,
+		       const size_t* stride, size_t blocks)
+{
+  constexpr unsigned W = O::lanes;
+  alignas(64) uint32_t words[16][W];
+  alignas(64) uint32_t s[4][W];
+  for (unsigned l = 0; l < W; ++l) {
+    for (int i = 0; i < 4; ++i) {
+      s[i][l] = state[l][i];
+    }
+  }
+  typename O::T a = O::load(s[0]), b = O::load(s[1]),
+    c = O::load(s[2]), d = O::load(s[3]);
+
+  for (size_t n = 0; n < blocks; ++n) {
+    for (unsigned l = 0; l < W; ++l) {
+      const unsigned char* p = data[l] + n * stride[l];
+      for (int i = 0; i < 16; ++i) {
+	memcpy(&words[i][l], p + 4 * i, 4); // x86 is little-endian
+      }
+    }
+    typename O::T m[16];
+    for (int i = 0; i < 16; ++i) {
+      m[i] = O::load(words[i]);
+    }
+    const auto aa = a, bb = b, cc = c, dd = d;
+    MD5_ROUNDS;
+    a = O::add(a, aa);
+    b = O::add(b, bb);
+    c = O::add(c, cc);
+    d = O::add(d, dd);
+  }
+
+  O::store(s[0], a);
+  O::store(s[1], b);
+  O::store(s[2], c);
+  O::store(s[3], d);
+  for (unsigned l = 0; l < W; ++l) {
+    for (int i = 0; i < 4; ++i) {
+      state[l][i] = s[i][l];
+    }
+  }
+}
+
+MD5_MB_AVX2 MD5_MB_FLATTEN void hash_avx2(uint32_t* const* state, const unsigned char* const* data,
+					  const size_t* stride, size_t blocks)
+{
+  hash_lanes<Avx2Ops>(state, data, stride, blocks);
+}
+
+MD5_MB_AVX512 MD5_MB_FLATTEN void hash_avx512(uint32_t* const* state, const unsigned char* const* data,
+					      const size_t* stride, size_t blocks)
+{
+  hash_lanes<Avx512Ops>(state, data, stride, blocks);
+}
+
+#pragma GCC diagnostic pop
+
+#endif // MD5_MB_X86
+
+void hash_lanes(unsigned lanes, uint32_t* const* state,
+		const unsigned char* const* data, const size_t* stride,
+		size_t blocks)
+{
+#ifdef MD5_MB_X86
+  if (lanes == 16) {
+    return hash_avx512(state, data, stride, blocks);
+  } else if (lanes == 8) {
+    return hash_avx2(state, data, stride, blocks);
+  }
+#endif
+  for (unsigned l = 0; l < lanes; ++l) {
+    if (stride[l] > 0) {
+      hash_scalar(state[l], data[l], blocks);
+    }
+  }
+}
+
+unsigned probe_lanes()
+{
+#ifdef MD5_MB_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return 16;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return 8;
+  }
+#endif
+  return 1;
+}
+
+// the padding and length that end the MD5 of a stream
+void finalize(uint32_t* state, uint32_t partial, uint64_t length,
+	      const unsigned char* block, unsigned char* out)
+{
+  unsigned char pad[2 * BLOCK] = {};
+  memcpy(pad, block, partial);
+  pad[partial] = 0x80;
+  const size_t total = partial < BLOCK - 8 ? BLOCK : 2 * BLOCK;
+  const uint64_t bits = length * 8;
+  for (int i = 0; i < 8; ++i) {
+    pad[total - 8 + i] = bits >> (8 * i);
+  }
+  hash_scalar(state, pad, total / BLOCK);
+  for (int i = 0; i < 4; ++i) {
+    store_le32(out + 4 * i, state[i]);
+  }
+}
+
+} // anonymous namespace
+
+unsigned Hasher::lanes()
+{
+  static const unsigned lanes = probe_lanes();
+  return lanes;
+}
+
+void hash_blocks(unsigned lanes, uint32_t* const* state,
+		 const unsigned char* const* data, size_t blocks)
+{
+  size_t stride[MAX_LANES];
+  std::fill_n(stride, lanes, BLOCK);
+  hash_lanes(lanes, state, data, stride, blocks);
+}
+
+Hasher::Hasher()
+  : thread(&Hasher::run, this)
+{}
+
+Hasher::~Hasher()
+{
+  {
+    std::lock_guard lock{mutex};
+    stopping = true;
+  }
+  cond.notify_one();
+  thread.join();
+}
+
+void Hasher::submit(Job&& job)
+{
+  {
+    std::lock_guard lock{mutex};
+    queue.push_back(std::move(job));
+  }
+  cond.notify_one();
+}
+
+void Hasher::update(Digest& digest, bufferlist data, Callback done)
+{
+  submit(Job{&digest, std::move(data), nullptr, std::move(done)});
+}
+
+void Hasher::final(Digest& digest, unsigned char* out, Callback done)
+{
+  submit(Job{&digest, {}, out, std::move(done)});
+}
+
+namespace {
+
+// a stream being hashed
+struct Lane {
+  bool busy = false;
+  uint32_t* state;
+  bufferlist data;
+  bufferlist::buffers_t::const_iterator next; // the next buffer of data
+  const unsigned char* pos = nullptr; // in the current buffer
+  const unsigned char* end = nullptr;
+  // the blocks to hash before calling next_run()
+  const unsigned char* run = nullptr;
+  size_t blocks = 0;
+};
+
+}
+
+// find the next blocks of the lane's digest to hash, copying the ends of
+// buffers into the digest's block; false once the data is consumed
+static bool next_run(Lane& l, uint32_t& partial, uint64_t& length,
+		     unsigned char* block)
+{
+  for (;;) {
+    if (l.pos == l.end) {
+      if (l.next == l.data.buffers().end()) {
+	return false;
+      }
+      l.pos = reinterpret_cast<const unsigned char*>(l.next->c_str());
+      l.end = l.pos + l.next->length();
+      ++l.next;
+      continue;
+    }
+    const size_t avail = l.end - l.pos;
+    if (partial > 0 || avail < BLOCK) {
+      const size_t n = std::min<size_t>(BLOCK - partial, avail);
+      memcpy(block + partial, l.pos, n);
+      partial += n;
+      length += n;
+      l.pos += n;
+      if (partial == BLOCK) {
+	partial = 0;
+	l.run = block;
+	l.blocks = 1;
+	return true;
+      }
+      continue;
+    }
+    const size_t blocks = avail / BLOCK;
+    l.run = l.pos;
+    l.blocks = blocks;
+    l.pos += blocks * BLOCK;
+    length += blocks * BLOCK;
+    return true;
+  }
+}
+
+void Hasher::run()
+{
+  const unsigned width = lanes();
+  std::array<Lane, MAX_LANES> lane;
+  std::array<Job, MAX_LANES> job;
+  std::deque<Job> jobs;
+  std::vector<Callback> completed;
+  unsigned active = 0;
+
+  // the state and data of the idle lanes
+  alignas(64) static const unsigned char zeros[BLOCK] = {};
+  uint32_t idle_state[MAX_LANES][4] = {};
+
+  auto start = [&] (unsigned i, Job&& j) {
+    Digest& d = *j.digest;
+    if (j.out) {
+      finalize(d.state, d.partial, d.length, d.block, j.out);
+      completed.push_back(std::move(j.done));
+      return;
+    }
+    Lane& l = lane[i];
+    l.data = std::move(j.data);
+    l.next = l.data.buffers().begin();
+    l.pos = l.end = nullptr;
+    if (!next_run(l, d.partial, d.length, d.block)) {
+      completed.push_back(std::move(j.done));
+      return;
+    }
+    l.busy = true;
+    l.state = d.state;
+    job[i] = std::move(j);
+    ++active;
+  };
+
+  std::unique_lock lock{mutex};
+  for (;;) {
+    if (active < width) {
+      if (queue.empty() && jobs.empty() && active == 0) {
+	if (stopping) {
+	  break;
+	}
+	cond.wait(lock);
+	continue;
+      }
+      std::move(queue.begin(), queue.end(), std::back_inserter(jobs));
+      queue.clear();
+    }
+    lock.unlock();
+
+    // fill the idle lanes
+    for (unsigned i = 0; i < width && !jobs.empty(); ) {
+      if (lane[i].busy) {
+	++i;
+	continue;
+      }
+      start(i, std::move(jobs.front()));
+      jobs.pop_front();
+    }
+
+    if (active == 1 || width == 1) {
+      // no lanes to share the work with. hash a part of each run, so that
+      // the streams submitted meanwhile can soon join in
+      for (unsigned i = 0; i < width; ++i) {
+	if (lane[i].busy) {
+	  const size_t blocks = std::min(lane[i].blocks, MAX_SCALAR_BLOCKS);
+	  hash_scalar(lane[i].state, lane[i].run, blocks);
+	  lane[i].run += blocks * BLOCK;
+	  lane[i].blocks -= blocks;
+	}
+      }
+    } else if (active > 1) {
+      size_t blocks = std::numeric_limits<size_t>::max();
+      uint32_t* state[MAX_LANES];
+      const unsigned char* data[MAX_LANES];
+      size_t stride[MAX_LANES];
+      // idle lanes hash the same zero block over and over
+      for (unsigned i = 0; i < width; ++i) {
+	if (lane[i].busy) {
+	  blocks = std::min(blocks, lane[i].blocks);
+	  state[i] = lane[i].state;
+	  data[i] = lane[i].run;
+	  stride[i] = BLOCK;
+	} else {
+	  state[i] = idle_state[i];
+	  data[i] = zeros;
+	  stride[i] = 0;
+	}
+      }
+      hash_lanes(width, state, data, stride, blocks);
+      for (unsigned i = 0; i < width; ++i) {
+	if (lane[i].busy) {
+	  lane[i].run += blocks * BLOCK;
+	  lane[i].blocks -= blocks;
+	}
+      }
+    }
+
+    // move on, or retire the lanes that hashed their run
+    for (unsigned i = 0; i < width; ++i) {
+      Lane& l = lane[i];
+      if (!l.busy || l.blocks > 0) {
+	continue;
+      }
+      Digest& d = *job[i].digest;
+      if (!next_run(l, d.partial, d.length, d.block)) {
+	l.busy = false;
+	l.data.clear();
+	--active;
+	completed.push_back(std::move(job[i].done));
+      }
+    }
+    for (auto& done : completed) {
+      done();
+    }
+    completed.clear();
+
+    lock.lock();
+  }
+}
+
+} // namespace rgw::md5_mb
@@ -0,0 +1,84 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "include/buffer.h"
+
+namespace rgw::md5_mb {
+
+// the MD5 of a stream, hashed a chunk at a time by a Hasher
+class Digest {
+  friend class Hasher;
+  uint32_t state[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+  uint64_t length = 0; // bytes consumed so far
+  uint32_t partial = 0; // bytes of block not hashed yet
+  unsigned char block[64];
+ public:
+  Digest() = default;
+  Digest(const Digest&) = delete;
+  Digest& operator=(const Digest&) = delete;
+};
+
+// hashes the chunks of many streams at once, in the SIMD lanes of one
+// thread: the blocks of up to lanes() streams go through each MD5 round
+// together, in the way of the multi-buffer hashing of ISA-L crypto. a
+// stream has at most one chunk in flight, and the callbacks run on the
+// hasher thread
+class Hasher {
+ public:
+  using Callback = std::function<void()>;
+
+  Hasher();
+  // hashes what was submitted, then stops the thread
+  ~Hasher();
+
+  // the streams this cpu hashes at once: 16 with AVX-512, 8 with AVX2, and
+  // 1 without, hashing them in turn
+  static unsigned lanes();
+
+  void update(Digest& digest, bufferlist data, Callback done);
+  // out gets the CEPH_CRYPTO_MD5_DIGESTSIZE bytes of the digest
+  void final(Digest& digest, unsigned char* out, Callback done);
+
+ private:
+  struct Job {
+    Digest* digest;
+    bufferlist data;
+    unsigned char* out = nullptr;
+    Callback done;
+  };
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<Job> queue;
+  bool stopping = false;
+  std::thread thread;
+
+  void submit(Job&& job);
+  void run();
+};
+
+// hash the given blocks of each lane, for tests and benchmarks. lanes is 1
+// or Hasher::lanes()
+void hash_blocks(unsigned lanes, uint32_t* const* state,
+		 const unsigned char* const* data, size_t blocks);
+
+} // namespace rgw::md5_mb
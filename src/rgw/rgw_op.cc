@@ -60,6 +60,7 @@
 #include "rgw_sal_rados.h"
 #include "rgw_torrent.h"
 #include "rgw_cksum_pipe.h"
+#include "rgw_putobj_hash.h"
 #include "rgw_lua_data_filter.h"
 #include "rgw_lua.h"
 #include "rgw_iam_managed_policy.h"
@@ -4385,6 +4386,27 @@ void RGWPutObj::execute(optional_yield y)
       filter = &*cksum_filter;
     }
   } /* !append */
+
+  /* hash the data of large uploads on the hash threads, while the request
+   * goes on with reading and writing it. with multi-buffer hashing, the
+   * ETags of small uploads go there too, to be hashed along with others */
+  std::optional<rgw::putobj::HashPipe> hash_pipe;
+  const uint64_t expected_size =
+    copy_source.empty() ? s->content_length : lst - fst + 1;
+  if (s->penv.hash_pool && (need_calc_md5 || cksum_filter) &&
+      (chunked_upload ||
+       expected_size >= s->cct->_conf.get_val<Option::size_t>("rgw_put_obj_hash_min_size") ||
+       (s->penv.hash_pool->multi_buffer() && !cksum_filter))) {
+    hash_pipe.emplace(filter, *s->penv.hash_pool, y,
+		      need_calc_md5 ? &hash : nullptr,
+		      cksum_filter ? cksum_filter->digest() : nullptr,
+		      s->cct->_conf->rgw_put_obj_min_window_size);
+    if (cksum_filter) {
+      cksum_filter->set_hashed_upstream();
+    }
+    filter = &*hash_pipe;
+  }
+
   tracepoint(rgw_op, before_data_transfer, s->req_id.c_str());
   do {
     bufferlist data;
@@ -4409,7 +4431,7 @@ void RGWPutObj::execute(optional_yield y)
       break;
     }
 
-    if (need_calc_md5) {
+    if (need_calc_md5 && !hash_pipe) {
       hash.Update((const unsigned char *)data.c_str(), data.length());
     }
 
@@ -4426,6 +4448,9 @@ void RGWPutObj::execute(optional_yield y)
 
   // flush any data in filters
   op_ret = filter->process({}, ofs);
+  if (hash_pipe) {
+    hash_pipe->drain();
+  }
   if (op_ret < 0) {
     return;
   }
@@ -4450,7 +4475,11 @@ void RGWPutObj::execute(optional_yield y)
     return;
   }
 
-  hash.Final(m);
+  if (hash_pipe && need_calc_md5) {
+    hash_pipe->final_md5(m);
+  } else {
+    hash.Final(m);
+  }
 
   if (compressor && compressor->is_compressed()) {
     bufferlist tmp;
@@ -26,6 +26,8 @@ void add_rgw_frontend_counters(PerfCountersBuilder *pcb) {
 
   pcb->add_u64_counter(l_rgw_cache_hit, "cache_hit", "Cache hits");
   pcb->add_u64_counter(l_rgw_cache_miss, "cache_miss", "Cache miss");
+  pcb->add_u64_counter(l_rgw_cache_lock_contended, "cache_lock_contended",
+                       "Cache lookups waiting for the lock of their shard");
 
   pcb->add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit", "Keystone token cache hits");
   pcb->add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
@@ -59,6 +61,12 @@ void add_rgw_frontend_counters(PerfCountersBuilder *pcb) {
   pcb->add_u64_counter(l_rgw_lua_script_ok, "lua_script_ok", "Successful executions of Lua scripts");
   pcb->add_u64_counter(l_rgw_lua_script_fail, "lua_script_fail", "Failed executions of Lua scripts");
   pcb->add_u64(l_rgw_lua_current_vms, "lua_current_vms", "Number of Lua VMs currently being executed");
+
+  pcb->add_u64_counter(l_rgw_index_complete_batch, "index_complete_batch", "Batches of bucket index complete ops sent");
+  pcb->add_u64_counter(l_rgw_index_complete_batch_ops, "index_complete_batch_ops", "Bucket index complete ops sent in batches");
+
+  pcb->add_u64_counter(l_rgw_get_obj_hedged, "get_obj_hedged", "Slow reads of object data sent again to a replica");
+  pcb->add_u64_counter(l_rgw_get_obj_hedge_won, "get_obj_hedge_won", "Hedged reads of object data that replied first");
 }
 
 void add_rgw_op_counters(PerfCountersBuilder *lpcb) {
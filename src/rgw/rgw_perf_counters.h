@@ -22,6 +22,7 @@ enum {
 
   l_rgw_cache_hit,
   l_rgw_cache_miss,
+  l_rgw_cache_lock_contended,
 
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
@@ -49,6 +50,12 @@ enum {
   l_rgw_lua_script_ok,
   l_rgw_lua_script_fail,
 
+  l_rgw_index_complete_batch,
+  l_rgw_index_complete_batch_ops,
+
+  l_rgw_get_obj_hedged,
+  l_rgw_get_obj_hedge_won,
+
   l_rgw_last,
 };
 
@@ -18,6 +18,9 @@ namespace rgw::auth {
 namespace rgw::lua {
   class Background;
 }
+namespace rgw::putobj {
+  class HashPool;
+}
 namespace rgw::sal {
   class ConfigStore;
   class Driver;
@@ -45,6 +48,7 @@ struct RGWProcessEnv {
   OpsLogSink *olog = nullptr;
   std::unique_ptr<rgw::auth::StrategyRegistry> auth_registry;
   ActiveRateLimiter* ratelimiting = nullptr;
+  rgw::putobj::HashPool* hash_pool = nullptr;
 
 #ifdef WITH_ARROW_FLIGHT
   // managed by rgw:flight::FlightFrontend in rgw_flight_frontend.cc
@@ -0,0 +1,146 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw_putobj_hash.h"
+
+#include <boost/asio/post.hpp>
+
+namespace rgw::putobj {
+
+template <typename Pred>
+void HashPipe::wait(std::unique_lock<std::mutex>& lock, Pred&& done)
+{
+  while (!done()) {
+    if (y) {
+      // suspend the coroutine, and drop the lock once it is suspended
+      auto yield = y.get_yield_context();
+      boost::system::error_code ec;
+      boost::asio::async_initiate<decltype(yield[ec]),
+				  void(boost::system::error_code)>(
+	  [this, &lock, &yield] (auto handler) {
+	    completion = Completion::create(yield.get_executor(),
+					    std::move(handler));
+	    lock.unlock();
+	  }, yield[ec]);
+      lock.lock();
+    } else {
+      cond.wait(lock);
+    }
+  }
+}
+
+void HashPipe::wake()
+{
+  if (completion) {
+    ceph::async::post(std::move(completion), boost::system::error_code{});
+  } else {
+    cond.notify_one();
+  }
+}
+
+void HashPipe::pop()
+{
+  pending_bytes -= pending.front().length();
+  pending.pop_front();
+  hashing = !pending.empty();
+}
+
+void HashPipe::hash()
+{
+  std::unique_lock lock{mutex};
+  while (!pending.empty()) {
+    // only push_back() is called on the deque while this runs, which
+    // leaves the reference to its front valid
+    const bufferlist& bl = pending.front();
+    lock.unlock();
+
+    for (const auto& ptr : bl.buffers()) {
+      const auto p = reinterpret_cast<const unsigned char*>(ptr.c_str());
+      if (md5) {
+	md5->Update(p, ptr.length());
+      }
+      if (digest) {
+	digest->Update(p, ptr.length());
+      }
+    }
+
+    lock.lock();
+    pop();
+    wake();
+  }
+}
+
+void HashPipe::submit()
+{
+  hasher->update(mb_digest, pending.front(), [this] { hashed(); });
+}
+
+void HashPipe::hashed()
+{
+  std::lock_guard lock{mutex};
+  pop();
+  if (hashing) {
+    submit();
+  }
+  wake();
+}
+
+int HashPipe::process(bufferlist&& data, uint64_t offset)
+{
+  if (data.length() > 0) {
+    std::unique_lock lock{mutex};
+    // make room for the chunk, but always accept one
+    const uint64_t room = max_pending > data.length() ?
+      max_pending - data.length() : 0;
+    wait(lock, [this, room] { return !hashing || pending_bytes <= room; });
+
+    // the chunk shares its buffers with the one passed on, which the
+    // following filters only read
+    pending.push_back(data);
+    pending_bytes += data.length();
+    if (!hashing) {
+      hashing = true;
+      if (hasher) {
+	submit();
+      } else {
+	boost::asio::post(ex, [this] { hash(); });
+      }
+    }
+  }
+  return Pipe::process(std::move(data), offset);
+}
+
+void HashPipe::drain()
+{
+  std::unique_lock lock{mutex};
+  wait(lock, [this] { return !hashing; });
+}
+
+void HashPipe::final_md5(unsigned char* m)
+{
+  std::unique_lock lock{mutex};
+  wait(lock, [this] { return !hashing; });
+  if (!hasher) {
+    md5->Final(m);
+    return;
+  }
+  hashing = true;
+  hasher->final(mb_digest, m, [this] {
+      std::lock_guard lock{mutex};
+      hashing = false;
+      wake();
+    });
+  wait(lock, [this] { return !hashing; });
+}
+
+} // namespace rgw::putobj
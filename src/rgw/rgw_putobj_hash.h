@@ -0,0 +1,119 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/asio/thread_pool.hpp>
+
+#include "common/async/completion.h"
+#include "common/async/yield_context.h"
+#include "common/ceph_crypto.h"
+#include "rgw_cksum_digest.h"
+#include "rgw_md5_mb.h"
+#include "rgw_putobj.h"
+
+namespace rgw::putobj {
+
+// the threads the uploads hash their data on. with multi_buffer, each thread
+// of a set of md5_mb::Hashers computes the ETags of many uploads at once
+class HashPool {
+  boost::asio::thread_pool pool;
+  std::vector<std::unique_ptr<md5_mb::Hasher>> hashers;
+  std::atomic<unsigned> next_hasher{0};
+ public:
+  HashPool(unsigned threads, bool multi_buffer) : pool(threads) {
+    if (multi_buffer) {
+      for (unsigned i = 0; i < threads; ++i) {
+	hashers.push_back(std::make_unique<md5_mb::Hasher>());
+      }
+    }
+  }
+  ~HashPool() { pool.join(); }
+
+  using executor_type = boost::asio::thread_pool::executor_type;
+  executor_type get_executor() { return pool.get_executor(); }
+
+  bool multi_buffer() const { return !hashers.empty(); }
+  // the hashers are handed out in turn, or null without multi_buffer
+  md5_mb::Hasher* get_hasher() {
+    if (hashers.empty()) {
+      return nullptr;
+    }
+    return hashers[next_hasher++ % hashers.size()].get();
+  }
+};
+
+// pipe that updates the ETag and checksum digests of the data on a HashPool,
+// so that hashing a chunk overlaps with reading the next one from the client
+// and with the processing of the chunk by the following filters. the chunks
+// are hashed in order, and at most max_pending bytes wait to be hashed.
+// drain() must be called before the digests are finalized. an ETag alone
+// goes to a multi-buffer hasher of the pool, if it has them, and is
+// finalized with final_md5()
+class HashPipe : public Pipe {
+  using Completion = ceph::async::Completion<void(boost::system::error_code)>;
+
+  HashPool::executor_type ex;
+  optional_yield y;
+  ceph::crypto::MD5* md5;
+  rgw::cksum::Digest* digest;
+  const uint64_t max_pending;
+  md5_mb::Hasher* hasher = nullptr; // hashes the md5 in mb_digest if set
+  md5_mb::Digest mb_digest;
+
+  std::mutex mutex;
+  std::condition_variable cond; // waiter without a coroutine
+  std::unique_ptr<Completion> completion; // waiting coroutine
+  std::deque<bufferlist> pending; // the front one is being hashed
+  uint64_t pending_bytes = 0;
+  bool hashing = false;
+
+  void hash(); // runs on the pool
+  void submit(); // passes the front chunk to the hasher
+  void hashed(); // called by the hasher
+  void pop(); // drops the hashed front chunk
+  void wake();
+  template <typename Pred>
+  void wait(std::unique_lock<std::mutex>& lock, Pred&& done);
+
+ public:
+  // md5 and digest may be null
+  HashPipe(rgw::sal::DataProcessor *next, HashPool& pool, optional_yield y,
+	   ceph::crypto::MD5* md5, rgw::cksum::Digest* digest,
+	   uint64_t max_pending)
+    : Pipe(next), ex(pool.get_executor()), y(y), md5(md5), digest(digest),
+      max_pending(max_pending)
+  {
+    if (md5 && !digest) {
+      hasher = pool.get_hasher();
+    }
+  }
+  ~HashPipe() override { drain(); }
+
+  int process(bufferlist&& data, uint64_t offset) override;
+
+  // wait for the data passed so far to be hashed
+  void drain();
+
+  // drain, then write the CEPH_CRYPTO_MD5_DIGESTSIZE bytes of the md5 to m
+  void final_md5(unsigned char* m);
+};
+
+} // namespace rgw::putobj
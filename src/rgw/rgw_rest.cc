@@ -775,9 +775,7 @@ void dump_range(req_state* const s,
 }
 
 
-int dump_body(req_state* const s,
-              const char* const buf,
-              const size_t len)
+static void ratelimit_sent(req_state* const s, const size_t len)
 {
   bool healthcheck = false;
   // we dont want to limit health checks
@@ -789,6 +787,13 @@ int dump_body(req_state* const s,
     if(!rgw::sal::Bucket::empty(s->bucket.get()))
       s->ratelimit_data->decrease_bytes(method, s->ratelimit_bucket_marker, len, &s->bucket_ratelimit);
   }
+}
+
+int dump_body(req_state* const s,
+              const char* const buf,
+              const size_t len)
+{
+  ratelimit_sent(s, len);
   try {
     return RESTFUL_IO(s)->send_body(buf, len);
   } catch (rgw::io::Exception& e) {
@@ -798,7 +803,13 @@ int dump_body(req_state* const s,
 
 int dump_body(req_state* const s, /* const */ ceph::buffer::list& bl)
 {
-  return dump_body(s, bl.c_str(), bl.length());
+  // hand the buffers to the frontend, which may send them without a copy
+  ratelimit_sent(s, bl.length());
+  try {
+    return RESTFUL_IO(s)->send_body_list(bl);
+  } catch (rgw::io::Exception& e) {
+    return -e.code().value();
+  }
 }
 
 int dump_body(req_state* const s, const std::string& str)
@@ -0,0 +1,190 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+// the rate of the bucket index completions of small object PUTs on one
+// index shard, sent one by one as bucket_complete_op and in batches as
+// bucket_complete_ops with rgw_bucket_index_complete_batch_window set.
+// run against a test cluster, e.g. vstart, which gets a temporary pool:
+//
+//   bench_cls_rgw_complete_ops --objects 20000 --batch 16 --concurrency 32
+
+#include "include/types.h"
+#include "cls/rgw/cls_rgw_client.h"
+#include "cls/rgw/cls_rgw_ops.h"
+#include "test/librados/test_cxx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+struct parameters {
+  uint64_t objects = 0;
+  uint64_t batch = 0;
+  uint64_t concurrency = 0; // calls in flight
+};
+
+static rgw_cls_obj_complete_op make_complete(librados::IoCtx& ioctx, uint64_t i)
+{
+  rgw_cls_obj_complete_op complete;
+  complete.op = CLS_RGW_OP_ADD;
+  complete.key = cls_rgw_obj_key("obj." + std::to_string(i));
+  complete.tag = "tag." + std::to_string(i);
+  complete.ver.pool = ioctx.get_id();
+  complete.ver.epoch = 1;
+  complete.meta.category = RGWObjCategory::Main;
+  complete.meta.size = 4096;
+  complete.meta.accounted_size = 4096;
+  complete.log_op = true;
+  return complete;
+}
+
+// run the calls, with at most concurrency of them in flight
+template <typename MakeOp>
+static int run_calls(librados::IoCtx& ioctx, const std::string& oid,
+		     uint64_t calls, uint64_t concurrency, MakeOp&& make_op)
+{
+  std::deque<librados::AioCompletion*> inflight;
+  auto wait_front = [&inflight] {
+    auto c = inflight.front();
+    inflight.pop_front();
+    c->wait_for_complete();
+    int r = c->get_return_value();
+    c->release();
+    return r;
+  };
+  int ret = 0;
+  for (uint64_t i = 0; i < calls; ++i) {
+    if (inflight.size() >= concurrency) {
+      ret = std::min(ret, wait_front());
+    }
+    librados::ObjectWriteOperation op;
+    make_op(op, i);
+    auto c = librados::Rados::aio_create_completion();
+    ioctx.aio_operate(oid, c, &op);
+    inflight.push_back(c);
+  }
+  while (!inflight.empty()) {
+    ret = std::min(ret, wait_front());
+  }
+  return ret;
+}
+
+// the index completions of p.objects PUTs, in calls of batch ops
+static double run(librados::IoCtx& ioctx, const parameters& p, uint64_t batch)
+{
+  const std::string oid = "bench.index." + std::to_string(batch);
+  {
+    librados::ObjectWriteOperation op;
+    cls_rgw_bucket_init_index(op);
+    if (int r = ioctx.operate(oid, &op); r < 0) {
+      std::cerr << "failed to init the index " << oid << ": " << r << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  const rgw_zone_set zones_trace;
+  int r = run_calls(ioctx, oid, p.objects, p.concurrency,
+    [&] (librados::ObjectWriteOperation& op, uint64_t i) {
+      const auto complete = make_complete(ioctx, i);
+      cls_rgw_bucket_prepare_op(op, CLS_RGW_OP_ADD, complete.tag, complete.key,
+				"", true, 0, zones_trace);
+    });
+  if (r < 0) {
+    std::cerr << "failed to prepare the index ops: " << r << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  const uint64_t calls = (p.objects + batch - 1) / batch;
+  const auto start = Clock::now();
+  r = run_calls(ioctx, oid, calls, p.concurrency,
+    [&] (librados::ObjectWriteOperation& op, uint64_t call) {
+      const uint64_t first = call * batch;
+      const uint64_t last = std::min(p.objects, first + batch);
+      if (batch == 1) {
+	const auto complete = make_complete(ioctx, first);
+	cls_rgw_bucket_complete_op(op, complete.op, complete.tag, complete.ver,
+				   complete.key, complete.meta, nullptr,
+				   complete.log_op, 0, nullptr);
+	return;
+      }
+      std::vector<rgw_cls_obj_complete_op> ops;
+      for (uint64_t i = first; i < last; ++i) {
+	ops.push_back(make_complete(ioctx, i));
+      }
+      cls_rgw_bucket_complete_ops(op, ops);
+    });
+  const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  if (r < 0) {
+    std::cerr << "failed to complete the index ops: " << r << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return p.objects / elapsed;
+}
+
+int main(int argc, char** argv)
+{
+  parameters p;
+  try {
+    using namespace boost::program_options;
+    options_description desc{"Options"};
+    desc.add_options()
+      ("help,h", "Help screen")
+      ("objects", value<uint64_t>()->default_value(10000), "PUTs to complete")
+      ("batch", value<uint64_t>()->default_value(16), "rgw_bucket_index_complete_batch_max")
+      ("concurrency", value<uint64_t>()->default_value(32), "index calls in flight");
+    variables_map vm;
+    store(parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    p.objects = vm["objects"].as<uint64_t>();
+    p.batch = std::max<uint64_t>(1, vm["batch"].as<uint64_t>());
+    p.concurrency = std::max<uint64_t>(1, vm["concurrency"].as<uint64_t>());
+  } catch (const boost::program_options::error& ex) {
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  librados::Rados rados;
+  const std::string pool_name = get_temp_pool_name();
+  if (auto err = create_one_pool_pp(pool_name, rados); !err.empty()) {
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+  }
+  librados::IoCtx ioctx;
+  if (int r = rados.ioctx_create(pool_name.c_str(), ioctx); r < 0) {
+    std::cerr << "failed to open the pool " << pool_name << ": " << r << std::endl;
+    destroy_one_pool_pp(pool_name, rados);
+    return EXIT_FAILURE;
+  }
+
+  const auto single = run(ioctx, p, 1);
+  std::cout << "bucket_complete_op: " << single << " completions/s" << std::endl;
+  if (p.batch > 1) {
+    const auto batched = run(ioctx, p, p.batch);
+    std::cout << "bucket_complete_ops of " << p.batch << ": " << batched
+	      << " completions/s, x" << batched / single << std::endl;
+  }
+
+  ioctx.close();
+  destroy_one_pool_pp(pool_name, rados);
+  return EXIT_SUCCESS;
+}
@@ -1480,6 +1480,60 @@ TEST_F(cls_rgw, reshardlog_num)
   reshardlog_entries(ioctx, bucket_oid, 2u);
 }
 
+TEST_F(cls_rgw, reshardlog_trim_entries)
+{
+  string bucket_oid = str_int("reshard3", 0);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::IN_LOGRECORD);
+
+  cls_rgw_obj_key obj1 = str_int("obj1", 0);
+  cls_rgw_obj_key obj2 = str_int("obj2", 0);
+  string tag = str_int("tag-prepare", 0);
+  string loc = str_int("loc", 0);
+  rgw_bucket_dir_entry_meta meta;
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj1, loc);
+  index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 1, obj1, meta);
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj2, loc);
+  index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 2, obj2, meta);
+  reshardlog_entries(ioctx, bucket_oid, 2u);
+
+  bool is_truncated = false;
+  std::list<rgw_cls_bi_entry> entries;
+  ASSERT_EQ(0, reshardlog_list(ioctx, bucket_oid, &entries, &is_truncated));
+  ASSERT_EQ(2u, entries.size());
+
+  // overwrite obj2 after its entry was listed
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj2, loc);
+  index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 3, obj2, meta);
+  reshardlog_entries(ioctx, bucket_oid, 3u);
+
+  // only the entry of obj1 is trimmed
+  {
+    ObjectWriteOperation op;
+    cls_rgw_reshard_log_trim_entries(op, {entries.begin(), entries.end()});
+    ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+  }
+  reshardlog_entries(ioctx, bucket_oid, 2u);
+  entries.clear();
+  ASSERT_EQ(0, reshardlog_list(ioctx, bucket_oid, &entries, &is_truncated));
+  ASSERT_EQ(1u, entries.size());
+
+  // trimming it once listed again leaves the log empty
+  {
+    ObjectWriteOperation op;
+    cls_rgw_reshard_log_trim_entries(op, {entries.begin(), entries.end()});
+    ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+  }
+  reshardlog_entries(ioctx, bucket_oid, 1u);
+  entries.clear();
+  ASSERT_EQ(0, reshardlog_list(ioctx, bucket_oid, &entries, &is_truncated));
+  ASSERT_EQ(0u, entries.size());
+}
+
 TEST_F(cls_rgw, bi_put_entries)
 {
   const string src_bucket = str_int("bi_put_entries", 0);
@@ -1570,3 +1624,79 @@ TEST_F(cls_rgw, bi_put_entries)
     test_stats(ioctx, dst_bucket, RGWObjCategory::Main, 3, 24576);
   }
 }
+
+TEST_F(cls_rgw, index_complete_batch)
+{
+  string bucket_oid = str_int("bucket", 9);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  const uint64_t obj_size = 1024;
+  std::vector<rgw_cls_obj_complete_op> ops;
+  for (int i = 0; i < NUM_OBJS; i++) {
+    cls_rgw_obj_key obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+
+    rgw_cls_obj_complete_op complete;
+    complete.op = CLS_RGW_OP_ADD;
+    complete.key = obj;
+    complete.tag = tag;
+    complete.ver.pool = ioctx.get_id();
+    complete.ver.epoch = 1;
+    complete.meta.category = RGWObjCategory::None;
+    complete.meta.size = obj_size;
+    complete.meta.accounted_size = obj_size;
+    complete.log_op = true;
+    ops.push_back(std::move(complete));
+  }
+  // an op whose prepare is unknown is skipped, the others are applied
+  {
+    rgw_cls_obj_complete_op complete = ops.front();
+    complete.key = str_int("obj", NUM_OBJS);
+    complete.tag = "unknown";
+    ops.push_back(std::move(complete));
+  }
+  {
+    ObjectWriteOperation op;
+    cls_rgw_bucket_complete_ops(op, ops);
+    ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+  }
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS,
+	     obj_size * NUM_OBJS);
+
+  // one bilog entry for each op applied
+  {
+    cls_rgw_bi_log_list_ret bilog;
+    ASSERT_EQ(0, bilog_list(ioctx, bucket_oid, &bilog));
+    ASSERT_EQ(size_t(NUM_OBJS), bilog.entries.size());
+    std::set<std::string> ids;
+    for (const auto& entry : bilog.entries) {
+      ids.insert(entry.id);
+    }
+    EXPECT_EQ(size_t(NUM_OBJS), ids.size());
+  }
+
+  // nothing is applied while the bucket is resharding
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::IN_PROGRESS);
+  {
+    std::vector<rgw_cls_obj_complete_op> deletes;
+    for (int i = 0; i < NUM_OBJS; i++) {
+      rgw_cls_obj_complete_op complete;
+      complete.op = CLS_RGW_OP_DEL;
+      complete.key = str_int("obj", i);
+      complete.ver.pool = ioctx.get_id();
+      complete.ver.epoch = 2;
+      deletes.push_back(std::move(complete));
+    }
+    ObjectWriteOperation op;
+    cls_rgw_bucket_complete_ops(op, deletes);
+    ASSERT_EQ(-CLS_RGW_ERR_BUSY_RESHARDING, ioctx.operate(bucket_oid, &op));
+  }
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS,
+	     obj_size * NUM_OBJS);
+}
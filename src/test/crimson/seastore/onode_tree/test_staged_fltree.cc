@@ -197,6 +197,34 @@ TEST_F(a_basic_test_t, 2_node_sizes)
   });
 }
 
+TEST_F(a_basic_test_t, 2_search_key_order)
+{
+  auto check_order = [](const auto& keys) {
+    for (auto& l : keys) {
+      for (auto& r : keys) {
+        ASSERT_EQ(l <=> r, to_search_key(l) <=> to_search_key(r))
+          << l << " vs " << r;
+      }
+    }
+  };
+  std::vector<shard_pool_crush_t> spcs;
+  for (shard_t shard : {INT8_MIN, -1, 0, 1, INT8_MAX}) {
+    for (pool_t pool : {INT64_MIN, -2l, -1l, 0l, 1l, INT64_MAX}) {
+      for (crush_hash_t crush : {0u, 1u, 0x80000000u, UINT32_MAX}) {
+        spcs.push_back({{shard, pool}, {crush}});
+      }
+    }
+  }
+  check_order(spcs);
+  std::vector<snap_gen_t> sgs;
+  for (snap_t snap : {0ul, 1ul, UINT64_MAX - 1, UINT64_MAX}) {
+    for (gen_t gen : {0ul, 1ul, UINT64_MAX}) {
+      sgs.push_back({snap, gen});
+    }
+  }
+  check_order(sgs);
+}
+
 struct b_dummy_tree_test_t : public seastar_test_suite_t {
   TransactionRef ref_t;
   std::unique_ptr<UnboundedBtree> tree;
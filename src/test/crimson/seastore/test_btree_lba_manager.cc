@@ -852,3 +852,84 @@ TEST_F(btree_lba_manager_test, split_merge_multi)
     check_mappings();
   });
 }
+
+TEST(lba_map_val_le_t, compressed_len)
+{
+  // the leaves keep the layout of the stores made before compression
+  static_assert(sizeof(lba_map_val_le_t) == 21);
+  static_assert(LEAF_NODE_CAPACITY == 140);
+
+  auto paddr = paddr_t::make_seg_paddr(segment_id_t{0, 1}, 4096);
+  for (extent_len_t compressed_len : {
+	 extent_len_t(0), COMPRESSED_LENGTH_UNIT, MAX_COMPRESSED_LENGTH}) {
+    lba_map_val_t val{16 << 20, pladdr_t(paddr), 2, 0x1234, compressed_len};
+    EXPECT_EQ(val, lba_map_val_t(lba_map_val_le_t(val)));
+  }
+
+  // and the mappings of raw extents are encoded as they were
+  lba_map_val_t val{4096, pladdr_t(paddr), 1, 0};
+  EXPECT_EQ(lba_map_val_le_t(val).pladdr.addr_type, addr_type_t::PADDR);
+  val.pladdr = pladdr_t(laddr_t::from_byte_offset(8192));
+  EXPECT_EQ(lba_map_val_le_t(val).pladdr.addr_type, addr_type_t::LADDR);
+  EXPECT_EQ(val, lba_map_val_t(lba_map_val_le_t(val)));
+}
+
+TEST(seastore_meta_t, format_version)
+{
+  // a store made now may map compressed extents, version 1 refuses to mount it
+  seastore_meta_t meta;
+  ceph::bufferlist bl;
+  encode(meta, bl);
+  seastore_meta_t decoded;
+  auto p = bl.cbegin();
+  decode(decoded, p);
+  EXPECT_EQ(decoded.format_version, SEASTORE_FORMAT_VERSION);
+  EXPECT_TRUE(decoded.supports_compression());
+  EXPECT_TRUE(decoded.is_mountable());
+  EXPECT_FALSE(decoded.is_mountable(1));
+
+  // the stores made before keep their extents raw, so version 1 can still
+  // mount them
+  decoded.format_version = 1;
+  EXPECT_FALSE(decoded.supports_compression());
+  EXPECT_TRUE(decoded.is_mountable());
+  EXPECT_TRUE(decoded.is_mountable(1));
+
+  decoded.format_version = SEASTORE_FORMAT_VERSION + 1;
+  EXPECT_FALSE(decoded.is_mountable());
+}
+
+// seastore_meta_t as version 1 decodes it
+struct seastore_meta_v1_t {
+  uuid_d seastore_id;
+
+  DENC(seastore_meta_v1_t, v, p) {
+    DENC_START(1, 1, p);
+    denc(v.seastore_id, p);
+    DENC_FINISH(p);
+  }
+};
+WRITE_CLASS_DENC(seastore_meta_v1_t)
+
+TEST(seastore_meta_t, decode_with_v1)
+{
+  // version 1 fails to decode the meta of a store made now
+  seastore_meta_t meta;
+  meta.seastore_id.generate_random();
+  ceph::bufferlist bl;
+  encode(meta, bl);
+  seastore_meta_v1_t v1;
+  auto p = bl.cbegin();
+  EXPECT_THROW(decode(v1, p), ceph::buffer::malformed_input);
+
+  // and the meta version 1 made still decodes, as a store of version 1
+  v1.seastore_id = meta.seastore_id;
+  bl.clear();
+  encode(v1, bl);
+  seastore_meta_t decoded;
+  p = bl.cbegin();
+  decode(decoded, p);
+  EXPECT_EQ(decoded.seastore_id, meta.seastore_id);
+  EXPECT_EQ(decoded.format_version, 1u);
+  EXPECT_FALSE(decoded.supports_compression());
+}
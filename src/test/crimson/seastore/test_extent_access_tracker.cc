@@ -0,0 +1,59 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 smarttab expandtab
+
+#include "test/crimson/gtest_seastar.h"
+#include "crimson/os/seastore/extent_access_tracker.h"
+
+using namespace crimson::os::seastore;
+
+struct access_tracker_test_t : public seastar_test_suite_t {
+  ExtentAccessTracker tracker;
+
+  static laddr_t make_laddr(uint64_t i) {
+    return laddr_t::from_raw_uint(i << 4);
+  }
+};
+
+TEST_F(access_tracker_test_t, disabled)
+{
+  tracker.init(1024, 0);
+  EXPECT_FALSE(tracker.is_enabled());
+  tracker.record_access(make_laddr(1), false);
+  EXPECT_FALSE(tracker.is_hot(make_laddr(1)));
+}
+
+TEST_F(access_tracker_test_t, hot_extents)
+{
+  tracker.init(1024, 4);
+  for (uint64_t i = 0; i < 256; ++i) {
+    tracker.record_access(make_laddr(i), false);
+  }
+  for (int n = 0; n < 8; ++n) {
+    tracker.record_access(make_laddr(1000), true);
+  }
+  EXPECT_TRUE(tracker.is_hot(make_laddr(1000)));
+  unsigned hot = 0;
+  for (uint64_t i = 0; i < 256; ++i) {
+    if (tracker.is_hot(make_laddr(i))) {
+      ++hot;
+    }
+  }
+  // few extents accessed once may share all their counters with hot ones
+  EXPECT_LT(hot, 4u);
+}
+
+TEST_F(access_tracker_test_t, aging)
+{
+  tracker.init(64, 4);
+  for (int n = 0; n < 8; ++n) {
+    tracker.record_access(make_laddr(1), false);
+  }
+  EXPECT_TRUE(tracker.is_hot(make_laddr(1)));
+  // with 64 wide rows, the counters are halved once 640 accesses are
+  // recorded, and then after every 320 accesses
+  for (int n = 0; n < 952; ++n) {
+    tracker.record_access(make_laddr(2), false);
+  }
+  EXPECT_FALSE(tracker.is_hot(make_laddr(1)));
+  EXPECT_TRUE(tracker.is_hot(make_laddr(2)));
+}
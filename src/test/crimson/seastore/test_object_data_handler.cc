@@ -110,6 +110,7 @@ struct object_data_handler_test_t:
 
   bufferptr known_contents;
   extent_len_t size = 0;
+  compression_params_t compression;
   std::random_device rd;
   std::mt19937 gen;
 
@@ -134,7 +135,7 @@ struct object_data_handler_test_t:
     with_trans_intr(t, [&](auto &t) {
       return seastar::do_with(
 	std::move(bl),
-	ObjectDataHandler(MAX_OBJECT_SIZE),
+	ObjectDataHandler(MAX_OBJECT_SIZE, compression),
 	[=, this, &t](auto &bl, auto &objhandler) {
 	  return objhandler.write(
 	    ObjectDataHandler::context_t{
@@ -161,7 +162,7 @@ struct object_data_handler_test_t:
 	size - offset);
       with_trans_intr(t, [&](auto &t) {
       return seastar::do_with(
-	ObjectDataHandler(MAX_OBJECT_SIZE),
+	ObjectDataHandler(MAX_OBJECT_SIZE, compression),
 	[=, this, &t](auto &objhandler) {
 	  return objhandler.truncate(
 	    ObjectDataHandler::context_t{
@@ -286,6 +287,25 @@ struct object_data_handler_test_t:
     crimson::common::local_conf().set_val("seastore_data_delta_based_overwrite", "0").get();
   }
 
+  void enable_compression() {
+    compression.algorithm = Compressor::COMP_ALG_SNAPPY;
+    compression.required_ratio = 0.875;
+  }
+  void disable_compression() {
+    compression = {};
+  }
+  // only the segmented ool writers compress
+  bool expect_compressed() const {
+    return epm->get_main_backend_type() == backend_type_t::SEGMENTED;
+  }
+  void check_compressed(objaddr_t offset, extent_len_t len) {
+    for (auto &pin : get_mappings(offset, len)) {
+      if (!pin->get_val().is_zero()) {
+	EXPECT_EQ(pin->is_compressed(), expect_compressed());
+      }
+    }
+  }
+
   void disable_max_extent_size() {
     epm->set_max_extent_size(16777216);
     crimson::common::local_conf().set_val(
@@ -783,6 +803,89 @@ TEST_P(object_data_handler_test_t, random_overwrite) {
   });
 }
 
+TEST_P(object_data_handler_test_t, compressed_write) {
+  run_async([this] {
+    disable_max_extent_size();
+    enable_compression();
+    write(0, 128<<10, 'x');
+    write(128<<10, 64<<10, 'a');
+    check_compressed(0, 192<<10);
+    read(0, 192<<10);
+    restart();
+    epm->check_usage();
+    check_compressed(0, 192<<10);
+    read_near(64<<10, 64<<10, 512);
+    read(0, 192<<10);
+    disable_compression();
+    enable_max_extent_size();
+  });
+}
+
+TEST_P(object_data_handler_test_t, compressed_overwrite) {
+  run_async([this] {
+    disable_max_extent_size();
+    enable_compression();
+    write(0, 128<<10, 'x');
+    restart();
+    // compressed extents are never remapped, the partial overwrites
+    // rewrite the whole extent instead
+    write(64<<10, 60<<10, 'a');
+    write(4<<10, 8<<10, 'b');
+    if (expect_compressed()) {
+      auto pins = get_mappings(0, 128<<10);
+      EXPECT_EQ(pins.size(), 1);
+    }
+    check_compressed(0, 128<<10);
+    read(0, 128<<10);
+    restart();
+    epm->check_usage();
+    read(0, 128<<10);
+    disable_compression();
+    enable_max_extent_size();
+  });
+}
+
+TEST_P(object_data_handler_test_t, compressed_truncate) {
+  run_async([this] {
+    disable_max_extent_size();
+    enable_compression();
+    write(0, 128<<10, 'x');
+    restart();
+    truncate(64<<10);
+    check_compressed(0, 64<<10);
+    read(0, 128<<10);
+    truncate(0);
+    restart();
+    epm->check_usage();
+    read(0, 128<<10);
+    disable_compression();
+    enable_max_extent_size();
+  });
+}
+
+TEST_P(object_data_handler_test_t, compressed_random_overwrite) {
+  run_async([this] {
+    enable_compression();
+    constexpr size_t TOTAL = 4<<20;
+    constexpr size_t BSIZE = 4<<10;
+    for (unsigned i = 0; i < 4; ++i) {
+      for (unsigned j = 0; j < 50; ++j) {
+	auto t = create_mutate_transaction();
+	for (unsigned k = 0; k < 2; ++k) {
+	  write(*t, get_random_write_offset(BSIZE, TOTAL - (64<<10)),
+	    std::uniform_int_distribution<>(1, 64<<10)(gen),
+	    (char)((j*k) % std::numeric_limits<char>::max()));
+	}
+	submit_transaction(std::move(t));
+      }
+      restart();
+      epm->check_usage();
+    }
+    read(0, 4<<20);
+    disable_compression();
+  });
+}
+
 TEST_P(object_data_handler_test_t, overwrite_then_read_within_transaction) {
   run_async([this] {
     disable_max_extent_size();
@@ -0,0 +1,204 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/crimson/gtest_seastar.h"
+
+#include <seastar/core/sleep.hh>
+
+#include "crimson/common/log.h"
+#include "crimson/os/seastore/journal/record_submitter.h"
+
+using namespace crimson;
+using namespace crimson::os;
+using namespace crimson::os::seastore;
+using namespace std::chrono_literals;
+
+namespace {
+  [[maybe_unused]] seastar::logger& logger() {
+    return crimson::get_logger(ceph_subsys_test);
+  }
+}
+
+// writes nowhere, each write taking write_latency
+struct test_journal_allocator_t final : journal::JournalAllocator {
+  const std::string name = "test";
+  const extent_len_t block_size = 4096;
+  std::chrono::microseconds write_latency = 20ms;
+  // the length of each write
+  std::vector<extent_len_t> writes;
+  segment_off_t written_to = 0;
+
+  const std::string& get_name() const final { return name; }
+
+  void update_modify_time(record_t&) final {}
+
+  extent_len_t get_block_size() const final { return block_size; }
+
+  close_ertr::future<> close() final { return close_ertr::now(); }
+
+  segment_nonce_t get_nonce() const final { return 0; }
+
+  journal_seq_t get_written_to() const final {
+    return journal_seq_t{
+      0, paddr_t::make_seg_paddr(segment_id_t{0, 0}, written_to)};
+  }
+
+  write_ertr::future<> write(ceph::bufferlist&& to_write) final {
+    written_to += to_write.length();
+    writes.push_back(to_write.length());
+    return seastar::sleep(write_latency);
+  }
+
+  bool can_write() const final { return true; }
+
+  roll_ertr::future<> roll() final { return roll_ertr::now(); }
+
+  bool needs_roll(std::size_t) const final { return false; }
+
+  open_ret open(bool) final {
+    return open_ertr::make_ready_future<journal_seq_t>(get_written_to());
+  }
+};
+
+struct record_submitter_test_t : public seastar_test_suite_t {
+  static constexpr std::size_t batch_capacity = 4;
+  static constexpr double preferred_fullness = 0.9;
+
+  test_journal_allocator_t allocator;
+  std::optional<journal::RecordSubmitter> submitter;
+
+  record_submitter_test_t() = default;
+
+  seastar::future<> tear_down_fut() final {
+    if (!submitter) {
+      return seastar::now();
+    }
+    return submitter->close(
+    ).handle_error(
+      crimson::ct_error::assert_all{"Unable to close"}
+    );
+  }
+
+  void open(std::chrono::microseconds group_commit_max_delay) {
+    submitter.emplace(
+      2, batch_capacity, 1 << 20, preferred_fullness,
+      group_commit_max_delay, allocator);
+    submitter->open(true).unsafe_get();
+  }
+
+  // as if the records had been written in write_latency, and submitted
+  // submit_gap apart
+  void prime(std::chrono::microseconds submit_gap) {
+    submitter->avg_write_latency = allocator.write_latency.count();
+    submitter->avg_submit_gap = submit_gap.count();
+    submitter->last_submit_time =
+      journal::RecordSubmitter::clock_t::now() - submit_gap;
+  }
+
+  record_t make_record(std::size_t data_blocks) {
+    std::vector<extent_t> extents;
+    if (data_blocks) {
+      bufferlist bl;
+      bl.append(buffer::ptr(buffer::create(
+        data_blocks * allocator.block_size, 'a')));
+      extents.push_back(extent_t{
+        extent_types_t::TEST_BLOCK,
+        L_ADDR_NULL,
+        bl});
+    }
+    bufferlist bl;
+    bl.append(buffer::ptr(buffer::create(64, 'b')));
+    std::vector<delta_info_t> deltas;
+    deltas.push_back(delta_info_t{
+      extent_types_t::TEST_BLOCK,
+      paddr_t{},
+      L_ADDR_NULL,
+      0, 0,
+      allocator.block_size,
+      1,
+      MAX_SEG_SEQ,
+      segment_type_t::NULL_SEG,
+      bl
+    });
+    return record_t(std::move(extents), std::move(deltas));
+  }
+
+  auto submit(std::size_t data_blocks = 0) {
+    EXPECT_TRUE(submitter->is_available());
+    return submitter->submit(make_record(data_blocks)).future;
+  }
+};
+
+TEST_F(record_submitter_test_t, group_commit_timer_flush)
+{
+  run_async([this] {
+    open(5ms);
+    // the window is min(5ms, 20ms / 2)
+    prime(100us);
+    auto start = seastar::steady_clock_type::now();
+    auto fut1 = submit();
+    // held for the records expected within the window
+    EXPECT_TRUE(allocator.writes.empty());
+    auto fut2 = submit();
+    EXPECT_TRUE(allocator.writes.empty());
+    auto locator1 = fut1.unsafe_get();
+    auto locator2 = fut2.unsafe_get();
+    EXPECT_GE(seastar::steady_clock_type::now() - start, 5ms);
+    ASSERT_EQ(allocator.writes.size(), 1u);
+    EXPECT_EQ(locator1.write_result.start_seq,
+              locator2.write_result.start_seq);
+  });
+}
+
+TEST_F(record_submitter_test_t, group_commit_size_flush)
+{
+  run_async([this] {
+    open(5ms);
+    prime(100us);
+    // filling the batch to its capacity flushes it at once
+    std::vector<journal::RecordBatch::add_pending_fut> futs;
+    for (std::size_t i = 0; i < batch_capacity; ++i) {
+      EXPECT_TRUE(allocator.writes.empty());
+      futs.push_back(submit());
+    }
+    ASSERT_EQ(allocator.writes.size(), 1u);
+    for (auto& fut : futs) {
+      fut.unsafe_get();
+    }
+
+    prime(100us);
+    auto fut = submit();
+    EXPECT_EQ(allocator.writes.size(), 1u);
+    // and so does a record filling the batch past preferred_fullness
+    auto fut_full = submit(16);
+    ASSERT_EQ(allocator.writes.size(), 2u);
+    fut.unsafe_get();
+    fut_full.unsafe_get();
+    // the timer didn't write anything else
+    seastar::sleep(10ms).get();
+    EXPECT_EQ(allocator.writes.size(), 2u);
+  });
+}
+
+TEST_F(record_submitter_test_t, group_commit_not_delayed)
+{
+  run_async([this] {
+    open(5ms);
+    // no further record is expected within the window
+    prime(10ms);
+    auto fut = submit();
+    EXPECT_EQ(allocator.writes.size(), 1u);
+    fut.unsafe_get();
+  });
+}
+
+TEST_F(record_submitter_test_t, group_commit_disabled)
+{
+  run_async([this] {
+    open(0us);
+    prime(100us);
+    auto fut = submit();
+    EXPECT_EQ(allocator.writes.size(), 1u);
+    fut.unsafe_get();
+  });
+}
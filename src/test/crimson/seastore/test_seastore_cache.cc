@@ -127,6 +127,34 @@ struct cache_test_t : public seastar_test_suite_t {
     );
   }
 
+  // a clean extent at paddr, as if it was read from disk
+  template <typename T>
+  static TCachedExtentRef<T> make_clean_extent(paddr_t paddr) {
+    auto ref = CachedExtent::make_cached_extent_ref<T>(
+      ceph::bufferptr(ceph::buffer::create_page_aligned(T::SIZE)));
+    ref->state = CachedExtent::extent_state_t::CLEAN;
+    ref->set_paddr(paddr);
+    return ref;
+  }
+
+  static paddr_t make_paddr(segment_id_t seg, std::size_t block) {
+    return paddr_t::make_seg_paddr(seg, block * TestBlock::SIZE);
+  }
+
+  static bool is_cached(const CachedExtent &extent) {
+    return extent.primary_ref_list_hook.is_linked();
+  }
+
+  static bool is_protected(const CachedExtent &extent) {
+    return is_cached(extent) && extent.lru_protected;
+  }
+
+  // room for 16 blocks, 4 of them on probation, and 8 evicted remembered
+  static constexpr std::size_t LRU_BLOCKS = 16;
+  Cache::LRU make_lru() {
+    return Cache::LRU(LRU_BLOCKS * TestBlock::SIZE, 0.25, 0.5);
+  }
+
   seastar::future<> tear_down_fut() final {
     return cache->close(
     ).safe_then([this] {
@@ -275,3 +303,115 @@ TEST_F(cache_test_t, test_dirty_extent)
     }
   });
 }
+
+TEST_F(cache_test_t, lru_scan_resistance)
+{
+  run_async([this] {
+    auto lru = make_lru();
+    std::vector<TestBlockPhysical::Ref> hot;
+    for (std::size_t i = 0; i < LRU_BLOCKS / 2; ++i) {
+      hot.push_back(make_clean_extent<TestBlockPhysical>(
+        make_paddr(segment_id_t{0, 0}, i)));
+      lru.move_to_top(*hot.back(), nullptr);
+      ASSERT_FALSE(is_protected(*hot.back()));
+      // metadata is promoted on its second access
+      lru.move_to_top(*hot.back(), nullptr);
+      ASSERT_TRUE(is_protected(*hot.back()));
+    }
+    EXPECT_EQ(lru.get_num_promoted(), hot.size());
+
+    // a single pass over many more data extents than the cache can hold,
+    // each of them accessed twice in a row, as by a read-modify-write
+    std::vector<TestBlock::Ref> scanned;
+    for (std::size_t i = 0; i < LRU_BLOCKS * 4; ++i) {
+      scanned.push_back(make_clean_extent<TestBlock>(
+        make_paddr(segment_id_t{0, 1}, i)));
+      lru.move_to_top(*scanned.back(), nullptr);
+      lru.move_to_top(*scanned.back(), nullptr);
+      ASSERT_FALSE(is_protected(*scanned.back()));
+      ASSERT_LE(lru.get_current_size_bytes(), lru.get_capacity_bytes());
+    }
+    // only evicted the scanned extents
+    for (auto &extent : hot) {
+      EXPECT_TRUE(is_protected(*extent));
+    }
+    EXPECT_EQ(lru.get_num_promoted(), hot.size());
+    EXPECT_EQ(lru.get_num_ghost_hits(), 0u);
+    EXPECT_EQ(lru.get_current_num_extents(), LRU_BLOCKS);
+    EXPECT_EQ(lru.get_probation_num_extents(), LRU_BLOCKS - hot.size());
+    EXPECT_TRUE(is_cached(*scanned.back()));
+    EXPECT_FALSE(is_cached(*scanned.front()));
+  });
+}
+
+TEST_F(cache_test_t, lru_ghost_promotion)
+{
+  run_async([this] {
+    auto lru = make_lru();
+    auto extent = make_clean_extent<TestBlock>(
+      make_paddr(segment_id_t{0, 0}, 0));
+    lru.move_to_top(*extent, nullptr);
+    std::vector<TestBlock::Ref> others;
+    for (std::size_t i = 0; i < LRU_BLOCKS; ++i) {
+      others.push_back(make_clean_extent<TestBlock>(
+        make_paddr(segment_id_t{0, 1}, i)));
+      lru.move_to_top(*others.back(), nullptr);
+    }
+    // evicted from probation, and remembered
+    ASSERT_FALSE(is_cached(*extent));
+    EXPECT_EQ(lru.get_ghost_size_bytes(), TestBlock::SIZE);
+
+    // read again soon enough, so it is reused
+    lru.move_to_top(*extent, nullptr);
+    EXPECT_TRUE(is_protected(*extent));
+    EXPECT_EQ(lru.get_num_ghost_hits(), 1u);
+    EXPECT_EQ(lru.get_ghost_size_bytes(), TestBlock::SIZE);
+
+    // the extents evicted long ago are forgotten
+    std::vector<TestBlock::Ref> more;
+    for (std::size_t i = 0; i < LRU_BLOCKS * 2; ++i) {
+      more.push_back(make_clean_extent<TestBlock>(
+        make_paddr(segment_id_t{0, 2}, i)));
+      lru.move_to_top(*more.back(), nullptr);
+    }
+    EXPECT_EQ(lru.get_ghost_size_bytes(), LRU_BLOCKS / 2 * TestBlock::SIZE);
+    ASSERT_FALSE(is_cached(*others.front()));
+    lru.move_to_top(*others.front(), nullptr);
+    EXPECT_FALSE(is_protected(*others.front()));
+    EXPECT_EQ(lru.get_num_ghost_hits(), 1u);
+    EXPECT_TRUE(is_protected(*extent));
+  });
+}
+
+TEST_F(cache_test_t, lru_ghost_space_freed)
+{
+  run_async([this] {
+    auto lru = make_lru();
+    std::vector<TestBlock::Ref> extents;
+    for (std::size_t i = 0; i < LRU_BLOCKS + 4; ++i) {
+      extents.push_back(make_clean_extent<TestBlock>(
+        make_paddr(segment_id_t{0, 0}, i)));
+      lru.move_to_top(*extents.back(), nullptr);
+    }
+    // the first 4 are evicted
+    ASSERT_EQ(lru.get_ghost_size_bytes(), 4 * TestBlock::SIZE);
+
+    // the space of the first 2 is freed, e.g. by reclaiming the segment,
+    // and reused by new extents
+    lru.on_space_freed(
+      make_paddr(segment_id_t{0, 0}, 0), 2 * TestBlock::SIZE);
+    EXPECT_EQ(lru.get_ghost_size_bytes(), 2 * TestBlock::SIZE);
+    for (std::size_t i = 0; i < 2; ++i) {
+      auto reused = make_clean_extent<TestBlock>(
+        make_paddr(segment_id_t{0, 0}, i));
+      lru.move_to_top(*reused, nullptr);
+      EXPECT_FALSE(is_protected(*reused));
+    }
+    EXPECT_EQ(lru.get_num_ghost_hits(), 0u);
+
+    // while the others are still remembered
+    lru.move_to_top(*extents[2], nullptr);
+    EXPECT_TRUE(is_protected(*extents[2]));
+    EXPECT_EQ(lru.get_num_ghost_hits(), 1u);
+  });
+}
@@ -1103,6 +1103,163 @@ struct transaction_manager_test_t :
     });
   }
 
+  void submit_transaction_without_cleaning(test_transaction_t &&t) {
+    auto write_seq = submit_transaction_fut_with_seq(*t.t
+    ).handle_error(
+      crimson::ct_error::assert_all{
+	"submit_transaction_without_cleaning hit invalid error"
+      }
+    ).get();
+    test_mappings.consume(t.mapping_delta, write_seq);
+    epm->background_process.trimmer->trim().get();
+  }
+
+  /*
+   * Passes the calls of the cleaner through to the transaction manager, and
+   * fails its transaction once, when the extents of a second segment are
+   * rewritten after those of a first one.
+   */
+  struct conflict_on_second_segment_t : ExtentCallbackInterface {
+    ExtentCallbackInterface &tm;
+    segment_id_t first_segment = NULL_SEG_ID;
+    bool conflicted = false;
+    // the bytes rewritten by the current transaction
+    std::size_t rewritten_bytes = 0;
+
+    conflict_on_second_segment_t(ExtentCallbackInterface &tm) : tm(tm) {}
+
+    shard_stats_t& get_shard_stats() final {
+      return tm.get_shard_stats();
+    }
+
+    TransactionRef create_transaction(
+      Transaction::src_t src, const char *name, bool is_weak) final {
+      first_segment = NULL_SEG_ID;
+      rewritten_bytes = 0;
+      return tm.create_transaction(src, name, is_weak);
+    }
+
+    get_next_dirty_extents_ret get_next_dirty_extents(
+      Transaction &t, journal_seq_t bound, size_t max_bytes) final {
+      return tm.get_next_dirty_extents(t, bound, max_bytes);
+    }
+
+    rewrite_extent_ret rewrite_extent(
+      Transaction &t,
+      CachedExtentRef extent,
+      rewrite_gen_t target_generation,
+      sea_time_point modify_time) final {
+      auto paddr = extent->get_paddr();
+      if (paddr.get_addr_type() == paddr_types_t::SEGMENT) {
+	auto segment = paddr.as_seg_paddr().get_segment_id();
+	if (first_segment == NULL_SEG_ID) {
+	  first_segment = segment;
+	} else if (segment != first_segment && !conflicted) {
+	  conflicted = true;
+	  t.test_set_conflict();
+	  return rewrite_extent_iertr::now();
+	}
+      }
+      rewritten_bytes += extent->get_disk_length();
+      return tm.rewrite_extent(t, extent, target_generation, modify_time);
+    }
+
+    get_extents_if_live_ret get_extents_if_live(
+      Transaction &t,
+      extent_types_t type,
+      paddr_t addr,
+      laddr_t laddr,
+      extent_len_t len) final {
+      return tm.get_extents_if_live(t, type, addr, laddr, len);
+    }
+
+    submit_transaction_direct_ret submit_transaction_direct(
+      Transaction &t,
+      std::optional<journal_seq_t> seq_to_trim) final {
+      return tm.submit_transaction_direct(t, seq_to_trim);
+    }
+  };
+
+  void test_reclaim_segments_together() {
+    // only the segmented backend reclaims segments
+    if (epm->get_main_backend_type() != backend_type_t::SEGMENTED) {
+      return;
+    }
+    constexpr size_t BSIZE = 4<<10;
+    constexpr size_t segment_size =
+      segment_manager::DEFAULT_TEST_EPHEMERAL.segment_size;
+    constexpr int BLOCKS_PER_TRANSACTION = 256;
+    constexpr int TRANSACTIONS =
+      segment_size * 4 / BSIZE / BLOCKS_PER_TRANSACTION;
+
+    run_async([this] {
+      auto &cleaner = static_cast<SegmentCleaner&>(
+	*epm->background_process.main_cleaner);
+      ASSERT_GE(cleaner.config.max_reclaiming_segments, 2u);
+
+      // fill several segments, then leave one block in four alive
+      for (int i = 0; i < TRANSACTIONS; ++i) {
+	allocate_sequentially(BSIZE, BLOCKS_PER_TRANSACTION, false).get();
+      }
+      std::vector<laddr_t> laddrs;
+      for (auto &[laddr, record] : test_mappings) {
+	laddrs.push_back(laddr);
+      }
+      for (size_t i = 0; i < laddrs.size(); i += BLOCKS_PER_TRANSACTION) {
+	auto t = create_transaction();
+	auto end = std::min(laddrs.size(), i + BLOCKS_PER_TRANSACTION);
+	for (size_t j = i; j < end; ++j) {
+	  if (j % 4 != 0) {
+	    dec_ref(t, laddrs[j]);
+	  }
+	}
+	submit_transaction_without_cleaning(std::move(t));
+      }
+      ASSERT_TRUE(cleaner.can_clean_space());
+
+      conflict_on_second_segment_t callback{*tm};
+      cleaner.set_extent_callback(&callback);
+      cleaner.clean_space().unsafe_get();
+
+      // both segments advanced in the same transaction, which was retried
+      // as a whole after failing halfway
+      ASSERT_EQ(cleaner.reclaim_states.size(),
+		cleaner.config.max_reclaiming_segments);
+      EXPECT_TRUE(callback.conflicted);
+      std::set<segment_id_t> reclaiming;
+      std::size_t reclaimed_bytes = 0;
+      for (auto &state : cleaner.reclaim_states) {
+	EXPECT_EQ(state.end_pos.as_seg_paddr().get_segment_off(),
+		  cleaner.config.reclaim_bytes_per_cycle);
+	reclaiming.insert(state.get_segment_id());
+	reclaimed_bytes += state.reclaimed_bytes;
+      }
+      EXPECT_EQ(reclaimed_bytes, callback.rewritten_bytes);
+
+      // each segment is released once it is reclaimed in full
+      const size_t max_cycles =
+	segment_size / cleaner.config.reclaim_bytes_per_cycle;
+      for (size_t cycle = 0; !reclaiming.empty(); ++cycle) {
+	ASSERT_LT(cycle, max_cycles);
+	ASSERT_TRUE(cleaner.can_clean_space());
+	cleaner.clean_space().unsafe_get();
+	for (auto it = reclaiming.begin(); it != reclaiming.end();) {
+	  if (cleaner.is_reclaiming(*it)) {
+	    ++it;
+	  } else {
+	    EXPECT_TRUE(cleaner.get_seg_info(*it).is_empty());
+	    it = reclaiming.erase(it);
+	  }
+	}
+      }
+      cleaner.set_extent_callback(tm.get());
+
+      check();
+      replay();
+      check();
+    });
+  }
+
   using remap_entry = TransactionManager::remap_entry;
   LBAMappingRef remap_pin(
     test_transaction_t &t,
@@ -2116,6 +2273,11 @@ TEST_P(tm_single_device_test_t, random_writes)
   });
 }
 
+TEST_P(tm_single_device_test_t, reclaim_segments_together)
+{
+  test_reclaim_segments_together();
+}
+
 TEST_P(tm_single_device_test_t, find_hole_assert_trigger)
 {
   constexpr unsigned max = 10;
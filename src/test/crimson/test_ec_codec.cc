@@ -0,0 +1,326 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <map>
+#include <set>
+
+#include "erasure-code/ErasureCode.h"
+#include "test/crimson/gtest_seastar.h"
+
+#include "crimson/osd/ec_codec.h"
+
+using namespace crimson;
+
+class test_interruption : public std::exception
+{};
+
+class TestInterruptCondition {
+public:
+  TestInterruptCondition(bool interrupt)
+    : interrupt(interrupt) {}
+
+  template <typename T>
+  std::optional<T> may_interrupt() {
+    if (interrupt) {
+      return seastar::futurize<T>::make_exception_future(test_interruption());
+    } else {
+      return std::optional<T>();
+    }
+  }
+
+  template <typename T>
+  static constexpr bool is_interruption_v = std::is_same_v<T, test_interruption>;
+
+  static bool is_interruption(std::exception_ptr& eptr) {
+    if (*eptr.__cxa_exception_type() == typeid(test_interruption))
+      return true;
+    return false;
+  }
+private:
+  bool interrupt = false;
+};
+
+namespace crimson::interruptible {
+template
+thread_local interrupt_cond_t<TestInterruptCondition>
+interrupt_cond<TestInterruptCondition>;
+}
+
+namespace {
+
+// k=2, m=1: the coding chunk is the XOR of the data chunks
+class XorErasureCode final : public ceph::ErasureCode {
+public:
+  unsigned int get_chunk_count() const override {
+    return 3;
+  }
+  unsigned int get_data_chunk_count() const override {
+    return 2;
+  }
+  unsigned int get_chunk_size(unsigned int stripe_width) const override {
+    return stripe_width / 2;
+  }
+  int encode_chunks(const std::set<int>& want_to_encode,
+		    std::map<int, ceph::bufferlist>* encoded) override {
+    xor_chunks((*encoded)[0], (*encoded)[1], (*encoded)[2]);
+    return 0;
+  }
+  int decode_chunks(const std::set<int>& want_to_read,
+		    const std::map<int, ceph::bufferlist>& chunks,
+		    std::map<int, ceph::bufferlist>* decoded) override {
+    for (int i = 0; i < 3; ++i) {
+      if (!chunks.contains(i)) {
+	xor_chunks((*decoded)[(i + 1) % 3], (*decoded)[(i + 2) % 3],
+		   (*decoded)[i]);
+      }
+    }
+    return 0;
+  }
+private:
+  static void xor_chunks(ceph::bufferlist& a,
+			 ceph::bufferlist& b,
+			 ceph::bufferlist& out) {
+    const char* pa = a.c_str();
+    const char* pb = b.c_str();
+    char* po = out.c_str();
+    for (unsigned i = 0; i < out.length(); ++i) {
+      po[i] = pa[i] ^ pb[i];
+    }
+  }
+};
+
+constexpr uint64_t STRIPE_WIDTH = 8192;
+
+ceph::bufferlist make_data(uint64_t len, char seed) {
+  ceph::bufferlist bl;
+  for (uint64_t i = 0; i < len; ++i) {
+    bl.append(char(seed + i % 23));
+  }
+  return bl;
+}
+
+using codec_t = crimson::osd::ECCodec<TestInterruptCondition>;
+
+// the logical content of the objects, as the shards decode it
+struct TestObjectSource final : codec_t::ObjectSource {
+  std::map<hobject_t, ceph::bufferlist> objects;
+  int read_error = 0;
+
+  codec_t::interruptible_future<codec_t::size_result_t>
+  get_object_size(const hobject_t& hoid) final {
+    codec_t::size_result_t ret;
+    if (auto p = objects.find(hoid); p != objects.end()) {
+      ret.size = p->second.length();
+    }
+    return seastar::make_ready_future<codec_t::size_result_t>(ret);
+  }
+  codec_t::interruptible_future<codec_t::read_result_t>
+  read_object_stripes(const hobject_t& hoid, uint64_t off, uint64_t len) final {
+    codec_t::read_result_t ret;
+    if (read_error) {
+      ret.error = read_error;
+    } else if (auto p = objects.find(hoid); p == objects.end()) {
+      ret.error = -ENOENT;
+    } else if (off < p->second.length()) {
+      ret.data.substr_of(p->second, off,
+			 std::min(len, p->second.length() - off));
+    }
+    return seastar::make_ready_future<codec_t::read_result_t>(
+      std::move(ret));
+  }
+};
+
+}
+
+struct ec_codec_test_t : seastar_test_suite_t {
+  using interruptor = interruptible::interruptor<TestInterruptCondition>;
+
+  const hobject_t hoid{object_t{"foo"}, "", CEPH_NOSNAP, 42, 1, ""};
+  TestObjectSource source;
+  codec_t codec{std::make_shared<XorErasureCode>(), STRIPE_WIDTH,
+		coll_t{}, source};
+  // the chunks the shards hold for hoid
+  std::map<int, ceph::bufferlist> shards;
+
+  void create_object(const ceph::bufferlist& data) {
+    ceph_assert(data.length() % STRIPE_WIDTH == 0);
+    source.objects[hoid] = data;
+    auto ec_impl = std::make_shared<XorErasureCode>();
+    ceph::ErasureCodeInterfaceRef ec_ref = ec_impl;
+    ceph::bufferlist bl = data;
+    ECUtil::encode(codec.get_sinfo(), ec_ref, bl,
+		   codec.get_all_shards(), &shards);
+  }
+
+  int generate(ceph::os::Transaction& txn,
+	       codec_t::split_transaction_t& split) {
+    int r = 0;
+    run_async([&] {
+      interruptor::with_interruption([&] {
+	return codec.generate_transactions(txn, split
+	).then_interruptible([&](int ret) {
+	  r = ret;
+	});
+      }, [](std::exception_ptr) {}, false).get();
+    });
+    return r;
+  }
+
+  /// apply the writes of the shard transactions to the chunks of hoid
+  void apply(codec_t::shard_transactions_t& txns) {
+    using ceph::os::Transaction;
+    for (auto& [shard, t] : txns) {
+      auto& chunk = shards[shard];
+      for (auto i = t.begin(); i.have_op(); ) {
+	const auto op = i.decode_op();
+	switch (op->op) {
+	case Transaction::OP_WRITE:
+	  {
+	    ASSERT_EQ(i.get_oid(op->oid),
+		      codec_t::shard_oid(hoid, shard_id_t(shard)));
+	    ceph::bufferlist bl;
+	    i.decode_bl(bl);
+	    // every shard write carries whole chunks
+	    const auto chunk_size = codec.get_sinfo().get_chunk_size();
+	    ASSERT_EQ(op->off % chunk_size, 0u);
+	    ASSERT_EQ(bl.length() % chunk_size, 0u);
+	    if (chunk.length() < op->off) {
+	      chunk.append_zero(op->off - chunk.length());
+	    }
+	    ceph::bufferlist updated;
+	    updated.substr_of(chunk, 0, op->off);
+	    updated.append(bl);
+	    if (op->off + bl.length() < chunk.length()) {
+	      ceph::bufferlist tail;
+	      tail.substr_of(chunk, op->off + bl.length(),
+			     chunk.length() - op->off - bl.length());
+	      updated.append(tail);
+	    }
+	    chunk = std::move(updated);
+	  }
+	  break;
+	case Transaction::OP_SETATTR:
+	  {
+	    std::string name = i.decode_string();
+	    ceph::bufferlist bl;
+	    i.decode_bl(bl);
+	  }
+	  break;
+	default:
+	  break;
+	}
+      }
+    }
+  }
+
+  /// decode hoid from the chunks of its shards, without the one in skip
+  ceph::bufferlist decode(std::optional<int> skip = std::nullopt) {
+    std::map<int, ceph::bufferlist> chunks = shards;
+    uint64_t chunk_len = chunks.begin()->second.length();
+    if (skip) {
+      chunks.erase(*skip);
+    }
+    auto r = codec.decode(chunks, chunk_len);
+    EXPECT_EQ(r.error, 0);
+    return r.data;
+  }
+};
+
+TEST_F(ec_codec_test_t, partial_overwrite)
+{
+  auto original = make_data(2 * STRIPE_WIDTH, 'a');
+  create_object(original);
+
+  ceph::os::Transaction txn;
+  auto data = make_data(100, 'A');
+  txn.write(coll_t{}, ghobject_t{hoid}, 10, data.length(), data);
+  codec_t::split_transaction_t split;
+  ASSERT_EQ(generate(txn, split), 0);
+  codec.finish_transactions(split);
+  ASSERT_EQ(split.txns.size(), 3u);
+  apply(split.txns);
+
+  // the chunks of the untouched stripe are kept as they are
+  for (auto& [shard, chunk] : shards) {
+    EXPECT_EQ(chunk.length(), 2 * codec.get_sinfo().get_chunk_size());
+  }
+  ceph::bufferlist expected;
+  expected.substr_of(original, 0, 10);
+  expected.append(data);
+  ceph::bufferlist tail;
+  tail.substr_of(original, 110, original.length() - 110);
+  expected.append(tail);
+  EXPECT_TRUE(decode() == expected);
+  // any of the shards can be lost
+  for (int shard = 0; shard < 3; ++shard) {
+    EXPECT_TRUE(decode(shard) == expected);
+  }
+}
+
+TEST_F(ec_codec_test_t, write_to_new_object)
+{
+  ceph::os::Transaction txn;
+  auto data = make_data(STRIPE_WIDTH + 100, 'x');
+  txn.write(coll_t{}, ghobject_t{hoid}, 0, data.length(), data);
+  codec_t::split_transaction_t split;
+  ASSERT_EQ(generate(txn, split), 0);
+  codec.finish_transactions(split);
+  apply(split.txns);
+
+  // the last stripe is padded with zeros
+  ceph::bufferlist expected = data;
+  expected.append_zero(STRIPE_WIDTH - 100);
+  EXPECT_TRUE(decode() == expected);
+  EXPECT_EQ(split.images[hoid].size, 2 * STRIPE_WIDTH);
+}
+
+TEST_F(ec_codec_test_t, split_in_two_passes)
+{
+  create_object(make_data(STRIPE_WIDTH, 'a'));
+
+  // the ops appended after the first split are split on their own
+  ceph::os::Transaction txn;
+  auto first = make_data(10, 'A');
+  txn.write(coll_t{}, ghobject_t{hoid}, 0, first.length(), first);
+  codec_t::split_transaction_t split;
+  ASSERT_EQ(generate(txn, split), 0);
+  EXPECT_EQ(split.num_ops, 1u);
+  auto second = make_data(10, 'B');
+  txn.write(coll_t{}, ghobject_t{hoid}, 20, second.length(), second);
+  ASSERT_EQ(generate(txn, split), 0);
+  EXPECT_EQ(split.num_ops, 2u);
+  apply(split.txns);
+
+  auto expected = make_data(STRIPE_WIDTH, 'a');
+  ceph::bufferlist bl = first;
+  ceph::bufferlist middle;
+  middle.substr_of(expected, 10, 10);
+  bl.append(middle);
+  bl.append(second);
+  ceph::bufferlist tail;
+  tail.substr_of(expected, 30, STRIPE_WIDTH - 30);
+  bl.append(tail);
+  EXPECT_TRUE(decode() == bl);
+}
+
+TEST_F(ec_codec_test_t, failed_read)
+{
+  create_object(make_data(STRIPE_WIDTH, 'a'));
+  source.read_error = -EIO;
+
+  ceph::os::Transaction txn;
+  auto data = make_data(10, 'A');
+  txn.write(coll_t{}, ghobject_t{hoid}, 10, data.length(), data);
+  codec_t::split_transaction_t split;
+  EXPECT_EQ(generate(txn, split), -EIO);
+}
+
+TEST_F(ec_codec_test_t, unsupported_op)
+{
+  ceph::os::Transaction txn;
+  std::map<std::string, ceph::bufferlist> keys;
+  keys["key"] = make_data(10, 'k');
+  txn.omap_setkeys(coll_t{}, ghobject_t{hoid}, keys);
+  codec_t::split_transaction_t split;
+  EXPECT_EQ(generate(txn, split), -EOPNOTSUPP);
+}
@@ -0,0 +1,131 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <seastar/core/sleep.hh>
+
+#include "crimson/common/config_proxy.h"
+#include "crimson/osd/scheduler/mclock_scheduler.h"
+#include "test/crimson/gtest_seastar.h"
+
+using namespace crimson::osd::scheduler;
+using crimson::common::local_conf;
+
+struct mclock_scheduler_test_t : public seastar_test_suite_t {
+  std::set<std::string> changed;
+
+  void set_conf(const std::string &key, const std::string &val) {
+    changed.insert(key);
+    local_conf().set_val(key, val).get();
+  }
+
+  seastar::future<> tear_down_fut() final {
+    return seastar::do_for_each(changed, [](auto &key) {
+      return local_conf().rm_val(key);
+    }).then([this] {
+      changed.clear();
+    });
+  }
+
+  static void enqueue(mClockScheduler &s, scheduler_class_t klass, unsigned n) {
+    for (unsigned i = 0; i < n; ++i) {
+      s.enqueue(item_t{params_t{1, 0, klass}, seastar::promise<>()});
+    }
+  }
+
+  /// the classes of the first n ops dispatched by s
+  static std::map<scheduler_class_t, unsigned> dispatch(
+    mClockScheduler &s, unsigned n) {
+    std::map<scheduler_class_t, unsigned> ret;
+    while (n-- && !s.empty()) {
+      auto work_item = s.dequeue();
+      if (auto when = std::get_if<std::chrono::nanoseconds>(&work_item)) {
+	seastar::sleep(*when).get();
+	++n;
+	continue;
+      }
+      auto &item = std::get<item_t>(work_item);
+      ++ret[item.params.klass];
+      item.wake.set_value();
+    }
+    return ret;
+  }
+};
+
+TEST_F(mclock_scheduler_test_t, capacity)
+{
+  run_async([this] {
+    set_conf("osd_mclock_max_capacity_iops_ssd", "1000");
+    set_conf("osd_mclock_max_sequential_bandwidth_ssd", "100M");
+    mClockScheduler s{local_conf(), 4, false};
+    EXPECT_DOUBLE_EQ(s.get_cost_per_io(), (100 << 20) / 1000.0);
+    EXPECT_DOUBLE_EQ(s.get_capacity_per_shard(), (100 << 20) / 4.0);
+  });
+}
+
+TEST_F(mclock_scheduler_test_t, immediate_bypasses_queue)
+{
+  run_async([this] {
+    set_conf("osd_mclock_profile", "high_client_ops");
+    mClockScheduler s{local_conf(), 1, false};
+    enqueue(s, scheduler_class_t::client, 4);
+    enqueue(s, scheduler_class_t::immediate, 1);
+    auto work_item = s.dequeue();
+    ASSERT_TRUE(std::holds_alternative<item_t>(work_item));
+    EXPECT_EQ(std::get<item_t>(work_item).params.klass,
+	      scheduler_class_t::immediate);
+  });
+}
+
+TEST_F(mclock_scheduler_test_t, high_client_ops)
+{
+  run_async([this] {
+    set_conf("osd_mclock_profile", "high_client_ops");
+    mClockScheduler s{local_conf(), 1, false};
+    enqueue(s, scheduler_class_t::client, 600);
+    enqueue(s, scheduler_class_t::background_recovery, 600);
+    auto dispatched = dispatch(s, 300);
+    // client has twice the weight and a larger reservation than recovery
+    EXPECT_GT(dispatched[scheduler_class_t::client], 180u);
+    EXPECT_LT(dispatched[scheduler_class_t::background_recovery], 120u);
+  });
+}
+
+TEST_F(mclock_scheduler_test_t, high_recovery_ops)
+{
+  run_async([this] {
+    set_conf("osd_mclock_profile", "high_recovery_ops");
+    mClockScheduler s{local_conf(), 1, false};
+    enqueue(s, scheduler_class_t::client, 600);
+    enqueue(s, scheduler_class_t::background_recovery, 600);
+    auto dispatched = dispatch(s, 300);
+    EXPECT_LT(dispatched[scheduler_class_t::client], 120u);
+    EXPECT_GT(dispatched[scheduler_class_t::background_recovery], 180u);
+  });
+}
+
+TEST_F(mclock_scheduler_test_t, limit_holds_back_ops)
+{
+  run_async([this] {
+    set_conf("osd_mclock_profile", "custom");
+    set_conf("osd_mclock_max_capacity_iops_ssd", "1000");
+    // at most 10 best effort ops per second
+    set_conf("osd_mclock_scheduler_background_best_effort_lim", "0.01");
+    mClockScheduler s{local_conf(), 1, false};
+    enqueue(s, scheduler_class_t::background_best_effort, 2);
+    auto first = s.dequeue();
+    ASSERT_TRUE(std::holds_alternative<item_t>(first));
+    auto second = s.dequeue();
+    ASSERT_TRUE(std::holds_alternative<std::chrono::nanoseconds>(second));
+    EXPECT_GT(std::get<std::chrono::nanoseconds>(second),
+	      std::chrono::milliseconds(50));
+    // the ops of other classes are not held back
+    enqueue(s, scheduler_class_t::client, 1);
+    auto third = s.dequeue();
+    ASSERT_TRUE(std::holds_alternative<item_t>(third));
+    EXPECT_EQ(std::get<item_t>(third).params.klass, scheduler_class_t::client);
+  });
+}
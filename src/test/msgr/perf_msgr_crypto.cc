@@ -0,0 +1,157 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+// Measures the cost of msgr2 frame assembly in crc vs secure mode, i.e.
+// the part of the send path that runs on the messenger worker thread before
+// the frame hits the socket.  Payloads can be fragmented into many small
+// buffers to mimic freshly encoded messages, and secure mode is run with
+// and without coalescing of small fragments (ms_crypto_tx_coalesce_size).
+
+#include <iostream>
+#include <string>
+
+#include "auth/Auth.h"
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "msg/async/frames_v2.h"
+
+using namespace std;
+using namespace ceph::msgr::v2;
+
+namespace {
+
+struct BenchFrame : Frame<BenchFrame,
+                          segment_t::DEFAULT_ALIGNMENT,
+                          segment_t::DEFAULT_ALIGNMENT,
+                          segment_t::DEFAULT_ALIGNMENT,
+                          segment_t::PAGE_SIZE_ALIGNMENT> {
+  static constexpr Tag tag = Tag::MESSAGE;
+
+  static BenchFrame Encode(const bufferlist& header,
+                           const bufferlist& front,
+                           const bufferlist& data) {
+    BenchFrame f;
+    f.segments[SegmentIndex::Msg::HEADER] = header;
+    f.segments[SegmentIndex::Msg::FRONT] = front;
+    f.segments[SegmentIndex::Msg::DATA] = data;
+    return f;
+  }
+
+protected:
+  using Frame::Frame;
+};
+
+bufferlist make_payload(size_t len, size_t fragment_len) {
+  bufferlist bl;
+  for (size_t off = 0; off < len; off += fragment_len) {
+    auto l = std::min(fragment_len, len - off);
+    bl.push_back(buffer::copy(std::string(l, 'x').data(), l));
+  }
+  return bl;
+}
+
+double run(const char* name,
+           const ceph::crypto::onwire::rxtx_t& crypto,
+           int frames, size_t front_len, size_t data_len,
+           size_t fragment_len)
+{
+  ceph::compression::onwire::rxtx_t comp{nullptr, nullptr};
+  FrameAssembler frame_asm(&crypto, /*is_rev1=*/true,
+                           /*with_data_crc=*/true, &comp);
+  const auto header = make_payload(sizeof(ceph_msg_header2), fragment_len);
+  const auto front = make_payload(front_len, fragment_len);
+  const auto data = make_payload(data_len, fragment_len);
+
+  uint64_t bytes = 0;
+  auto start = ceph::mono_clock::now();
+  for (int i = 0; i < frames; i++) {
+    auto frame = BenchFrame::Encode(header, front, data);
+    bytes += frame.get_buffer(frame_asm).length();
+  }
+  auto elapsed = std::chrono::duration<double>(ceph::mono_clock::now() - start);
+  double mbps = bytes / elapsed.count() / (1 << 20);
+  cout << name
+       << " frames=" << frames
+       << " seconds=" << elapsed.count()
+       << " frames/s=" << frames / elapsed.count()
+       << " MB/s=" << mbps << std::endl;
+  return mbps;
+}
+
+ceph::crypto::onwire::rxtx_t make_secure(CephContext* cct)
+{
+  AuthConnectionMeta auth_meta;
+  auth_meta.con_mode = CEPH_CON_MODE_SECURE;
+  auth_meta.connection_secret.resize(64);
+  cct->random()->get_bytes(auth_meta.connection_secret.data(),
+                           auth_meta.connection_secret.size());
+  return ceph::crypto::onwire::rxtx_t::create_handler_pair(
+    cct, auth_meta, /*new_nonce_format=*/true, /*crossed=*/false);
+}
+
+void usage(const char* name) {
+  cout << "usage: " << name
+       << " [--frames N] [--front-len bytes] [--data-len bytes]"
+       << " [--fragment-len bytes]" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+                         CODE_ENVIRONMENT_UTILITY,
+                         CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+
+  int frames = 100000;
+  size_t front_len = 256;
+  size_t data_len = 4096;
+  size_t fragment_len = 4096;
+  std::string val;
+  for (auto i = args.begin(); i != args.end();) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--frames", (char*)NULL)) {
+      frames = std::stoi(val);
+    } else if (ceph_argparse_witharg(args, i, &val, "--front-len", (char*)NULL)) {
+      front_len = std::stoul(val);
+    } else if (ceph_argparse_witharg(args, i, &val, "--data-len", (char*)NULL)) {
+      data_len = std::stoul(val);
+    } else if (ceph_argparse_witharg(args, i, &val, "--fragment-len", (char*)NULL)) {
+      fragment_len = std::max<size_t>(1, std::stoul(val));
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  ceph::crypto::onwire::rxtx_t crc{nullptr, nullptr};
+  double crc_mbps = run("crc", crc, frames, front_len, data_len, fragment_len);
+
+  g_conf().set_val_or_die("ms_crypto_tx_coalesce_size", "0");
+  auto secure = make_secure(g_ceph_context);
+  run("secure (no coalescing)", secure,
+      frames, front_len, data_len, fragment_len);
+
+  g_conf().rm_val("ms_crypto_tx_coalesce_size");
+  secure = make_secure(g_ceph_context);
+  double secure_mbps = run("secure", secure,
+                           frames, front_len, data_len, fragment_len);
+
+  cout << "secure/crc throughput ratio: " << secure_mbps / crc_mbps
+       << std::endl;
+  return 0;
+}
@@ -0,0 +1,232 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+// Compares messenger transports between two endpoints on the same host,
+// e.g. async+posix (tcp over loopback) against async+shm (shared memory
+// rings).  For every transport a server and a client messenger are started
+// in this process; the client first sends MOSDOps one at a time to measure
+// the round trip latency, then keeps --depth of them in flight to measure
+// throughput.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "auth/DummyAuth.h"
+#include "common/ceph_argparse.h"
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "global/global_init.h"
+#include "include/str_list.h"
+#include "messages/MOSDOp.h"
+#include "messages/MOSDOpReply.h"
+#include "msg/Messenger.h"
+
+using namespace std;
+
+namespace {
+
+class EchoDispatcher : public Dispatcher {
+ public:
+  explicit EchoDispatcher(CephContext *cct) : Dispatcher(cct) {}
+  bool ms_can_fast_dispatch_any() const override { return true; }
+  bool ms_can_fast_dispatch(const Message *m) const override {
+    return m->get_type() == CEPH_MSG_OSD_OP;
+  }
+  void ms_fast_dispatch(Message *m) override {
+    auto op = static_cast<MOSDOp*>(m);
+    m->get_connection()->send_message(new MOSDOpReply(op, 0, 0, 0, false));
+    m->put();
+  }
+  bool ms_dispatch(Message *m) override { return true; }
+  bool ms_handle_reset(Connection *con) override { return true; }
+  void ms_handle_remote_reset(Connection *con) override {}
+  bool ms_handle_refused(Connection *con) override { return false; }
+};
+
+class ReplyDispatcher : public Dispatcher {
+ public:
+  ceph::mutex lock = ceph::make_mutex("ReplyDispatcher::lock");
+  ceph::condition_variable cond;
+  uint64_t replies = 0;
+
+  explicit ReplyDispatcher(CephContext *cct) : Dispatcher(cct) {}
+  bool ms_can_fast_dispatch_any() const override { return true; }
+  bool ms_can_fast_dispatch(const Message *m) const override {
+    return m->get_type() == CEPH_MSG_OSD_OPREPLY;
+  }
+  void ms_fast_dispatch(Message *m) override {
+    m->put();
+    std::lock_guard l{lock};
+    ++replies;
+    cond.notify_all();
+  }
+  bool ms_dispatch(Message *m) override { return true; }
+  bool ms_handle_reset(Connection *con) override { return true; }
+  void ms_handle_remote_reset(Connection *con) override {}
+  bool ms_handle_refused(Connection *con) override { return false; }
+
+  void wait_for(uint64_t n) {
+    std::unique_lock l{lock};
+    cond.wait(l, [this, n] { return replies >= n; });
+  }
+};
+
+MOSDOp *make_op(const bufferlist &data)
+{
+  object_locator_t oloc(1, 1);
+  pg_t pgid;
+  hobject_t hobj(object_t("object-name"), oloc.key, CEPH_NOSNAP, pgid.ps(),
+		 pgid.pool(), oloc.nspace);
+  spg_t spgid(pgid);
+  auto m = new MOSDOp(0, 0, hobj, spgid, 0, 0, 0);
+  bufferlist bl(data);
+  m->write(0, bl.length(), bl);
+  return m;
+}
+
+void run(const string &type, const entity_addr_t &bind_addr,
+	 int ops, int depth, int msg_len)
+{
+  DummyAuthClientServer dummy_auth(g_ceph_context);
+  dummy_auth.auth_registry.refresh_config();
+  EchoDispatcher echo(g_ceph_context);
+  ReplyDispatcher replies(g_ceph_context);
+
+  Messenger *server = Messenger::create(g_ceph_context, type,
+					entity_name_t::OSD(0), "server", 0);
+  server->set_default_policy(Messenger::Policy::stateless_server(0));
+  server->set_auth_server(&dummy_auth);
+  server->bind(bind_addr);
+  server->add_dispatcher_head(&echo);
+  server->start();
+
+  Messenger *client = Messenger::create(g_ceph_context, type,
+					entity_name_t::CLIENT(0), "client",
+					getpid());
+  client->set_default_policy(Messenger::Policy::lossless_client(0));
+  client->set_auth_client(&dummy_auth);
+  client->add_dispatcher_head(&replies);
+  client->start();
+  ConnectionRef conn = client->connect_to_osd(server->get_myaddrs());
+
+  bufferlist data;
+  data.append_zero(msg_len);
+  uint64_t sent = 0;
+
+  // the first op also pays for the connection handshake
+  conn->send_message(make_op(data));
+  replies.wait_for(++sent);
+
+  vector<double> lat;
+  lat.reserve(ops);
+  for (int i = 0; i < ops; i++) {
+    auto start = ceph::mono_clock::now();
+    conn->send_message(make_op(data));
+    replies.wait_for(++sent);
+    lat.push_back(std::chrono::duration<double, std::micro>(
+      ceph::mono_clock::now() - start).count());
+  }
+  std::sort(lat.begin(), lat.end());
+  double avg = 0;
+  for (auto l : lat) {
+    avg += l;
+  }
+  avg /= lat.size();
+
+  auto start = ceph::mono_clock::now();
+  for (int i = 0; i < ops; i++) {
+    if (sent >= uint64_t(depth)) {
+      replies.wait_for(sent - depth + 1);
+    }
+    conn->send_message(make_op(data));
+    ++sent;
+  }
+  replies.wait_for(sent);
+  auto elapsed = std::chrono::duration<double>(ceph::mono_clock::now() - start);
+
+  cout << type
+       << " latency(us) avg=" << avg
+       << " p50=" << lat[lat.size() / 2]
+       << " p99=" << lat[lat.size() * 99 / 100]
+       << " | depth=" << depth
+       << " ops/s=" << ops / elapsed.count()
+       << " MB/s=" << double(ops) * msg_len / elapsed.count() / (1 << 20)
+       << std::endl;
+
+  client->shutdown();
+  client->wait();
+  server->shutdown();
+  server->wait();
+  delete client;
+  delete server;
+}
+
+void usage(const char *name) {
+  cout << "usage: " << name
+       << " [--types async+posix,async+shm] [--addr ip] [--port port]"
+       << " [--ops N] [--depth N] [--msg-len bytes]" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+
+  string types = "async+posix,async+shm";
+  string ip = "127.0.0.1";
+  int port = 16800;
+  int ops = 100000;
+  int depth = 32;
+  int msg_len = 4096;
+  string val;
+  for (auto i = args.begin(); i != args.end();) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--types", (char*)NULL)) {
+      types = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--addr", (char*)NULL)) {
+      ip = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--port", (char*)NULL)) {
+      port = std::stoi(val);
+    } else if (ceph_argparse_witharg(args, i, &val, "--ops", (char*)NULL)) {
+      ops = std::max(1, std::stoi(val));
+    } else if (ceph_argparse_witharg(args, i, &val, "--depth", (char*)NULL)) {
+      depth = std::max(1, std::stoi(val));
+    } else if (ceph_argparse_witharg(args, i, &val, "--msg-len", (char*)NULL)) {
+      msg_len = std::stoi(val);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  cout << "ops " << ops << " message data bytes " << msg_len << std::endl;
+  for (const auto &type : get_str_list(types, ",")) {
+    entity_addr_t addr;
+    if (!addr.parse(ip.c_str())) {
+      cerr << "unable to parse address " << ip << std::endl;
+      return 1;
+    }
+    // a fresh port for every transport, so that lingering connections of
+    // the previous run do not get in the way
+    addr.set_port(port++);
+    run(type, addr, ops, depth, msg_len);
+  }
+  return 0;
+}
@@ -23,10 +23,19 @@
 #include <set>
 #include <vector>
 #include <gtest/gtest.h>
+#ifdef __linux__
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include "acconfig.h"
 #include "common/config_obs.h"
 #include "include/Context.h"
+#include "include/scope_guard.h"
 #include "msg/async/Event.h"
 #include "msg/async/Stack.h"
 
@@ -317,6 +326,106 @@ TEST_P(NetworkWorkerTest, ConnectFailedTest) {
   });
 }
 
+#ifdef __linux__
+// the squatter of ShmUntrustedListenerTest, exec'd by it so that it drops
+// its privileges in a process of its own rather than in a fork of the
+// multithreaded test
+TEST(ShmUntrustedListener, Squatter) {
+  const char* name = ::getenv("CEPH_TEST_SHM_SQUATTER_NAME");
+  if (!name) {
+    GTEST_SKIP() << "run by ShmUntrustedListenerTest";
+  }
+  const int ready = atoi(::getenv("CEPH_TEST_SHM_SQUATTER_READY"));
+  const int result = atoi(::getenv("CEPH_TEST_SHM_SQUATTER_RESULT"));
+  sockaddr_un un = {};
+  un.sun_family = AF_UNIX;
+  const size_t name_len = strlen(name);
+  memcpy(un.sun_path + 1, name, name_len);
+  socklen_t len = offsetof(sockaddr_un, sun_path) + 1 + name_len;
+  int sd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (::setgid(65534) < 0 || ::setuid(65534) < 0 || sd < 0 ||
+      ::bind(sd, reinterpret_cast<sockaddr*>(&un), len) < 0 ||
+      ::listen(sd, 1) < 0 ||
+      ::write(ready, "r", 1) != 1) {
+    ::_exit(1);
+  }
+  int cd = ::accept(sd, nullptr, nullptr);
+  char buf[512];
+  iovec iov = {buf, sizeof(buf)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  // the connector hangs up instead of sending its memfd
+  bool got_fd = cd >= 0 && ::recvmsg(cd, &msg, 0) > 0 &&
+    CMSG_FIRSTHDR(&msg) != nullptr;
+  ::_exit(::write(result, got_fd ? "f" : "n", 1) == 1 ? 0 : 1);
+}
+
+// a local user squatting the abstract socket of an address must not get
+// the memory of the connections to it
+TEST_P(NetworkWorkerTest, ShmUntrustedListenerTest) {
+  if (strcmp(GetParam(), "shm")) {
+    GTEST_SKIP() << "only the shm stack maps memory";
+  }
+  if (::geteuid() != 0) {
+    GTEST_SKIP() << "needs root to listen as another user";
+  }
+  entity_addr_t addr;
+  ASSERT_TRUE(addr.parse(get_ip_different_port().c_str()));
+
+  int ready[2], result[2];
+  ASSERT_EQ(0, ::pipe(ready));
+  ASSERT_EQ(0, ::pipe(result));
+  // everything the child needs is built before the fork, which leaves it
+  // nothing to do but exec the squatter
+  std::vector<std::string> env_strs = {
+    // the name ShmWorker listens on for addr
+    "CEPH_TEST_SHM_SQUATTER_NAME=ceph-msgr-shm:" + addr.ip_n_port_to_str(),
+    "CEPH_TEST_SHM_SQUATTER_READY=" + std::to_string(ready[1]),
+    "CEPH_TEST_SHM_SQUATTER_RESULT=" + std::to_string(result[1]),
+  };
+  std::vector<char*> env;
+  for (char** e = environ; *e; ++e) {
+    env.push_back(*e);
+  }
+  for (auto& e : env_strs) {
+    env.push_back(e.data());
+  }
+  env.push_back(nullptr);
+  std::string exe = "/proc/self/exe";
+  std::string filter = "--gtest_filter=ShmUntrustedListener.Squatter";
+  char* argv[] = {exe.data(), filter.data(), nullptr};
+  pid_t pid = ::fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    ::execve(argv[0], argv, env.data());
+    ::_exit(127);
+  }
+  auto reap = make_scope_guard([pid] {
+    ::kill(pid, SIGKILL);
+    ::waitpid(pid, nullptr, 0);
+  });
+  ::close(ready[1]);
+  ::close(result[1]);
+  char c = 0;
+  ASSERT_EQ(1, ::read(ready[0], &c, 1));
+
+  // falls back to tcp, where nothing listens
+  SocketOptions options;
+  ConnectedSocket cli_socket;
+  get_worker(0)->connect(addr, options, &cli_socket);
+  pollfd pfd = {result[0], POLLIN, 0};
+  ASSERT_EQ(1, ::poll(&pfd, 1, 5000));
+  ASSERT_EQ(1, ::read(result[0], &c, 1));
+  EXPECT_EQ('n', c);
+  ::close(ready[0]);
+  ::close(result[0]);
+}
+#endif
+
 TEST_P(NetworkWorkerTest, ListenTest) {
   Worker *worker = get_worker(0);
   entity_addr_t bind_addr;
@@ -1058,6 +1167,9 @@ INSTANTIATE_TEST_SUITE_P(
   ::testing::Values(
 #ifdef HAVE_DPDK
     "dpdk",
+#endif
+#ifdef __linux__
+    "shm",
 #endif
     "posix"
   )
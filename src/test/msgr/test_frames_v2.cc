@@ -147,6 +147,18 @@ static bufferlist make_bufferlist(size_t len, char c) {
   return bl;
 }
 
+// same contents as bl, but scattered over many tiny buffers as is the case
+// for a freshly encoded message
+static bufferlist make_fragmented(const bufferlist& bl, size_t chunk_len) {
+  bufferlist fragmented;
+  for (unsigned off = 0; off < bl.length(); off += chunk_len) {
+    bufferlist chunk;
+    chunk.substr_of(bl, off, std::min<unsigned>(chunk_len, bl.length() - off));
+    fragmented.push_back(buffer::copy(chunk.c_str(), chunk.length()));
+  }
+  return fragmented;
+}
+
 bool disassemble_frame(FrameAssembler& frame_asm, bufferlist& frame_bl,
                        Tag& tag, segment_bls_t& segment_bls) {
   bufferlist preamble_bl;
@@ -232,8 +244,13 @@ protected:
                       frame_asm.get_frame_onwire_len());
   }
 
-  void test_round_trip() {
-    auto tx_frame = TestFrame::Encode(m_header, m_front, m_middle, m_data);
+  void test_round_trip(size_t chunk_len = 0) {
+    auto tx_frame = chunk_len == 0 ?
+      TestFrame::Encode(m_header, m_front, m_middle, m_data) :
+      TestFrame::Encode(make_fragmented(m_header, chunk_len),
+                        make_fragmented(m_front, chunk_len),
+                        make_fragmented(m_middle, chunk_len),
+                        make_fragmented(m_data, chunk_len));
     auto onwire_bl = tx_frame.get_buffer(m_tx_frame_asm);
     check_frame_assembler(m_tx_frame_asm);
     EXPECT_EQ(m_tx_frame_asm.get_frame_onwire_len(), onwire_bl.length());
@@ -279,6 +296,13 @@ TEST_P(RoundTripTest, Reuse) {
   }
 }
 
+TEST_P(RoundTripTest, Fragmented) {
+  // small fragments go through the tx crypto handler's staging buffer
+  for (size_t chunk_len : {1, 7, 64}) {
+    test_round_trip(chunk_len);
+  }
+}
+
 static const round_trip_instance_t round_trip_instances[] = {
   // first segment is empty
   { 0,   0,   0,   0, 1, {{32,  0,  17,   0,   0,  0},
@@ -32,6 +32,7 @@
 
 #include "common/ceph_argparse.h"
 #include "common/ceph_mutex.h"
+#include "common/perf_counters_collection.h"
 #include "global/global_init.h"
 #include "messages/MCommand.h"
 #include "messages/MPing.h"
@@ -1584,6 +1585,257 @@ TEST_P(MessengerTest, MessageTest) {
 }
 
 
+// records the order the messages of each connection are dispatched in, and
+// how many are dispatched at once
+class ShardedDispatcher : public Dispatcher {
+ public:
+  ceph::mutex lock = ceph::make_mutex("ShardedDispatcher::lock");
+  ceph::condition_variable cond;
+  map<ConnectionRef, vector<uint64_t>> seqs;
+  unsigned dispatching = 0;
+  unsigned max_dispatching = 0;
+  unsigned waits = 0;
+  uint64_t count = 0;
+
+  ShardedDispatcher(): Dispatcher(g_ceph_context) {}
+  bool ms_can_fast_dispatch_any() const override { return false; }
+  bool ms_dispatch(Message *m) override {
+    std::unique_lock l{lock};
+    seqs[m->get_connection()].push_back(m->get_seq());
+    max_dispatching = std::max(max_dispatching, ++dispatching);
+    cond.notify_all();
+    if (max_dispatching < 2 && waits < 10) {
+      // hold the thread, so that another one gets to dispatch meanwhile
+      waits++;
+      cond.wait_for(l, 1s, [this] { return max_dispatching > 1; });
+    }
+    dispatching--;
+    count++;
+    cond.notify_all();
+    m->put();
+    return true;
+  }
+  bool ms_handle_reset(Connection *con) override {
+    return true;
+  }
+  void ms_handle_remote_reset(Connection *con) override {}
+  bool ms_handle_refused(Connection *con) override {
+    return false;
+  }
+  bool ms_handle_fast_authentication(Connection *con) override {
+    return true;
+  }
+};
+
+TEST_P(MessengerTest, ShardedDispatchTest) {
+  g_ceph_context->_conf.set_val("ms_dispatch_threads", "4");
+  delete server_msgr;
+  server_msgr = Messenger::create(g_ceph_context, string(GetParam()),
+                                  entity_name_t::OSD(0), "server", getpid());
+  g_ceph_context->_conf.set_val("ms_dispatch_threads", "1");
+  server_msgr->set_default_policy(Messenger::Policy::stateless_server(0));
+  server_msgr->set_auth_client(&dummy_auth);
+  server_msgr->set_auth_server(&dummy_auth);
+  server_msgr->set_require_authorizer(false);
+
+  ShardedDispatcher srv_dispatcher;
+  FakeDispatcher cli_dispatcher(false);
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  // a connection per client, which land in different shards
+  constexpr unsigned num_clients = 8;
+  constexpr unsigned num_messages = 100;
+  vector<Messenger*> clients;
+  vector<ConnectionRef> conns;
+  for (unsigned i = 0; i < num_clients; i++) {
+    Messenger *msgr = Messenger::create(g_ceph_context, string(GetParam()),
+                                        entity_name_t::CLIENT(-1), "client",
+                                        getpid() + i + 1);
+    msgr->set_default_policy(Messenger::Policy::lossy_client(0));
+    msgr->set_auth_client(&dummy_auth);
+    msgr->set_auth_server(&dummy_auth);
+    msgr->add_dispatcher_head(&cli_dispatcher);
+    msgr->start();
+    clients.push_back(msgr);
+    conns.push_back(msgr->connect_to(server_msgr->get_mytype(),
+                                     server_msgr->get_myaddrs()));
+  }
+  for (unsigned i = 0; i < num_messages; i++) {
+    for (auto& conn : conns) {
+      ASSERT_EQ(conn->send_message(new MPing()), 0);
+    }
+  }
+
+  {
+    std::unique_lock l{srv_dispatcher.lock};
+    ASSERT_TRUE(srv_dispatcher.cond.wait_for(l, 60s, [&] {
+      return srv_dispatcher.count == num_clients * num_messages;
+    }));
+    // several connections were dispatched at once
+    EXPECT_GT(srv_dispatcher.max_dispatching, 1u);
+    // but the messages of each in the order they were sent
+    ASSERT_EQ(num_clients, srv_dispatcher.seqs.size());
+    for (auto& [conn, seqs] : srv_dispatcher.seqs) {
+      ASSERT_EQ(num_messages, seqs.size());
+      for (unsigned i = 1; i < seqs.size(); i++) {
+        ASSERT_EQ(seqs[i - 1] + 1, seqs[i]);
+      }
+    }
+    srv_dispatcher.seqs.clear();
+  }
+
+  conns.clear();
+  for (auto msgr : clients) {
+    msgr->shutdown();
+    msgr->wait();
+    delete msgr;
+  }
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
+
+// the data of the i-th message, of varying length
+static bufferlist make_payload(uint32_t i)
+{
+  bufferlist bl;
+  ceph::encode(i, bl);
+  bl.append(string((i % 7 + 1) * 1000, 'a' + i % 26));
+  return bl;
+}
+
+// checks the data of the messages it gets, and records their order
+class PayloadDispatcher : public Dispatcher {
+ public:
+  ceph::mutex lock = ceph::make_mutex("PayloadDispatcher::lock");
+  ceph::condition_variable cond;
+  vector<uint32_t> received;
+  bool corrupted = false;
+
+  PayloadDispatcher(): Dispatcher(g_ceph_context) {}
+  bool ms_can_fast_dispatch_any() const override { return false; }
+  bool ms_dispatch(Message *m) override {
+    uint32_t i;
+    auto p = m->get_data().cbegin();
+    ceph::decode(i, p);
+    std::lock_guard l{lock};
+    if (!m->get_data().contents_equal(make_payload(i))) {
+      corrupted = true;
+    }
+    received.push_back(i);
+    cond.notify_all();
+    m->put();
+    return true;
+  }
+  bool ms_handle_reset(Connection *con) override {
+    return true;
+  }
+  void ms_handle_remote_reset(Connection *con) override {}
+  bool ms_handle_refused(Connection *con) override {
+    return false;
+  }
+  bool ms_handle_fast_authentication(Connection *con) override {
+    return true;
+  }
+};
+
+// the <sum, count> of msgr_send_messages_per_syscall over all workers
+static std::pair<uint64_t, uint64_t> read_messages_per_syscall()
+{
+  std::pair<uint64_t, uint64_t> total{0, 0};
+  g_ceph_context->get_perfcounters_collection()->with_counters(
+    [&total] (const PerfCountersCollectionImpl::CounterMap& by_path) {
+      for (auto& [path, counter] : by_path) {
+	if (path.ends_with(".msgr_send_messages_per_syscall")) {
+	  auto [sum, count] = counter.data->read_avg();
+	  total.first += sum;
+	  total.second += count;
+	}
+      }
+    });
+  return total;
+}
+
+TEST_P(MessengerTest, SendBatchTest) {
+  PayloadDispatcher srv_dispatcher;
+  FakeDispatcher cli_dispatcher(false);
+  TestInterceptor *srv_interceptor = new TestInterceptor();
+
+  server_msgr->set_policy(entity_name_t::TYPE_CLIENT, Messenger::Policy::stateful_server(0));
+  server_msgr->interceptor = srv_interceptor;
+  client_msgr->set_policy(entity_name_t::TYPE_OSD, Messenger::Policy::lossless_peer(0));
+
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+  client_msgr->bind(bind_addr);
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  // queue the messages faster than they are sent, so that they go out in
+  // batches of ms_async_send_batch_max_messages
+  auto send = [&conn] (uint32_t from, uint32_t to) {
+    for (uint32_t i = from; i < to; i++) {
+      MPing *m = new MPing();
+      m->set_data(make_payload(i));
+      ASSERT_EQ(conn->send_message(m), 0);
+    }
+  };
+  auto wait_for = [&srv_dispatcher] (size_t n) {
+    std::unique_lock l{srv_dispatcher.lock};
+    return srv_dispatcher.cond.wait_for(l, 60s, [&] {
+      return srv_dispatcher.received.size() >= n;
+    });
+  };
+
+  // 1. the batched frames arrive intact and in order, and several of them
+  // go out with each send call
+  auto [sum_before, count_before] = read_messages_per_syscall();
+  send(0, 500);
+  ASSERT_TRUE(wait_for(500));
+  {
+    auto [sum, count] = read_messages_per_syscall();
+    ASSERT_GT(count, count_before);
+    EXPECT_GT(sum - sum_before, count - count_before);
+  }
+
+  // 2. fail the server while it handles the first message of the second
+  // burst, so that the client reconnects and sends the rest of it again
+  srv_interceptor->proceed(Interceptor::STEP::HANDLE_MESSAGE, Interceptor::ACTION::FAIL);
+  send(500, 1000);
+  ASSERT_TRUE(wait_for(1000));
+
+  {
+    std::lock_guard l{srv_dispatcher.lock};
+    EXPECT_FALSE(srv_dispatcher.corrupted);
+    ASSERT_EQ(1000u, srv_dispatcher.received.size());
+    for (uint32_t i = 0; i < srv_dispatcher.received.size(); i++) {
+      ASSERT_EQ(i, srv_dispatcher.received[i]);
+    }
+  }
+  unsigned reconnects = 0;
+  for (auto& [c, steps] : srv_interceptor->step_history) {
+    reconnects += srv_interceptor->count_step(c, Interceptor::STEP::SEND_RECONNECT_OK);
+  }
+  EXPECT_EQ(1u, reconnects);
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+
+  delete srv_interceptor;
+}
+
+
 class SyntheticWorkload;
 
 struct Payload {
@@ -2083,6 +2335,41 @@ TEST_P(MessengerTest, SyntheticStressTest1) {
 }
 
 
+TEST_P(MessengerTest, SyntheticRebalanceTest) {
+  // rebalance as often as possible so connections keep hopping between
+  // workers while traffic and faults are going on
+  g_ceph_context->_conf.set_val("ms_async_rebalance_interval", "0.01");
+  g_ceph_context->_conf.set_val("ms_async_rebalance_threshold", "0");
+  SyntheticWorkload test_msg(8, 32, GetParam(), 100,
+                             Messenger::Policy::stateful_server(0),
+                             Messenger::Policy::lossless_client(0));
+  for (int i = 0; i < 20; ++i) {
+    if (!(i % 10)) lderr(g_ceph_context) << "seeding connection " << i << dendl;
+    test_msg.generate_connection();
+  }
+  gen_type rng(time(NULL));
+  for (int i = 0; i < 5000; ++i) {
+    if (!(i % 10)) {
+      lderr(g_ceph_context) << "Op " << i << ": " << dendl;
+      test_msg.print_internal_state();
+    }
+    boost::uniform_int<> true_false(0, 99);
+    int val = true_false(rng);
+    if (val > 95) {
+      test_msg.generate_connection();
+    } else if (val > 90) {
+      test_msg.drop_connection();
+    } else if (val > 10) {
+      test_msg.send_message();
+    } else {
+      usleep(rand() % 1000 + 500);
+    }
+  }
+  test_msg.wait_for_done();
+  g_ceph_context->_conf.set_val("ms_async_rebalance_interval", "0");
+  g_ceph_context->_conf.set_val("ms_async_rebalance_threshold", "0.2");
+}
+
 TEST_P(MessengerTest, SyntheticInjectTest) {
   uint64_t dispatch_throttle_bytes = g_ceph_context->_conf->ms_dispatch_throttle_bytes;
   g_ceph_context->_conf.set_val("ms_inject_socket_failures", "30");
@@ -0,0 +1,233 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+// the latency of the small PUTs of concurrent clients, written through to a
+// simulated backing store, and acknowledged by the D4N Writeback once their
+// record is synced to a journal on local disk, as with rgw_d4n_writeback_enabled.
+// the clients are coroutines on a few frontend threads, as with beast
+
+#include "driver/d4n/d4n_writeback.h"
+#include "global/global_init.h"
+#include "common/ceph_argparse.h"
+#include "common/errno.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/program_options.hpp>
+
+using rgw::d4n::Writeback;
+using rgw::d4n::WritebackJournal;
+using rgw::d4n::WritebackRecord;
+using Clock = ceph::mono_clock;
+
+struct parameters {
+  uint64_t object_size = 0;
+  uint64_t clients = 0;
+  uint64_t frontend_threads = 0;
+  uint64_t puts = 0; // per client
+  ceph::timespan backing_latency{};
+  double backing_bandwidth = 0; // bytes per second of a write
+  std::string journal_path;
+};
+
+static ceph::timespan seconds(double s)
+{
+  return std::chrono::duration_cast<ceph::timespan>(std::chrono::duration<double>(s));
+}
+
+// of a write of the object to the backing store
+static ceph::timespan backing_time(const parameters& p, uint64_t len)
+{
+  return p.backing_latency + seconds(len / p.backing_bandwidth);
+}
+
+// writes back to the simulated backing store
+class BenchWriteback : public Writeback {
+  const parameters& p;
+
+ protected:
+  int write_back(const DoutPrefixProvider* dpp, const WritebackRecord& record,
+		 optional_yield y) override {
+    std::this_thread::sleep_for(backing_time(p, record.data.length()));
+    return 0;
+  }
+
+ public:
+  explicit BenchWriteback(const parameters& p)
+    : Writeback(g_ceph_context, nullptr, nullptr,
+		std::make_unique<WritebackJournal>(p.journal_path)),
+      p(p) {}
+  ~BenchWriteback() override {
+    stop();
+  }
+};
+
+struct result {
+  std::vector<ceph::timespan> latencies;
+  uint64_t written_through = 0; // by write-back, past the bound on dirty bytes
+  ceph::timespan elapsed{};
+};
+
+static result run(const parameters& p, bool writeback_enabled)
+{
+  const NoDoutPrefix dpp{g_ceph_context, ceph_subsys_rgw};
+  std::filesystem::remove_all(p.journal_path);
+  std::optional<BenchWriteback> writeback;
+  if (writeback_enabled) {
+    writeback.emplace(p);
+    if (int r = writeback->init(&dpp); r < 0) {
+      std::cerr << "failed to init the journal in " << p.journal_path
+		<< ": " << cpp_strerror(-r) << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  const std::string data(p.object_size, 'a');
+
+  std::vector<result> results(p.clients);
+  boost::asio::io_context context;
+  for (uint64_t c = 0; c < p.clients; ++c) {
+    boost::asio::spawn(context,
+      [&, c] (boost::asio::yield_context yield) {
+	auto& res = results[c];
+	boost::asio::steady_timer backing(context);
+	for (uint64_t i = 0; i < p.puts; ++i) {
+	  const auto put_start = Clock::now();
+	  int r = -ENOSPC;
+	  if (writeback) {
+	    WritebackRecord record;
+	    record.bucket = rgw_bucket("", "bucket", "bucket.id");
+	    record.key = rgw_obj_key("obj." + std::to_string(c) + "." + std::to_string(i));
+	    record.accounted_size = data.size();
+	    record.data.append(data);
+	    r = writeback->add(&dpp, std::move(record), yield);
+	  }
+	  if (r < 0) {
+	    res.written_through += writeback_enabled;
+	    boost::system::error_code ec;
+	    backing.expires_after(backing_time(p, data.size()));
+	    backing.async_wait(yield[ec]);
+	  }
+	  res.latencies.push_back(Clock::now() - put_start);
+	}
+      }, [] (std::exception_ptr eptr) {
+	if (eptr) std::rethrow_exception(eptr);
+      });
+  }
+  const auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < p.frontend_threads; ++t) {
+    threads.emplace_back([&context] { context.run(); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  result total;
+  total.elapsed = Clock::now() - start;
+  for (auto& res : results) {
+    total.latencies.insert(total.latencies.end(), res.latencies.begin(), res.latencies.end());
+    total.written_through += res.written_through;
+  }
+  std::sort(total.latencies.begin(), total.latencies.end());
+  writeback.reset();
+  std::filesystem::remove_all(p.journal_path);
+  return total;
+}
+
+static double ms(ceph::timespan t)
+{
+  return std::chrono::duration<double, std::milli>(t).count();
+}
+
+int main(int argc, char** argv)
+{
+  parameters p;
+  uint64_t dirty_bytes;
+  uint64_t flush_threads;
+  uint64_t journal_threads;
+  try {
+    using namespace boost::program_options;
+    options_description desc{"Options"};
+    desc.add_options()
+      ("help,h", "Help screen")
+      ("object_size", value<uint64_t>()->default_value(64 << 10), "bytes of an object")
+      ("clients", value<uint64_t>()->default_value(16), "concurrent clients")
+      ("frontend_threads", value<uint64_t>()->default_value(2), "threads running the clients")
+      ("puts", value<uint64_t>()->default_value(200), "PUTs per client")
+      ("backing_latency_ms", value<int>()->default_value(10), "latency of a write to the backing store")
+      ("backing_bandwidth", value<double>()->default_value(200e6), "bytes per second of a write")
+      ("dirty_bytes", value<uint64_t>()->default_value(1 << 30), "bound on the dirty bytes")
+      ("flush_threads", value<uint64_t>()->default_value(4), "rgw_d4n_writeback_flush_threads")
+      ("journal_threads", value<uint64_t>()->default_value(4), "rgw_d4n_writeback_journal_threads")
+      ("journal_path", value<std::string>()->default_value(
+	(std::filesystem::temp_directory_path() / "bench_rgw_d4n_writeback").string()),
+       "directory of the journal, on the disk of the cache");
+    variables_map vm;
+    store(parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    p.object_size = vm["object_size"].as<uint64_t>();
+    p.clients = vm["clients"].as<uint64_t>();
+    p.frontend_threads = std::max<uint64_t>(1, vm["frontend_threads"].as<uint64_t>());
+    p.puts = vm["puts"].as<uint64_t>();
+    p.backing_latency = std::chrono::milliseconds(vm["backing_latency_ms"].as<int>());
+    p.backing_bandwidth = vm["backing_bandwidth"].as<double>();
+    p.journal_path = vm["journal_path"].as<std::string>();
+    dirty_bytes = vm["dirty_bytes"].as<uint64_t>();
+    flush_threads = vm["flush_threads"].as<uint64_t>();
+    journal_threads = vm["journal_threads"].as<uint64_t>();
+  } catch (const boost::program_options::error& ex) {
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<const char*> args;
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("rgw_d4n_l1_datacache_size", std::to_string(dirty_bytes));
+  conf.set_val_or_die("rgw_d4n_writeback_max_dirty_ratio", "1");
+  conf.set_val_or_die("rgw_d4n_writeback_max_object_size", std::to_string(p.object_size));
+  conf.set_val_or_die("rgw_d4n_writeback_flush_threads", std::to_string(flush_threads));
+  conf.set_val_or_die("rgw_d4n_writeback_journal_threads", std::to_string(journal_threads));
+  common_init_finish(g_ceph_context);
+
+  for (bool writeback_enabled : {false, true}) {
+    const auto r = run(p, writeback_enabled);
+    const auto& l = r.latencies;
+    ceph::timespan sum = ceph::timespan::zero();
+    for (auto t : l) {
+      sum += t;
+    }
+    std::cout << (writeback_enabled ? "write-back" : "write-through") << ": "
+	      << l.size() / std::chrono::duration<double>(r.elapsed).count() << " PUT/s, latency mean "
+	      << ms(sum / l.size()) << " ms, p50 " << ms(l[l.size() / 2]) << " ms, p99 "
+	      << ms(l[l.size() * 99 / 100]) << " ms, max " << ms(l.back()) << " ms";
+    if (writeback_enabled) {
+      std::cout << ", " << r.written_through << " written through";
+    }
+    std::cout << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
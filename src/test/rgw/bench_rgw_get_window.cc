@@ -0,0 +1,202 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+// the throughput of the GET of a large object through a YieldingAioThrottle,
+// with the fixed window, the AdaptiveWindow and the hedged reads of
+// RGWRados::Object::Read::iterate(), over simulated reads from RADOS and a
+// simulated client
+
+#include "rgw_aio_throttle.h"
+#include "rgw_hedged_read.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <boost/asio/basic_waitable_timer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/program_options.hpp>
+
+using namespace std::chrono_literals;
+using Clock = ceph::mono_clock;
+using Timer = boost::asio::basic_waitable_timer<ceph::coarse_mono_clock>;
+
+struct parameters {
+  uint64_t object_size = 0;
+  uint64_t stripe_size = 0;
+  uint64_t window_size = 0;
+  uint64_t max_window_size = 0;
+  ceph::timespan read_latency{};
+  double osd_bandwidth = 0; // bytes per second of a read
+  double slow_ratio = 0; // of the reads that take slow_latency more
+  ceph::timespan slow_latency{};
+  double client_bandwidth = 0;
+  double hedge_ratio = 0; // zero for no hedging
+  ceph::timespan hedge_min_delay{};
+};
+
+static ceph::timespan seconds(double s)
+{
+  return std::chrono::duration_cast<ceph::timespan>(std::chrono::duration<double>(s));
+}
+
+struct result {
+  double bytes_per_second = 0;
+  uint64_t hedged = 0;
+};
+
+static result simulate(const parameters& p, bool adaptive, bool hedge)
+{
+  boost::asio::io_context context;
+  std::mt19937 rng{1};
+  std::uniform_real_distribution<double> uniform;
+  const ceph::bufferptr stripe = ceph::buffer::create(p.stripe_size);
+  result res;
+
+  // a read from an osd, slow now and then
+  auto read = [&] (bool, auto cb) {
+    auto latency = p.read_latency + seconds(p.stripe_size / p.osd_bandwidth);
+    if (uniform(rng) < p.slow_ratio) {
+      latency += p.slow_latency;
+    }
+    auto t = std::make_unique<Timer>(context);
+    t->expires_after(latency);
+    t->async_wait([t=std::move(t), cb=std::move(cb), &stripe] (boost::system::error_code) mutable {
+        bufferlist bl;
+        bl.append(stripe);
+        cb(boost::system::error_code{}, std::move(bl));
+      });
+  };
+
+  boost::asio::spawn(context,
+    [&] (boost::asio::yield_context yield) {
+      rgw::YieldingAioThrottle aio(p.window_size, yield);
+      // tracks the latency for the hedges of a fixed window as well
+      rgw::AdaptiveWindow window(p.window_size, adaptive ? p.max_window_size : p.window_size);
+      rgw::AioResultList completed;
+      uint64_t offset = 0;
+      Timer client(context);
+
+      // as get_obj_data::flush()
+      auto flush = [&] (rgw::AioResultList&& results) {
+        for (const auto& r : results) {
+          window.add_read(r.latency);
+        }
+        auto cmp = [](const auto& lhs, const auto& rhs) { return lhs.id < rhs.id; };
+        results.sort(cmp);
+        completed.merge(results, cmp);
+        while (!completed.empty() && completed.front().id == offset) {
+          const uint64_t len = completed.front().data.length();
+          const auto start = Clock::now();
+          boost::system::error_code ec;
+          client.expires_after(seconds(len / p.client_bandwidth));
+          client.async_wait(yield[ec]);
+          window.add_client(len, Clock::now() - start);
+          offset += len;
+          completed.pop_front_and_dispose(std::default_delete<rgw::AioResultEntry>{});
+        }
+      };
+
+      const auto start = Clock::now();
+      for (uint64_t ofs = 0; ofs < p.object_size; ofs += p.stripe_size) {
+        ceph::timespan delay = ceph::timespan::zero();
+        if (hedge) {
+          delay = std::max(p.hedge_min_delay, std::chrono::duration_cast<ceph::timespan>(
+                               window.get_latency() * p.hedge_ratio));
+        }
+        auto op = [&, delay] (rgw::Aio* a, rgw::AioResult& r) {
+          rgw::async_hedged_read(yield.get_executor(), delay, read,
+              [&res, a, &r] (boost::system::error_code ec, bufferlist bl,
+                             bool hedged, bool) {
+                res.hedged += hedged;
+                r.result = -ec.value();
+                r.data = std::move(bl);
+                a->put(r);
+              });
+        };
+        flush(aio.get(rgw_raw_obj{{"pool"}, "obj"}, std::move(op), p.stripe_size, ofs));
+        if (adaptive) {
+          aio.set_window(window.get());
+        }
+      }
+      for (auto c = aio.wait(); !c.empty(); c = aio.wait()) {
+        flush(std::move(c));
+      }
+      flush(aio.drain());
+      const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+      res.bytes_per_second = offset / elapsed;
+    }, [] (std::exception_ptr eptr) {
+      if (eptr) std::rethrow_exception(eptr);
+    });
+  context.run();
+  return res;
+}
+
+int main(int argc, char** argv)
+{
+  parameters p;
+  try {
+    using namespace boost::program_options;
+    options_description desc{"Options"};
+    desc.add_options()
+      ("help,h", "Help screen")
+      ("object_size", value<uint64_t>()->default_value(256 << 20), "bytes of the object")
+      ("stripe_size", value<uint64_t>()->default_value(4 << 20), "bytes per read (rgw_get_obj_max_req_size)")
+      ("window_size", value<uint64_t>()->default_value(16 << 20), "rgw_get_obj_window_size")
+      ("max_window_size", value<uint64_t>()->default_value(64 << 20), "rgw_get_obj_max_window_size")
+      ("read_latency_ms", value<int>()->default_value(20), "latency of a read")
+      ("osd_bandwidth", value<double>()->default_value(200e6), "bytes per second of a read")
+      ("slow_ratio", value<double>()->default_value(0.02), "ratio of the slow reads")
+      ("slow_latency_ms", value<int>()->default_value(500), "extra latency of a slow read")
+      ("client_bandwidth", value<double>()->default_value(1e9), "bytes per second the client takes")
+      ("hedge_ratio", value<double>()->default_value(3), "rgw_get_obj_hedge_latency_ratio")
+      ("hedge_min_delay_ms", value<int>()->default_value(20), "rgw_get_obj_hedge_min_delay");
+    variables_map vm;
+    store(parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    p.object_size = vm["object_size"].as<uint64_t>();
+    p.stripe_size = vm["stripe_size"].as<uint64_t>();
+    p.window_size = vm["window_size"].as<uint64_t>();
+    p.max_window_size = vm["max_window_size"].as<uint64_t>();
+    p.read_latency = std::chrono::milliseconds(vm["read_latency_ms"].as<int>());
+    p.osd_bandwidth = vm["osd_bandwidth"].as<double>();
+    p.slow_ratio = vm["slow_ratio"].as<double>();
+    p.slow_latency = std::chrono::milliseconds(vm["slow_latency_ms"].as<int>());
+    p.client_bandwidth = vm["client_bandwidth"].as<double>();
+    p.hedge_ratio = vm["hedge_ratio"].as<double>();
+    p.hedge_min_delay = std::chrono::milliseconds(vm["hedge_min_delay_ms"].as<int>());
+  } catch (const boost::program_options::error& ex) {
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const struct {
+    const char* name;
+    bool adaptive;
+    bool hedge;
+  } modes[] = {
+    {"fixed window", false, false},
+    {"adaptive window", true, false},
+    {"adaptive window, hedged", true, true},
+  };
+  for (const auto& mode : modes) {
+    const auto r = simulate(p, mode.adaptive, mode.hedge);
+    std::cout << mode.name << ": " << r.bytes_per_second / 1e6 << " MB/s, "
+              << r.hedged << " hedged reads" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+// an http load generator for the requests/s and latency of the frontend.
+// run radosgw with rgw_enable_apis=zero (and num_io_contexts in rgw_frontends
+// to compare), then keep the given connections busy with requests to /zero:
+//
+//   bench_rgw_http_load --port 8000 --connections 256 --threads 8
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/program_options.hpp>
+
+namespace http = boost::beast::http;
+using tcp = boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+struct parameters {
+  std::string host;
+  std::string port;
+  std::string target;
+  std::string method;
+  size_t connections = 0;
+  size_t threads = 0;
+  std::chrono::seconds duration{};
+};
+
+// the requests of one thread, each a latency in microseconds
+struct results {
+  std::vector<uint32_t> latencies;
+  uint64_t errors = 0;
+};
+
+static void run_connection(const parameters& p,
+                           const tcp::resolver::results_type& endpoints,
+                           Clock::time_point deadline, results& r,
+                           boost::asio::yield_context yield)
+{
+  boost::system::error_code ec;
+  tcp::socket socket{yield.get_executor()};
+  boost::beast::flat_buffer buffer;
+
+  http::request<http::empty_body> req;
+  req.method(http::string_to_verb(p.method));
+  req.target(p.target);
+  req.version(11);
+  req.set(http::field::host, p.host);
+  req.keep_alive(true);
+
+  while (Clock::now() < deadline) {
+    if (!socket.is_open()) {
+      boost::asio::async_connect(socket, endpoints, yield[ec]);
+      if (ec) {
+        r.errors++;
+        continue;
+      }
+      socket.set_option(tcp::no_delay(true), ec);
+    }
+    const auto start = Clock::now();
+    http::async_write(socket, req, yield[ec]);
+    if (!ec) {
+      http::response<http::string_body> res;
+      http::async_read(socket, buffer, res, yield[ec]);
+      if (!ec && res.result_int() >= 500) {
+        r.errors++;
+      }
+      if (!ec && !res.keep_alive()) {
+        socket.close(ec);
+      }
+    }
+    if (ec) {
+      r.errors++;
+      socket.close(ec);
+      continue;
+    }
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start);
+    r.latencies.push_back(us.count());
+  }
+}
+
+int main(int argc, char** argv)
+{
+  parameters p;
+  try {
+    using namespace boost::program_options;
+    options_description desc{"Options"};
+    desc.add_options()
+      ("help,h", "Help screen")
+      ("host", value<std::string>()->default_value("localhost"), "radosgw host")
+      ("port", value<std::string>()->default_value("8000"), "radosgw port")
+      ("target", value<std::string>()->default_value("/zero"), "request target")
+      ("method", value<std::string>()->default_value("GET"), "request method")
+      ("connections", value<size_t>()->default_value(64), "concurrent connections")
+      ("threads", value<size_t>()->default_value(4), "client threads")
+      ("seconds", value<int>()->default_value(10), "duration of the run");
+    variables_map vm;
+    store(parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    p.host = vm["host"].as<std::string>();
+    p.port = vm["port"].as<std::string>();
+    p.target = vm["target"].as<std::string>();
+    p.method = vm["method"].as<std::string>();
+    p.connections = std::max<size_t>(vm["connections"].as<size_t>(), 1);
+    p.threads = std::clamp<size_t>(vm["threads"].as<size_t>(), 1, p.connections);
+    p.duration = std::chrono::seconds(vm["seconds"].as<int>());
+  } catch (const boost::program_options::error& ex) {
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (http::string_to_verb(p.method) == http::verb::unknown) {
+    std::cerr << "unknown method " << p.method << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  tcp::resolver::results_type endpoints;
+  {
+    boost::asio::io_context context;
+    tcp::resolver resolver{context};
+    boost::system::error_code ec;
+    endpoints = resolver.resolve(p.host, p.port, ec);
+    if (ec) {
+      std::cerr << "failed to resolve " << p.host << ':' << p.port
+                << ": " << ec.message() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // an io_context per thread, with its share of the connections
+  std::list<boost::asio::io_context> contexts;
+  std::vector<results> res(p.threads);
+  const auto start = Clock::now();
+  const auto deadline = start + p.duration;
+  for (size_t t = 0; t < p.threads; t++) {
+    auto& context = contexts.emplace_back(1);
+    for (size_t c = t; c < p.connections; c += p.threads) {
+      boost::asio::spawn(context,
+        [&, t] (boost::asio::yield_context yield) {
+          run_connection(p, endpoints, deadline, res[t], yield);
+        }, [] (std::exception_ptr eptr) {
+          if (eptr) std::rethrow_exception(eptr);
+        });
+    }
+  }
+  std::vector<std::thread> threads;
+  for (auto& context : contexts) {
+    threads.emplace_back([&context] { context.run(); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<uint32_t> latencies;
+  uint64_t errors = 0;
+  for (auto& r : res) {
+    latencies.insert(latencies.end(), r.latencies.begin(), r.latencies.end());
+    errors += r.errors;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies] (double q) -> uint32_t {
+    if (latencies.empty()) {
+      return 0;
+    }
+    return latencies[std::min<size_t>(latencies.size() * q, latencies.size() - 1)];
+  };
+  std::cout << latencies.size() << " requests in " << elapsed << "s, "
+            << errors << " errors\n"
+            << "requests/s " << latencies.size() / elapsed << "\n"
+            << "latency us: p50 " << percentile(0.5)
+            << " p99 " << percentile(0.99)
+            << " p99.9 " << percentile(0.999)
+            << " max " << percentile(1) << std::endl;
+  return EXIT_SUCCESS;
+}
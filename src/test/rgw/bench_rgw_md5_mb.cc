@@ -0,0 +1,120 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+// compares the MD5 throughput of a core hashing one stream at a time with
+// that of an md5_mb::Hasher hashing many concurrent streams
+
+#include "rgw_md5_mb.h"
+#include "common/ceph_crypto.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <boost/program_options.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+static double gbps(uint64_t bytes, Clock::duration elapsed)
+{
+  return bytes / std::chrono::duration<double>(elapsed).count() / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+  size_t streams;
+  size_t object_size;
+  size_t chunk_size;
+  try {
+    using namespace boost::program_options;
+    options_description desc{"Options"};
+    desc.add_options()
+      ("help,h", "Help screen")
+      ("streams", value<size_t>()->default_value(64), "concurrent uploads")
+      ("object_size", value<size_t>()->default_value(16 << 20), "bytes per upload")
+      ("chunk_size", value<size_t>()->default_value(4 << 20), "bytes per update");
+    variables_map vm;
+    store(parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    streams = vm["streams"].as<size_t>();
+    object_size = vm["object_size"].as<size_t>();
+    chunk_size = std::max<size_t>(vm["chunk_size"].as<size_t>(), 1);
+  } catch (const boost::program_options::error& ex) {
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  bufferlist chunk;
+  chunk.append(std::string(chunk_size, 'x'));
+  const size_t chunks = (object_size + chunk_size - 1) / chunk_size;
+  const uint64_t total = uint64_t(streams) * chunks * chunk_size;
+  unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
+
+  // one stream after the other
+  auto start = Clock::now();
+  for (size_t s = 0; s < streams; ++s) {
+    ceph::crypto::MD5 md5;
+    for (size_t c = 0; c < chunks; ++c) {
+      md5.Update(reinterpret_cast<const unsigned char*>(chunk.c_str()),
+		 chunk.length());
+    }
+    md5.Final(m);
+  }
+  const double single = gbps(total, Clock::now() - start);
+
+  // all the streams at once, each with a chunk in flight
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t done = 0;
+  std::vector<rgw::md5_mb::Digest> digests(streams);
+  std::vector<size_t> submitted(streams, 0);
+  std::vector<unsigned char> out(streams * CEPH_CRYPTO_MD5_DIGESTSIZE);
+  start = Clock::now();
+  {
+    rgw::md5_mb::Hasher hasher;
+    // the callback of a chunk submits the next chunk of its stream
+    std::function<void(size_t)> next = [&] (size_t s) {
+      if (submitted[s]++ < chunks) {
+	hasher.update(digests[s], chunk, [&, s] { next(s); });
+      } else {
+	hasher.final(digests[s], &out[s * CEPH_CRYPTO_MD5_DIGESTSIZE], [&] {
+	    std::lock_guard lock{mutex};
+	    ++done;
+	    cond.notify_one();
+	  });
+      }
+    };
+    {
+      std::unique_lock lock{mutex};
+      for (size_t s = 0; s < streams; ++s) {
+	next(s);
+      }
+      cond.wait(lock, [&] { return done == streams; });
+    }
+  }
+  const double multi = gbps(total, Clock::now() - start);
+
+  std::cout << "streams " << streams << ", " << chunks << " chunks of "
+	    << chunk_size << " bytes each\n"
+	    << "lanes " << rgw::md5_mb::Hasher::lanes() << "\n"
+	    << "single-buffer " << single << " GB/s\n"
+	    << "multi-buffer " << multi << " GB/s (one core)\n"
+	    << "speedup " << multi / single << std::endl;
+  return EXIT_SUCCESS;
+}
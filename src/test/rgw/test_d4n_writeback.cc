@@ -0,0 +1,428 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "driver/d4n/d4n_writeback.h"
+#include "global/global_init.h"
+#include "common/ceph_argparse.h"
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <gtest/gtest.h>
+
+using rgw::d4n::Writeback;
+using rgw::d4n::WritebackJournal;
+using rgw::d4n::WritebackRecord;
+
+// with a cache of 1000 bytes and the default ratio of 0.1
+static constexpr uint64_t max_dirty_bytes = 100;
+
+static const rgw_bucket test_bucket("", "bucket", "bucket.id");
+
+static WritebackRecord make_record(const std::string& name, const std::string& data)
+{
+  WritebackRecord record;
+  record.bucket = test_bucket;
+  record.key = rgw_obj_key(name);
+  record.etag = "etag";
+  record.accounted_size = data.size();
+  record.attrs["user.rgw.content_type"].append("text/plain");
+  record.data.append(data);
+  return record;
+}
+
+class WritebackJournalTest : public ::testing::Test {
+ protected:
+  const NoDoutPrefix dpp{g_ceph_context, ceph_subsys_rgw};
+  std::string path;
+
+  void SetUp() override {
+    path = (std::filesystem::temp_directory_path() /
+	    ("test_d4n_writeback." + std::to_string(::getpid()))).string();
+    std::filesystem::remove_all(path);
+  }
+  void TearDown() override {
+    std::filesystem::remove_all(path);
+  }
+};
+
+TEST_F(WritebackJournalTest, CommitLoad)
+{
+  WritebackJournal journal{path};
+  ASSERT_EQ(0, journal.init(&dpp));
+  const auto record = make_record("obj", "data");
+  const auto id = WritebackJournal::get_id(record.bucket, record.key);
+  ASSERT_EQ(0, journal.prepare(&dpp, id, 1, record));
+  ASSERT_EQ(0, journal.commit(&dpp, id, 1));
+  ASSERT_EQ(0, journal.sync(&dpp));
+
+  std::map<std::string, WritebackRecord> records;
+  ASSERT_EQ(0, journal.load(&dpp, records));
+  ASSERT_EQ(1u, records.size());
+  const auto& loaded = records.begin()->second;
+  EXPECT_EQ(id, records.begin()->first);
+  EXPECT_EQ(record.key, loaded.key);
+  EXPECT_EQ(record.bucket, loaded.bucket);
+  EXPECT_EQ(record.etag, loaded.etag);
+  EXPECT_EQ(4u, loaded.accounted_size);
+  EXPECT_EQ(1u, loaded.attrs.size());
+  EXPECT_EQ("data", loaded.data.to_str());
+}
+
+TEST_F(WritebackJournalTest, LastCommitWins)
+{
+  WritebackJournal journal{path};
+  ASSERT_EQ(0, journal.init(&dpp));
+  const auto first = make_record("obj", "first");
+  const auto second = make_record("obj", "second");
+  const auto id = WritebackJournal::get_id(first.bucket, first.key);
+  ASSERT_EQ(0, journal.prepare(&dpp, id, 1, first));
+  ASSERT_EQ(0, journal.prepare(&dpp, id, 2, second));
+  ASSERT_EQ(0, journal.commit(&dpp, id, 1));
+  ASSERT_EQ(0, journal.commit(&dpp, id, 2));
+
+  std::map<std::string, WritebackRecord> records;
+  ASSERT_EQ(0, journal.load(&dpp, records));
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("second", records[id].data.to_str());
+}
+
+TEST_F(WritebackJournalTest, DropPrepared)
+{
+  WritebackJournal journal{path};
+  ASSERT_EQ(0, journal.init(&dpp));
+  const auto committed = make_record("a", "a");
+  const auto prepared = make_record("b", "b");
+  const auto aborted = make_record("c", "c");
+  const auto id_a = WritebackJournal::get_id(committed.bucket, committed.key);
+  const auto id_b = WritebackJournal::get_id(prepared.bucket, prepared.key);
+  const auto id_c = WritebackJournal::get_id(aborted.bucket, aborted.key);
+  ASSERT_EQ(0, journal.prepare(&dpp, id_a, 1, committed));
+  ASSERT_EQ(0, journal.commit(&dpp, id_a, 1));
+  ASSERT_EQ(0, journal.prepare(&dpp, id_b, 2, prepared));
+  ASSERT_EQ(0, journal.prepare(&dpp, id_c, 3, aborted));
+  journal.abort(&dpp, id_c, 3);
+
+  // a restart only finds the committed record
+  std::map<std::string, WritebackRecord> records;
+  ASSERT_EQ(0, journal.load(&dpp, records));
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(1u, records.count(id_a));
+  EXPECT_EQ(0u, records.count(id_b));
+  EXPECT_EQ(1u, std::distance(std::filesystem::directory_iterator(path),
+			      std::filesystem::directory_iterator()));
+}
+
+TEST_F(WritebackJournalTest, Remove)
+{
+  WritebackJournal journal{path};
+  ASSERT_EQ(0, journal.init(&dpp));
+  const auto record = make_record("obj", "data");
+  const auto id = WritebackJournal::get_id(record.bucket, record.key);
+  ASSERT_EQ(0, journal.prepare(&dpp, id, 1, record));
+  ASSERT_EQ(0, journal.commit(&dpp, id, 1));
+  ASSERT_EQ(0, journal.remove(&dpp, id));
+  // removing a record twice is not an error
+  ASSERT_EQ(0, journal.remove(&dpp, id));
+
+  std::map<std::string, WritebackRecord> records;
+  ASSERT_EQ(0, journal.load(&dpp, records));
+  EXPECT_TRUE(records.empty());
+}
+
+TEST_F(WritebackJournalTest, DistinctIds)
+{
+  const rgw_bucket other("", "other", "other.id");
+  EXPECT_NE(WritebackJournal::get_id(test_bucket, rgw_obj_key("a")),
+	    WritebackJournal::get_id(test_bucket, rgw_obj_key("b")));
+  EXPECT_NE(WritebackJournal::get_id(test_bucket, rgw_obj_key("a")),
+	    WritebackJournal::get_id(other, rgw_obj_key("a")));
+  EXPECT_EQ(WritebackJournal::get_id(test_bucket, rgw_obj_key("a")),
+	    WritebackJournal::get_id(test_bucket, rgw_obj_key("a")));
+}
+
+// holds the prepare() of one gen until released
+class BlockingJournal : public WritebackJournal {
+  std::mutex m;
+  std::condition_variable c;
+  uint64_t blocked_gen = 0;
+  bool blocked = false;
+
+ public:
+  using WritebackJournal::WritebackJournal;
+
+  void block(uint64_t gen) {
+    std::lock_guard l{m};
+    blocked_gen = gen;
+  }
+  void wait_blocked() {
+    std::unique_lock l{m};
+    c.wait(l, [this] { return blocked; });
+  }
+  void release() {
+    std::lock_guard l{m};
+    blocked_gen = 0;
+    c.notify_all();
+  }
+
+  int prepare(const DoutPrefixProvider* dpp, const std::string& id, uint64_t gen,
+	      const WritebackRecord& record) override {
+    int r = WritebackJournal::prepare(dpp, id, gen, record);
+    std::unique_lock l{m};
+    if (gen == blocked_gen) {
+      blocked = true;
+      c.notify_all();
+      c.wait(l, [this, gen] { return blocked_gen != gen; });
+    }
+    return r;
+  }
+};
+
+// records the write backs instead of writing to a backing store, and holds
+// them while blocked
+class TestWriteback : public Writeback {
+  std::mutex m;
+  std::condition_variable c;
+  bool blocked = false;
+  int waiting = 0;
+  int result = 0;
+  std::vector<std::string> written;
+
+ protected:
+  int write_back(const DoutPrefixProvider* dpp, const WritebackRecord& record,
+		 optional_yield y) override {
+    std::unique_lock l{m};
+    ++waiting;
+    c.notify_all();
+    c.wait(l, [this] { return !blocked; });
+    --waiting;
+    written.push_back(record.data.to_str());
+    return result;
+  }
+
+ public:
+  explicit TestWriteback(std::unique_ptr<WritebackJournal> journal)
+    : Writeback(g_ceph_context, nullptr, nullptr, std::move(journal)) {}
+  ~TestWriteback() override {
+    unblock();
+    // the flushers call write_back()
+    stop();
+  }
+
+  void block() {
+    std::lock_guard l{m};
+    blocked = true;
+  }
+  void unblock() {
+    std::lock_guard l{m};
+    blocked = false;
+    c.notify_all();
+  }
+  // until a flusher holds a write back
+  void wait_write_back() {
+    std::unique_lock l{m};
+    c.wait(l, [this] { return waiting > 0; });
+  }
+  void set_result(int r) {
+    std::lock_guard l{m};
+    result = r;
+  }
+  std::vector<std::string> get_written() {
+    std::lock_guard l{m};
+    return written;
+  }
+};
+
+class WritebackTest : public WritebackJournalTest {
+ protected:
+  const rgw_obj_key key{"obj"};
+
+  size_t count_records() {
+    WritebackJournal journal{path};
+    std::map<std::string, WritebackRecord> records;
+    EXPECT_EQ(0, journal.load(&dpp, records));
+    return records.size();
+  }
+};
+
+TEST_F(WritebackTest, AddRace)
+{
+  auto journal = std::make_unique<BlockingJournal>(path);
+  auto j = journal.get();
+  j->block(1);
+  TestWriteback writeback{std::move(journal)};
+  ASSERT_EQ(0, writeback.init(&dpp));
+
+  std::thread first([&] {
+      EXPECT_EQ(0, writeback.add(&dpp, make_record("obj", "first"), null_yield));
+    });
+  j->wait_blocked();
+  // the later PUT is journaled and even written back before the first one
+  ASSERT_EQ(0, writeback.add(&dpp, make_record("obj", "second"), null_yield));
+  ASSERT_EQ(0, writeback.flush(&dpp, test_bucket, key, null_yield));
+  j->release();
+  first.join();
+
+  // so the first one is dropped rather than written back over it
+  ASSERT_EQ(0, writeback.flush(&dpp, test_bucket, key, null_yield));
+  EXPECT_EQ(std::vector<std::string>{"second"}, writeback.get_written());
+  EXPECT_EQ(0u, writeback.get_dirty_bytes());
+  EXPECT_EQ(0u, count_records());
+}
+
+TEST_F(WritebackTest, OverwriteWhileFlushing)
+{
+  TestWriteback writeback{std::make_unique<WritebackJournal>(path)};
+  writeback.block();
+  ASSERT_EQ(0, writeback.init(&dpp));
+
+  ASSERT_EQ(0, writeback.add(&dpp, make_record("obj", "first"), null_yield));
+  writeback.wait_write_back();
+  ASSERT_EQ(0, writeback.add(&dpp, make_record("obj", "second"), null_yield));
+  EXPECT_EQ(6u, writeback.get_dirty_bytes());
+  writeback.unblock();
+
+  // the write back of the first record leaves the second one dirty
+  ASSERT_EQ(0, writeback.flush(&dpp, test_bucket, key, null_yield));
+  const std::vector<std::string> expected{"first", "second"};
+  EXPECT_EQ(expected, writeback.get_written());
+  EXPECT_EQ(0u, writeback.get_dirty_bytes());
+  EXPECT_EQ(0u, count_records());
+}
+
+TEST_F(WritebackTest, GetDirty)
+{
+  TestWriteback writeback{std::make_unique<WritebackJournal>(path)};
+  writeback.block();
+  ASSERT_EQ(0, writeback.init(&dpp));
+
+  EXPECT_EQ(nullptr, writeback.get_dirty(test_bucket, key));
+  ASSERT_EQ(0, writeback.add(&dpp, make_record("obj", "first"), null_yield));
+  ASSERT_EQ(0, writeback.add(&dpp, make_record("obj", "second"), null_yield));
+  // the reads see the last record, even while it is written back
+  writeback.wait_write_back();
+  auto record = writeback.get_dirty(test_bucket, key);
+  ASSERT_NE(nullptr, record);
+  EXPECT_EQ("second", record->data.to_str());
+  EXPECT_EQ(nullptr, writeback.get_dirty(test_bucket, rgw_obj_key("other")));
+
+  writeback.unblock();
+  ASSERT_EQ(0, writeback.flush(&dpp, test_bucket, key, null_yield));
+  EXPECT_EQ(nullptr, writeback.get_dirty(test_bucket, key));
+  EXPECT_EQ("second", record->data.to_str());
+}
+
+TEST_F(WritebackTest, DirtyBound)
+{
+  TestWriteback writeback{std::make_unique<WritebackJournal>(path)};
+  writeback.block();
+  ASSERT_EQ(0, writeback.init(&dpp));
+
+  const std::string data(max_dirty_bytes / 2 + 1, 'a');
+  ASSERT_EQ(0, writeback.add(&dpp, make_record("a", data), null_yield));
+  EXPECT_EQ(-ENOSPC, writeback.add(&dpp, make_record("b", data), null_yield));
+  EXPECT_EQ(data.size(), writeback.get_dirty_bytes());
+  EXPECT_EQ(1u, count_records());
+
+  // room again once the first object is written back
+  writeback.unblock();
+  ASSERT_EQ(0, writeback.flush(&dpp, test_bucket, rgw_obj_key("a"), null_yield));
+  EXPECT_EQ(0, writeback.add(&dpp, make_record("b", data), null_yield));
+}
+
+TEST_F(WritebackTest, AddFromCoroutines)
+{
+  TestWriteback writeback{std::make_unique<WritebackJournal>(path)};
+  writeback.block();
+  ASSERT_EQ(0, writeback.init(&dpp));
+
+  // the journal I/O runs off the thread of the coroutines
+  boost::asio::io_context context;
+  constexpr int puts = 5;
+  int added = 0;
+  for (int i = 0; i < puts; ++i) {
+    boost::asio::spawn(context,
+      [&, i] (boost::asio::yield_context yield) {
+	EXPECT_EQ(0, writeback.add(&dpp, make_record("obj" + std::to_string(i), "data"),
+				   yield));
+	++added;
+      }, [] (std::exception_ptr eptr) {
+	if (eptr) std::rethrow_exception(eptr);
+      });
+  }
+  context.run();
+
+  EXPECT_EQ(puts, added);
+  EXPECT_EQ(puts * 4u, writeback.get_dirty_bytes());
+  EXPECT_EQ(size_t(puts), count_records());
+}
+
+TEST_F(WritebackTest, DropMissingBucket)
+{
+  TestWriteback writeback{std::make_unique<WritebackJournal>(path)};
+  writeback.block();
+  ASSERT_EQ(0, writeback.init(&dpp));
+
+  ASSERT_EQ(0, writeback.add(&dpp, make_record("obj", "data"), null_yield));
+  writeback.wait_write_back();
+  writeback.set_result(-ENOENT);
+  writeback.unblock();
+
+  // the flusher gave up on it at once
+  ASSERT_EQ(0, writeback.flush(&dpp, test_bucket, key, null_yield));
+  EXPECT_EQ(1u, writeback.get_written().size());
+  EXPECT_EQ(0u, writeback.get_dirty_bytes());
+  EXPECT_EQ(0u, count_records());
+}
+
+TEST_F(WritebackTest, RetryTransientErrors)
+{
+  TestWriteback writeback{std::make_unique<WritebackJournal>(path)};
+  writeback.block();
+  ASSERT_EQ(0, writeback.init(&dpp));
+
+  ASSERT_EQ(0, writeback.add(&dpp, make_record("obj", "data"), null_yield));
+  writeback.wait_write_back();
+  writeback.set_result(-EIO);
+  writeback.unblock();
+
+  // the acknowledged PUT stays dirty however many times it fails
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(-EIO, writeback.flush(&dpp, test_bucket, key, null_yield));
+  }
+  EXPECT_EQ(4u, writeback.get_dirty_bytes());
+  EXPECT_EQ(1u, count_records());
+
+  // and is written back once the backing store is back
+  writeback.set_result(0);
+  EXPECT_EQ(0, writeback.flush(&dpp, test_bucket, key, null_yield));
+  EXPECT_EQ(0u, writeback.get_dirty_bytes());
+  EXPECT_EQ(0u, count_records());
+}
+
+int main(int argc, char** argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  // startup options, set before the threads start
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("rgw_d4n_l1_datacache_size", std::to_string(max_dirty_bytes * 10));
+  conf.set_val_or_die("rgw_d4n_writeback_flush_threads", "1");
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,238 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw_asio_zerocopy.h"
+
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/spawn.hpp>
+
+#include <gtest/gtest.h>
+
+using tcp = boost::asio::ip::tcp;
+
+namespace rgw::asio {
+
+// a bufferlist of several buffers of random bytes
+static ceph::bufferlist make_data(size_t buffers, size_t size)
+{
+  std::mt19937 rng{1};
+  ceph::bufferlist bl;
+  for (size_t i = 0; i < buffers; i++) {
+    ceph::bufferptr p = ceph::buffer::create(size + i * 1000);
+    for (size_t j = 0; j < p.length(); j++) {
+      p[j] = rng();
+    }
+    bl.append(std::move(p));
+  }
+  return bl;
+}
+
+// sends bl count times over loopback, and returns what the peer read
+static std::string send_over_loopback(const ceph::bufferlist& bl, int count,
+                                      size_t& pending)
+{
+  boost::asio::io_context context;
+  const auto localhost = boost::asio::ip::make_address("127.0.0.1");
+  tcp::acceptor acceptor{context, tcp::endpoint{localhost, 0}};
+  const auto port = acceptor.local_endpoint().port();
+
+  boost::asio::spawn(context,
+    [&] (boost::asio::yield_context yield) {
+      tcp::socket socket{context};
+      acceptor.async_accept(socket, yield);
+      ZeroCopySender sender{socket};
+      boost::system::error_code ec;
+      sender.enable(ec);
+      ASSERT_FALSE(ec) << ec.message();
+      for (int i = 0; i < count; i++) {
+        EXPECT_EQ(bl.length(), sender.send(bl, yield, ec));
+        EXPECT_FALSE(ec) << ec.message();
+      }
+      sender.drain(std::chrono::seconds(10), yield, ec);
+      EXPECT_FALSE(ec) << ec.message();
+      pending = sender.pending();
+      socket.shutdown(tcp::socket::shutdown_send, ec);
+    }, [] (std::exception_ptr eptr) {
+      if (eptr) std::rethrow_exception(eptr);
+    });
+
+  std::string received;
+  std::thread peer([&] {
+      boost::asio::io_context c;
+      tcp::socket socket{c};
+      socket.connect(tcp::endpoint{localhost, port});
+      // let the sender fill the socket buffer and wait for room
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      char buf[65536];
+      boost::system::error_code ec;
+      for (;;) {
+        const auto n = socket.read_some(boost::asio::buffer(buf), ec);
+        if (ec) {
+          break;
+        }
+        received.append(buf, n);
+      }
+    });
+  context.run();
+  peer.join();
+  return received;
+}
+
+TEST(ZeroCopySender, SendsAllBuffers)
+{
+  auto bl = make_data(64, 65536);
+  size_t pending = 1;
+  const auto received = send_over_loopback(bl, 4, pending);
+
+  std::string expected;
+  for (int i = 0; i < 4; i++) {
+    expected.append(bl.c_str(), bl.length());
+  }
+  ASSERT_EQ(expected.size(), received.size());
+  EXPECT_TRUE(expected == received);
+  EXPECT_EQ(0u, pending);
+}
+
+TEST(ZeroCopySender, DisabledOnCopy)
+{
+  boost::asio::io_context context;
+  const auto localhost = boost::asio::ip::make_address("127.0.0.1");
+  tcp::acceptor acceptor{context, tcp::endpoint{localhost, 0}};
+  tcp::socket client{context};
+  client.connect(acceptor.local_endpoint());
+  tcp::socket socket = acceptor.accept();
+
+  ZeroCopySender sender{socket};
+  EXPECT_FALSE(sender.enabled());
+  boost::system::error_code ec;
+  sender.enable(ec);
+  ASSERT_FALSE(ec) << ec.message();
+  EXPECT_TRUE(sender.enabled());
+
+  auto bl = make_data(2, 16384);
+  boost::asio::spawn(context,
+    [&] (boost::asio::yield_context yield) {
+      sender.send(bl, yield, ec);
+      EXPECT_FALSE(ec) << ec.message();
+      sender.drain(std::chrono::seconds(10), yield, ec);
+      EXPECT_FALSE(ec) << ec.message();
+    }, [] (std::exception_ptr eptr) {
+      if (eptr) std::rethrow_exception(eptr);
+    });
+  context.run();
+  // the kernel copies what goes over loopback, and says so
+  EXPECT_FALSE(sender.enabled());
+  EXPECT_EQ(0u, sender.pending());
+}
+
+TEST(ZeroCopySender, StalledPeer)
+{
+  boost::asio::io_context context;
+  const auto localhost = boost::asio::ip::make_address("127.0.0.1");
+  tcp::acceptor acceptor{context, tcp::endpoint{localhost, 0}};
+  // a peer that never reads, with a window too small for the data
+  tcp::socket peer{context};
+  peer.open(tcp::v4());
+  peer.set_option(tcp::socket::receive_buffer_size(1));
+  peer.connect(acceptor.local_endpoint());
+  tcp::socket socket = acceptor.accept();
+  // room for all of the data in the send queue
+  socket.set_option(tcp::socket::send_buffer_size(1 << 20));
+
+  ZeroCopySender sender{socket};
+  boost::system::error_code ec;
+  sender.enable(ec);
+  ASSERT_FALSE(ec) << ec.message();
+
+  auto bl = make_data(4, 16384);
+  boost::system::error_code drain_ec;
+  size_t pending = 0;
+  boost::asio::spawn(context,
+    [&] (boost::asio::yield_context yield) {
+      EXPECT_EQ(bl.length(), sender.send(bl, yield, ec));
+      EXPECT_FALSE(ec) << ec.message();
+      pending = sender.pending();
+      sender.drain(std::chrono::milliseconds(100), yield, drain_ec);
+    }, [] (std::exception_ptr eptr) {
+      if (eptr) std::rethrow_exception(eptr);
+    });
+  context.run();
+
+  // the kernel held on to the unsent data until drain() reset the connection
+  EXPECT_EQ(1u, pending);
+  EXPECT_EQ(boost::asio::error::timed_out, drain_ec);
+  EXPECT_EQ(0u, sender.pending());
+  EXPECT_TRUE(socket.is_open());
+
+  char buf[65536];
+  do {
+    peer.read_some(boost::asio::buffer(buf), ec);
+  } while (!ec);
+  EXPECT_EQ(boost::asio::error::connection_reset, ec);
+}
+
+TEST(ZeroCopySender, OrphanedSends)
+{
+  boost::asio::io_context context;
+  const auto localhost = boost::asio::ip::make_address("127.0.0.1");
+  tcp::acceptor acceptor{context, tcp::endpoint{localhost, 0}};
+  // a peer that never reads, with a window too small for the data
+  tcp::socket peer{context};
+  peer.open(tcp::v4());
+  peer.set_option(tcp::socket::receive_buffer_size(1));
+  peer.connect(acceptor.local_endpoint());
+  std::optional<tcp::socket> socket{acceptor.accept()};
+  socket->set_option(tcp::socket::send_buffer_size(1 << 20));
+
+  const size_t orphaned = ZeroCopySender::orphaned();
+  std::optional<ZeroCopySender> sender{*socket};
+  boost::system::error_code ec;
+  sender->enable(ec);
+  ASSERT_FALSE(ec) << ec.message();
+
+  auto bl = make_data(4, 16384);
+  boost::asio::spawn(context,
+    [&] (boost::asio::yield_context yield) {
+      EXPECT_EQ(bl.length(), sender->send(bl, yield, ec));
+      EXPECT_FALSE(ec) << ec.message();
+    }, [] (std::exception_ptr eptr) {
+      if (eptr) std::rethrow_exception(eptr);
+    });
+  context.run();
+  ASSERT_EQ(1u, sender->pending());
+
+  // destroyed and closed before the kernel reported on the send
+  sender.reset();
+  socket.reset();
+  EXPECT_EQ(orphaned + 1, ZeroCopySender::orphaned());
+
+  // the connection was reset, so the report comes in shortly
+  for (int i = 0; i < 100 && ZeroCopySender::orphaned() > orphaned; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ZeroCopySender::reap_orphans();
+  }
+  EXPECT_EQ(orphaned, ZeroCopySender::orphaned());
+
+  char buf[65536];
+  do {
+    peer.read_some(boost::asio::buffer(buf), ec);
+  } while (!ec);
+  EXPECT_EQ(boost::asio::error::connection_reset, ec);
+}
+
+} // namespace rgw::asio
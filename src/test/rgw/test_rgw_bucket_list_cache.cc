@@ -0,0 +1,142 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw_bucket_list_cache.h"
+#include <thread>
+#include <gtest/gtest.h>
+
+using namespace rgw::bucket_list;
+using namespace std::chrono_literals;
+
+static Key make_key(const std::string& bucket, const std::string& prefix = "")
+{
+  return Key{bucket, 0, -1, prefix, "/", false};
+}
+
+static ShardEntry make_entry(uint32_t pos, const std::string& name)
+{
+  ShardEntry e;
+  e.pos = pos;
+  e.name = name;
+  e.entry.key.name = name;
+  return e;
+}
+
+// two shards merged into a, b, c, d; e and f were read but not merged
+static Page make_page()
+{
+  Page page;
+  auto& s0 = page.shards[0];
+  s0.entries = {make_entry(0, "a"), make_entry(2, "c"),
+		make_entry(ShardEntry::UNMERGED, "e")};
+  s0.is_truncated = true;
+  auto& s1 = page.shards[1];
+  s1.entries = {make_entry(1, "b"), make_entry(3, "d"),
+		make_entry(ShardEntry::UNMERGED, "f")};
+  s1.is_truncated = false;
+  for (const auto& name : {"a", "b", "c", "d"}) {
+    page.markers.emplace(cls_rgw_obj_key{name}, page.markers.size());
+  }
+  return page;
+}
+
+TEST(BucketListCache, ResumeAfterMarker)
+{
+  Cache cache;
+  cache.insert(make_key("bucket"), make_page(), 4);
+  std::map<int, rgw_cls_list_ret> results;
+  ASSERT_TRUE(cache.take(make_key("bucket"), cls_rgw_obj_key{"b"}, 10s,
+			 results));
+  ASSERT_EQ(2u, results.size());
+  const auto& m0 = results[0].dir.m;
+  ASSERT_EQ(2u, m0.size());
+  EXPECT_EQ("c", m0.begin()->first);
+  EXPECT_EQ("e", std::next(m0.begin())->first);
+  EXPECT_TRUE(results[0].is_truncated);
+  const auto& m1 = results[1].dir.m;
+  ASSERT_EQ(2u, m1.size());
+  EXPECT_EQ("d", m1.begin()->first);
+  EXPECT_EQ("f", std::next(m1.begin())->first);
+  EXPECT_FALSE(results[1].is_truncated);
+}
+
+TEST(BucketListCache, ResumeAfterLastMerged)
+{
+  Cache cache;
+  cache.insert(make_key("bucket"), make_page(), 4);
+  std::map<int, rgw_cls_list_ret> results;
+  ASSERT_TRUE(cache.take(make_key("bucket"), cls_rgw_obj_key{"d"}, 10s,
+			 results));
+  ASSERT_EQ(1u, results[0].dir.m.size());
+  EXPECT_EQ("e", results[0].dir.m.begin()->first);
+  ASSERT_EQ(1u, results[1].dir.m.size());
+  EXPECT_EQ("f", results[1].dir.m.begin()->first);
+}
+
+TEST(BucketListCache, TakenOnce)
+{
+  Cache cache;
+  cache.insert(make_key("bucket"), make_page(), 4);
+  std::map<int, rgw_cls_list_ret> results;
+  EXPECT_TRUE(cache.take(make_key("bucket"), cls_rgw_obj_key{"a"}, 10s,
+			 results));
+  EXPECT_FALSE(cache.take(make_key("bucket"), cls_rgw_obj_key{"a"}, 10s,
+			  results));
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(BucketListCache, UnknownMarker)
+{
+  Cache cache;
+  cache.insert(make_key("bucket"), make_page(), 4);
+  std::map<int, rgw_cls_list_ret> results;
+  EXPECT_FALSE(cache.take(make_key("bucket"), cls_rgw_obj_key{"e"}, 10s,
+			  results));
+  EXPECT_EQ(1u, cache.size());
+}
+
+TEST(BucketListCache, DistinctListings)
+{
+  Cache cache;
+  cache.insert(make_key("bucket", "x"), make_page(), 4);
+  std::map<int, rgw_cls_list_ret> results;
+  EXPECT_FALSE(cache.take(make_key("bucket", "y"), cls_rgw_obj_key{"a"}, 10s,
+			  results));
+  EXPECT_FALSE(cache.take(make_key("other", "x"), cls_rgw_obj_key{"a"}, 10s,
+			  results));
+  EXPECT_TRUE(cache.take(make_key("bucket", "x"), cls_rgw_obj_key{"a"}, 10s,
+			 results));
+}
+
+TEST(BucketListCache, Expired)
+{
+  Cache cache;
+  cache.insert(make_key("bucket"), make_page(), 4);
+  std::this_thread::sleep_for(20ms);
+  std::map<int, rgw_cls_list_ret> results;
+  EXPECT_FALSE(cache.take(make_key("bucket"), cls_rgw_obj_key{"a"}, 1ms,
+			  results));
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(BucketListCache, Bounded)
+{
+  Cache cache;
+  for (int i = 0; i < 8; ++i) {
+    cache.insert(make_key(std::to_string(i)), make_page(), 4);
+  }
+  EXPECT_EQ(4u, cache.size());
+  std::map<int, rgw_cls_list_ret> results;
+  // the least recent pages were dropped
+  EXPECT_FALSE(cache.take(make_key("0"), cls_rgw_obj_key{"a"}, 10s, results));
+  EXPECT_TRUE(cache.take(make_key("7"), cls_rgw_obj_key{"a"}, 10s, results));
+}
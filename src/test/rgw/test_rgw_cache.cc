@@ -0,0 +1,168 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw_cache.h"
+#include "global/global_context.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#define dout_subsys ceph_subsys_rgw
+
+static constexpr size_t num_shards = 4;
+// two entries per shard
+static constexpr size_t lru_size = 2 * num_shards;
+
+// the first count names that fall in the given shard
+static std::vector<std::string> names_in_shard(size_t shard, size_t count)
+{
+  std::vector<std::string> names;
+  for (int i = 0; names.size() < count; i++) {
+    auto name = "obj" + std::to_string(i);
+    if (std::hash<std::string>{}(name) % num_shards == shard) {
+      names.push_back(std::move(name));
+    }
+  }
+  return names;
+}
+
+// counts the invalidations of its entries
+struct CountingCache : RGWChainedCache {
+  std::map<std::string, int> invalidated;
+  int invalidated_all = 0;
+
+  void chain_cb(const std::string& key, void *data) override {}
+  void invalidate(const std::string& key) override {
+    invalidated[key]++;
+  }
+  void invalidate_all() override {
+    invalidated_all++;
+  }
+};
+
+class ObjectCacheTest : public ::testing::Test {
+ protected:
+  const DoutPrefix dp{g_ceph_context, dout_subsys, "test rgw cache: "};
+  ObjectCache cache;
+
+  void SetUp() override {
+    auto& conf = g_ceph_context->_conf;
+    ASSERT_EQ(0, conf.set_val("rgw_cache_shards", std::to_string(num_shards)));
+    ASSERT_EQ(0, conf.set_val("rgw_cache_lru_size", std::to_string(lru_size)));
+    ASSERT_EQ(0, conf.set_val("rgw_cache_expiry_interval", "0"));
+    cache.set_ctx(g_ceph_context);
+    cache.set_enabled(true);
+  }
+
+  void put(const std::string& name, rgw_cache_entry_info* cache_info = nullptr) {
+    ObjectCacheInfo info;
+    info.flags = CACHE_FLAG_DATA;
+    info.data.append(name);
+    cache.put(&dp, name, info, cache_info);
+  }
+  bool cached(const std::string& name) {
+    return cache.get(&dp, name).has_value();
+  }
+};
+
+TEST_F(ObjectCacheTest, LruIsPerShard)
+{
+  const auto a = names_in_shard(0, 6);
+  const auto b = names_in_shard(1, 1);
+
+  put(b[0]);
+  for (const auto& name : a) {
+    put(name);
+  }
+  // filling shard 0 evicts its oldest entries only
+  EXPECT_FALSE(cached(a[0]));
+  EXPECT_FALSE(cached(a[1]));
+  EXPECT_TRUE(cached(a.back()));
+  EXPECT_TRUE(cached(b[0]));
+}
+
+TEST_F(ObjectCacheTest, GetKeepsEntryInLru)
+{
+  const auto a = names_in_shard(2, 5);
+
+  put(a[0]);
+  put(a[1]);
+  put(a[2]);
+  // promote a[0] past the lru window, so a[1] is evicted in its place
+  ASSERT_TRUE(cached(a[0]));
+  put(a[3]);
+  put(a[4]);
+  EXPECT_TRUE(cached(a[0]));
+  EXPECT_FALSE(cached(a[1]));
+}
+
+TEST_F(ObjectCacheTest, InvalidateRemove)
+{
+  const auto a = names_in_shard(0, 2);
+  const auto b = names_in_shard(3, 1);
+
+  CountingCache chained;
+  cache.chain_cache(&chained);
+
+  rgw_cache_entry_info info0, info1;
+  put(a[0], &info0);
+  put(b[0], &info1);
+  put(a[1]);
+  // chain an entry to objects in two shards
+  const std::string key = "chained";
+  RGWChainedCache::Entry entry{&chained, key, nullptr};
+  ASSERT_TRUE(cache.chain_cache_entry(&dp, {&info0, &info1}, &entry));
+
+  EXPECT_TRUE(cache.invalidate_remove(&dp, b[0]));
+  EXPECT_FALSE(cache.invalidate_remove(&dp, b[0]));
+  EXPECT_EQ(1, chained.invalidated[key]);
+  EXPECT_FALSE(cached(b[0]));
+  EXPECT_TRUE(cached(a[0]));
+  EXPECT_TRUE(cached(a[1]));
+  // b[0] is gone, so nothing can be chained to it
+  EXPECT_FALSE(cache.chain_cache_entry(&dp, {&info0, &info1}, &entry));
+
+  cache.unchain_cache(&chained);
+}
+
+TEST_F(ObjectCacheTest, InvalidateAll)
+{
+  std::vector<std::string> names;
+  for (size_t shard = 0; shard < num_shards; shard++) {
+    names.push_back(names_in_shard(shard, 1)[0]);
+    put(names.back());
+  }
+  CountingCache chained;
+  cache.chain_cache(&chained);
+
+  cache.invalidate_all();
+  EXPECT_EQ(1, chained.invalidated_all);
+  for (const auto& name : names) {
+    EXPECT_FALSE(cached(name));
+  }
+
+  // disabling invalidates too, and nothing is cached until enabled again
+  put(names[0]);
+  cache.set_enabled(false);
+  EXPECT_EQ(2, chained.invalidated_all);
+  put(names[0]);
+  EXPECT_FALSE(cached(names[0]));
+  cache.set_enabled(true);
+  EXPECT_FALSE(cached(names[0]));
+  put(names[0]);
+  EXPECT_TRUE(cached(names[0]));
+
+  cache.unchain_cache(&chained);
+}
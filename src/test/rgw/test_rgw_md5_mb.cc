@@ -0,0 +1,161 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw_md5_mb.h"
+#include "rgw_hex.h"
+#include "common/ceph_crypto.h"
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <gtest/gtest.h>
+
+using rgw::md5_mb::Digest;
+using rgw::md5_mb::Hasher;
+
+static std::string hex(const std::string& etag)
+{
+  char str[CEPH_CRYPTO_MD5_DIGESTSIZE * 2 + 1];
+  buf_to_hex(reinterpret_cast<const unsigned char*>(etag.data()), etag.size(), str);
+  return str;
+}
+
+static std::string md5_of(const std::string& data)
+{
+  ceph::crypto::MD5 md5;
+  md5.Update(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+  unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
+  md5.Final(m);
+  return std::string(reinterpret_cast<char*>(m), sizeof(m));
+}
+
+// hashes the given streams at once, in chunks of up to max_chunk bytes made
+// of buffers of up to max_buffer bytes
+static std::vector<std::string> hash_all(const std::vector<std::string>& data,
+					 size_t max_chunk, size_t max_buffer)
+{
+  std::mt19937 rng{42};
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t done = 0;
+  std::vector<Digest> digests(data.size());
+  std::vector<size_t> offsets(data.size(), 0);
+  std::vector<std::string> etags(data.size(),
+				 std::string(CEPH_CRYPTO_MD5_DIGESTSIZE, '\0'));
+
+  Hasher hasher;
+  // each callback submits the next chunk of its stream
+  std::function<void(size_t)> next = [&] (size_t i) {
+    std::unique_lock lock{mutex};
+    const size_t offset = offsets[i];
+    const size_t chunk = std::min<size_t>(1 + rng() % max_chunk,
+					  data[i].size() - offset);
+    bufferlist bl;
+    for (size_t pos = 0; pos < chunk; ) {
+      const size_t len = std::min<size_t>(1 + rng() % max_buffer, chunk - pos);
+      bl.append(data[i].data() + offset + pos, len);
+      pos += len;
+    }
+    offsets[i] += chunk;
+    lock.unlock();
+
+    if (chunk > 0) {
+      hasher.update(digests[i], std::move(bl), [&, i] { next(i); });
+    } else {
+      auto out = reinterpret_cast<unsigned char*>(etags[i].data());
+      hasher.final(digests[i], out, [&] {
+	  std::lock_guard lock{mutex};
+	  ++done;
+	  cond.notify_one();
+	});
+    }
+  };
+  for (size_t i = 0; i < data.size(); ++i) {
+    next(i);
+  }
+  std::unique_lock lock{mutex};
+  cond.wait(lock, [&] { return done == data.size(); });
+  return etags;
+}
+
+TEST(MD5_MB, Known)
+{
+  const std::vector<std::string> data = {"", "abc",
+    "12345678901234567890123456789012345678901234567890123456789012345678901234567890"};
+  const auto etags = hash_all(data, 7, 3);
+  ASSERT_EQ(3u, etags.size());
+  EXPECT_EQ("d41d8cd98f00b204e9800998ecf8427e", hex(etags[0]));
+  EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", hex(etags[1]));
+  EXPECT_EQ("57edf4a22be3c955ac49da2e2107b67a", hex(etags[2]));
+}
+
+TEST(MD5_MB, ManyStreams)
+{
+  // more streams than lanes, of lengths around the block and padding sizes
+  std::mt19937 rng{7};
+  std::vector<std::string> data;
+  for (size_t i = 0; i < 40; ++i) {
+    const size_t len = i < 8 ? 55 + i : rng() % 200000;
+    std::string s(len, '\0');
+    for (auto& c : s) {
+      c = rng();
+    }
+    data.push_back(std::move(s));
+  }
+  const auto etags = hash_all(data, 70000, 5000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(md5_of(data[i]), etags[i]) << "stream " << i;
+  }
+}
+
+TEST(MD5_MB, SmallBuffers)
+{
+  // buffers shorter than a block go through the digest's partial block
+  std::vector<std::string> data;
+  for (size_t i = 0; i < 20; ++i) {
+    data.emplace_back(1000 + i * 100, 'a' + i);
+  }
+  const auto etags = hash_all(data, 300, 13);
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(md5_of(data[i]), etags[i]) << "stream " << i;
+  }
+}
+
+TEST(MD5_MB, HashBlocks)
+{
+  // the lanes of the SIMD kernel hash as the scalar one does
+  const unsigned lanes = Hasher::lanes();
+  constexpr size_t blocks = 5;
+  std::mt19937 rng{3};
+  std::vector<unsigned char> data(lanes * blocks * 64);
+  for (auto& c : data) {
+    c = rng();
+  }
+  std::vector<uint32_t> simd(lanes * 4), scalar(lanes * 4);
+  for (size_t i = 0; i < simd.size(); ++i) {
+    simd[i] = scalar[i] = rng();
+  }
+  std::vector<uint32_t*> simd_state, scalar_state;
+  std::vector<const unsigned char*> blocks_of;
+  for (unsigned l = 0; l < lanes; ++l) {
+    simd_state.push_back(&simd[l * 4]);
+    scalar_state.push_back(&scalar[l * 4]);
+    blocks_of.push_back(&data[l * blocks * 64]);
+  }
+  rgw::md5_mb::hash_blocks(lanes, simd_state.data(), blocks_of.data(), blocks);
+  for (unsigned l = 0; l < lanes; ++l) {
+    rgw::md5_mb::hash_blocks(1, &scalar_state[l], &blocks_of[l], blocks);
+  }
+  EXPECT_EQ(scalar, simd);
+}
@@ -13,6 +13,10 @@
  */
 
 #include "rgw_putobj.h"
+#include "rgw_putobj_hash.h"
+#include <array>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
 #include <gtest/gtest.h>
 
 inline bufferlist string_buf(const char* buf) {
@@ -194,3 +198,107 @@ TEST(PutObj_Stripe, SkipFirstChunk)
   ASSERT_EQ(4u, mock.ops.size());
   EXPECT_EQ(Op({"", 4}), mock.ops[3]); // flush
 }
+
+// the data of the hash tests, in chunks of different sizes
+static std::vector<std::string> hash_chunks()
+{
+  std::vector<std::string> chunks;
+  for (size_t i = 1; i <= 64; ++i) {
+    chunks.emplace_back(i * 37, 'a' + i % 26);
+  }
+  return chunks;
+}
+
+static std::string md5_of(const std::vector<std::string>& chunks)
+{
+  ceph::crypto::MD5 md5;
+  for (const auto& chunk : chunks) {
+    md5.Update(reinterpret_cast<const unsigned char*>(chunk.data()), chunk.size());
+  }
+  unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
+  md5.Final(m);
+  return std::string(reinterpret_cast<char*>(m), sizeof(m));
+}
+
+static void put_hashed(const std::vector<std::string>& chunks,
+		       rgw::putobj::HashPipe& pipe, MockProcessor& mock)
+{
+  uint64_t offset = 0;
+  for (const auto& chunk : chunks) {
+    bufferlist bl;
+    bl.append(chunk);
+    ASSERT_EQ(0, pipe.process(std::move(bl), offset));
+    offset += chunk.size();
+  }
+  ASSERT_EQ(0, pipe.process({}, offset));
+  pipe.drain();
+  ASSERT_EQ(chunks.size() + 1, mock.ops.size());
+  EXPECT_EQ(Op({"", offset}), mock.ops.back()); // flush
+}
+
+TEST(PutObj_Hash, Blocking)
+{
+  const auto chunks = hash_chunks();
+  rgw::putobj::HashPool pool(2, false);
+  MockProcessor mock;
+  ceph::crypto::MD5 md5;
+  // a small window to wait on the hashing
+  rgw::putobj::HashPipe pipe(&mock, pool, null_yield, &md5, nullptr, 100);
+  put_hashed(chunks, pipe, mock);
+
+  unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
+  md5.Final(m);
+  EXPECT_EQ(md5_of(chunks), std::string(reinterpret_cast<char*>(m), sizeof(m)));
+}
+
+TEST(PutObj_Hash, Yielding)
+{
+  const auto chunks = hash_chunks();
+  rgw::putobj::HashPool pool(2, false);
+  ceph::crypto::MD5 md5;
+
+  boost::asio::io_context context;
+  boost::asio::spawn(context,
+    [&] (boost::asio::yield_context yield) {
+      MockProcessor mock;
+      rgw::putobj::HashPipe pipe(&mock, pool, yield, &md5, nullptr, 100);
+      put_hashed(chunks, pipe, mock);
+    }, [] (std::exception_ptr eptr) {
+      if (eptr) std::rethrow_exception(eptr);
+    });
+  context.run();
+
+  unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
+  md5.Final(m);
+  EXPECT_EQ(md5_of(chunks), std::string(reinterpret_cast<char*>(m), sizeof(m)));
+}
+
+TEST(PutObj_Hash, MultiBuffer)
+{
+  const auto chunks = hash_chunks();
+  rgw::putobj::HashPool pool(1, true);
+  constexpr size_t uploads = 20;
+  std::array<std::string, uploads> etags;
+
+  // concurrent uploads share the lanes of the hasher
+  boost::asio::io_context context;
+  for (size_t i = 0; i < uploads; ++i) {
+    boost::asio::spawn(context,
+      [&, i] (boost::asio::yield_context yield) {
+        MockProcessor mock;
+        ceph::crypto::MD5 md5;
+        rgw::putobj::HashPipe pipe(&mock, pool, yield, &md5, nullptr, 1000);
+        put_hashed(chunks, pipe, mock);
+        unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
+        pipe.final_md5(m);
+        etags[i].assign(reinterpret_cast<char*>(m), sizeof(m));
+      }, [] (std::exception_ptr eptr) {
+        if (eptr) std::rethrow_exception(eptr);
+      });
+  }
+  context.run();
+
+  for (const auto& etag : etags) {
+    EXPECT_EQ(md5_of(chunks), etag);
+  }
+}
@@ -13,6 +13,7 @@
  */
 
 #include "rgw_aio_throttle.h"
+#include "rgw_hedged_read.h"
 
 #include <optional>
 #include <thread>
@@ -193,4 +194,146 @@ TEST(Aio_Throttle, YieldingThrottleOverMax)
   EXPECT_EQ(window, max_outstanding);
 }
 
+TEST(Aio_Throttle, SetWindow)
+{
+  BlockingAioThrottle throttle(2);
+  auto obj = make_obj(__PRETTY_FUNCTION__);
+  {
+    scoped_completion op1;
+    auto c1 = throttle.get(obj, wait_on(op1), 1, 0);
+    scoped_completion op2;
+    auto c2 = throttle.get(obj, wait_on(op2), 1, 0);
+    // a wider window takes more ops without waiting
+    throttle.set_window(4);
+    scoped_completion op3;
+    auto c3 = throttle.get(obj, wait_on(op3), 1, 0);
+    EXPECT_TRUE(c3.empty());
+    // and a narrower one rejects what no longer fits
+    throttle.set_window(1);
+    scoped_completion op4;
+    auto c4 = throttle.get(obj, wait_on(op4), 2, 0);
+    ASSERT_EQ(1u, c4.size());
+    EXPECT_EQ(-EDEADLK, c4.front().result);
+  }
+  auto completions = throttle.drain();
+  ASSERT_EQ(3u, completions.size());
+  for (auto& c : completions) {
+    EXPECT_LE(ceph::timespan::zero(), c.latency);
+  }
+}
+
+TEST(Aio_AdaptiveWindow, FastClient)
+{
+  using namespace std::chrono_literals;
+  AdaptiveWindow window(16, 1024);
+  EXPECT_EQ(16u, window.get());
+  EXPECT_EQ(ceph::timespan::zero(), window.get_latency());
+  // without a measure of the client, the window doubles with each read
+  window.add_read(10ms);
+  EXPECT_EQ(32u, window.get());
+  window.add_read(10ms);
+  EXPECT_EQ(64u, window.get());
+  for (int i = 0; i < 10; i++) {
+    window.add_read(10ms);
+  }
+  EXPECT_EQ(1024u, window.get());
+  EXPECT_EQ(10ms, std::chrono::round<std::chrono::milliseconds>(window.get_latency()));
+}
+
+TEST(Aio_AdaptiveWindow, SlowClient)
+{
+  using namespace std::chrono_literals;
+  AdaptiveWindow window(16, 1024);
+  for (int i = 0; i < 10; i++) {
+    window.add_read(100ms);
+  }
+  EXPECT_EQ(1024u, window.get());
+  // a client taking 1000 bytes a second needs twice 100 bytes in flight
+  for (int i = 0; i < 50; i++) {
+    window.add_client(100, 100ms);
+  }
+  EXPECT_NEAR(200, window.get(), 10);
+  // and a slower one, no less than min
+  for (int i = 0; i < 50; i++) {
+    window.add_client(1, 1s);
+  }
+  EXPECT_EQ(16u, window.get());
+}
+
+// a read that replies after the given delay, or the hedge after another
+auto delayed_read(boost::asio::io_context& context, ceph::timespan delay,
+                  ceph::timespan hedge_delay, std::string data, int& reads)
+{
+  using Clock = ceph::coarse_mono_clock;
+  using Timer = boost::asio::basic_waitable_timer<Clock>;
+  return [&context, delay, hedge_delay, data, &reads] (bool hedge, auto cb) {
+    ++reads;
+    auto t = std::make_unique<Timer>(context);
+    t->expires_after(hedge ? hedge_delay : delay);
+    t->async_wait([t=std::move(t), cb=std::move(cb), data] (boost::system::error_code) mutable {
+        bufferlist bl;
+        bl.append(data);
+        cb(boost::system::error_code{}, std::move(bl));
+      });
+  };
+}
+
+TEST(Aio_HedgedRead, NoHedge)
+{
+  using namespace std::chrono_literals;
+  boost::asio::io_context context;
+  int reads = 0;
+  std::optional<bool> hedged;
+  async_hedged_read(context.get_executor(), 100ms,
+      delayed_read(context, 1ms, 1ms, "primary", reads),
+      [&] (boost::system::error_code ec, bufferlist bl, bool h, bool won) {
+        EXPECT_FALSE(ec);
+        EXPECT_EQ("primary", bl.to_str());
+        EXPECT_FALSE(won);
+        hedged = h;
+      });
+  context.run();
+  ASSERT_TRUE(hedged);
+  EXPECT_FALSE(*hedged);
+  EXPECT_EQ(1, reads);
+}
+
+TEST(Aio_HedgedRead, HedgeWins)
+{
+  using namespace std::chrono_literals;
+  boost::asio::io_context context;
+  int reads = 0;
+  int replies = 0;
+  async_hedged_read(context.get_executor(), 10ms,
+      delayed_read(context, 500ms, 1ms, "", reads),
+      [&] (boost::system::error_code ec, bufferlist bl, bool hedged, bool won) {
+        EXPECT_FALSE(ec);
+        EXPECT_TRUE(hedged);
+        EXPECT_TRUE(won);
+        ++replies;
+      });
+  context.run();
+  EXPECT_EQ(2, reads);
+  // the late reply of the first read is dropped
+  EXPECT_EQ(1, replies);
+}
+
+TEST(Aio_HedgedRead, PrimaryWins)
+{
+  using namespace std::chrono_literals;
+  boost::asio::io_context context;
+  int reads = 0;
+  int replies = 0;
+  async_hedged_read(context.get_executor(), 10ms,
+      delayed_read(context, 50ms, 500ms, "", reads),
+      [&] (boost::system::error_code ec, bufferlist bl, bool hedged, bool won) {
+        EXPECT_TRUE(hedged);
+        EXPECT_FALSE(won);
+        ++replies;
+      });
+  context.run();
+  EXPECT_EQ(2, reads);
+  EXPECT_EQ(1, replies);
+}
+
 } // namespace rgw